@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+
+#include "core/Camera.h"
+#include "core/PointLightSource.h"
+#include "core/RangeAllocator.h"
+#include "core/Scene.h"
+#include "physically_based/BRDFCoefficients.h"
+#include "physically_based/PhysicallyBasedMaterial.h"
+#include "physically_based/PhysicallyBasedSceneObject.h"
+#include "physically_based/PhysicallyBasedShaderUniforms.h"
+#include "scene_objects/CustomObject.h"
+
+namespace fs = std::filesystem;
+
+using namespace PBR;
+using namespace PBR::physically_based;
+using namespace PBR::scene_objects;
+
+namespace {
+
+/**
+ * The number of calls to `operator new` made by this process so far.
+ */
+std::atomic<size_t> allocationCount(0);
+
+/**
+ * The number of bytes requested from `operator new` so far.
+ */
+std::atomic<size_t> allocatedBytes(0);
+
+} // anonymous namespace
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+namespace {
+
+/**
+ * Counts the allocations made while a benchmark is running, and reports them
+ * per iteration alongside its timings. Only the timed loop is counted, so
+ * setup done before it is ignored.
+ */
+class AllocationCounter {
+private:
+    benchmark::State& state;
+    size_t startCount;
+    size_t startBytes;
+
+public:
+    explicit AllocationCounter(benchmark::State& state)
+            :state(state),
+             startCount(allocationCount.load()),
+             startBytes(allocatedBytes.load())
+    {
+    }
+
+    ~AllocationCounter()
+    {
+        auto perIteration = benchmark::Counter::kAvgIterations;
+        state.counters["allocs"] = benchmark::Counter((double) (allocationCount.load() - startCount), perIteration);
+        state.counters["bytes"] = benchmark::Counter((double) (allocatedBytes.load() - startBytes), perIteration);
+    }
+};
+
+/**
+ * A material for the objects in the scene benchmarks. Its values don't affect any timings.
+ */
+PhysicallyBasedMaterial makeMaterial()
+{
+    return PhysicallyBasedMaterial{glm::vec3(0.8f), 0.5f, 0.0f, glm::vec3(0.04f)};
+}
+
+/**
+ * Makes objects scattered around the origin. They have no vertex data, since
+ * none of the benchmarks draw them.
+ */
+std::vector<std::shared_ptr<PhysicallyBasedSceneObject>> makeObjects(size_t count)
+{
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+    std::vector<std::shared_ptr<PhysicallyBasedSceneObject>> objects;
+    objects.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 position(distribution(generator), distribution(generator), distribution(generator));
+        glm::vec3 orientation(distribution(generator), distribution(generator), distribution(generator));
+        objects.push_back(std::make_shared<PhysicallyBasedSceneObject>(position, orientation, glm::vec3(1.0f),
+                                                                       makeMaterial(), nullptr));
+    }
+    return objects;
+}
+
+std::vector<PointLightSource> makeLights(size_t count)
+{
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+    std::vector<PointLightSource> lights;
+    lights.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 position(distribution(generator), distribution(generator), distribution(generator));
+        lights.push_back(PointLightSource{position, glm::vec3(1.0f), 10.0f});
+    }
+    return lights;
+}
+
+/**
+ * Makes distinct vertices with a position, normal and texcoord, as the hasher
+ * sees once for each vertex of a loaded mesh.
+ */
+std::vector<vertex_data_t> makeVertices(size_t count)
+{
+    std::mt19937 generator(13);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    std::vector<vertex_data_t> vertices;
+    vertices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 position(distribution(generator), distribution(generator), distribution(generator));
+        glm::vec2 texcoord(distribution(generator), distribution(generator));
+        vertices.push_back(vertex_data_t{position, glm::normalize(position), texcoord});
+    }
+    return vertices;
+}
+
+void BM_ReadObjFile(benchmark::State& state, const fs::path& objPath)
+{
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    {
+        AllocationCounter counter(state);
+        for (auto _ : state) {
+            ObjMeshData meshData = readObjFile(objPath, false);
+            vertexCount = meshData.vertexData->size() / 6;
+            indexCount = meshData.indices->size();
+            benchmark::DoNotOptimize(meshData);
+        }
+    }
+    state.counters["vertices"] = (double) vertexCount;
+    state.counters["indices"] = (double) indexCount;
+    state.SetBytesProcessed((int64_t) (state.iterations() * fs::file_size(objPath)));
+}
+
+void BM_VertexDataHasher(benchmark::State& state)
+{
+    std::vector<vertex_data_t> vertices = makeVertices((size_t) state.range(0));
+    VertexDataHasher hasher;
+
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        for (const auto& vertex : vertices) {
+            benchmark::DoNotOptimize(hasher(vertex));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_VertexDataHasher)->RangeMultiplier(8)->Range(512, 1 << 18);
+
+/**
+ * Frees and reallocates random meshes' ranges in a full `RangeAllocator`, the
+ * way `MeshArena` does when meshes are loaded and unloaded.
+ */
+void BM_RangeAllocatorChurn(benchmark::State& state)
+{
+    size_t rangesCount = (size_t) state.range(0);
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> sizeDistribution(24, 4096);
+    std::vector<size_t> sizes(rangesCount);
+    for (size_t& size : sizes) {
+        size = sizeDistribution(generator);
+    }
+
+    // Enough space for every range, plus some slack
+    RangeAllocator allocator(rangesCount * 4096 * 2);
+    std::vector<size_t> offsets(rangesCount);
+    for (size_t i = 0; i < rangesCount; i++) {
+        offsets[i] = *allocator.allocate(sizes[i]);
+    }
+
+    std::uniform_int_distribution<size_t> indexDistribution(0, rangesCount - 1);
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        size_t i = indexDistribution(generator);
+        allocator.free(offsets[i], sizes[i]);
+        offsets[i] = *allocator.allocate(sizes[i]);
+        benchmark::DoNotOptimize(offsets[i]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RangeAllocatorChurn)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+void BM_SceneObjectGetModelMatrix(benchmark::State& state)
+{
+    auto objects = makeObjects((size_t) state.range(0));
+
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        for (const auto& object : objects) {
+            benchmark::DoNotOptimize(object->getModelMatrix());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SceneObjectGetModelMatrix)->RangeMultiplier(8)->Range(1, 4096);
+
+void BM_CameraGetViewMatrix(benchmark::State& state)
+{
+    Camera camera(glm::vec3(0.0f, 1.0f, 5.0f), 16.0f / 9.0f);
+
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(camera.getViewMatrix());
+    }
+}
+BENCHMARK(BM_CameraGetViewMatrix);
+
+void BM_SceneConstruction(benchmark::State& state)
+{
+    auto objects = makeObjects((size_t) state.range(0));
+    auto lights = makeLights((size_t) state.range(1));
+
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        Scene<PhysicallyBasedSceneObject> scene(objects, lights);
+        benchmark::DoNotOptimize(scene);
+    }
+}
+BENCHMARK(BM_SceneConstruction)->ArgsProduct({{1, 64, 4096}, {1, 16, 256, 4096}});
+
+/**
+ * Packs the uniforms of every object in a scene the way `DrawPacketBuilder`
+ * does each frame, on a single thread.
+ */
+void BM_PackObjectUniforms(benchmark::State& state)
+{
+    Scene<PhysicallyBasedSceneObject> scene(makeObjects((size_t) state.range(0)), makeLights(1));
+    std::vector<PhysicallyBasedObjectUniforms> uniforms(scene.getSceneObjectsList().size());
+
+    AllocationCounter counter(state);
+    for (auto _ : state) {
+        const auto& objects = scene.getSceneObjectsList();
+        for (size_t i = 0; i < objects.size(); i++) {
+            uniforms[i] = packObjectUniforms(objects[i]->getModelMatrix(), objects[i]->getRotationMatrix(),
+                                             objects[i]->material, 0);
+        }
+        benchmark::DoNotOptimize(uniforms.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PackObjectUniforms)->RangeMultiplier(8)->Range(1, 1 << 16);
+
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    // Register a case for every model, so that new ones are picked up and the
+    // cases cover a range of mesh sizes
+    fs::path modelsPath = fs::current_path() / "example" / "resources" / "models";
+    if (fs::is_directory(modelsPath)) {
+        std::vector<fs::path> models;
+        for (const auto& entry : fs::directory_iterator(modelsPath)) {
+            if (entry.path().extension() == ".obj") {
+                models.push_back(entry.path());
+            }
+        }
+        std::sort(models.begin(), models.end());
+        for (const auto& model : models) {
+            benchmark::RegisterBenchmark(("BM_ReadObjFile/" + model.stem().string()).c_str(), BM_ReadObjFile, model)
+                    ->Unit(benchmark::kMillisecond);
+        }
+    }
+    else {
+        std::cerr << "Couldn't find " << modelsPath << ", so the .obj loading benchmarks are skipped. "
+                  << "Run from the root of the repository to include them." << std::endl;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
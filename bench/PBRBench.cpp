@@ -0,0 +1,441 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <PBR/PBR.h>
+
+#include "ExampleScenes.h"
+
+using namespace PBR;
+using namespace PBR::phong;
+using namespace PBR::physically_based;
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The options that every scene is run with.
+ */
+struct BenchmarkOptions {
+    unsigned int frames = 600;
+    float timestep = 1.0f / 60.0f;
+};
+
+/**
+ * The measurements taken for one scene.
+ */
+struct BenchmarkResult {
+    std::string scene;
+
+    /**
+     * The time to compile the renderer's shaders and load the scene, including
+     * any precomputation that the scene does before its constructor returns.
+     */
+    double startupMilliseconds;
+
+    /**
+     * The time from starting to load the scene until every precomputed map is at
+     * full quality, or nothing if the scene has no maps or they weren't finished
+     * by the last frame.
+     */
+    std::optional<double> bakeMilliseconds;
+
+    /**
+     * The time each frame took, including waiting for the GPU to finish it.
+     */
+    std::vector<double> frameMilliseconds;
+};
+
+/**
+ * One part of the camera path: the keys held down, and for how long.
+ */
+struct CameraPathSegment {
+    std::vector<int> keys;
+    float seconds;
+};
+
+/**
+ * The camera path that every scene is rendered along. It starts from the
+ * driver's default position, looking at the origin, and loops if there are
+ * more frames than it lasts for.
+ */
+const std::vector<CameraPathSegment>& cameraPath()
+{
+    static std::vector<CameraPathSegment> path{
+            {{}, 1.0f},
+            {{GLFW_KEY_W}, 1.5f},
+            {{GLFW_KEY_A, GLFW_KEY_RIGHT}, 2.0f},
+            {{GLFW_KEY_S}, 1.5f},
+            {{GLFW_KEY_D, GLFW_KEY_LEFT}, 2.0f},
+            {{GLFW_KEY_R, GLFW_KEY_DOWN}, 1.0f},
+            {{GLFW_KEY_F, GLFW_KEY_UP}, 1.0f},
+    };
+    return path;
+}
+
+/**
+ * Replays the camera path through a driver's keyboard handling, so that the
+ * camera moves exactly as it would if someone pressed the same keys.
+ */
+template<class SceneType>
+class CameraPathPlayer {
+private:
+    RendererDriver<SceneType>& driver;
+    std::optional<size_t> currentSegment;
+
+public:
+    explicit CameraPathPlayer(RendererDriver<SceneType>& driver)
+            :driver(driver),
+             currentSegment()
+    {
+    }
+
+    /**
+     * Presses and releases keys to match the segment of the path at a time.
+     */
+    void seek(float time)
+    {
+        const auto& path = cameraPath();
+        float duration = 0.0f;
+        for (const auto& segment : path) {
+            duration += segment.seconds;
+        }
+
+        float timeInPath = std::fmod(time, duration);
+        size_t segment = 0;
+        while (segment + 1 < path.size() && timeInPath >= path[segment].seconds) {
+            timeInPath -= path[segment].seconds;
+            segment++;
+        }
+
+        if (currentSegment == segment) {
+            return;
+        }
+        if (currentSegment) {
+            for (int key : path[*currentSegment].keys) {
+                driver.onKeyboardEvent(key, 0, GLFW_RELEASE, 0);
+            }
+        }
+        for (int key : path[segment].keys) {
+            driver.onKeyboardEvent(key, 0, GLFW_PRESS, 0);
+        }
+        currentSegment = segment;
+    }
+};
+
+double millisecondsSince(Clock::time_point startTime)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+}
+
+/**
+ * Loads a scene, then renders it along the camera path with a fixed timestep,
+ * timing each frame.
+ */
+template<class SceneType>
+BenchmarkResult runScene(const std::string& name, Window& window, const BenchmarkOptions& options,
+                         const std::function<std::shared_ptr<Renderer<SceneType>>()>& makeRenderer,
+                         const std::function<std::shared_ptr<SceneType>()>& loadScene)
+{
+    BenchmarkResult result{name, 0.0, std::nullopt, {}};
+    std::shared_ptr<BackgroundBaker> backgroundBaker = window.getBackgroundBaker();
+
+    glFinish();
+    auto startTime = Clock::now();
+    std::shared_ptr<Renderer<SceneType>> renderer = makeRenderer();
+    std::shared_ptr<SceneType> scene = loadScene();
+    glFinish();
+    result.startupMilliseconds = millisecondsSince(startTime);
+
+    glm::vec3 backgroundColour = scene->getBackgroundColour();
+    glClearColor(backgroundColour.r, backgroundColour.g, backgroundColour.b, 1.0f);
+
+    RendererDriver<SceneType> driver(renderer, window.getAspectRatio(), scene);
+    CameraPathPlayer<SceneType> cameraPathPlayer(driver);
+
+    for (unsigned int frame = 0; frame < options.frames; frame++) {
+        auto frameStartTime = Clock::now();
+        float time = (float) frame * options.timestep;
+
+        backgroundBaker->poll();
+        cameraPathPlayer.seek(time);
+        driver.update(options.timestep);
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        driver.render(time);
+        window.swapBuffers();
+
+        // Without vsync the driver can queue up several frames, so wait for this
+        // one to finish to charge it its GPU time
+        glFinish();
+        result.frameMilliseconds.push_back(millisecondsSince(frameStartTime));
+
+        if constexpr (std::is_same_v<SceneType, PhysicallyBasedScene>) {
+            if (!result.bakeMilliseconds && scene->isPrecomputationComplete()) {
+                result.bakeMilliseconds = millisecondsSince(startTime);
+            }
+        }
+    }
+
+    // Don't let the next scene's first frames pay for finishing this one's bakes
+    while (backgroundBaker->pendingJobs() > 0) {
+        backgroundBaker->poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return result;
+}
+
+/**
+ * @return The value below which the given fraction of the sorted values lie,
+ *         using the nearest-rank method
+ */
+double percentile(const std::vector<double>& sortedValues, double fraction)
+{
+    if (sortedValues.empty()) {
+        return 0.0;
+    }
+    auto rank = (size_t) std::ceil(fraction * (double) sortedValues.size());
+    return sortedValues[std::clamp(rank, (size_t) 1, sortedValues.size()) - 1];
+}
+
+/**
+ * Writes a string as a JSON string literal.
+ */
+std::string jsonString(const std::string& string)
+{
+    std::string escaped = "\"";
+    for (char c : string) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+/**
+ * Writes the results as JSON, with the frame times summarised as percentiles.
+ */
+void writeResults(std::ostream& stream, const std::vector<BenchmarkResult>& results, const BenchmarkOptions& options)
+{
+    stream << "{\n"
+           << "  \"openglVersion\": " << jsonString((const char*) glGetString(GL_VERSION)) << ",\n"
+           << "  \"openglRenderer\": " << jsonString((const char*) glGetString(GL_RENDERER)) << ",\n"
+           << "  \"frames\": " << options.frames << ",\n"
+           << "  \"timestep\": " << options.timestep << ",\n"
+           << "  \"scenes\": [";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        std::vector<double> sortedFrameTimes = result.frameMilliseconds;
+        std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+        double totalFrameTime = 0.0;
+        for (double frameTime : sortedFrameTimes) {
+            totalFrameTime += frameTime;
+        }
+        double mean = sortedFrameTimes.empty() ? 0.0 : totalFrameTime / (double) sortedFrameTimes.size();
+
+        stream << (i == 0 ? "" : ",") << "\n    {\n"
+               << "      \"name\": " << jsonString(result.scene) << ",\n"
+               << "      \"startupMilliseconds\": " << result.startupMilliseconds << ",\n"
+               << "      \"bakeMilliseconds\": ";
+        if (result.bakeMilliseconds) {
+            stream << *result.bakeMilliseconds;
+        }
+        else {
+            stream << "null";
+        }
+        stream << ",\n"
+               << "      \"frameMilliseconds\": {"
+               << "\"mean\": " << mean
+               << ", \"p50\": " << percentile(sortedFrameTimes, 0.50)
+               << ", \"p95\": " << percentile(sortedFrameTimes, 0.95)
+               << ", \"p99\": " << percentile(sortedFrameTimes, 0.99)
+               << ", \"max\": " << (sortedFrameTimes.empty() ? 0.0 : sortedFrameTimes.back()) << "}\n"
+               << "    }";
+    }
+
+    stream << "\n  ]\n}" << std::endl;
+}
+
+void printUsage(std::ostream& stream, const std::vector<std::string>& sceneNames)
+{
+    stream << "Usage: PBRBench [--frames N] [--size WIDTH HEIGHT] [--scene NAME ...] [--output PATH] [--visible]"
+           << std::endl
+           << "Renders each example scene along a scripted camera path with a fixed timestep" << std::endl
+           << "and vsync off, and reports the startup time, bake time and frame time" << std::endl
+           << "percentiles as JSON. The scenes are:";
+    for (const auto& name : sceneNames) {
+        stream << " " << name;
+    }
+    stream << std::endl;
+}
+
+/**
+ * Reports a bad command line, so that a typo doesn't silently benchmark the wrong setup.
+ *
+ * @return The status to exit with
+ */
+int usageError(const std::string& message, const std::vector<std::string>& sceneNames)
+{
+    std::cerr << message << std::endl;
+    printUsage(std::cerr, sceneNames);
+    return 1;
+}
+
+/**
+ * @return The number, or nothing if the text isn't entirely a positive integer
+ */
+std::optional<int> parsePositive(const std::string& text)
+{
+    size_t length = 0;
+    int value;
+    try {
+        value = std::stoi(text, &length);
+    }
+    catch (const std::logic_error&) {
+        return std::nullopt;
+    }
+    if (length != text.size() || value < 1) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    int width = 1280;
+    int height = 720;
+    bool visible = false;
+    std::optional<std::string> outputPath;
+    std::vector<std::string> chosenScenes;
+
+    std::vector<std::string> sceneNames{
+            "CubesWithSkybox",
+            "ObjectLoading",
+            "DifferentMaterialBunnies",
+            "PhysicallyRenderedSpheres",
+            "SpheresDifferentBRDFs",
+    };
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            std::optional<int> frames = parsePositive(argv[++i]);
+            if (!frames) {
+                return usageError("--frames needs a positive number, not " + std::string(argv[i]), sceneNames);
+            }
+            options.frames = *frames;
+        }
+        else if (arg == "--size" && i + 2 < argc) {
+            std::optional<int> parsedWidth = parsePositive(argv[++i]);
+            std::optional<int> parsedHeight = parsePositive(argv[++i]);
+            if (!parsedWidth || !parsedHeight) {
+                return usageError("--size needs two positive numbers, not " + std::string(argv[i - 1]) + " "
+                                  + argv[i], sceneNames);
+            }
+            width = *parsedWidth;
+            height = *parsedHeight;
+        }
+        else if (arg == "--scene" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (std::find(sceneNames.begin(), sceneNames.end(), name) == sceneNames.end()) {
+                return usageError("Unknown scene " + name, sceneNames);
+            }
+            chosenScenes.push_back(name);
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (arg == "--visible") {
+            visible = true;
+        }
+        else if (arg == "--help") {
+            printUsage(std::cout, sceneNames);
+            return 0;
+        }
+        else {
+            // Either the flag is unknown or it's missing its values
+            return usageError("Unrecognised or incomplete argument " + arg, sceneNames);
+        }
+    }
+    if (chosenScenes.empty()) {
+        chosenScenes = sceneNames;
+    }
+
+    Window window("Physically Based Renderer: Benchmark", width, height, visible);
+    window.setVSyncEnabled(false);
+
+    // On high-DPI displays the framebuffer has more pixels than the window has
+    // screen coordinates, so the viewport must be sized from the framebuffer
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &framebufferWidth, &framebufferHeight);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+
+    // Each scene should do all of its own loading and baking, as it would on its own
+    ResourceRegistry::setEnabled(false);
+
+    auto makePhongRenderer = []() -> std::shared_ptr<Renderer<PhongScene>> {
+        return std::make_shared<PhongRenderer>();
+    };
+    auto makePhysicallyBasedRenderer = []() -> std::shared_ptr<Renderer<PhysicallyBasedScene>> {
+        return std::make_shared<PhysicallyBasedRenderer>();
+    };
+
+    std::vector<BenchmarkResult> results;
+    for (const auto& name : chosenScenes) {
+        std::cerr << "Running " << name << "..." << std::endl;
+        if (name == "CubesWithSkybox") {
+            results.push_back(runScene<PhongScene>(name, window, options, makePhongRenderer,
+                                                   examples::loadCubesWithSkybox));
+        }
+        else if (name == "ObjectLoading") {
+            results.push_back(runScene<PhongScene>(name, window, options, makePhongRenderer,
+                                                   examples::loadObjectLoading));
+        }
+        else if (name == "DifferentMaterialBunnies") {
+            auto loadScene = [&window]() {
+                return examples::loadDifferentMaterialBunnies(window.getBackgroundBaker());
+            };
+            results.push_back(runScene<PhysicallyBasedScene>(name, window, options, makePhysicallyBasedRenderer,
+                                                             loadScene));
+        }
+        else if (name == "PhysicallyRenderedSpheres") {
+            results.push_back(runScene<PhysicallyBasedScene>(name, window, options, makePhysicallyBasedRenderer,
+                                                             examples::loadPhysicallyRenderedSpheres));
+        }
+        else if (name == "SpheresDifferentBRDFs") {
+            results.push_back(runScene<PhysicallyBasedScene>(name, window, options, makePhysicallyBasedRenderer,
+                                                             examples::loadSpheresDifferentBRDFs));
+        }
+    }
+
+    if (outputPath) {
+        std::ofstream stream(*outputPath);
+        if (!stream) {
+            std::cerr << "Failed to open " << *outputPath << std::endl;
+            return 1;
+        }
+        writeResults(stream, results, options);
+    }
+    else {
+        writeResults(std::cout, results, options);
+    }
+
+    return 0;
+}
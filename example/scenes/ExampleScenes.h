@@ -0,0 +1,45 @@
+#ifndef PHYSICALLYBASEDRENDERER_EXAMPLESCENES
+#define PHYSICALLYBASEDRENDERER_EXAMPLESCENES
+
+#include <memory>
+
+#include <PBR/PBR.h>
+
+/**
+ * The scenes shown by the example programs, shared with the benchmark so that
+ * it measures exactly what the examples render. Each must be called after a
+ * `Window` has been created, and loads its resources relative to the current
+ * directory, which must be the root of the repository.
+ */
+namespace examples {
+
+/**
+ * A coloured cube and a textured cube in front of a skybox.
+ */
+std::shared_ptr<PBR::phong::PhongScene> loadCubesWithSkybox();
+
+/**
+ * The viking room and monkey models, one textured and one coloured.
+ */
+std::shared_ptr<PBR::phong::PhongScene> loadObjectLoading();
+
+/**
+ * Copper, silver and plastic Stanford bunnies, lit by an environment map that
+ * is loaded progressively and baked on the background baker.
+ */
+std::shared_ptr<PBR::physically_based::PhysicallyBasedScene> loadDifferentMaterialBunnies(
+        std::shared_ptr<PBR::BackgroundBaker> backgroundBaker);
+
+/**
+ * Spheres at a range of roughnesses, sharing one layer of the lighting maps.
+ */
+std::shared_ptr<PBR::physically_based::PhysicallyBasedScene> loadPhysicallyRenderedSpheres();
+
+/**
+ * Spheres that each use a different BRDF, with their maps baked progressively.
+ */
+std::shared_ptr<PBR::physically_based::PhysicallyBasedScene> loadSpheresDifferentBRDFs();
+
+} // namespace examples
+
+#endif //PHYSICALLYBASEDRENDERER_EXAMPLESCENES
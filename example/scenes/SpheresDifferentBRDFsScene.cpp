@@ -0,0 +1,74 @@
+#include "ExampleScenes.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <PBR/PBR.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+using namespace PBR;
+using namespace PBR::physically_based;
+
+namespace fs = std::filesystem;
+
+namespace examples {
+
+std::shared_ptr<PhysicallyBasedScene> loadSpheresDifferentBRDFs()
+{
+    // Generate the spheres and lights
+    fs::path objPath = std::filesystem::current_path() / "example" / "resources" / "models" / "SphereHighPoly.obj";
+    std::vector<std::shared_ptr<PhysicallyBasedSceneObject>> sceneObjects;
+    std::vector<PointLightSource> lights;
+    for (int i = 0; i < 5; i++) {
+        glm::vec3 position(2.1f * i, 0.0f, 0.0f);
+        glm::vec3 orientation(0.0f);
+        float scale = 1.0f;
+        glm::vec3 albedo(0.8f);
+        float roughness = 0.5f;
+        float metallic = 0.8f;
+        glm::vec3 F0 = FresnelValues::Silver;
+        PhysicallyBasedMaterial material{albedo, roughness, metallic, F0};
+        material.brdfCoefficients.normalDistribution = NormalDistributionFunctionCoefficients{(float) (4 - i) / 4, (float) i / 4};
+        material.brdfCoefficients.geometricAttenutation = GeometricAttenuationFunctionCoefficients{(float) (4 - i) / 4, (float) i / 4};
+        std::shared_ptr<PhysicallyBasedSceneObject> object(
+                new scene_objects::CustomObject(objPath, position, orientation, material, scale));
+        sceneObjects.push_back(object);
+
+        // Put a light in front of each sphere
+        lights.push_back(PointLightSource{position + glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(1.0f), 20.0f});
+    }
+
+    // Find the sun in the environment map and render it as an analytic light. With
+    // it clamped out of the map, the prefiltered maps converge with far fewer samples.
+    PrecomputationSettings settings;
+    settings.extractSun = true;
+    settings.prefilterSampleCount = 64;
+    settings.minimumPrefilterSampleCount = 8;
+
+    // Texture for the environment map
+    auto environmentMapsDir = fs::current_path() / "example" / "resources" / "environment_maps";
+
+    // Map 1: Utah desert
+    auto texturePath = environmentMapsDir / "Arches_E_PineTree" / "Arches_E_PineTree_3k.hdr";
+    std::shared_ptr<EnvironmentMap> environmentMap(
+            new EnvironmentMap(texturePath, std::nullopt, IrradianceMode::IrradianceMap, settings));
+
+    // Map 2: Malibu coast
+//    auto texturePath = environmentMapsDir / "Malibu_Overlook" / "Malibu_Overlook_3k.hdr";
+//    auto sunDirection = PBRUtil::uvToCartesian(glm::vec2(0.424f, 0.2f));
+//    DirectedLightSource sun{sunDirection, glm::vec3(1.0f, 251.0f/255.0f, 232.0f/255.0f), 1.0f};
+//    std::shared_ptr<EnvironmentMap> environmentMap(new EnvironmentMap(texturePath, sun));
+
+    // Map 3: Winter forest
+//    auto texturePath = environmentMapsDir / "Winter_Forest" / "WinterForest_Ref.hdr";
+//    std::shared_ptr<EnvironmentMap> environmentMap(new EnvironmentMap(texturePath));
+
+    // Create the scene. Every sphere has its own material, so we bake the lighting maps
+    // progressively rather than making the window wait for all of them.
+    return std::make_shared<PhysicallyBasedScene>(sceneObjects, lights, environmentMap,
+                                                  PrecomputationMode::Progressive, nullptr, settings);
+}
+
+} // namespace examples
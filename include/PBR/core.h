@@ -1,10 +1,24 @@
 #ifndef PHYSICALLYBASEDRENDERER_CORE
 #define PHYSICALLYBASEDRENDERER_CORE
 
+#include "core/BackgroundBaker.h"
 #include "core/Camera.h"
+#include "core/DDSFile.h"
 #include "core/DirectedLightSource.h"
 #include "core/ErrorCodes.h"
+#include "core/FrameSnapshot.h"
+#include "core/FrameSnapshotBuffer.h"
+#include "core/Frustum.h"
+#include "core/HalfFloat.h"
+#include "core/HDRImage.h"
+#include "core/MeshArena.h"
+#include "core/MipGenerator.h"
 #include "core/PointLightSource.h"
+#include "core/PrecomputationContext.h"
+#include "core/Profiler.h"
+#include "core/RadianceHDRFile.h"
+#include "core/RangeAllocator.h"
+#include "core/RenderStats.h"
 #include "core/Renderer.h"
 #include "core/RendererDriver.h"
 #include "core/Scene.h"
@@ -12,6 +26,9 @@
 #include "core/ShaderProgram.h"
 #include "core/Texture.h"
 #include "core/TexturePrecomputation.h"
+#include "core/ThreadPool.h"
+#include "core/UniformBuffer.h"
+#include "core/UniformRingBuffer.h"
 #include "core/VertexData.h"
 #include "core/Window.h"
 
@@ -0,0 +1,141 @@
+#ifndef PHYSICALLYBASEDRENDERER_BACKGROUNDBAKER
+#define PHYSICALLYBASEDRENDERER_BACKGROUNDBAKER
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define GL_SILENCE_DEPRECATION
+#define GLFW_INCLUDE_NONE
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "core/ShaderProgram.h"
+
+namespace PBR {
+
+/**
+ * Runs OpenGL work, such as baking lighting maps, on a separate thread so that
+ * the rendering thread can keep drawing frames in the meantime.
+ *
+ * The thread has its own hidden OpenGL context that shares objects (textures,
+ * buffers and shader programs) with the main window's context. Each job is
+ * followed by a fence, and its completion callback is only run on the main
+ * thread once the GPU has passed that fence, so the callback can safely hand
+ * the finished textures over to the renderer.
+ *
+ * Objects that aren't shared between contexts, such as framebuffers and vertex
+ * arrays, must be created and destroyed within the job that uses them.
+ */
+class BackgroundBaker {
+private:
+    struct QueuedJob {
+
+        /**
+         * Passed once the main thread's commands issued before the job was submitted have completed.
+         */
+        GLsync ready;
+
+        std::function<void()> work;
+        std::function<void()> onComplete;
+    };
+
+    struct SubmittedJob {
+        GLsync fence;
+        std::function<void()> onComplete;
+    };
+
+    /**
+     * The hidden window that owns the baker thread's context.
+     */
+    GLFWwindow* context;
+
+    std::thread worker;
+
+    std::mutex mutex;
+    std::condition_variable jobsAvailable;
+
+    /**
+     * Jobs waiting to run on the baker thread.
+     */
+    std::deque<QueuedJob> queuedJobs;
+
+    /**
+     * Jobs that have run on the baker thread but whose GPU work may still be in flight.
+     */
+    std::vector<SubmittedJob> submittedJobs;
+
+    bool stopping;
+
+    /**
+     * The shader programs that jobs have asked for, by name. Only the baker
+     * thread touches these, and it deletes them before its context goes.
+     */
+    std::unordered_map<std::string, std::shared_ptr<ShaderProgram>> shaderPrograms;
+
+public:
+    /**
+     * Creates the baker's context and starts its thread. This must be called on
+     * the main thread.
+     *
+     * @param sharedWith The window whose context the baker shares objects with
+     */
+    explicit BackgroundBaker(GLFWwindow* sharedWith);
+    ~BackgroundBaker();
+
+    BackgroundBaker(const BackgroundBaker&) = delete;
+    BackgroundBaker& operator=(const BackgroundBaker&) = delete;
+
+    /**
+     * Queues a job. This must be called on the main thread, and the job will see
+     * every change that the main thread made to shared objects before the call.
+     *
+     * @param work The OpenGL work to run on the baker thread
+     * @param onComplete Called on the main thread from `poll()` once the GPU has finished the work
+     */
+    void submit(std::function<void()> work, std::function<void()> onComplete);
+
+    /**
+     * Runs the completion callbacks of any jobs that have finished. This must be
+     * called regularly on the main thread; `Window` does so once per frame.
+     */
+    void poll();
+
+    /**
+     * @return The number of jobs whose completion callbacks have not yet been run
+     */
+    size_t pendingJobs();
+
+    /**
+     * Gets a shader program for jobs to share, so that each one is only compiled
+     * once rather than by every job that uses it. This must be called from a job.
+     *
+     * Programs are shared between contexts, but their uniform values are too, so
+     * the main thread must not use the same program while the baker does.
+     *
+     * @param name Identifies the program, including any defines it was compiled with
+     * @param create Compiles the program, if the baker doesn't have it yet
+     */
+    std::shared_ptr<ShaderProgram> getShaderProgram(const std::string& name,
+                                                    const std::function<std::shared_ptr<ShaderProgram>()>& create);
+
+    /**
+     * Stops the baker thread, abandoning any jobs that haven't started, and destroys
+     * its context. This must be called on the main thread before GLFW is terminated.
+     */
+    void shutdown();
+
+private:
+    void workerLoop();
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_BACKGROUNDBAKER
@@ -0,0 +1,88 @@
+#ifndef PHYSICALLYBASEDRENDERER_DDSFILE
+#define PHYSICALLYBASEDRENDERER_DDSFILE
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace PBR {
+
+/**
+ * The GPU block compression formats that we know how to store and upload.
+ */
+enum class BlockCompressionFormat {
+
+    /**
+     * Unsigned half-float HDR data (DXGI_FORMAT_BC6H_UF16).
+     */
+    BC6H,
+
+    /**
+     * 8-bit RGBA LDR data (DXGI_FORMAT_BC7_UNORM).
+     */
+    BC7,
+};
+
+/**
+ * A single level of a block-compressed mipmap chain.
+ */
+struct CompressedMipLevel {
+    unsigned int width;
+    unsigned int height;
+
+    /**
+     * The compressed blocks, in row-major order, 16 bytes per 4x4 block.
+     */
+    std::vector<unsigned char> data;
+};
+
+/**
+ * A block-compressed texture stored in a DirectDraw Surface (.dds) container
+ * with the DX10 header extension.
+ */
+struct DDSFile {
+    BlockCompressionFormat format;
+
+    /**
+     * The mipmap levels, starting with the full-size image.
+     */
+    std::vector<CompressedMipLevel> mipLevels;
+
+    /**
+     * Reads a .dds file from disk.
+     *
+     * @param path The path to the file
+     * @return The file's contents, or nothing if the file could not be read or
+     *         uses a format that we don't support
+     */
+    static std::optional<DDSFile> read(const std::filesystem::path& path);
+
+    /**
+     * Writes this texture to disk as a .dds file.
+     *
+     * @param path The path to write to
+     * @return `true` if the file was written successfully
+     */
+    bool write(const std::filesystem::path& path) const;
+
+    /**
+     * @return The number of bytes needed to store a level of the given dimensions
+     */
+    static size_t levelSize(unsigned int width, unsigned int height);
+
+    /**
+     * @return The path that the `CompressTextures` tool writes a compressed copy
+     *         of an image to, which is next to it with a .dds extension
+     */
+    static std::filesystem::path compressedPathFor(const std::filesystem::path& sourcePath);
+
+    /**
+     * @return `true` if the compressed copy of an image exists and was written
+     *         no earlier than the image was last modified
+     */
+    static bool isUpToDate(const std::filesystem::path& sourcePath);
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_DDSFILE
@@ -34,6 +34,12 @@ enum class ErrorCodes {
      * Failed to link a shader program
      */
     FailedToLinkShaders = 13,
+
+    /**
+     * Failed to find space for a mesh, or used the mesh arena from the wrong
+     * OpenGL context
+     */
+    MeshArenaError = 14,
 };
 
 } // namespace PBR
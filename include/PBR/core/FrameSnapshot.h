@@ -0,0 +1,74 @@
+#ifndef PHYSICALLYBASEDRENDERER_FRAMESNAPSHOT
+#define PHYSICALLYBASEDRENDERER_FRAMESNAPSHOT
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "core/Camera.h"
+
+namespace PBR {
+
+/**
+ * Everything about a frame that can change while the application runs: the
+ * camera, the transforms of the scene's objects and its lights. Renderers draw
+ * from a snapshot rather than reading these from the scene and camera, so that
+ * an update thread can move things around while the last snapshot it published
+ * is being drawn.
+ *
+ * Element i of the per-object vectors belongs to the ith object in the scene.
+ * Everything else about the objects, such as their meshes and materials, is
+ * still read from the scene, so it mustn't change while another thread is
+ * rendering it.
+ */
+struct FrameSnapshot {
+    double time{0.0};
+
+    glm::mat4 viewMatrix{1.0f};
+    glm::mat4 projectionMatrix{1.0f};
+    glm::vec3 cameraPosition{0.0f};
+
+    std::vector<glm::mat4> modelMatrices;
+    std::vector<glm::mat4> rotationMatrices;
+
+    std::vector<glm::vec3> lightPositions;
+    std::vector<glm::vec3> lightColours;
+    std::vector<float> lightIntensities;
+
+    /**
+     * Records the camera's matrices and position.
+     */
+    void captureCamera(const Camera& camera);
+
+    /**
+     * Records the camera, and the transforms and lights of a scene. The vectors
+     * keep their capacity, so capturing into the same snapshot each frame
+     * doesn't allocate once the scene's size is stable.
+     */
+    template<class SceneType>
+    void capture(const SceneType& scene, const Camera& camera, double time);
+};
+
+template<class SceneType>
+void FrameSnapshot::capture(const SceneType& scene, const Camera& camera, double time)
+{
+    this->time = time;
+    captureCamera(camera);
+
+    const auto& objects = scene.getSceneObjectsList();
+    modelMatrices.resize(objects.size());
+    rotationMatrices.resize(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        modelMatrices[i] = objects[i]->getModelMatrix();
+        rotationMatrices[i] = objects[i]->getRotationMatrix();
+    }
+
+    lightPositions.assign(scene.getLightPositions().begin(), scene.getLightPositions().end());
+    lightColours.assign(scene.getLightColours().begin(), scene.getLightColours().end());
+    lightIntensities.assign(scene.getLightIntensities().begin(), scene.getLightIntensities().end());
+}
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_FRAMESNAPSHOT
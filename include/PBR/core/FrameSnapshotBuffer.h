@@ -0,0 +1,75 @@
+#ifndef PHYSICALLYBASEDRENDERER_FRAMESNAPSHOTBUFFER
+#define PHYSICALLYBASEDRENDERER_FRAMESNAPSHOTBUFFER
+
+#include <array>
+#include <atomic>
+
+#include "core/FrameSnapshot.h"
+
+namespace PBR {
+
+/**
+ * Hands `FrameSnapshot`s from one update thread to one render thread without
+ * either of them taking a lock or waiting for the other.
+ *
+ * Each side has a snapshot of its own, so from either side it is an ordinary
+ * double buffer. A third snapshot sits between them: publishing swaps the
+ * writer's snapshot with it, and acquiring swaps it with the reader's, each
+ * with a single atomic exchange. If the writer publishes twice before the
+ * reader acquires, the older snapshot is simply overwritten, so the reader
+ * always gets the newest one.
+ */
+class FrameSnapshotBuffer {
+private:
+    std::array<FrameSnapshot, 3> snapshots;
+
+    /**
+     * The index of the snapshot between the two threads, with `freshFlag` set
+     * if it has been published since the reader last acquired one.
+     */
+    std::atomic<unsigned int> middle;
+
+    /**
+     * Only used by the writer.
+     */
+    unsigned int writeIndex;
+
+    /**
+     * Only used by the reader.
+     */
+    unsigned int readIndex;
+
+    static constexpr unsigned int freshFlag = 4;
+    static constexpr unsigned int indexMask = 3;
+
+public:
+    FrameSnapshotBuffer();
+
+    /**
+     * @return The snapshot for the writer to fill in. It still holds whatever
+     *         was written to it last, so it can be updated rather than rebuilt.
+     */
+    FrameSnapshot& writeSnapshot();
+
+    /**
+     * Makes the snapshot that the writer filled in available to the reader.
+     */
+    void publish();
+
+    /**
+     * Takes the most recently published snapshot, if there is a new one.
+     *
+     * @return Whether there was a new snapshot. Either way, `readSnapshot()`
+     *         returns the newest snapshot that the reader has.
+     */
+    bool acquire();
+
+    /**
+     * @return The snapshot the reader acquired last
+     */
+    const FrameSnapshot& readSnapshot() const;
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_FRAMESNAPSHOTBUFFER
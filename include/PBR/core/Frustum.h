@@ -0,0 +1,37 @@
+#ifndef PHYSICALLYBASEDRENDERER_FRUSTUM
+#define PHYSICALLYBASEDRENDERER_FRUSTUM
+
+#include <array>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace PBR {
+
+/**
+ * The region of world space that a camera can see, for culling objects that
+ * are entirely outside it.
+ */
+struct Frustum {
+    /**
+     * The left, right, bottom, top, near and far planes, as (normal, distance)
+     * with the normals pointing inwards.
+     */
+    std::array<glm::vec4, 6> planes;
+
+    /**
+     * Extracts the planes of the frustum from a view-projection matrix.
+     */
+    static Frustum fromMatrix(const glm::mat4& viewProjectionMatrix);
+
+    /**
+     * @return Whether any part of a sphere might be inside the frustum. Spheres
+     *         near a corner can give false positives, but never false negatives.
+     */
+    bool intersectsSphere(const glm::vec3& centre, float radius) const;
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_FRUSTUM
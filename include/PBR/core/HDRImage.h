@@ -0,0 +1,41 @@
+#ifndef PHYSICALLYBASEDRENDERER_HDRIMAGE
+#define PHYSICALLYBASEDRENDERER_HDRIMAGE
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+namespace PBR {
+
+/**
+ * A floating-point RGB image held in CPU memory, so that it can be analysed or
+ * modified before it is uploaded as a `Texture`.
+ *
+ * Rows are stored bottom to top, matching the way `Texture` uploads HDR images.
+ */
+struct HDRImage {
+    unsigned int width;
+    unsigned int height;
+
+    /**
+     * Three floats per pixel, in row-major order.
+     */
+    std::vector<float> pixels;
+
+    /**
+     * Loads an HDR image file, such as a Radiance .hdr file.
+     *
+     * @param path The path to the image file
+     */
+    static HDRImage load(const std::filesystem::path& path);
+
+    glm::vec3 pixel(unsigned int x, unsigned int y) const;
+
+    void setPixel(unsigned int x, unsigned int y, glm::vec3 value);
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_HDRIMAGE
@@ -0,0 +1,26 @@
+#ifndef PHYSICALLYBASEDRENDERER_HALFFLOAT
+#define PHYSICALLYBASEDRENDERER_HALFFLOAT
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PBR {
+
+/**
+ * Conversion to the 16-bit floats used by `GL_HALF_FLOAT` textures.
+ */
+struct HalfFloat {
+
+    /**
+     * Converts non-negative floats to half floats, rounding to nearest even.
+     * Values too large for a half float are clamped to the largest finite one.
+     *
+     * The hardware conversion instructions are used where the compiler enables
+     * them (F16C on x86 with -mf16c, or NEON on aarch64).
+     */
+    static void convert(const float* input, uint16_t* output, size_t count);
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_HALFFLOAT
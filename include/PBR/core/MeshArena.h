@@ -0,0 +1,147 @@
+#ifndef PHYSICALLYBASEDRENDERER_MESHARENA
+#define PHYSICALLYBASEDRENDERER_MESHARENA
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+#define GL_SILENCE_DEPRECATION
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "core/RangeAllocator.h"
+
+namespace PBR {
+
+class VertexData;
+
+/**
+ * Holds the vertices and indices of every mesh in a few large buffers, rather
+ * than giving each mesh buffers of its own.
+ *
+ * There is a vertex buffer for each vertex layout, with a vertex array object
+ * that every mesh in that layout shares, and one index buffer shared by all of
+ * them. A mesh is a range of vertices and a range of indices, which are drawn
+ * with `glDrawElementsBaseVertex`. Switching between meshes with the same layout
+ * then needs no rebinding at all.
+ *
+ * When a buffer runs out of space its contents are moved to the start of a new
+ * buffer of the same size, if that would leave enough room, or otherwise copied
+ * into one twice the size. Either way the copying happens on the GPU, and the
+ * meshes' `VertexData` are updated with their new positions.
+ *
+ * Vertex array objects aren't shared between OpenGL contexts, so the arena
+ * belongs to the context that was current when it was created, which must be
+ * the main window's. Meshes must be created on that context, not on a
+ * background baking context, where the arena's vertex array objects don't
+ * exist. Using the arena from any other context is an error, which exits.
+ */
+class MeshArena {
+private:
+    /**
+     * The vertices of every mesh with one layout.
+     */
+    struct VertexPool {
+        bool textured;
+
+        /**
+         * The size of a vertex in bytes.
+         */
+        size_t stride;
+
+        unsigned int vaoId;
+        unsigned int vboId;
+
+        /**
+         * Allocates ranges of the vertex buffer, in vertices.
+         */
+        RangeAllocator allocator;
+    };
+
+    /**
+     * The context the arena's buffers and vertex array objects were made in.
+     */
+    GLFWwindow* context;
+
+    std::vector<VertexPool> pools;
+
+    unsigned int eboId;
+
+    /**
+     * Allocates ranges of the index buffer, in indices.
+     */
+    RangeAllocator indexAllocator;
+
+    /**
+     * Every mesh in the arena, so that they can be updated when they move.
+     */
+    std::unordered_set<VertexData*> meshes;
+
+public:
+    /**
+     * Creates the arena's buffers in the current OpenGL context.
+     *
+     * @param initialVertices The number of vertices of each layout to make room for
+     * @param initialIndices The number of indices to make room for
+     */
+    MeshArena(size_t initialVertices, size_t initialIndices);
+
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    /**
+     * @return The arena that `VertexData` allocates from. It is never destroyed,
+     *         so that meshes held in statics can still be removed from it at
+     *         exit. Its buffers are left for the driver to clean up. If the
+     *         window has been recreated since the arena was created and it holds
+     *         no meshes, it is replaced by one made in the new context.
+     */
+    static MeshArena& shared();
+
+    /**
+     * Copies a mesh into the arena and sets where it is in the `VertexData`. The
+     * arena's context must be current.
+     *
+     * @param mesh The handle for the mesh, which must have its layout set
+     * @param vertices The interleaved vertex data, in the mesh's layout
+     * @param indices The indices into `vertices`
+     */
+    void add(VertexData& mesh, const std::vector<float>& vertices, const std::vector<unsigned int>& indices);
+
+    /**
+     * Frees a mesh's ranges for reuse. This makes no OpenGL calls.
+     */
+    void remove(VertexData& mesh);
+
+    /**
+     * Moves every mesh to the start of its buffers, so that all the free space is
+     * in one range at the end. The arena's context must be current.
+     */
+    void defragment();
+
+    /**
+     * @return The vertex array object for meshes with or without texture
+     *         coordinates. The index buffer is bound to it.
+     */
+    unsigned int getVaoId(bool textured) const;
+
+private:
+    VertexPool& poolFor(bool textured);
+
+    size_t allocateVertices(VertexPool& pool, size_t count);
+
+    size_t allocateIndices(size_t count);
+
+    void defragmentVertices(VertexPool& pool);
+
+    void defragmentIndices();
+
+    /**
+     * Points a pool's vertex array object at its current buffers.
+     */
+    void bindBuffers(const VertexPool& pool) const;
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_MESHARENA
@@ -0,0 +1,116 @@
+#ifndef PHYSICALLYBASEDRENDERER_MIPGENERATOR
+#define PHYSICALLYBASEDRENDERER_MIPGENERATOR
+
+#include <vector>
+
+#include "core/ThreadPool.h"
+
+namespace PBR {
+
+/**
+ * The filter used to shrink each mipmap level into the next.
+ */
+enum class MipFilter {
+
+    /**
+     * Averages each 2x2 block, like most drivers' `glGenerateMipmap`. Cheap,
+     * but blurry and prone to aliasing.
+     */
+    Box,
+
+    /**
+     * A Kaiser-windowed sinc, three texels wide on each side. Sharp, with very
+     * little ringing.
+     */
+    Kaiser,
+
+    /**
+     * A Lanczos-windowed sinc, three texels wide on each side. Slightly sharper
+     * than `Kaiser`, with more ringing around high-contrast edges.
+     */
+    Lanczos,
+};
+
+/**
+ * What a filter sees past one edge of an image.
+ */
+enum class MipEdge {
+
+    /**
+     * The image repeats, matching `GL_REPEAT`.
+     */
+    Wrap,
+
+    /**
+     * The texels along the edge carry on outwards, matching `GL_CLAMP_TO_EDGE`.
+     */
+    Clamp,
+};
+
+/**
+ * How an image carries on past its edges along each axis.
+ */
+struct MipEdges {
+    MipEdge horizontal = MipEdge::Wrap;
+    MipEdge vertical = MipEdge::Wrap;
+
+    /**
+     * @return The edges of an equirectangular map, which wraps around from east
+     *         to west but not across the poles
+     */
+    static MipEdges equirectangular();
+};
+
+/**
+ * Generates mipmap chains on the CPU, spread across the threads of a pool.
+ *
+ * Each level is half the size of the one above, rounded down, until both sides
+ * are one texel. The filter is applied separably, first down the columns and
+ * then along the rows. The column pass works on whole rows at a time, so it is a
+ * sequence of multiply-adds over contiguous floats that the compiler vectorises.
+ *
+ * Each axis of an image either repeats or is clamped at its edges, which should
+ * match the wrap mode of the sampler it is read through. Any negative lobes of
+ * the filter that would take a texel below zero are clamped off.
+ */
+struct MipGenerator {
+
+    /**
+     * Generates the levels below the base level of a floating-point image.
+     *
+     * @param pixels The base level, `channels` floats per pixel in row-major order
+     * @param edges How the image carries on past its edges
+     * @return Every level after the base level, largest first
+     */
+    static std::vector<std::vector<float>> generate(const float* pixels, unsigned int width, unsigned int height,
+                                                    unsigned int channels, MipFilter filter,
+                                                    MipEdges edges = MipEdges(),
+                                                    ThreadPool& threadPool = ThreadPool::shared());
+
+    /**
+     * Generates the levels below the base level of an 8-bit image. The levels are
+     * filtered at full precision and rounded separately, so errors don't build up.
+     *
+     * @param pixels The base level, `channels` bytes per pixel in row-major order
+     * @param edges How the image carries on past its edges
+     * @return Every level after the base level, largest first
+     */
+    static std::vector<std::vector<unsigned char>> generate(const unsigned char* pixels, unsigned int width,
+                                                            unsigned int height, unsigned int channels,
+                                                            MipFilter filter, MipEdges edges = MipEdges(),
+                                                            ThreadPool& threadPool = ThreadPool::shared());
+
+    /**
+     * @return The number of levels in a full mipmap chain, including the base level
+     */
+    static unsigned int levelCount(unsigned int width, unsigned int height);
+
+    /**
+     * @return The size of a side of a mipmap level
+     */
+    static unsigned int levelSize(unsigned int baseSize, unsigned int level);
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_MIPGENERATOR
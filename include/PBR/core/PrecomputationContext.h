@@ -0,0 +1,122 @@
+#ifndef PHYSICALLYBASEDRENDERER_PRECOMPUTATIONCONTEXT
+#define PHYSICALLYBASEDRENDERER_PRECOMPUTATIONCONTEXT
+
+#include <vector>
+
+#include "core/Texture.h"
+
+namespace PBR {
+
+/**
+ * The OpenGL objects that `TexturePrecomputation` needs to render into textures,
+ * kept alive between renders instead of being recreated every time.
+ *
+ * Vertex arrays and framebuffers can't be shared between contexts, so there is
+ * one instance per thread, which is assumed to only ever use one context.
+ */
+class PrecomputationContext {
+private:
+    /**
+     * An empty vertex array. The fullscreen triangle is generated from
+     * `gl_VertexID` in the vertex shader, but core profile OpenGL still
+     * requires a vertex array to be bound in order to draw.
+     */
+    unsigned int vaoId;
+
+    /**
+     * Framebuffers that have been created but aren't currently in use.
+     */
+    std::vector<unsigned int> framebufferPool;
+
+    /**
+     * The framebuffer bound for the current batch, or 0 outside of one.
+     */
+    unsigned int batchFramebufferId;
+
+    /**
+     * How many batches are currently open. Batches can be nested, and the objects
+     * are only unbound when the outermost one ends.
+     */
+    unsigned int batchDepth;
+
+    PrecomputationContext();
+
+public:
+    ~PrecomputationContext();
+
+    PrecomputationContext(const PrecomputationContext&) = delete;
+    PrecomputationContext& operator=(const PrecomputationContext&) = delete;
+
+    /**
+     * @return The context for the calling thread, which is created the first time it is needed
+     */
+    static PrecomputationContext& current();
+
+    /**
+     * Deletes the calling thread's context, if it has one. This must be called
+     * while the thread's OpenGL context is still current.
+     */
+    static void releaseCurrent();
+
+    /**
+     * Binds the vertex array and a framebuffer so that any number of renders can
+     * follow without rebinding them.
+     *
+     * @return The bound framebuffer
+     */
+    unsigned int beginBatch();
+
+    /**
+     * Unbinds the objects bound by the matching call to `beginBatch()`.
+     */
+    void endBatch();
+
+    /**
+     * Draws a triangle that covers the whole viewport, with texture coordinates
+     * running from 0 to 1 across it. Must be called within a batch.
+     *
+     * @param instances The number of instances to draw, for layered rendering
+     */
+    void drawFullscreenTriangle(unsigned int instances = 1);
+
+    /**
+     * Allocates storage for a 2D, cubemap, 2D array or cubemap array texture with
+     * the given number of mipmap levels, and sets its sampling parameters to match.
+     *
+     * Immutable storage is used where the OpenGL implementation supports it,
+     * which means that the texture can't be reallocated afterwards.
+     *
+     * @param texture The texture to allocate. It must not already have storage.
+     * @param internalFormat The sized internal format, e.g. `GL_RGB16F`
+     * @param width The width of the base mipmap level
+     * @param height The height of the base mipmap level
+     * @param mipmapLevels The number of mipmap levels
+     * @param layers The number of layers of an array texture, counting each face
+     *               of a cubemap array separately. Ignored for other textures.
+     */
+    static void allocateStorage(const Texture& texture, unsigned int internalFormat,
+                                unsigned int width, unsigned int height, unsigned int mipmapLevels,
+                                unsigned int layers = 1);
+
+private:
+    unsigned int acquireFramebuffer();
+
+    void releaseFramebuffer(unsigned int framebufferId);
+};
+
+/**
+ * Keeps the calling thread's `PrecomputationContext` bound for its lifetime, so
+ * that the renders made in the meantime all share the same bindings.
+ */
+class PrecomputationBatch {
+public:
+    PrecomputationBatch();
+    ~PrecomputationBatch();
+
+    PrecomputationBatch(const PrecomputationBatch&) = delete;
+    PrecomputationBatch& operator=(const PrecomputationBatch&) = delete;
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_PRECOMPUTATIONCONTEXT
@@ -0,0 +1,270 @@
+#ifndef PHYSICALLYBASEDRENDERER_PROFILER
+#define PHYSICALLYBASEDRENDERER_PROFILER
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace PBR {
+
+/**
+ * One timed section of a frame.
+ */
+struct ProfileEvent {
+
+    /**
+     * The name of the section. This always points to a string literal.
+     */
+    const char* name;
+
+    /**
+     * Whether this is the GPU time of a render pass rather than CPU time.
+     */
+    bool isGPU;
+
+    /**
+     * A small number identifying the thread the section ran on. GPU events use
+     * the thread that submitted them.
+     */
+    uint32_t threadIndex;
+
+    /**
+     * The frame the section was part of.
+     */
+    uint64_t frame;
+
+    /**
+     * When the section started, in microseconds since the profiler was created.
+     * For GPU events this is when the commands were submitted, since the GPU
+     * only reports how long they took.
+     */
+    double startMicroseconds;
+
+    double durationMicroseconds;
+};
+
+/**
+ * Records CPU and GPU timings of each frame into a ring buffer, which can be
+ * written out as a Chrome trace to view in chrome://tracing or Perfetto.
+ *
+ * Code is instrumented with the `PBR_PROFILE_*` macros below rather than by
+ * calling this class directly. They only do anything when the library is built
+ * with `PBR_ENABLE_PROFILING`; otherwise they expand to nothing and the ring
+ * buffer stays empty.
+ *
+ * GPU timings use `GL_TIME_ELAPSED` queries, which can't be nested, so a GPU
+ * scope opened inside another one is only timed on the CPU. The queries are
+ * double buffered: a frame's results are read back at the end of the next
+ * frame, by which point the GPU has normally finished with them, so reading
+ * them rarely stalls. Only the thread that called `attachGPUContext` issues
+ * queries, since query objects aren't shared between contexts. Other threads
+ * still get CPU timings.
+ */
+class Profiler {
+private:
+    /**
+     * A query that has been issued but whose result hasn't been read back.
+     */
+    struct PendingGPUEvent {
+        const char* name;
+        unsigned int query;
+        double startMicroseconds;
+    };
+
+    /**
+     * The queries issued during one frame. There are two of these, used alternately.
+     */
+    struct GPUFrame {
+        uint64_t frame;
+        std::vector<unsigned int> queries;
+        std::vector<PendingGPUEvent> pendingEvents;
+    };
+
+    std::chrono::steady_clock::time_point startTime;
+
+    /**
+     * Guards every member below.
+     */
+    std::mutex profilerMutex;
+
+    std::vector<ProfileEvent> events;
+
+    /**
+     * Where the next event is written in `events`, once it has reached `capacity`.
+     */
+    size_t nextEvent;
+
+    size_t capacity;
+
+    uint64_t currentFrame;
+
+    std::optional<std::thread::id> gpuThread;
+
+    GPUFrame gpuFrames[2];
+
+    /**
+     * Whether a GPU query is open, since they can't be nested.
+     */
+    bool gpuQueryActive;
+
+public:
+    /**
+     * @param capacity The number of events to keep before the oldest are overwritten
+     */
+    explicit Profiler(size_t capacity = 65536);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    /**
+     * @return The profiler that the `PBR_PROFILE_*` macros record into
+     */
+    static Profiler& shared();
+
+    /**
+     * @return Whether the library was built with `PBR_ENABLE_PROFILING`
+     */
+    static constexpr bool isCompiledIn()
+    {
+#ifdef PBR_ENABLE_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Marks the calling thread as the one whose context GPU scopes are timed in.
+     * `Window` does this for its own context.
+     */
+    void attachGPUContext();
+
+    /**
+     * @return The time since the profiler was created, in microseconds
+     */
+    double now() const;
+
+    /**
+     * Records a section of CPU time on the calling thread.
+     */
+    void recordCPU(const char* name, double startMicroseconds, double endMicroseconds);
+
+    /**
+     * Starts timing a render pass on the GPU.
+     *
+     * @return Whether a query was started, which must then be ended with `endGPU`
+     */
+    bool beginGPU(const char* name);
+
+    /**
+     * Ends the query started by the last successful call to `beginGPU`.
+     */
+    void endGPU();
+
+    /**
+     * Ends the frame: reads back the GPU timings from the frame before this
+     * one, and moves on to the next frame.
+     */
+    void endFrame();
+
+    /**
+     * @return The events in the ring buffer, oldest first
+     */
+    std::vector<ProfileEvent> getEvents();
+
+    /**
+     * Discards every recorded event.
+     */
+    void clear();
+
+    /**
+     * Writes the events in the ring buffer in the Chrome trace event format.
+     *
+     * @return Whether the file could be written
+     */
+    bool writeChromeTrace(const std::filesystem::path& path);
+
+private:
+    /**
+     * Adds an event to the ring buffer. The caller must hold `profilerMutex`.
+     */
+    void addEventLocked(const ProfileEvent& event);
+
+    /**
+     * Reads back the results of a frame's queries. The caller must hold `profilerMutex`.
+     */
+    void resolveGPUFrameLocked(GPUFrame& gpuFrame);
+};
+
+/**
+ * Times the CPU work from its construction to the end of its scope.
+ */
+class ProfileScope {
+private:
+    const char* name;
+    double startMicroseconds;
+
+public:
+    explicit ProfileScope(const char* name);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+/**
+ * Times the GPU work submitted from its construction to the end of its scope,
+ * along with the CPU time spent submitting it.
+ */
+class GPUProfileScope {
+private:
+    ProfileScope cpuScope;
+    bool timingGPU;
+
+public:
+    explicit GPUProfileScope(const char* name);
+    ~GPUProfileScope();
+
+    GPUProfileScope(const GPUProfileScope&) = delete;
+    GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+};
+
+} // namespace PBR
+
+#define PBR_PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PBR_PROFILE_CONCATENATE(a, b) PBR_PROFILE_CONCATENATE_INNER(a, b)
+
+#ifdef PBR_ENABLE_PROFILING
+
+/**
+ * Times the CPU work from here to the end of the enclosing scope. The name must
+ * be a string literal.
+ */
+#define PBR_PROFILE_SCOPE(name) ::PBR::ProfileScope PBR_PROFILE_CONCATENATE(pbrProfileScope, __LINE__)(name)
+
+/**
+ * Times the GPU work submitted from here to the end of the enclosing scope, as
+ * well as the CPU time. The name must be a string literal.
+ */
+#define PBR_PROFILE_GPU_SCOPE(name) ::PBR::GPUProfileScope PBR_PROFILE_CONCATENATE(pbrProfileScope, __LINE__)(name)
+
+/**
+ * Marks the end of a frame.
+ */
+#define PBR_PROFILE_END_FRAME() ::PBR::Profiler::shared().endFrame()
+
+#else
+
+#define PBR_PROFILE_SCOPE(name) ((void) 0)
+#define PBR_PROFILE_GPU_SCOPE(name) ((void) 0)
+#define PBR_PROFILE_END_FRAME() ((void) 0)
+
+#endif
+
+#endif //PHYSICALLYBASEDRENDERER_PROFILER
@@ -0,0 +1,134 @@
+#ifndef PHYSICALLYBASEDRENDERER_RADIANCEHDRFILE
+#define PHYSICALLYBASEDRENDERER_RADIANCEHDRFILE
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "core/ThreadPool.h"
+
+namespace PBR {
+
+class MappedFile;
+
+/**
+ * How long it took to decode an image.
+ */
+struct HDRDecodeStatistics {
+
+    /**
+     * The size of the encoded file.
+     */
+    size_t fileBytes;
+
+    double milliseconds;
+
+    /**
+     * @return The rate at which the file was decoded, in megabytes of encoded data per second
+     */
+    double megabytesPerSecond() const;
+};
+
+/**
+ * A Radiance RGBE (.hdr) image file, memory-mapped and decoded in parallel.
+ *
+ * Opening the file only parses the header and finds where each scanline
+ * starts, which has to be done in order since run-length encoded scanlines
+ * vary in length. The scanlines are then decoded independently across the
+ * threads of a pool, straight into the caller's buffer.
+ *
+ * Both the new-style run-length encoding and uncompressed files are supported,
+ * with the standard -Y +X or +Y +X orientation. Other files are reported as
+ * invalid, so that the caller can fall back to a general-purpose loader.
+ */
+class RadianceHDRFile {
+private:
+    std::unique_ptr<MappedFile> file;
+
+    unsigned int imageWidth;
+    unsigned int imageHeight;
+
+    /**
+     * Whether the first scanline in the file is the top of the image.
+     */
+    bool topToBottom;
+
+    /**
+     * Whether the scanlines are run-length encoded.
+     */
+    bool runLengthEncoded;
+
+    /**
+     * The offset of each scanline in the file, in file order.
+     */
+    std::vector<size_t> scanlineOffsets;
+
+public:
+    /**
+     * Maps the file into memory and reads its header.
+     *
+     * @param path The path to the .hdr file
+     */
+    explicit RadianceHDRFile(const std::filesystem::path& path);
+    ~RadianceHDRFile();
+
+    RadianceHDRFile(const RadianceHDRFile&) = delete;
+    RadianceHDRFile& operator=(const RadianceHDRFile&) = delete;
+
+    /**
+     * @return Whether the file could be read and is in a format that we can decode
+     */
+    bool isValid() const;
+
+    unsigned int width() const;
+
+    unsigned int height() const;
+
+    /**
+     * Decodes the image to half floats, three per pixel. This is the layout that
+     * `GL_RGB16F` textures are uploaded from, so the output can be a mapped
+     * pixel buffer object.
+     *
+     * Values too large for a half float are clamped to the largest finite one.
+     *
+     * @param output Space for width * height * 3 half floats
+     * @param flipVertically Whether to store the bottom row of the image first,
+     *                       which is what `Texture` does with HDR images
+     * @param threadPool The pool to decode on
+     * @return How long the decode took, or nothing if the file is corrupt
+     */
+    std::optional<HDRDecodeStatistics> decodeToHalf(uint16_t* output, bool flipVertically,
+                                                    ThreadPool& threadPool = ThreadPool::shared()) const;
+
+    /**
+     * Decodes the image to floats, three per pixel.
+     *
+     * @param output Space for width * height * 3 floats
+     * @param flipVertically Whether to store the bottom row of the image first
+     * @param threadPool The pool to decode on
+     * @return How long the decode took, or nothing if the file is corrupt
+     */
+    std::optional<HDRDecodeStatistics> decodeToFloat(float* output, bool flipVertically,
+                                                     ThreadPool& threadPool = ThreadPool::shared()) const;
+
+private:
+    /**
+     * Reads the header and finds the start of each scanline.
+     */
+    bool parse();
+
+    /**
+     * Decodes every scanline in parallel, converting each to floats and then
+     * passing it to `writeRow` along with the row of the output it belongs in.
+     */
+    std::optional<HDRDecodeStatistics> decode(bool flipVertically, ThreadPool& threadPool,
+                                              const std::function<void(const float*, unsigned int)>& writeRow) const;
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_RADIANCEHDRFILE
@@ -0,0 +1,72 @@
+#ifndef PHYSICALLYBASEDRENDERER_RANGEALLOCATOR
+#define PHYSICALLYBASEDRENDERER_RANGEALLOCATOR
+
+#include <cstddef>
+#include <map>
+#include <optional>
+
+namespace PBR {
+
+/**
+ * Hands out ranges of a fixed amount of space, such as a buffer object, and
+ * takes them back.
+ *
+ * The free ranges are kept both in order of offset, so that freed ranges can be
+ * merged with their neighbours, and in order of size, so that each allocation
+ * takes the smallest range it fits in. Both take logarithmic time. The allocator
+ * only does the bookkeeping, so the units are up to the caller.
+ */
+class RangeAllocator {
+private:
+    /**
+     * The free ranges as offset to size.
+     */
+    std::map<size_t, size_t> freeRangesByOffset;
+
+    /**
+     * The free ranges as size to offset.
+     */
+    std::multimap<size_t, size_t> freeRangesBySize;
+
+    size_t capacity;
+    size_t freeSpace;
+
+public:
+    explicit RangeAllocator(size_t capacity);
+
+    /**
+     * @return The offset of the allocated range, or nothing if no free range is
+     *         big enough. There may still be enough free space in total, split
+     *         across several ranges.
+     */
+    std::optional<size_t> allocate(size_t size);
+
+    /**
+     * Returns a range that was allocated earlier.
+     */
+    void free(size_t offset, size_t size);
+
+    /**
+     * Adds space at the end.
+     */
+    void grow(size_t newCapacity);
+
+    /**
+     * Forgets every allocation except a single one covering the first `used`
+     * units, for after the caller has moved everything to the start.
+     */
+    void compact(size_t used);
+
+    size_t getCapacity() const;
+
+    size_t getFreeSpace() const;
+
+private:
+    void addFreeRange(size_t offset, size_t size);
+
+    void removeFreeRange(std::map<size_t, size_t>::iterator range);
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_RANGEALLOCATOR
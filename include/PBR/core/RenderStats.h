@@ -0,0 +1,73 @@
+#ifndef PHYSICALLYBASEDRENDERER_RENDERSTATS
+#define PHYSICALLYBASEDRENDERER_RENDERSTATS
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PBR {
+
+/**
+ * Counts the work submitted to OpenGL while rendering a frame.
+ *
+ * Each thread has its own stats for the frame in progress, returned by
+ * `current()`. `ShaderProgram` and `UniformBuffer` count the uniforms, texture
+ * bindings and uploads they make, and renderers count their draw calls, objects
+ * and state changes. Keeping the stats per thread means that precomputation on
+ * a `BackgroundBaker` isn't counted as part of the render thread's frames.
+ */
+struct RenderStats {
+    unsigned int drawCalls{0};
+
+    size_t triangles{0};
+
+    unsigned int objectsDrawn{0};
+
+    /**
+     * Objects skipped because they weren't visible.
+     */
+    unsigned int objectsCulled{0};
+
+    /**
+     * Calls to `glUseProgram`.
+     */
+    unsigned int programSwitches{0};
+
+    unsigned int textureBinds{0};
+
+    unsigned int vaoBinds{0};
+
+    /**
+     * Calls to `glUniform*`.
+     */
+    unsigned int uniformCalls{0};
+
+    /**
+     * Bytes passed to OpenGL in uniforms and buffer updates.
+     */
+    size_t bytesUploaded{0};
+
+    /**
+     * Vertex and fragment shader invocations counted by the driver. These are
+     * only measured while the `debug::OverdrawHeatmap` is shown, on drivers with
+     * `ARB_pipeline_statistics_query`, and lag a frame behind the other counters.
+     */
+    uint64_t vertexShaderInvocations{0};
+    uint64_t fragmentShaderInvocations{0};
+
+    RenderStats& operator+=(const RenderStats& other);
+
+    /**
+     * @return The stats being recorded on the calling thread
+     */
+    static RenderStats& current();
+
+    /**
+     * Returns the stats recorded on the calling thread so far and starts counting
+     * from zero again. `RendererDriver` calls this around each frame.
+     */
+    static RenderStats takeCurrent();
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_RENDERSTATS
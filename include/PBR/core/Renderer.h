@@ -3,7 +3,7 @@
 
 #include <memory>
 
-#include "core/Camera.h"
+#include "core/FrameSnapshot.h"
 
 namespace PBR {
 
@@ -23,11 +23,15 @@ public:
     /**
      * Render the scene.
      *
+     * The camera, the objects' transforms and the lights are taken from the
+     * snapshot rather than the scene, which may be being updated by another
+     * thread. Element i of the snapshot's per-object vectors belongs to the ith
+     * object in the scene.
+     *
      * @param scene The scene to render
-     * @param camera The current Camera
-     * @param time The current time
+     * @param frame The state of the frame to render
      */
-    virtual void render(std::shared_ptr<SceneType> scene, const Camera& camera, double time) = 0;
+    virtual void render(std::shared_ptr<SceneType> scene, const FrameSnapshot& frame) = 0;
 };
 
 } // namespace PBR
@@ -1,14 +1,20 @@
 #ifndef PHYSICALLYBASEDRENDERER_RENDERERDRIVER
 #define PHYSICALLYBASEDRENDERER_RENDERERDRIVER
 
+#include <atomic>
 #include <memory>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
 #include "Camera.h"
+#include "core/FrameSnapshot.h"
+#include "core/RenderStats.h"
 #include "core/Renderer.h"
 #include "core/Scene.h"
+#include "core/Texture.h"
+#include "debug/OverdrawHeatmap.h"
+#include "debug/PerformanceOverlay.h"
 
 #define DEFAULT_MOVE_SPEED 2.0f
 #define DEFAULT_TURN_SPEED 0.8f
@@ -38,6 +44,17 @@ struct MovementState {
 /**
  * Manages moving a Camera according to user inputs and uses this
  * to call the render() method of a Renderer object.
+ *
+ * Pressing F3 toggles a `debug::PerformanceOverlay` showing the recent frame
+ * times and the render stats of the last frame, and F4 toggles a
+ * `debug::OverdrawHeatmap` in place of the rendered scene.
+ *
+ * The camera and the debug views can be driven from different threads. The
+ * camera is moved by `update`, `setAspectRatio` and `onCameraKeyboardEvent`,
+ * and read by `captureSnapshot`, which must all be called from the same thread.
+ * The debug views are drawn by `render` and toggled by
+ * `onDebugViewKeyboardEvent`, which must be called from the thread that owns the
+ * OpenGL context.
  */
 template<class SceneType>
 class RendererDriver {
@@ -48,6 +65,27 @@ private:
     float turnSpeed;
     std::shared_ptr<Renderer<SceneType>> renderer;
     std::shared_ptr<SceneType> scene;
+    RenderStats lastFrameStats;
+
+    /**
+     * Created the first time it is shown, since it compiles its own shaders.
+     */
+    std::unique_ptr<debug::PerformanceOverlay> performanceOverlay;
+    bool performanceOverlayVisible;
+
+    std::unique_ptr<debug::OverdrawHeatmap> overdrawHeatmap;
+    bool overdrawHeatmapVisible;
+
+    /**
+     * Whether something besides the scene has changed what should be drawn,
+     * such as the aspect ratio or which debug views are shown.
+     */
+    std::atomic<bool> frameInvalidated;
+
+    /**
+     * Reused by `render(float)` to avoid reallocating its vectors every frame.
+     */
+    FrameSnapshot snapshot;
 
 public:
     RendererDriver(std::shared_ptr<Renderer<SceneType>> renderer, float aspectRatio, std::shared_ptr<SceneType> scene);
@@ -56,25 +94,76 @@ public:
 
     /**
      * Update the state for a new frame.
+     *
+     * @return Whether the camera is moving, in which case the frame needs redrawing
+     */
+    bool update(float dt);
+
+    /**
+     * Adds a frame's duration to the performance overlay's graph, if it has been
+     * shown.
+     */
+    void recordFrameTime(float dt);
+
+    /**
+     * Records the current state of the camera and scene, ready to be rendered.
+     */
+    void captureSnapshot(FrameSnapshot& frame, double time) const;
+
+    /**
+     * @return Whether the last frame drawn is out of date, because the scene or
+     *         the view has changed since, because textures have better mipmaps
+     *         on the way, or because the performance overlay is shown and its
+     *         frame times change every frame
+     */
+    bool needsRender() const;
+
+    /**
+     * Marks the last frame drawn as out of date, such as when the window's
+     * contents have been lost.
      */
-    void update(float dt);
+    void invalidate();
 
     /**
-     * Render to the window using the driven renderer.
+     * Render the current state of the camera and scene to the window using the
+     * driven renderer.
      */
     void render(float time);
 
+    /**
+     * Render a snapshot to the window using the driven renderer.
+     */
+    void render(const FrameSnapshot& frame);
+
+    /**
+     * @return What was submitted to OpenGL to render the last frame, not
+     *         including the performance overlay
+     */
+    const RenderStats& getRenderStats() const;
+
     /**
      * Respond to a keyboard event.
      */
     void onKeyboardEvent(int key, int scancode, int action, int mods);
+
+    /**
+     * Respond to the keys that move the camera, ignoring any others.
+     */
+    void onCameraKeyboardEvent(int key, int action);
+
+    /**
+     * Respond to the keys that toggle the debug views, ignoring any others.
+     */
+    void onDebugViewKeyboardEvent(int key, int action);
 };
 
 template<class SceneType>
 RendererDriver<SceneType>::RendererDriver(std::shared_ptr<Renderer<SceneType>> renderer, float aspectRatio,
                                           std::shared_ptr<SceneType> scene)
         :camera(glm::vec3(0.0f, 0.0f, 5.0f), aspectRatio), movementState(), moveSpeed(DEFAULT_MOVE_SPEED),
-         turnSpeed(DEFAULT_TURN_SPEED), renderer(std::move(renderer)), scene(std::move(scene))
+         turnSpeed(DEFAULT_TURN_SPEED), renderer(std::move(renderer)), scene(std::move(scene)), lastFrameStats(),
+         performanceOverlay(), performanceOverlayVisible(false), overdrawHeatmap(), overdrawHeatmapVisible(false),
+         frameInvalidated(true), snapshot()
 {
     this->renderer->activate();
 }
@@ -83,10 +172,11 @@ template<class SceneType>
 void RendererDriver<SceneType>::setAspectRatio(float aspectRatio)
 {
     camera.setAspectRatio(aspectRatio);
+    frameInvalidated = true;
 }
 
 template<class SceneType>
-void RendererDriver<SceneType>::update(float dt)
+bool RendererDriver<SceneType>::update(float dt)
 {
     float movementDistance = moveSpeed * dt;
     float rotationAngle = turnSpeed * dt;
@@ -120,16 +210,91 @@ void RendererDriver<SceneType>::update(float dt)
 
     if (movementState.rotatingDown && !movementState.rotatingUp)
         camera.rotateDown(rotationAngle);
+
+    // The camera keeps moving for as long as any of its keys are held
+    return movementState.movingForwards || movementState.movingBackwards || movementState.movingLeft
+           || movementState.movingRight || movementState.movingUp || movementState.movingDown
+           || movementState.rotatingUp || movementState.rotatingDown || movementState.rotatingLeft
+           || movementState.rotatingRight;
+}
+
+template<class SceneType>
+void RendererDriver<SceneType>::recordFrameTime(float dt)
+{
+    if (performanceOverlay) {
+        performanceOverlay->addFrameTime(dt);
+    }
+}
+
+template<class SceneType>
+void RendererDriver<SceneType>::captureSnapshot(FrameSnapshot& frame, double time) const
+{
+    frame.capture(*scene, camera, time);
+}
+
+template<class SceneType>
+bool RendererDriver<SceneType>::needsRender() const
+{
+    return frameInvalidated || performanceOverlayVisible || scene->needsRedraw() || Texture::hasPendingMipmaps();
+}
+
+template<class SceneType>
+void RendererDriver<SceneType>::invalidate()
+{
+    frameInvalidated = true;
 }
 
 template<class SceneType>
 void RendererDriver<SceneType>::render(float time)
 {
-    renderer->render(scene, camera, time);
+    captureSnapshot(snapshot, time);
+    render(snapshot);
+}
+
+template<class SceneType>
+void RendererDriver<SceneType>::render(const FrameSnapshot& frame)
+{
+    // Swap in any mipmaps that have finished filtering on the CPU
+    Texture::uploadFinishedMipmaps();
+
+    // Discard anything counted between frames, such as loading
+    RenderStats::takeCurrent();
+    if (overdrawHeatmapVisible) {
+        overdrawHeatmap->beginCounting();
+    }
+    renderer->render(scene, frame);
+    if (overdrawHeatmapVisible) {
+        overdrawHeatmap->endCounting();
+    }
+    lastFrameStats = RenderStats::takeCurrent();
+
+    if (overdrawHeatmapVisible) {
+        overdrawHeatmap->render();
+    }
+
+    if (performanceOverlayVisible) {
+        performanceOverlay->render(lastFrameStats);
+    }
+
+    frameInvalidated = false;
+    scene->markRedrawn();
+}
+
+template<class SceneType>
+const RenderStats& RendererDriver<SceneType>::getRenderStats() const
+{
+    return lastFrameStats;
 }
 
 template<class SceneType>
 void RendererDriver<SceneType>::onKeyboardEvent(int key, int scancode, int action, int mods)
+{
+    onCameraKeyboardEvent(key, action);
+    onDebugViewKeyboardEvent(key, action);
+}
+
+template<class SceneType>
+void RendererDriver<SceneType>::onCameraKeyboardEvent(int key, int action)
 {
     switch (key) {
 
@@ -208,6 +373,37 @@ void RendererDriver<SceneType>::onKeyboardEvent(int key, int scancode, int actio
     }
 }
 
+template<class SceneType>
+void RendererDriver<SceneType>::onDebugViewKeyboardEvent(int key, int action)
+{
+    switch (key) {
+
+    case GLFW_KEY_F3:
+        if (action == GLFW_PRESS) {
+            if (!performanceOverlay) {
+                performanceOverlay = std::make_unique<debug::PerformanceOverlay>();
+            }
+            performanceOverlayVisible = !performanceOverlayVisible;
+            frameInvalidated = true;
+        }
+        break;
+
+    case GLFW_KEY_F4:
+        if (action == GLFW_PRESS) {
+            if (!overdrawHeatmap) {
+                overdrawHeatmap = std::make_unique<debug::OverdrawHeatmap>();
+            }
+            overdrawHeatmapVisible = !overdrawHeatmapVisible;
+            overdrawHeatmap->reset();
+            frameInvalidated = true;
+        }
+        break;
+
+    default: break;
+
+    }
+}
+
 } // namespace PBR
 
 #endif //PHYSICALLYBASEDRENDERER_RENDERERDRIVER
@@ -1,6 +1,7 @@
 #ifndef PHYSICALLYBASEDRENDERER_SCENE
 #define PHYSICALLYBASEDRENDERER_SCENE
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -49,6 +50,14 @@ private:
      */
     glm::vec3 backgroundColour;
 
+    /**
+     * Whether the scene has changed since it was last drawn. Atomic because an
+     * update thread may invalidate the scene while the render thread draws it.
+     */
+    std::atomic<bool> invalidated;
+
+    void rebuildLightArrays();
+
 public:
 
     /**
@@ -70,6 +79,31 @@ public:
     const std::vector<float>& getLightIntensities() const;
 
     glm::vec3 getBackgroundColour() const;
+
+    /**
+     * Replaces the lights in the scene.
+     *
+     * When the scene is rendered with `Window::loopUntilClosedWithUpdateThread`,
+     * this may be called from the update thread, since renderers read the lights
+     * from the `FrameSnapshot` instead.
+     */
+    void setLights(std::vector<PointLightSource> lights);
+
+    /**
+     * Marks the scene as changed, so that it is redrawn when the window only
+     * renders on demand. Call this after moving objects or changing their materials.
+     */
+    void invalidate();
+
+    /**
+     * @return Whether the scene has changed since it was last drawn
+     */
+    bool needsRedraw() const;
+
+    /**
+     * Called by `RendererDriver` once the scene has been drawn.
+     */
+    void markRedrawn();
 };
 
 template<class SceneObjectType>
@@ -79,9 +113,19 @@ Scene<SceneObjectType>::Scene(std::vector<std::shared_ptr<SceneObjectType>> scen
          lights(std::move(lights)),
          lightPositions(),
          lightColours(),
-         backgroundColour(backgroundColour)
+         backgroundColour(backgroundColour),
+         invalidated(true)
 {
-    for (const PointLightSource& light : this->lights) {
+    rebuildLightArrays();
+}
+
+template<class SceneObjectType>
+void Scene<SceneObjectType>::rebuildLightArrays()
+{
+    lightPositions.clear();
+    lightColours.clear();
+    lightIntensitites.clear();
+    for (const PointLightSource& light : lights) {
         lightPositions.push_back(light.pos);
         lightColours.push_back(light.colour);
         lightIntensitites.push_back(light.intensity);
@@ -124,6 +168,32 @@ glm::vec3 Scene<SceneObjectType>::getBackgroundColour() const
     return backgroundColour;
 }
 
+template<class SceneObjectType>
+void Scene<SceneObjectType>::setLights(std::vector<PointLightSource> lights)
+{
+    this->lights = std::move(lights);
+    rebuildLightArrays();
+    invalidate();
+}
+
+template<class SceneObjectType>
+void Scene<SceneObjectType>::invalidate()
+{
+    invalidated = true;
+}
+
+template<class SceneObjectType>
+bool Scene<SceneObjectType>::needsRedraw() const
+{
+    return invalidated;
+}
+
+template<class SceneObjectType>
+void Scene<SceneObjectType>::markRedrawn()
+{
+    invalidated = false;
+}
+
 } // namespace PBR
 
 #endif //PHYSICALLYBASEDRENDERER_SCENE
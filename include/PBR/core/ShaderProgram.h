@@ -3,6 +3,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <glm/vec3.hpp>
@@ -11,6 +12,7 @@
 
 #include "core/ShaderProgram.h"
 #include "core/Texture.h"
+#include "core/UniformBuffer.h"
 
 namespace PBR {
 
@@ -18,7 +20,8 @@ namespace PBR {
 namespace phong { class Skybox; }
 
 /**
- * Wraps a shader program containing a vertex and fragment shader.
+ * Wraps a shader program containing a vertex and fragment shader, and
+ * optionally a geometry shader, or else a single compute shader.
  */
 class ShaderProgram {
 private:
@@ -32,8 +35,46 @@ private:
      */
     unsigned int texturesCount{0};
 
+    /**
+     * The number of uniform blocks bound so far.
+     */
+    unsigned int uniformBlocksCount{0};
+
 public:
-    ShaderProgram(const std::filesystem::path& vertexShaderLocation, const std::filesystem::path& fragmentShaderLocation);
+    /**
+     * Loads, compiles and links a shader program.
+     *
+     * @param vertexShaderLocation The path to the vertex shader source
+     * @param fragmentShaderLocation The path to the fragment shader source
+     * @param defines Preprocessor symbols to define in both shaders, for compiling
+     *                different variants of the same source
+     */
+    ShaderProgram(const std::filesystem::path& vertexShaderLocation, const std::filesystem::path& fragmentShaderLocation,
+                  const std::vector<std::string>& defines = {});
+
+    /**
+     * Loads, compiles and links a shader program with a geometry shader.
+     *
+     * @param vertexShaderLocation The path to the vertex shader source
+     * @param geometryShaderLocation The path to the geometry shader source
+     * @param fragmentShaderLocation The path to the fragment shader source
+     * @param defines Preprocessor symbols to define in all three shaders. This has
+     *                no default, to keep the two constructors distinguishable.
+     */
+    ShaderProgram(const std::filesystem::path& vertexShaderLocation,
+                  const std::filesystem::path& geometryShaderLocation,
+                  const std::filesystem::path& fragmentShaderLocation,
+                  const std::vector<std::string>& defines);
+
+    /**
+     * Loads, compiles and links a compute shader program. This needs OpenGL 4.3.
+     *
+     * @param computeShaderLocation The path to the compute shader source
+     * @param defines Preprocessor symbols to define in the shader
+     */
+    explicit ShaderProgram(const std::filesystem::path& computeShaderLocation,
+                           const std::vector<std::string>& defines = {});
+
     ~ShaderProgram();
 
     /**
@@ -57,7 +98,21 @@ public:
     void setUniform(const std::string& name, const std::vector<glm::vec3>& values);
     void setUniform(const std::string& name, const std::shared_ptr<Texture>& texture);
     void setUniform(const std::string& name, const std::shared_ptr<phong::Skybox>& skybox);
+    void setUniform(const std::string& name, const std::shared_ptr<UniformBuffer>& uniformBlock);
 
+    /**
+     * Assigns a binding point to a uniform block without binding a buffer to it,
+     * for callers that bind a different range of a buffer for each draw.
+     *
+     * @return The binding point, which is unbound again by `resetUniforms`
+     */
+    unsigned int reserveUniformBlock(const std::string& name);
+
+private:
+    /**
+     * Links the compiled shaders into the program, then deletes them.
+     */
+    void linkShaders(const std::vector<unsigned int>& shaders);
 };
 
 } // namespace PBR
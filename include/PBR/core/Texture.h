@@ -2,14 +2,24 @@
 #define PHYSICALLYBASEDRENDERER_TEXTURE
 
 #include <filesystem>
+#include <memory>
+#include <optional>
 
 #define GL_SILENCE_DEPRECATION
 #define GLFW_INCLUDE_NONE
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "core/HDRImage.h"
+#include "core/MipGenerator.h"
+
 namespace PBR {
 
+/**
+ * Mipmap levels being filtered on the thread pool for a texture.
+ */
+struct PendingMipmapUpload;
+
 /**
  * Wraps an OpenGL texture object.
  */
@@ -17,32 +27,111 @@ class Texture {
 private:
     unsigned int textureId;
 
+    /**
+     * The target that the texture is bound to, e.g. GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP.
+     */
+    unsigned int textureTarget;
+
+    /**
+     * The mipmap levels still being filtered on the CPU for this texture, if any.
+     * The filtering task only holds a weak reference, so the levels are thrown
+     * away if the texture is deleted first.
+     */
+    std::shared_ptr<PendingMipmapUpload> pendingMipmap;
+
 public:
     /**
      * Create a texture object without initialising it.
+     *
+     * @param target The target that the texture will be bound to
      */
-    Texture();
+    explicit Texture(unsigned int target = GL_TEXTURE_2D);
 
     /**
      * Create and initialise a texture by loading from the specified image file.
      *
+     * If the file is a .dds file, or a .dds file with the same name has been
+     * generated next to it by the `CompressTextures` tool, then the BC6H/BC7
+     * compressed blocks and mipmap chain are uploaded directly instead.
+     *
      * This object assumes ownership of the underlying OpenGL texture object and
      * will safely handle its deletion.
      *
      * @param texturePath The path to the image file
      * @param isHDR Whether the file contains floating-point HDR data rather than
-     *              unsigned chars
+     *              unsigned chars. HDR images are taken to be equirectangular
+     *              environment maps, so they repeat horizontally but are clamped
+     *              vertically, at the poles.
      * @param wrappingMode The wrapping mode to use
      * @param filteringMode The filtering mode to use
      */
     explicit Texture(const std::filesystem::path& texturePath, bool isHDR = false, bool createMipmap = true);
 
+    /**
+     * Create and initialise an HDR texture from an image that has already been
+     * loaded into memory. Like HDR images loaded from files, it is taken to be an
+     * equirectangular environment map.
+     *
+     * @param image The image to upload
+     * @param createMipmap Whether to generate a mipmap chain
+     */
+    explicit Texture(const HDRImage& image, bool createMipmap = true);
+
     Texture(const Texture&) = delete;
     Texture& operator=(const Texture&) = delete;
 
     ~Texture();
 
     unsigned int id() const;
+
+    /**
+     * @return The target that the texture is bound to
+     */
+    unsigned int target() const;
+
+    /**
+     * Chooses how the mipmap chains of textures loaded from images are generated.
+     *
+     * With a filter, the chain is filtered on the CPU by a task on the shared
+     * pool, so loading never waits for it. Until `uploadFinishedMipmaps` finds
+     * the levels ready, the texture's maximum level is held at zero, so only the
+     * base level is sampled. By default `MipFilter::Kaiser` is used.
+     *
+     * @param filter The filter to use, or nothing to leave it to `glGenerateMipmap`
+     */
+    static void setMipmapFilter(std::optional<MipFilter> filter);
+
+    /**
+     * @return The filter used to generate mipmap chains, or nothing if it is left to the driver
+     */
+    static std::optional<MipFilter> mipmapFilter();
+
+    /**
+     * Uploads the mipmap levels that have finished filtering on the CPU since the
+     * last call. `RendererDriver` calls this at the start of every frame. It must
+     * be called on the main thread, whose context shares textures with any other.
+     */
+    static void uploadFinishedMipmaps();
+
+    /**
+     * @return Whether any mipmap levels are still being filtered or waiting to be uploaded
+     */
+    static bool hasPendingMipmaps();
+
+private:
+    /**
+     * Uploads a block-compressed texture stored in a .dds file.
+     */
+    void loadCompressed(const std::filesystem::path& texturePath, bool createMipmap);
+
+    /**
+     * Decodes a Radiance .hdr file straight into a pixel buffer object as half
+     * floats, and uploads the texture from there. If the mipmap is filtered on
+     * the CPU, the filtering task decodes the file again to floats for itself.
+     *
+     * @return Whether the file could be decoded. If not, nothing is uploaded.
+     */
+    bool loadRadianceHDR(const std::filesystem::path& texturePath, bool createMipmap);
 };
 
 } // namespace PBR
@@ -9,6 +9,40 @@
 
 namespace PBR {
 
+/**
+ * A rectangle within one face and mipmap level of an allocated texture.
+ */
+struct TextureRegion {
+    /**
+     * The cubemap face, in the order +X, -X, +Y, -Y, +Z, -Z. Ignored for 2D textures.
+     */
+    unsigned int face;
+
+    unsigned int mipmapLevel;
+
+    /**
+     * The size of the whole mipmap level.
+     */
+    unsigned int levelWidth;
+    unsigned int levelHeight;
+
+    /**
+     * The rectangle to render, in pixels from the bottom-left corner of the level.
+     */
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+};
+
+/**
+ * Renders precomputed data into textures by drawing a fullscreen triangle with a
+ * given shader program. The vertex shader should be PrepVerticesForRenderingTexture.vert.
+ *
+ * The functions that allocate a texture need a texture with no storage yet. Each
+ * call binds the calling thread's `PrecomputationContext`; wrap many calls in a
+ * `PrecomputationBatch` to bind it only once.
+ */
 struct TexturePrecomputation {
     /**
      * Precomputes a texture using the supplied shader program.
@@ -18,9 +52,11 @@ struct TexturePrecomputation {
      * @param width The width of the texture, in pixels
      * @param height The height of the texture, in pixels
      * @param setUniforms A function that sets all uniforms required for the shader program
+     * @param internalFormat The sized internal format to allocate the texture with
      */
     static void renderToTexture(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
-                                unsigned int width, unsigned int height, const std::function<void()>& setUniforms);
+                                unsigned int width, unsigned int height, const std::function<void()>& setUniforms,
+                                unsigned int internalFormat = GL_RGB8);
 
     /**
      * Precomputes each level of a mipmapped texture using the supplied shader program.
@@ -35,6 +71,106 @@ struct TexturePrecomputation {
     static void renderToMipmappedTexture(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
                                          unsigned int maxWidth, unsigned int maxHeight, unsigned int mipmapLevels,
                                          const std::function<void(unsigned int)>& setUniforms);
+
+    /**
+     * Precomputes each face and mipmap level of a cubemap using the supplied shader program.
+     *
+     * The shader is run once per face per mipmap level. The index of the face being
+     * rendered, in the order +X, -X, +Y, -Y, +Z, -Z, is passed to the shader in the
+     * `cubemapFace` uniform so that it can map its texture coordinates to a direction.
+     *
+     * @param texture The cubemap texture to write to
+     * @param shaderProgram The shader program to use
+     * @param faceSize The width and height of each face in the base mipmap level
+     * @param mipmapLevels The number of mipmap levels to render
+     * @param setUniforms A function that sets the uniforms for a given mipmap level
+     * @param internalFormat The sized internal format to allocate the texture with
+     */
+    static void renderToCubemap(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
+                                unsigned int faceSize, unsigned int mipmapLevels,
+                                const std::function<void(unsigned int)>& setUniforms,
+                                unsigned int internalFormat = GL_RGB16F);
+
+    /**
+     * Precomputes every mipmap level of every layer of a 2D array or cubemap array
+     * texture, covering many layers with each draw.
+     *
+     * The shader program must include PrepVerticesForLayeredRendering.geom and be
+     * compiled with `LAYERED` defined, plus `CUBEMAP_ARRAY` for cubemap arrays. Each
+     * draw renders one instance per layer. The fragment shader receives the index of
+     * the layer within the draw in `layerInDraw`, for indexing per-layer uniform
+     * arrays, and the cubemap face in `cubemapFaceInLayer`.
+     *
+     * @param texture The 2D array or cubemap array texture to write to
+     * @param shaderProgram The shader program to use
+     * @param internalFormat The sized internal format to allocate the texture with
+     * @param width The width of the base mipmap level
+     * @param height The height of the base mipmap level
+     * @param mipmapLevels The number of mipmap levels to render
+     * @param layerCount The number of layers, counting each cubemap of a cubemap array once
+     * @param layersPerDraw The most layers that one draw can cover, which is limited by
+     *                      the size of the shader's per-layer uniform arrays
+     * @param setUniforms A function that sets the uniforms for a draw, given the mipmap
+     *                    level, the first layer and the number of layers
+     */
+    static void renderToLayers(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
+                               unsigned int internalFormat, unsigned int width, unsigned int height,
+                               unsigned int mipmapLevels, unsigned int layerCount, unsigned int layersPerDraw,
+                               const std::function<void(unsigned int, unsigned int, unsigned int)>& setUniforms);
+
+    /**
+     * Precomputes each mipmap level (and each face, for cubemaps) of a texture using
+     * a compute shader instead of rasterisation.
+     *
+     * The shader must declare `layout (FORMAT, binding = 0) uniform writeonly`
+     * `image2D` or `imageCube` to write to, where FORMAT matches `internalFormat`
+     * (`rgba16f` for `GL_RGBA16F`, for example). It is dispatched with enough work
+     * groups to cover one mipmap level, with the face index in `gl_GlobalInvocationID.z`
+     * for cubemaps, and can find the size of the level with `imageSize`.
+     *
+     * Image stores don't support three-component formats such as `GL_RGB16F`, so
+     * use `GL_RGBA16F` or `GL_R11F_G11F_B10F` instead.
+     *
+     * @param texture The 2D or cubemap texture to write to
+     * @param computeProgram The compute shader program to use
+     * @param width The width of the base mipmap level
+     * @param height The height of the base mipmap level
+     * @param mipmapLevels The number of mipmap levels to compute
+     * @param setUniforms A function that sets the uniforms for a given mipmap level
+     * @param internalFormat The sized internal format to allocate the texture with
+     */
+    static void computeToTexture(std::shared_ptr<Texture> texture, const ShaderProgram& computeProgram,
+                                 unsigned int width, unsigned int height, unsigned int mipmapLevels,
+                                 const std::function<void(unsigned int)>& setUniforms,
+                                 unsigned int internalFormat = GL_RGBA16F);
+
+    /**
+     * @return Whether the current context supports compute shaders, and they haven't
+     *         been disabled with `setComputeShadersEnabled`
+     */
+    static bool computeShadersAvailable();
+
+    /**
+     * Chooses whether the precomputations should use compute shaders when the context
+     * supports them, which is the default. This is mainly for comparing the two paths.
+     */
+    static void setComputeShadersEnabled(bool enabled);
+
+    /**
+     * Re-renders part of a texture that has already been allocated by one of the
+     * functions above, leaving the rest of it untouched.
+     *
+     * This allows expensive precomputations to be split into small pieces of work
+     * that can be spread across several frames. As with `renderToCubemap`, the face
+     * index is passed to the shader in the `cubemapFace` uniform.
+     *
+     * @param texture The 2D or cubemap texture to write to
+     * @param shaderProgram The shader program to use
+     * @param region The part of the texture to write
+     * @param setUniforms A function that sets all uniforms required for the shader program
+     */
+    static void renderToTextureRegion(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
+                                      const TextureRegion& region, const std::function<void()>& setUniforms);
 };
 
 } // namespace PBR
@@ -0,0 +1,76 @@
+#ifndef PHYSICALLYBASEDRENDERER_THREADPOOL
+#define PHYSICALLYBASEDRENDERER_THREADPOOL
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PBR {
+
+/**
+ * A fixed-size pool of worker threads for splitting CPU work into parallel
+ * chunks.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+
+    /**
+     * Tasks waiting to be picked up by a worker.
+     */
+    std::deque<std::function<void()>> tasks;
+
+    std::mutex tasksMutex;
+    std::condition_variable tasksAvailable;
+
+    bool stopping;
+
+public:
+    /**
+     * Creates a pool with the specified number of worker threads.
+     *
+     * @param numThreads The number of threads to create. Zero means one fewer than the
+     *                   number of hardware threads, since the calling thread also
+     *                   takes part in `parallelFor`.
+     */
+    explicit ThreadPool(unsigned int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @return The number of threads that can run work at once, including the caller
+     */
+    unsigned int concurrency() const;
+
+    /**
+     * Calls `body` for every index in [0, count), spreading the indices across
+     * the pool and the calling thread. Blocks until every call has returned.
+     *
+     * @param count The number of indices
+     * @param body The function to run for each index
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    /**
+     * Queues a task to be run on one of the worker threads, without waiting for it.
+     */
+    void enqueue(std::function<void()> task);
+
+    /**
+     * @return A pool shared by the whole library, created on first use
+     */
+    static ThreadPool& shared();
+
+private:
+    void workerLoop();
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_THREADPOOL
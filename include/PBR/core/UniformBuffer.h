@@ -0,0 +1,45 @@
+#ifndef PHYSICALLYBASEDRENDERER_UNIFORMBUFFER
+#define PHYSICALLYBASEDRENDERER_UNIFORMBUFFER
+
+#include <cstddef>
+
+namespace PBR {
+
+/**
+ * Wraps an OpenGL buffer object holding the contents of a uniform block.
+ */
+class UniformBuffer {
+private:
+    unsigned int bufferId;
+
+    size_t bufferSize;
+
+public:
+    /**
+     * Allocates a uniform buffer of the given size.
+     *
+     * @param size The size of the buffer in bytes
+     * @param data The initial contents, or nullptr to leave them undefined
+     */
+    explicit UniformBuffer(size_t size, const void* data = nullptr);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    /**
+     * Overwrites the start of the buffer.
+     *
+     * @param data The data to copy, laid out according to the block's std140 layout
+     * @param size The number of bytes to copy
+     */
+    void update(const void* data, size_t size);
+
+    unsigned int id() const;
+
+    size_t size() const;
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_UNIFORMBUFFER
@@ -0,0 +1,132 @@
+#ifndef PHYSICALLYBASEDRENDERER_UNIFORMRINGBUFFER
+#define PHYSICALLYBASEDRENDERER_UNIFORMRINGBUFFER
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#define GL_SILENCE_DEPRECATION
+#include <GL/glew.h>
+
+namespace PBR {
+
+/**
+ * A uniform buffer for data that is rewritten every frame, split into one region
+ * per frame in flight.
+ *
+ * Each frame writes to the next region, after waiting on a fence for the GPU to
+ * finish the frame that last used it. That frame is normally long finished, so
+ * the writes never stall and the driver never has to copy or synchronise them.
+ *
+ * When `ARB_buffer_storage` is available, the buffer stays mapped with
+ * `GL_MAP_PERSISTENT_BIT` and `GL_MAP_COHERENT_BIT`, so allocations point
+ * straight into it. Otherwise they point into a copy in memory that `flush`
+ * copies into the region through an unsynchronised mapping.
+ */
+class UniformRingBuffer {
+public:
+    static constexpr unsigned int regionCount = 3;
+
+    /**
+     * Space for some data in the current region.
+     */
+    struct Allocation {
+        /**
+         * Where to write the data. Only valid until the end of the frame.
+         */
+        void* data;
+
+        /**
+         * The offset of the data in the buffer, for `glBindBufferRange`.
+         */
+        size_t offset;
+    };
+
+private:
+    unsigned int bufferId;
+    size_t regionSize;
+    size_t alignment;
+
+    /**
+     * The persistent mapping of the whole buffer, or nullptr if it isn't
+     * persistently mapped.
+     */
+    unsigned char* persistentMapping;
+
+    /**
+     * Holds the current region's data until `flush` when the buffer isn't
+     * persistently mapped.
+     */
+    std::vector<unsigned char> staging;
+
+    /**
+     * Signalled when the GPU has finished the last frame to use each region.
+     */
+    std::array<GLsync, regionCount> fences;
+
+    unsigned int currentRegion;
+
+    /**
+     * The number of bytes of the current region that have been allocated.
+     */
+    size_t used;
+
+    /**
+     * The number of bytes of the current region already copied in by `flush`.
+     */
+    size_t flushed;
+
+public:
+    /**
+     * @param regionSize The number of bytes each frame can allocate
+     * @param alignment The value of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, which
+     *                  every allocation's offset is rounded up to
+     */
+    UniformRingBuffer(size_t regionSize, size_t alignment);
+    ~UniformRingBuffer();
+
+    UniformRingBuffer(const UniformRingBuffer&) = delete;
+    UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+    /**
+     * Moves on to the next region, waiting for the GPU to finish with it if it
+     * hasn't already.
+     */
+    void beginFrame();
+
+    /**
+     * Reserves space in the current region. The caller must make sure that a
+     * frame's allocations fit, using `allocationSize`.
+     */
+    Allocation allocate(size_t size);
+
+    /**
+     * Makes everything allocated so far visible to the GPU. Call this before the
+     * draws that read it.
+     */
+    void flush();
+
+    /**
+     * Marks the current region as in use until the GPU reaches this point.
+     */
+    void endFrame();
+
+    /**
+     * @return The space an allocation of a given size takes up in a region,
+     *         including padding for alignment
+     */
+    size_t allocationSize(size_t size) const;
+
+    unsigned int id() const;
+
+    size_t getRegionSize() const;
+
+    /**
+     * @return Whether the buffer is persistently mapped
+     */
+    bool isPersistent() const;
+};
+
+} // namespace PBR
+
+#endif //PHYSICALLYBASEDRENDERER_UNIFORMRINGBUFFER
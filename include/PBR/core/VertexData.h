@@ -4,22 +4,31 @@
 #include <memory>
 #include <vector>
 
+#include <glm/vec3.hpp>
+
 namespace PBR {
 
 /**
- * Contains a buffer of vertex data that has been sent to the GPU.
+ * A mesh that has been sent to the GPU.
  *
- * Supports dynamic data organisations and stride lengths.
+ * The data itself is held in the shared `MeshArena`, so this only records where
+ * it is: the vertex array object for its layout, the base vertex and the range
+ * of indices, which are what `glDrawElementsBaseVertex` takes. Meshes must be
+ * created on the main window's OpenGL context, since that is where the arena's
+ * vertex array objects live.
  */
 class VertexData {
 private:
-    std::shared_ptr<std::vector<float>> data;
-    std::shared_ptr<std::vector<unsigned int>> indices;
-    size_t stride;
-
     unsigned int vaoId;
-    unsigned int vboId;
-    unsigned int eboId;
+
+    /**
+     * The position of the mesh's vertices and indices in the arena's buffers,
+     * which the arena updates if it moves them.
+     */
+    size_t baseVertex;
+    size_t firstIndex;
+    size_t vertexCount;
+    size_t indicesCount;
 
     bool hasNormals;
     bool hasTextureCoordinates;
@@ -28,6 +37,12 @@ private:
     size_t normalsOffset;
     size_t textureCoordinatesOffset;
 
+    /**
+     * A sphere in model space containing every vertex, for culling.
+     */
+    glm::vec3 boundsCentre;
+    float boundsRadius;
+
 public:
     VertexData(std::shared_ptr<std::vector<float>> vertexData, std::shared_ptr<std::vector<unsigned int>> elementData,
                bool textured = true);
@@ -36,6 +51,8 @@ public:
     VertexData(const VertexData& other) = delete;
     void operator=(const VertexData& other) = delete;
 
+    friend class MeshArena;
+
     /**
      * Whether this vertex data includes normals.
      */
@@ -65,11 +82,26 @@ public:
      */
     size_t getTextureCoordinatesOffset() const;
 
+    /**
+     * The vertex array object shared by every mesh with the same layout.
+     */
     unsigned int getVaoId() const;
 
-    unsigned int getVboId() const;
+    /**
+     * The value to add to each index, for `glDrawElementsBaseVertex`.
+     */
+    int getBaseVertex() const;
 
-    unsigned int getEboId() const;
+    /**
+     * The position of the first index in the element buffer.
+     */
+    unsigned int getFirstIndex() const;
+
+    /**
+     * The byte offset of the first index, for the `indices` parameter of
+     * `glDrawElementsBaseVertex`.
+     */
+    const void* getIndicesOffset() const;
 
     /**
      * The number of triangles pointed to by this data.
@@ -81,8 +113,18 @@ public:
      */
     unsigned int verticesCount() const;
 
+    /**
+     * The centre of a sphere in model space that contains every vertex.
+     */
+    glm::vec3 getBoundingSphereCentre() const;
+
+    /**
+     * The radius of a sphere in model space that contains every vertex.
+     */
+    float getBoundingSphereRadius() const;
+
 private:
-    void initBuffers();
+    void computeBounds(const std::vector<float>& data);
 };
 
 inline
@@ -124,27 +166,45 @@ unsigned int VertexData::getVaoId() const
 }
 
 inline
-unsigned int VertexData::getVboId() const
+int VertexData::getBaseVertex() const
+{
+    return (int) baseVertex;
+}
+
+inline
+unsigned int VertexData::getFirstIndex() const
 {
-    return vboId;
+    return firstIndex;
 }
 
 inline
-unsigned int VertexData::getEboId() const
+const void* VertexData::getIndicesOffset() const
 {
-    return eboId;
+    return (const void*) (firstIndex * sizeof(unsigned int));
 }
 
 inline
 unsigned int VertexData::trianglesCount() const
 {
-    return indices->size() / 3;
+    return indicesCount / 3;
 }
 
 inline
 unsigned int VertexData::verticesCount() const
 {
-    return indices->size();
+    return indicesCount;
+}
+
+inline
+glm::vec3 VertexData::getBoundingSphereCentre() const
+{
+    return boundsCentre;
+}
+
+inline
+float VertexData::getBoundingSphereRadius() const
+{
+    return boundsRadius;
 }
 
 } // namespace PBR
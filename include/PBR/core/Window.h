@@ -2,19 +2,27 @@
 #define PHYSICALLYBASEDRENDERER_WINDOW
 
 #include <any>
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #define GL_SILENCE_DEPRECATION
 #define GLFW_INCLUDE_NONE
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "core/BackgroundBaker.h"
 #include "core/ErrorCodes.h"
+#include "core/FrameSnapshotBuffer.h"
+#include "core/Profiler.h"
 #include "core/Renderer.h"
 #include "core/RendererDriver.h"
 #include "core/Scene.h"
@@ -31,15 +39,105 @@ class Window {
 private:
     GLFWwindow* window;
 
+    /**
+     * Created the first time it is requested, since most programs don't need one.
+     */
+    std::shared_ptr<BackgroundBaker> backgroundBaker;
+
+    /**
+     * Whether `loopUntilClosed` only draws frames when something has changed.
+     */
+    bool renderOnDemand;
+
+    /**
+     * Handles the keys that act on the window itself, whichever loop is running.
+     */
+    static void onWindowKeyboardEvent(GLFWwindow* theWindow, int key, int action);
+
+    static void onGLFWError(int error, const char* description);
+
 public:
-    Window(const std::string& title, int width, int height);
+    /**
+     * How long the main loop waits for events when rendering on demand, in
+     * seconds. It wakes up this often even without events so that the background
+     * baker is still polled.
+     */
+    static constexpr double onDemandWaitTimeout = 0.25;
+
+    /**
+     * @param visible Whether to show the window. Hidden windows still have a
+     *                context and framebuffer, so they can be used to render
+     *                without anything appearing on screen.
+     */
+    Window(const std::string& title, int width, int height, bool visible = true);
     ~Window();
 
+    /**
+     * Gets a baker whose context shares objects with this window's context.
+     *
+     * The baker's completion callbacks are run on the main thread once per
+     * frame by `loopUntilClosed`.
+     */
+    std::shared_ptr<BackgroundBaker> getBackgroundBaker();
+
+    /**
+     * Chooses whether swapping the buffers waits for the display's vertical sync.
+     * This is on by default, to avoid tearing.
+     */
+    void setVSyncEnabled(bool enabled);
+
+    /**
+     * Chooses whether `loopUntilClosed` only draws a frame when the camera moves,
+     * the scene is invalidated or the window's contents are lost. In between, it
+     * sleeps in `glfwWaitEventsTimeout` and leaves the last frame on screen, so an
+     * idle window uses almost no CPU or GPU time. This is off by default.
+     */
+    void setRenderOnDemand(bool enabled);
+
+    /**
+     * @return The width of the framebuffer divided by its height
+     */
+    float getAspectRatio() const;
+
+    /**
+     * Shows what has been rendered. `loopUntilClosed` does this itself, so this is
+     * only needed by programs that run their own loop, such as benchmarks.
+     */
+    void swapBuffers();
+
     /**
      * Runs the application's main loop.
+     *
+     * When the library is built with `PBR_ENABLE_PROFILING`, pressing F12 writes
+     * the frames recorded by `Profiler::shared()` to profile.json in the current
+     * directory, in the Chrome trace format.
      */
     template<class SceneType>
     void loopUntilClosed(std::shared_ptr<Renderer<SceneType>> renderer, std::shared_ptr<SceneType> scene);
+
+    /**
+     * Runs the application's main loop, with the camera and scene updated on a
+     * separate thread at a fixed timestep.
+     *
+     * After each update, the update thread publishes a `FrameSnapshot` of the
+     * camera, the objects' transforms and the lights. This thread draws the
+     * newest snapshot every frame, so neither thread waits for the other and a
+     * slow frame doesn't slow down the simulation. The window always renders
+     * continuously, whether or not `setRenderOnDemand` has been called.
+     *
+     * `onUpdate` is called on the update thread after the camera has moved. It
+     * may move the scene's objects and replace its lights, but it mustn't add or
+     * remove objects or change anything else the renderer reads from the scene,
+     * such as materials, since a frame may be being drawn at the same time.
+     *
+     * @param onUpdate Called with the scene and the timestep at every update
+     * @param timestep The time between updates, in seconds
+     */
+    template<class SceneType>
+    void loopUntilClosedWithUpdateThread(std::shared_ptr<Renderer<SceneType>> renderer,
+                                         std::shared_ptr<SceneType> scene,
+                                         std::function<void(SceneType&, float)> onUpdate = nullptr,
+                                         double timestep = 1.0 / 120.0);
 };
 
 /**
@@ -53,11 +151,13 @@ class GLFWCallbackWrapper {
 public:
     using KeyboardCallback = std::function<void(GLFWwindow*, int, int, int, int)>;
     using FrameBufferResizeCallback = std::function<void(GLFWwindow*, int, int)>;
+    using WindowRefreshCallback = std::function<void(GLFWwindow*)>;
     using ErrorCallback = std::function<void(int, const char*)>;
 
 private:
     static std::optional<KeyboardCallback> s_keyboardCallback;
     static std::optional<FrameBufferResizeCallback> s_frameBufferResizeCallback;
+    static std::optional<WindowRefreshCallback> s_windowRefreshCallback;
     static std::optional<ErrorCallback> s_errorCallback;
 
 public:
@@ -68,12 +168,14 @@ public:
 
     static void bindKeyboardCallback(const KeyboardCallback& keyboardCallback);
     static void bindFrameBufferResizeCallback(const FrameBufferResizeCallback& frameBufferResizeCallback);
+    static void bindWindowRefreshCallback(const WindowRefreshCallback& windowRefreshCallback);
     static void bindErrorCallback(const ErrorCallback& errorCallback);
 
     static void unbindAllCallbacks();
 
     static void keyboardCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void frameBufferResizeCallback(GLFWwindow* window, int width, int height);
+    static void windowRefreshCallback(GLFWwindow* window);
     static void errorCallback(int error, const char* description);
 };
 
@@ -97,11 +199,7 @@ void Window::loopUntilClosed(std::shared_ptr<Renderer<SceneType>> renderer, std:
     // Callback for keyboard events
     GLFWCallbackWrapper::bindKeyboardCallback(
         [&driver](GLFWwindow *theWindow, int key, int scancode, int action, int mods) {
-
-            // If they pressed escape then we should close
-            if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
-                glfwSetWindowShouldClose(theWindow, GLFW_TRUE);
-            }
+            onWindowKeyboardEvent(theWindow, key, action);
 
             // Forward it on to the renderer driver
             driver.onKeyboardEvent(key, scancode, action, mods);
@@ -116,29 +214,61 @@ void Window::loopUntilClosed(std::shared_ptr<Renderer<SceneType>> renderer, std:
         }
     );
 
-    // Callback for errors
-    GLFWCallbackWrapper::bindErrorCallback(
-        [](int error, const char *description) {
-            std::cout << "GLFW Error: " << description << std::endl;
-            glfwTerminate();
-            exit((int) ErrorCodes::GlfwError);
+    // Callback for when the window's contents need drawing again, such as after
+    // it was covered up
+    GLFWCallbackWrapper::bindWindowRefreshCallback(
+        [&driver](GLFWwindow*) {
+            driver.invalidate();
         }
     );
 
+    // Callback for errors
+    GLFWCallbackWrapper::bindErrorCallback(onGLFWError);
+
     double previousTime = glfwGetTime();
 
+    // Whether the last iteration left the previous frame on screen
+    bool idle = false;
+
     // The main loop
     while (!glfwWindowShouldClose(window)) {
 
-        // Compute dt
+        // Poll events and trigger callbacks, sleeping until there are some if
+        // there's nothing to draw
+        {
+            PBR_PROFILE_SCOPE("Poll events");
+            if (renderOnDemand && idle) {
+                glfwWaitEventsTimeout(onDemandWaitTimeout);
+            }
+            else {
+                glfwPollEvents();
+            }
+        }
+
+        // Compute dt. Time spent idle doesn't count, or the camera would jump
+        // as soon as a key is pressed.
         double currentTime = glfwGetTime();
-        auto dt = (float) (currentTime - previousTime);
+        auto dt = idle ? 0.0f : (float) (currentTime - previousTime);
 
-        // Poll events and trigger callbacks
-        glfwPollEvents();
+        // Hand over anything that has finished baking in the background
+        if (backgroundBaker) {
+            PBR_PROFILE_SCOPE("Poll background baker");
+            backgroundBaker->poll();
+        }
 
         // Update the renderer driver's state
-        driver.update(dt);
+        bool cameraMoving;
+        {
+            PBR_PROFILE_SCOPE("Update");
+            cameraMoving = driver.update(dt);
+        }
+
+        // Leave the last frame on screen if nothing has changed since it was drawn
+        idle = renderOnDemand && !cameraMoving && !driver.needsRender();
+        if (idle) {
+            previousTime = currentTime;
+            continue;
+        }
 
         // Make sure the viewport is the right size
         int width, height;
@@ -146,15 +276,172 @@ void Window::loopUntilClosed(std::shared_ptr<Renderer<SceneType>> renderer, std:
         glViewport(0, 0, width, height);
 
         // Render the scene
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        driver.render((float) currentTime);
+        {
+            PBR_PROFILE_SCOPE("Render");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            driver.recordFrameTime(dt);
+            driver.render((float) currentTime);
+        }
 
         // Swap the buffers to make the render visible
-        glfwSwapBuffers(window);
+        {
+            PBR_PROFILE_SCOPE("Swap buffers");
+            glfwSwapBuffers(window);
+        }
+        PBR_PROFILE_END_FRAME();
+
+        previousTime = currentTime;
+    }
+
+    GLFWCallbackWrapper::unbindAllCallbacks();
+}
+
+template <class SceneType>
+void Window::loopUntilClosedWithUpdateThread(std::shared_ptr<Renderer<SceneType>> renderer,
+                                             std::shared_ptr<SceneType> scene,
+                                             std::function<void(SceneType&, float)> onUpdate, double timestep)
+{
+    using Clock = std::chrono::steady_clock;
+
+    glm::vec3 backgroundColour = scene->getBackgroundColour();
+    glClearColor(backgroundColour.r, backgroundColour.g, backgroundColour.b, 1.0f);
+
+    // Create a driver to handle camera movement
+    std::shared_ptr<SceneType> updatedScene = scene;
+    RendererDriver driver(std::move(renderer), getAspectRatio(), std::move(scene));
+
+    // Input for the update thread, which it takes at the start of each update
+    std::mutex inputMutex;
+    std::vector<std::pair<int, int>> pendingKeyEvents;
+    std::optional<float> pendingAspectRatio;
+
+    // Callback for keyboard events. The debug views create OpenGL objects, so
+    // they are toggled on this thread.
+    GLFWCallbackWrapper::bindKeyboardCallback(
+        [&](GLFWwindow *theWindow, int key, int scancode, int action, int mods) {
+            onWindowKeyboardEvent(theWindow, key, action);
+            driver.onDebugViewKeyboardEvent(key, action);
+
+            std::lock_guard<std::mutex> lock(inputMutex);
+            pendingKeyEvents.emplace_back(key, action);
+        }
+    );
+
+    // Callback for frame buffer resize events
+    GLFWCallbackWrapper::bindFrameBufferResizeCallback(
+        [&](GLFWwindow*, int width, int height) {
+            std::lock_guard<std::mutex> lock(inputMutex);
+            pendingAspectRatio = (float) width / (float) height;
+        }
+    );
+
+    // Callback for errors
+    GLFWCallbackWrapper::bindErrorCallback(onGLFWError);
+
+    // Publish the starting state so that there is something to draw straight away
+    FrameSnapshotBuffer snapshots;
+    double simulationTime = glfwGetTime();
+    driver.captureSnapshot(snapshots.writeSnapshot(), simulationTime);
+    snapshots.publish();
+
+    std::atomic<bool> stopping(false);
+    std::thread updateThread([&]() {
+        const auto tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timestep));
+
+        // If the updates fall further behind than this, such as while a debugger
+        // is paused, skip the missed ones instead of running them all at once
+        const auto maxLag = 10 * tick;
+
+        std::vector<std::pair<int, int>> keyEvents;
+        auto nextTick = Clock::now() + tick;
+
+        while (!stopping) {
+            {
+                PBR_PROFILE_SCOPE("Update");
+
+                std::optional<float> aspectRatio;
+                {
+                    std::lock_guard<std::mutex> lock(inputMutex);
+                    keyEvents.swap(pendingKeyEvents);
+                    aspectRatio = std::exchange(pendingAspectRatio, std::nullopt);
+                }
+                for (const auto& [key, action] : keyEvents) {
+                    driver.onCameraKeyboardEvent(key, action);
+                }
+                keyEvents.clear();
+                if (aspectRatio) {
+                    driver.setAspectRatio(*aspectRatio);
+                }
+
+                driver.update((float) timestep);
+                if (onUpdate) {
+                    onUpdate(*updatedScene, (float) timestep);
+                }
+                simulationTime += timestep;
+
+                driver.captureSnapshot(snapshots.writeSnapshot(), simulationTime);
+                snapshots.publish();
+            }
+
+            // Wait for the next update
+            auto now = Clock::now();
+            if (now > nextTick + maxLag) {
+                nextTick = now;
+            }
+            std::this_thread::sleep_until(nextTick);
+            nextTick += tick;
+        }
+    });
+
+    double previousTime = glfwGetTime();
+
+    // The main loop
+    while (!glfwWindowShouldClose(window)) {
 
+        // Poll events and trigger callbacks
+        {
+            PBR_PROFILE_SCOPE("Poll events");
+            glfwPollEvents();
+        }
+
+        double currentTime = glfwGetTime();
+        auto dt = (float) (currentTime - previousTime);
         previousTime = currentTime;
+
+        // Hand over anything that has finished baking in the background
+        if (backgroundBaker) {
+            PBR_PROFILE_SCOPE("Poll background baker");
+            backgroundBaker->poll();
+        }
+
+        // Take the newest state from the update thread. If there isn't a new one
+        // then the last one is drawn again.
+        snapshots.acquire();
+
+        // Make sure the viewport is the right size
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        glViewport(0, 0, width, height);
+
+        // Render the scene
+        {
+            PBR_PROFILE_SCOPE("Render");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            driver.recordFrameTime(dt);
+            driver.render(snapshots.readSnapshot());
+        }
+
+        // Swap the buffers to make the render visible
+        {
+            PBR_PROFILE_SCOPE("Swap buffers");
+            glfwSwapBuffers(window);
+        }
+        PBR_PROFILE_END_FRAME();
     }
 
+    stopping = true;
+    updateThread.join();
+
     GLFWCallbackWrapper::unbindAllCallbacks();
 }
 
@@ -2,5 +2,7 @@
 #define PHYSICALLYBASEDRENDERER_DEBUG
 
 #include "debug/DebuggingUtil.h"
+#include "debug/OverdrawHeatmap.h"
+#include "debug/PerformanceOverlay.h"
 
 #endif //PHYSICALLYBASEDRENDERER_DEBUG
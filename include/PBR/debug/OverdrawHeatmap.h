@@ -0,0 +1,81 @@
+#ifndef PHYSICALLYBASEDRENDERER_OVERDRAWHEATMAP
+#define PHYSICALLYBASEDRENDERER_OVERDRAWHEATMAP
+
+#include "core/ShaderProgram.h"
+
+namespace PBR::debug {
+
+/**
+ * Shows how many fragments were shaded at each pixel, to find where the
+ * renderers spend their fragment budget on overdraw.
+ *
+ * Fragments are counted in the stencil buffer: while counting, every fragment
+ * that passes the depth test increments the stencil value of its pixel, so it
+ * works with any renderer without needing variants of its shaders. The heatmap
+ * then replaces the rendered image, with one colour per count from black for no
+ * fragments, through blue, cyan, green, yellow, orange, red and magenta, to
+ * white for 8 or more.
+ *
+ * On drivers with `ARB_pipeline_statistics_query`, the vertex and fragment
+ * shader invocations while counting are also added to `RenderStats::current()`.
+ * They are read back a frame later so that reading them doesn't stall.
+ */
+class OverdrawHeatmap {
+public:
+    /**
+     * The number of colours in the heatmap. The last one is used for every
+     * count from `colourCount - 1` upwards.
+     */
+    static constexpr int colourCount = 9;
+
+private:
+    ShaderProgram shaderProgram;
+    unsigned int vaoId;
+    unsigned int vboId;
+
+    /**
+     * Two sets of vertex and fragment shader invocation queries, used on alternate frames.
+     */
+    unsigned int queries[2][2];
+    bool queriesIssued[2];
+    int currentQueries;
+
+public:
+    OverdrawHeatmap();
+    ~OverdrawHeatmap();
+
+    OverdrawHeatmap(const OverdrawHeatmap&) = delete;
+    OverdrawHeatmap& operator=(const OverdrawHeatmap&) = delete;
+
+    /**
+     * @return Whether shader invocations can be counted
+     */
+    static bool isPipelineStatisticsSupported();
+
+    /**
+     * Clears the stencil buffer and starts counting the fragments that are drawn.
+     */
+    void beginCounting();
+
+    /**
+     * Stops counting fragments, and records the shader invocations counted in
+     * the previous frame.
+     */
+    void endCounting();
+
+    /**
+     * Forgets the queries issued so far, so that the next `endCounting()` doesn't
+     * report the invocations from an earlier time the heatmap was shown. Call it
+     * whenever counting is turned on or off.
+     */
+    void reset();
+
+    /**
+     * Replaces the contents of the viewport with the heatmap of the fragments counted.
+     */
+    void render();
+};
+
+} // namespace PBR::debug
+
+#endif //PHYSICALLYBASEDRENDERER_OVERDRAWHEATMAP
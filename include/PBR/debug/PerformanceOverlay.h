@@ -0,0 +1,80 @@
+#ifndef PHYSICALLYBASEDRENDERER_PERFORMANCEOVERLAY
+#define PHYSICALLYBASEDRENDERER_PERFORMANCEOVERLAY
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+#include "core/RenderStats.h"
+#include "core/ShaderProgram.h"
+
+namespace PBR::debug {
+
+/**
+ * Draws a graph of recent frame times and the render stats of the last frame
+ * in the top left corner of the viewport.
+ *
+ * The text uses a small built-in bitmap font, so the overlay doesn't need any
+ * resources besides its shaders.
+ */
+class PerformanceOverlay {
+public:
+    /**
+     * The number of frame times shown in the graph.
+     */
+    static constexpr size_t historyLength = 240;
+
+private:
+    ShaderProgram shaderProgram;
+    unsigned int vaoId;
+    unsigned int vboId;
+
+    /**
+     * Recent frame times in seconds, used as a ring buffer.
+     */
+    std::array<float, historyLength> frameTimes;
+    size_t nextFrameTime;
+    size_t frameTimesCount;
+
+    /**
+     * The vertices of the frame being drawn, kept to avoid reallocating them each frame.
+     */
+    std::vector<float> vertices;
+
+public:
+    PerformanceOverlay();
+    ~PerformanceOverlay();
+
+    PerformanceOverlay(const PerformanceOverlay&) = delete;
+    PerformanceOverlay& operator=(const PerformanceOverlay&) = delete;
+
+    /**
+     * Adds the time that a frame took to the graph.
+     */
+    void addFrameTime(float seconds);
+
+    /**
+     * Draws the overlay on top of whatever has been rendered to the current viewport.
+     */
+    void render(const RenderStats& stats);
+
+private:
+    /**
+     * Adds a rectangle, measured in pixels from the top left corner.
+     */
+    void addRectangle(float left, float top, float right, float bottom, const glm::vec4& colour);
+
+    /**
+     * Adds a line of text, measured in pixels from the top left corner.
+     *
+     * @param scale The size of one pixel of the font, in pixels
+     */
+    void addText(float left, float top, const std::string& text, float scale, const glm::vec4& colour);
+};
+
+} // namespace PBR::debug
+
+#endif //PHYSICALLYBASEDRENDERER_PERFORMANCEOVERLAY
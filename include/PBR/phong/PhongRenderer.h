@@ -3,6 +3,7 @@
 
 #include <memory>
 
+#include "core/FrameSnapshot.h"
 #include "core/Renderer.h"
 #include "core/Scene.h"
 #include "core/ShaderProgram.h"
@@ -38,7 +39,7 @@ public:
 
     void activate() override;
 
-    void render(std::shared_ptr<PhongScene> scene, const Camera& camera, double time) override;
+    void render(std::shared_ptr<PhongScene> scene, const FrameSnapshot& frame) override;
 };
 
 } // namespace PBR::phong
@@ -3,7 +3,8 @@
 
 #include <memory>
 
-#include "core/Camera.h"
+#include <glm/mat4x4.hpp>
+
 #include "core/ShaderProgram.h"
 #include "Skybox.h"
 
@@ -26,9 +27,11 @@ public:
      * Renders a skybox to the scene.
      *
      * @param skybox The skybox to render
-     * @param camera The camera being used to render the scene
+     * @param viewMatrix The view matrix of the camera being used to render the scene
+     * @param projectionMatrix The projection matrix of the camera being used to render the scene
      */
-    void renderSkybox(const std::shared_ptr<Skybox>& skybox, const Camera& camera);
+    void renderSkybox(const std::shared_ptr<Skybox>& skybox, const glm::mat4& viewMatrix,
+                      const glm::mat4& projectionMatrix);
 };
 
 } // namespace PBR::phong
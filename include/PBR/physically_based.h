@@ -2,14 +2,20 @@
 #define PHYSICALLYBASEDRENDERER_PHYSICALLY_BASED
 
 #include "physically_based/BRDFCoefficients.h"
+#include "physically_based/DrawPacketBuilder.h"
 #include "physically_based/EnvironmentMap.h"
 #include "physically_based/EnvironmentMapRenderer.h"
 #include "physically_based/FresnelValues.h"
+#include "physically_based/IBLFile.h"
+#include "physically_based/LightExtraction.h"
 #include "physically_based/PBRUtil.h"
 #include "physically_based/PhysicallyBasedMaterial.h"
 #include "physically_based/PhysicallyBasedRenderer.h"
 #include "physically_based/PhysicallyBasedScene.h"
 #include "physically_based/PhysicallyBasedSceneObject.h"
 #include "physically_based/PhysicallyBasedShaderUniforms.h"
+#include "physically_based/PrecomputationSettings.h"
+#include "physically_based/ResourceRegistry.h"
+#include "physically_based/SphericalHarmonics.h"
 
 #endif //PHYSICALLYBASEDRENDERER_PHYSICALLY_BASED
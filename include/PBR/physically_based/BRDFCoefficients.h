@@ -1,6 +1,8 @@
 #ifndef PHYSICALLYBASEDRENDERER_BRDFCOEFFICIENTS
 #define PHYSICALLYBASEDRENDERER_BRDFCOEFFICIENTS
 
+#include <cstddef>
+
 namespace PBR::physically_based {
 
 /**
@@ -33,6 +35,13 @@ struct BRDFCoefficients {
     bool operator==(const struct BRDFCoefficients& other) const;
 };
 
+/**
+ * Hashes BRDF coefficients, for looking up the maps that depend only on the BRDF.
+ */
+struct BRDFCoefficientsHasher {
+    size_t operator()(const BRDFCoefficients& coefficients) const;
+};
+
 } // namespace PBR::physically_based
 
 #endif //PHYSICALLYBASEDRENDERER_BRDFCOEFFICIENTS
@@ -0,0 +1,110 @@
+#ifndef PHYSICALLYBASEDRENDERER_DRAWPACKETBUILDER
+#define PHYSICALLYBASEDRENDERER_DRAWPACKETBUILDER
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "core/FrameSnapshot.h"
+#include "core/ThreadPool.h"
+#include "physically_based/PhysicallyBasedScene.h"
+#include "physically_based/PhysicallyBasedShaderUniforms.h"
+
+namespace PBR::physically_based {
+
+/**
+ * Everything the render thread needs to draw one object, besides its uniforms.
+ */
+struct DrawPacket {
+    /**
+     * Packets are drawn in increasing order of this. It groups objects by their
+     * lighting maps and then their vertex array, which is shared by every mesh
+     * with the same layout, so that those are rebound as rarely as possible.
+     * Then it orders them front to back.
+     */
+    uint64_t sortKey;
+
+    /**
+     * The index of the object in the scene.
+     */
+    size_t objectIndex;
+
+    /**
+     * The object's mesh, as the arguments to `glDrawElementsBaseVertex`.
+     */
+    unsigned int vaoId;
+    unsigned int indicesCount;
+    const void* indicesOffset;
+    int baseVertex;
+};
+
+/**
+ * Does the CPU work of drawing a `PhysicallyBasedScene` ahead of submitting it:
+ * frustum culling, sorting, and packing each object's uniforms into the layout
+ * of the shader's `ObjectData` block.
+ *
+ * The objects are split between the threads of a `ThreadPool`, so the time this
+ * takes falls with the number of cores. The objects are culled and sorted in
+ * chunks, a few per thread, which the threads claim as they go. The sorted
+ * chunks are then merged in pairs, also in parallel. The render thread is left
+ * to copy the uniforms into a buffer and issue a draw for each packet.
+ */
+class DrawPacketBuilder {
+private:
+    ThreadPool& threadPool;
+
+    /**
+     * The distance between the starts of consecutive objects' uniforms, which
+     * is a multiple of the alignment OpenGL requires for uniform buffer ranges.
+     */
+    size_t objectUniformsStride;
+
+    /**
+     * The visible packets from each chunk of the objects, each sorted on its own
+     * before they are merged.
+     */
+    std::vector<std::vector<DrawPacket>> chunkPackets;
+
+    /**
+     * Where each pass of the merge writes to, before it is swapped with `packets`.
+     */
+    std::vector<DrawPacket> mergeBuffer;
+
+    std::vector<DrawPacket> packets;
+    std::vector<unsigned char> objectUniforms;
+    size_t culledCount;
+
+public:
+    /**
+     * @param uniformBufferOffsetAlignment The value of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+     * @param threadPool The threads to build the packets on
+     */
+    explicit DrawPacketBuilder(size_t uniformBufferOffsetAlignment, ThreadPool& threadPool = ThreadPool::shared());
+
+    /**
+     * Builds the packets for the objects in a scene that are visible in a frame.
+     */
+    void build(const PhysicallyBasedScene& scene, const FrameSnapshot& frame);
+
+    /**
+     * @return The packets for the visible objects, in the order to draw them
+     */
+    const std::vector<DrawPacket>& getPackets() const;
+
+    /**
+     * @return The `PhysicallyBasedObjectUniforms` for each packet, in the same
+     *         order, `getObjectUniformsStride()` bytes apart
+     */
+    const std::vector<unsigned char>& getObjectUniforms() const;
+
+    size_t getObjectUniformsStride() const;
+
+    /**
+     * @return The number of objects left out because they were outside the frustum
+     */
+    size_t getCulledCount() const;
+};
+
+} // namespace PBR::physically_based
+
+#endif //PHYSICALLYBASEDRENDERER_DRAWPACKETBUILDER
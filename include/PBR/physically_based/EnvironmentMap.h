@@ -2,14 +2,39 @@
 #define PHYSICALLYBASEDRENDERER_ENVIRONMENTMAP
 
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
 
+#include "core/BackgroundBaker.h"
 #include "core/DirectedLightSource.h"
+#include "core/HDRImage.h"
 #include "core/Texture.h"
+#include "core/UniformBuffer.h"
+#include "physically_based/IBLFile.h"
+#include "physically_based/PrecomputationSettings.h"
 
 namespace PBR::physically_based {
 
+/**
+ * Selects how the diffuse part of the image-based lighting is represented.
+ */
+enum class IrradianceMode {
+
+    /**
+     * A small cubemap of precomputed irradiance, sampled per fragment.
+     */
+    IrradianceMap,
+
+    /**
+     * Nine spherical harmonic coefficients projected on the CPU and evaluated
+     * per fragment as a polynomial in the normal. This is much faster to
+     * precompute and slightly cheaper to shade, at the cost of losing
+     * some very low-frequency detail.
+     */
+    SphericalHarmonics,
+};
+
 /**
  * Wraps the lighting information required to describe an HDR scene for
  * image-based lighting.
@@ -17,31 +42,157 @@ namespace PBR::physically_based {
 class EnvironmentMap {
 private:
     /**
-     * The underlying HDR texture.
+     * The underlying HDR texture, converted from the equirectangular image into
+     * a mipmapped cubemap.
      */
     std::shared_ptr<Texture> radianceMap;
 
     /**
-     * The irradiance map for diffuse lighting.
+     * The radiance map that the lighting is computed from. When a sun has been
+     * extracted from the image this has the sun clamped out, since it is lit
+     * separately, while `radianceMap` keeps it for the skybox. Otherwise it is
+     * the same texture as `radianceMap`.
+     */
+    std::shared_ptr<Texture> lightingRadianceMap;
+
+    /**
+     * The width and height of each face of the radiance map's base mipmap level.
+     */
+    unsigned int radianceMapFaceSize;
+
+    /**
+     * How the diffuse lighting is represented.
+     */
+    IrradianceMode irradianceMode;
+
+    /**
+     * The irradiance map for diffuse lighting, stored as a cubemap.
      *
      * This is the integral of Li(p, wi) * (n dot wi) precomputed for each hemisphere.
+     * It is only computed in `IrradianceMode::IrradianceMap`.
      */
     std::shared_ptr<Texture> irradianceMap;
 
+    /**
+     * The same irradiance as spherical harmonic coefficients, stored in a buffer
+     * for the `SphericalHarmonics` uniform block. It is only computed in
+     * `IrradianceMode::SphericalHarmonics`.
+     */
+    std::shared_ptr<UniformBuffer> irradianceSphericalHarmonics;
+
     /**
      * The sun's light source, if it exists.
      */
     std::optional<DirectedLightSource> sun;
 
+    /**
+     * Incremented each time the maps are replaced, for example when the full
+     * image of a progressively loaded environment map arrives.
+     */
+    unsigned int version;
+
 public:
+    /**
+     * @param sun The sun's light source. If `settings.extractSun` is set and a sun
+     *            is found in the image, that is used instead.
+     * @param settings The irradiance map's size and sample count are taken from here
+     */
     explicit EnvironmentMap(const std::filesystem::path& texturePath,
-                            std::optional<DirectedLightSource> sun = std::nullopt);
+                            std::optional<DirectedLightSource> sun = std::nullopt,
+                            IrradianceMode irradianceMode = IrradianceMode::IrradianceMap,
+                            const PrecomputationSettings& settings = PrecomputationSettings());
+
+    /**
+     * Creates an environment map from an image that has already been loaded.
+     *
+     * @param sun The sun's light source. If `settings.extractSun` is set and a sun
+     *            is found in the image, that is used instead.
+     * @param settings The irradiance map's size and sample count are taken from here
+     */
+    explicit EnvironmentMap(HDRImage image,
+                            std::optional<DirectedLightSource> sun = std::nullopt,
+                            IrradianceMode irradianceMode = IrradianceMode::IrradianceMap,
+                            const PrecomputationSettings& settings = PrecomputationSettings());
+
+    /**
+     * Loads and precomputes an environment map on a background baker's thread,
+     * so that the main thread can carry on rendering in the meantime.
+     *
+     * @param onLoaded Called on the main thread with the finished environment map
+     */
+    static void loadInBackground(BackgroundBaker& baker,
+                                 const std::filesystem::path& texturePath,
+                                 std::optional<DirectedLightSource> sun,
+                                 IrradianceMode irradianceMode,
+                                 std::function<void(std::shared_ptr<EnvironmentMap>)> onLoaded,
+                                 const PrecomputationSettings& settings = PrecomputationSettings());
 
+    /**
+     * Creates an environment map from an sIBL set's small preview image straight
+     * away, then loads its full HDR image on a background baker's thread and
+     * replaces the maps with the full-resolution ones when they are ready.
+     *
+     * The preview is a tonemapped JPEG, so it only approximates the lighting, but
+     * it is enough to show something while the HDR image loads. The set's sun is
+     * used unless `settings.extractSun` finds one in the full image. Scenes notice
+     * the replacement through `getVersion()` and recompute their own maps.
+     *
+     * If the set has no preview then the full image is loaded before returning.
+     *
+     * @param onLoaded Called on the main thread once the full-resolution maps are in place
+     * @return The environment map, or nothing if the set names no HDR image that exists
+     */
+    static std::shared_ptr<EnvironmentMap> loadProgressively(BackgroundBaker& baker,
+                                                             const IBLFile& file,
+                                                             IrradianceMode irradianceMode = IrradianceMode::IrradianceMap,
+                                                             std::function<void()> onLoaded = nullptr,
+                                                             const PrecomputationSettings& settings = PrecomputationSettings());
+
+    /**
+     * @return The radiance map as it should be seen, for drawing the skybox
+     */
     std::shared_ptr<Texture> getRadianceMap() const;
 
+    /**
+     * @return The radiance map to compute the prefiltered environment maps from,
+     *         with any extracted sun clamped out
+     */
+    std::shared_ptr<Texture> getLightingRadianceMap() const;
+
+    unsigned int getRadianceMapFaceSize() const;
+
+    IrradianceMode getIrradianceMode() const;
+
     std::shared_ptr<Texture> getIrradianceMap() const;
 
+    std::shared_ptr<UniformBuffer> getIrradianceSphericalHarmonics() const;
+
     const std::optional<DirectedLightSource>& getSun() const;
+
+    /**
+     * @return A number that changes whenever the maps are replaced
+     */
+    unsigned int getVersion() const;
+
+private:
+    /**
+     * Uploads the image and precomputes the maps from it. If `settings.extractSun`
+     * is set, the sun is taken out of a copy of the image, which only the lighting
+     * is computed from.
+     */
+    void precomputeFromImage(const HDRImage& image, const PrecomputationSettings& settings);
+
+    /**
+     * Converts the equirectangular images to radiance cubemaps and precomputes
+     * the diffuse lighting.
+     *
+     * @param equirectangularMap The image as it should be seen
+     * @param lightingEquirectangularMap The image to light the scene with, which
+     *                                   may be the same texture
+     */
+    void precompute(const std::shared_ptr<Texture>& equirectangularMap,
+                    const std::shared_ptr<Texture>& lightingEquirectangularMap,
+                    const PrecomputationSettings& settings);
 };
 
 } // namespace PBR::physically_based
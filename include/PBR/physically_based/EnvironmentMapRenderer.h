@@ -3,7 +3,8 @@
 
 #include <memory>
 
-#include "core/Camera.h"
+#include <glm/mat4x4.hpp>
+
 #include "core/ShaderProgram.h"
 #include "physically_based/EnvironmentMap.h"
 
@@ -36,7 +37,8 @@ public:
     EnvironmentMapRenderer(const EnvironmentMapRenderer& other) = delete;
     EnvironmentMapRenderer& operator=(const EnvironmentMapRenderer& other) = delete;
 
-    void renderSkybox(const std::shared_ptr<EnvironmentMap>& environmentMap, const Camera& camera);
+    void renderSkybox(const std::shared_ptr<EnvironmentMap>& environmentMap, const glm::mat4& viewMatrix,
+                      const glm::mat4& projectionMatrix);
 };
 
 } // namespace PBR::physically_based
@@ -0,0 +1,62 @@
+#ifndef PHYSICALLYBASEDRENDERER_IBLFILE
+#define PHYSICALLYBASEDRENDERER_IBLFILE
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include "core/DirectedLightSource.h"
+
+namespace PBR::physically_based {
+
+/**
+ * The descriptor (.ibl) file of an sIBL set, which names the images that make
+ * up an environment and describes its sun.
+ *
+ * Every path is resolved relative to the directory containing the .ibl file.
+ */
+struct IBLFile {
+
+    /**
+     * The human-readable name of the environment.
+     */
+    std::string name;
+
+    /**
+     * A small, tonemapped JPEG of the whole environment, if the set includes one.
+     */
+    std::optional<std::filesystem::path> previewPath;
+
+    /**
+     * The low-resolution HDR image intended for diffuse lighting.
+     */
+    std::optional<std::filesystem::path> environmentPath;
+
+    /**
+     * The high-resolution HDR image intended for reflections.
+     */
+    std::optional<std::filesystem::path> reflectionPath;
+
+    /**
+     * The sun, if the set describes one.
+     */
+    std::optional<DirectedLightSource> sun;
+
+    /**
+     * Reads an .ibl file from disk.
+     *
+     * @param path The path to the file
+     * @return The file's contents, or nothing if the file could not be read or
+     *         names neither an environment nor a reflection image
+     */
+    static std::optional<IBLFile> read(const std::filesystem::path& path);
+
+    /**
+     * @return The highest-resolution HDR image of the set that exists on disk
+     */
+    std::optional<std::filesystem::path> radiancePath() const;
+};
+
+} // namespace PBR::physically_based
+
+#endif //PHYSICALLYBASEDRENDERER_IBLFILE
@@ -0,0 +1,44 @@
+#ifndef PHYSICALLYBASEDRENDERER_LIGHTEXTRACTION
+#define PHYSICALLYBASEDRENDERER_LIGHTEXTRACTION
+
+#include <vector>
+
+#include "core/DirectedLightSource.h"
+#include "core/HDRImage.h"
+#include "core/ThreadPool.h"
+
+namespace PBR::physically_based {
+
+/**
+ * Finds the dominant light sources in HDR environment maps, such as the sun.
+ */
+struct LightExtraction {
+
+    /**
+     * Finds the small, very bright regions of an equirectangular environment map
+     * and moves their light out of the image into analytic lights.
+     *
+     * A region is a connected group of pixels whose luminance is more than
+     * `thresholdRatio` times the average over the sphere. Each region that is
+     * compact and carries a significant share of the map's total light is
+     * clamped down to the threshold, and the light taken out of it becomes a
+     * `DirectedLightSource` pointing at the region's centre. The clamped map has
+     * no tiny, intense lobes left, so integrating it by sampling needs far fewer
+     * samples to avoid fireflies.
+     *
+     * The luminance analysis is split across the threads of the pool, one row per task.
+     *
+     * @param image The equirectangular image, which is modified in place
+     * @param thresholdRatio How many times brighter than the average a pixel must be
+     * @param maxLights The most regions to extract
+     * @param threadPool The pool to run the analysis on
+     * @return The extracted lights, brightest first
+     */
+    static std::vector<DirectedLightSource> extractDominantLights(HDRImage& image, float thresholdRatio,
+                                                                  unsigned int maxLights,
+                                                                  ThreadPool& threadPool = ThreadPool::shared());
+};
+
+} // namespace PBR::physically_based
+
+#endif //PHYSICALLYBASEDRENDERER_LIGHTEXTRACTION
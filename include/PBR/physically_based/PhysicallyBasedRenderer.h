@@ -3,9 +3,11 @@
 
 #include <memory>
 
-#include "core/Camera.h"
+#include "core/FrameSnapshot.h"
 #include "core/Renderer.h"
 #include "core/ShaderProgram.h"
+#include "core/UniformRingBuffer.h"
+#include "physically_based/DrawPacketBuilder.h"
 #include "physically_based/EnvironmentMapRenderer.h"
 #include "physically_based/PhysicallyBasedScene.h"
 
@@ -18,14 +20,37 @@ namespace PBR::physically_based {
 class PhysicallyBasedRenderer : public Renderer<PhysicallyBasedScene> {
 private:
     ShaderProgram shaderProgram;
+
+    /**
+     * A variant of the shader that evaluates diffuse lighting from spherical harmonics,
+     * used for environment maps in `IrradianceMode::SphericalHarmonics`.
+     */
+    ShaderProgram sphericalHarmonicsShaderProgram;
+
+    /**
+     * Variants of the two shaders above that sample lighting maps stored as layers
+     * of array textures, used for scenes in `PrecomputationMode::Layered`.
+     */
+    ShaderProgram layeredShaderProgram;
+    ShaderProgram layeredSphericalHarmonicsShaderProgram;
+
     EnvironmentMapRenderer environmentMapRenderer;
 
+    DrawPacketBuilder drawPacketBuilder;
+
+    /**
+     * Holds each frame's camera and lighting uniforms, and every drawn object's
+     * `PhysicallyBasedObjectUniforms`. It is replaced with a bigger one when a
+     * frame needs more space than it has.
+     */
+    std::unique_ptr<UniformRingBuffer> uniformRingBuffer;
+
 public:
     PhysicallyBasedRenderer();
 
     void activate() override;
 
-    void render(std::shared_ptr<PhysicallyBasedScene> scene, const Camera& camera, double time) override;
+    void render(std::shared_ptr<PhysicallyBasedScene> scene, const FrameSnapshot& frame) override;
 };
 
 } // namespace PBR::physically_based
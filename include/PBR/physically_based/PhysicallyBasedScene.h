@@ -1,20 +1,81 @@
 #ifndef PHYSICALLYBASEDRENDERER_PHYSICALLYBASEDSCENE
 #define PHYSICALLYBASEDRENDERER_PHYSICALLYBASEDSCENE
 
+#include <array>
+#include <cstddef>
+#include <deque>
+#include <functional>
 #include <iterator>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "core/BackgroundBaker.h"
 #include "core/PointLightSource.h"
 #include "core/Scene.h"
+#include "core/ShaderProgram.h"
 #include "core/Texture.h"
 #include "physically_based/EnvironmentMap.h"
 #include "physically_based/PhysicallyBasedMaterial.h"
 #include "physically_based/PhysicallyBasedSceneObject.h"
+#include "physically_based/PrecomputationSettings.h"
 
 namespace PBR::physically_based {
 
+/**
+ * Selects when the scene's prefiltered environment maps and BRDF integration
+ * maps are computed.
+ */
+enum class PrecomputationMode {
+
+    /**
+     * Compute every map at full quality before the constructor returns.
+     */
+    Blocking,
+
+    /**
+     * Compute a coarse, low-sample version of every map in the constructor, then
+     * refine them to full quality a little at a time by calling
+     * `refinePrecomputation()` once per frame.
+     */
+    Progressive,
+
+    /**
+     * Compute a coarse version of every map in the constructor, then compute the
+     * full-quality maps on a `BackgroundBaker`'s thread and swap them in when
+     * they are ready. The swap happens in `refinePrecomputation()`.
+     */
+    Background,
+
+    /**
+     * Compute every map at full quality before the constructor returns, with the
+     * maps for all of the scene's BRDF variants rendered together as the layers
+     * of a cubemap array and a 2D array texture. This takes a handful of draws
+     * however many variants there are.
+     */
+    Layered,
+};
+
+/**
+ * How far a scene's precomputed maps are from reference maps computed with many
+ * more samples. Each error is the root-mean-square difference divided by the
+ * root-mean-square value of the reference, taking the worst over all the
+ * scene's BRDFs.
+ */
+struct PrecomputationErrorEstimate {
+
+    /**
+     * The error of each mipmap level of the prefiltered environment maps.
+     */
+    std::vector<double> prefilteredEnvironmentMapErrors;
+
+    /**
+     * The error of the BRDF integration maps.
+     */
+    double brdfIntegrationMapError;
+};
+
 class PhysicallyBasedScene : public Scene<PhysicallyBasedSceneObject> {
 private:
     /**
@@ -23,7 +84,7 @@ private:
     std::shared_ptr<EnvironmentMap> environmentMap;
 
     /**
-     * The prefiltered environment maps. These are specific to each object, since
+     * The prefiltered environment cubemaps. These are specific to each object, since
      * each object may have a different BRDF configuration.
      */
     std::vector<std::shared_ptr<Texture>> prefilteredEnvironmentMaps;
@@ -34,9 +95,122 @@ private:
      */
     std::vector<std::shared_ptr<Texture>> brdfIntegrationMaps;
 
+    /**
+     * The layer of the lighting maps that each object should use. This is always 0
+     * unless the maps were computed in `PrecomputationMode::Layered`.
+     */
+    std::vector<int> lightingMapLayers;
+
+    /**
+     * The resolutions and sample counts of the maps.
+     */
+    PrecomputationSettings settings;
+
+    /**
+     * The mode the maps were precomputed in, which is used again if the
+     * environment map changes.
+     */
+    PrecomputationMode precomputationMode;
+
+    /**
+     * The version of the environment map that the prefiltered environment maps
+     * were computed from.
+     */
+    unsigned int environmentMapVersion;
+
+    /**
+     * Whether each kind of map is computed with compute shaders rather than by
+     * rendering to it. This needs OpenGL 4.3, and isn't used for progressive
+     * refinement, which renders a tile at a time. The compute shaders also have
+     * a limit on the number of samples, so settings with more are rendered.
+     */
+    bool usePrefilterComputeShader;
+    bool useBRDFIntegrationComputeShader;
+
+    /**
+     * The shader programs used to compute the maps, kept so that progressive
+     * refinement can reuse them.
+     */
+    std::shared_ptr<ShaderProgram> prefilterShader;
+    std::shared_ptr<ShaderProgram> brdfIntegrationShader;
+
+    /**
+     * The outstanding pieces of work for progressive refinement, in the order
+     * that they will be run.
+     */
+    std::deque<std::function<void()>> refinementJobs;
+
+    /**
+     * The number of refinement jobs that were originally queued.
+     */
+    size_t totalRefinementJobs;
+
+    /**
+     * The maximum time to spend refining per call to `refinePrecomputation()`.
+     */
+    double refinementBudgetMilliseconds;
+
+    /**
+     * A pair of timestamp queries around one call's refinement jobs, which is read
+     * back in a later frame once the GPU has reached it.
+     */
+    struct RefinementTiming {
+        std::array<unsigned int, 2> queries{};
+        size_t jobsCount = 0;
+        bool pending = false;
+    };
+
+    /**
+     * One timing per frame in flight, used in turn.
+     */
+    std::array<RefinementTiming, 3> refinementTimings;
+    unsigned int nextRefinementTiming;
+
+    /**
+     * The GPU time that one refinement job is expected to take, averaged over the
+     * timings read back so far.
+     */
+    double estimatedRefinementJobMilliseconds;
+
+    /**
+     * The baker used in `PrecomputationMode::Background`.
+     */
+    std::shared_ptr<BackgroundBaker> backgroundBaker;
+
+    /**
+     * Pairs of (coarse map, full-quality replacement) that have finished baking
+     * in the background but haven't been swapped in yet. The baker's callbacks
+     * only hold a weak reference, so they do nothing if the scene has gone.
+     */
+    std::shared_ptr<std::vector<std::pair<std::shared_ptr<Texture>, std::shared_ptr<Texture>>>> finishedBackgroundBakes;
+
+    /**
+     * The number of background bakes that haven't been swapped in yet.
+     */
+    size_t outstandingBackgroundBakes;
+
+    /**
+     * The number of background bakes that were originally submitted.
+     */
+    size_t totalBackgroundBakes;
+
+    /**
+     * Functions to call once every map has reached full quality.
+     */
+    std::vector<std::function<void()>> completionCallbacks;
+
 public:
+    /**
+     * @param backgroundBaker The baker to use in `PrecomputationMode::Background`. If
+     *                        none is given then that mode falls back to `Progressive`.
+     * @param settings The resolutions and sample counts of the maps
+     */
     PhysicallyBasedScene(std::vector<std::shared_ptr<PhysicallyBasedSceneObject>> sceneObjects,
-                         std::vector<PointLightSource> lights, std::shared_ptr<EnvironmentMap> environmentMap);
+                         std::vector<PointLightSource> lights, std::shared_ptr<EnvironmentMap> environmentMap,
+                         PrecomputationMode precomputationMode = PrecomputationMode::Blocking,
+                         std::shared_ptr<BackgroundBaker> backgroundBaker = nullptr,
+                         const PrecomputationSettings& settings = PrecomputationSettings());
+    ~PhysicallyBasedScene();
 
     std::shared_ptr<EnvironmentMap> getEnvironmentMap() const;
 
@@ -44,26 +218,140 @@ public:
 
     const std::vector<std::shared_ptr<Texture>>& getBRDFIntegrationMaps() const;
 
+    const std::vector<int>& getLightingMapLayers() const;
+
+    /**
+     * @return Whether the lighting maps are layers of array textures, which need a
+     *         different shader to sample them
+     */
+    bool hasLayeredLightingMaps() const;
+
+    const PrecomputationSettings& getPrecomputationSettings() const;
+
+    /**
+     * Does as much outstanding progressive refinement as fits in the time budget,
+     * and swaps in any maps that have finished baking in the background.
+     *
+     * If the environment map has been replaced since the prefiltered environment
+     * maps were computed, they are first recomputed in the scene's precomputation mode.
+     *
+     * Jobs are issued until their GPU time, estimated from timer queries read back
+     * in earlier frames, would exceed the budget. Nothing waits for the GPU, so the
+     * work overlaps with rendering as usual. At least one piece of work is done per
+     * call, so progress is always made. This does nothing once precomputation is
+     * complete.
+     */
+    void refinePrecomputation();
+
+    /**
+     * @return Whether the scene has changed since it was last drawn, or has maps
+     *         waiting to be refined or swapped in by `refinePrecomputation()`,
+     *         which only runs when the scene is drawn
+     */
+    bool needsRedraw() const;
+
+    /**
+     * Sets the maximum time that `refinePrecomputation()` should spend per call,
+     * on both the CPU and the GPU.
+     */
+    void setRefinementBudget(double milliseconds);
+
+    /**
+     * @return Whether every map has been computed at full quality
+     */
+    bool isPrecomputationComplete() const;
+
+    /**
+     * @return The fraction of the refinement or background work done so far, between 0 and 1
+     */
+    float getPrecomputationProgress() const;
+
+    /**
+     * Registers a function to be called once every map has reached full quality.
+     *
+     * If that has already happened then the function is called immediately.
+     */
+    void addPrecomputationCompleteCallback(std::function<void()> callback);
+
+    /**
+     * Compares the scene's current maps against reference maps computed with
+     * `referenceSampleCount` samples per texel, to show how much quality the
+     * settings give up. Baking the references is slow, so this is meant for
+     * choosing settings rather than for use at runtime.
+     */
+    PrecomputationErrorEstimate estimatePrecomputationError() const;
+
 private:
+    /**
+     * Recomputes the maps that depend on the environment map, after it has been replaced.
+     */
+    void recomputeForNewEnvironmentMap();
+
     /**
      * Generates the prefiltered environment map for all objects.
      */
-    void precomputePrefilteredEnvironmentMaps();
+    void precomputePrefilteredEnvironmentMaps(PrecomputationMode precomputationMode);
 
     /**
      * Generates the prefiltered environment map for a given material.
      */
-    std::shared_ptr<Texture> computePrefilteredEnvironmentMap(const PhysicallyBasedMaterial& material);
+    std::shared_ptr<Texture> computePrefilteredEnvironmentMap(const PhysicallyBasedMaterial& material,
+                                                              const PrecomputationSettings& settings);
+
+    /**
+     * Queues the jobs to recompute a prefiltered environment map at full quality,
+     * tile by tile and mipmap level by mipmap level.
+     */
+    void queuePrefilteredEnvironmentMapRefinement(std::shared_ptr<Texture> texture,
+                                                  const PhysicallyBasedMaterial& material);
 
     /**
      * Precomputes the BRDF integration map for each object in the scene.
      */
-    void precomputeBRDFIntegrationMaps();
+    void precomputeBRDFIntegrationMaps(PrecomputationMode precomputationMode);
 
     /**
      * Precomputes the BRDF integration map for a particular material.
      */
-    std::shared_ptr<Texture> computeBRDFIntegrationMap(const PhysicallyBasedMaterial& material);
+    std::shared_ptr<Texture> computeBRDFIntegrationMap(const PhysicallyBasedMaterial& material,
+                                                       const PrecomputationSettings& settings);
+
+    /**
+     * Queues the jobs to recompute a BRDF integration map at full quality, tile by tile.
+     */
+    void queueBRDFIntegrationMapRefinement(std::shared_ptr<Texture> texture, const PhysicallyBasedMaterial& material);
+
+    /**
+     * Computes the lighting maps for every BRDF variant in the scene as layers
+     * of two array textures.
+     */
+    void precomputeLayeredLightingMaps();
+
+    /**
+     * Submits a job to the background baker that bakes a full-quality replacement
+     * for a coarse map.
+     *
+     * @param onBaked Called on the main thread with the replacement once it is
+     *                ready, even if the scene has gone by then
+     */
+    void submitBackgroundBake(std::shared_ptr<Texture> coarseTexture, std::function<std::shared_ptr<Texture>()> bake,
+                              std::function<void(const std::shared_ptr<Texture>&)> onBaked);
+
+    /**
+     * Replaces the coarse maps whose full-quality versions have finished baking.
+     */
+    void swapInBackgroundBakes();
+
+    /**
+     * Calls and clears the completion callbacks if every map is at full quality.
+     */
+    void notifyIfComplete();
+
+    /**
+     * Folds the refinement timings that the GPU has finished into the estimated
+     * cost of a job, without waiting for any that it hasn't.
+     */
+    void readRefinementTimings();
 };
 
 } // namespace PBR::physically_based
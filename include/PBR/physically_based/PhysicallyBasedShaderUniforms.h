@@ -1,54 +1,106 @@
 #ifndef PHYSICALLYBASEDRENDERER_PHYSICALLYBASEDSHADERUNIFORMS
 #define PHYSICALLYBASEDRENDERER_PHYSICALLYBASEDSHADERUNIFORMS
 
-#include <memory>
+#include <cstddef>
 #include <optional>
 #include <vector>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
 #include "core/DirectedLightSource.h"
-#include "core/ShaderProgram.h"
-#include "core/Texture.h"
-#include "physically_based/BRDFCoefficients.h"
 #include "physically_based/PhysicallyBasedMaterial.h"
 
 namespace PBR::physically_based {
 
-struct PhysicallyBasedDirectLightingInfo {
-    std::vector<glm::vec3> lightPositions;
-    std::vector<glm::vec3> lightColours;
-    std::vector<float> intensities;
+/**
+ * The number of point lights the shader evaluates. Any more are ignored.
+ */
+constexpr size_t maxPointLights = 16;
+
+/**
+ * The camera's uniforms, laid out to match the std140 layout of the shader's
+ * `CameraData` block.
+ */
+struct PhysicallyBasedCameraUniforms {
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    glm::vec3 cameraPosition;
+    float padding0;
+};
+
+static_assert(sizeof(PhysicallyBasedCameraUniforms) == 144, "Must match the std140 layout of CameraData");
+
+/**
+ * The lighting uniforms, laid out to match the std140 layout of the shader's
+ * `LightingData` block. Every element of an array takes up 16 bytes, so only
+ * the first components of the light intensities are used.
+ */
+struct PhysicallyBasedLightingUniforms {
+
+    // Point lights. Unused ones have zero intensity.
+    glm::vec4 lightPositions[maxPointLights];
+    glm::vec4 lightColours[maxPointLights];
+    glm::vec4 lightIntensities[maxPointLights];
+
+    // The sun, with zero intensity if there isn't one
+    glm::vec3 sunDirection;
+    float padding0;
+    glm::vec3 sunColour;
+    float sunIntensity;
+
+    // The mipmap level of the prefiltered environment maps that holds roughness 1
+    float preFilteredEnvironmentMapMaxLod;
+    float padding1[3];
 };
 
-struct PhysicallyBasedShaderUniforms {
+static_assert(sizeof(PhysicallyBasedLightingUniforms) == 816, "Must match the std140 layout of LightingData");
+
+/**
+ * The uniforms for a single object, laid out to match the std140 layout of the
+ * shader's `ObjectData` block so that many of them can be uploaded at once.
+ */
+struct PhysicallyBasedObjectUniforms {
 
     // Geometry stuff
     glm::mat4 modelMatrix;
-    glm::mat4 viewMatrix;
-    glm::mat4 projectionMatrix;
     glm::mat4 normalsRotationMatrix;
-    glm::vec3 cameraPosition;
 
-    // Material description
-    PhysicallyBasedMaterial material;
+    // Material description. Each struct in the block starts on a 16-byte boundary.
+    glm::vec3 albedo;
+    float roughness;
+    float metallic;
+    float padding0[3];
+    glm::vec3 F0;
+    float padding1;
 
-    // Lighting information
-    PhysicallyBasedDirectLightingInfo lightingInfo;
-    std::optional<DirectedLightSource> sun;
+    // Distribution coefficients
+    float k_TrowbridgeReitzGGX;
+    float k_Beckmann;
+    float padding2[2];
+    float k_SchlickGGX;
+    float k_CookTorrance;
+    float padding3[2];
 
-    // Distribution coefficients;
-    NormalDistributionFunctionCoefficients ndfCoefficients;
-    GeometricAttenuationFunctionCoefficients geometryCoefficients;
-
-    // Lighting maps
-    std::shared_ptr<Texture> irradianceMap;
-    std::shared_ptr<Texture> preFilteredEnvironmentMap;
-    std::shared_ptr<Texture> brdfIntegrationMap;
+    // The layer of the lighting maps to sample, if they are array textures
+    int lightingMapLayer;
+    int padding4[3];
 };
 
-void writeUniformsToShaderProgram(const PhysicallyBasedShaderUniforms& uniforms, ShaderProgram& shaderProgram);
+static_assert(sizeof(PhysicallyBasedObjectUniforms) == 224, "Must match the std140 layout of ObjectData");
+
+PhysicallyBasedObjectUniforms packObjectUniforms(const glm::mat4& modelMatrix, const glm::mat4& normalsRotationMatrix,
+                                                 const PhysicallyBasedMaterial& material, int lightingMapLayer);
+
+PhysicallyBasedCameraUniforms packCameraUniforms(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
+                                                 const glm::vec3& cameraPosition);
+
+PhysicallyBasedLightingUniforms packLightingUniforms(const std::vector<glm::vec3>& lightPositions,
+                                                     const std::vector<glm::vec3>& lightColours,
+                                                     const std::vector<float>& lightIntensities,
+                                                     const std::optional<DirectedLightSource>& sun,
+                                                     float preFilteredEnvironmentMapMaxLod);
 
 } // namespace PBR::phong
 
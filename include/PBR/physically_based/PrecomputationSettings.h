@@ -0,0 +1,156 @@
+#ifndef PHYSICALLYBASEDRENDERER_PRECOMPUTATIONSETTINGS
+#define PHYSICALLYBASEDRENDERER_PRECOMPUTATIONSETTINGS
+
+namespace PBR::physically_based {
+
+/**
+ * Named trade-offs between how long the image-based lighting maps take to
+ * precompute and how accurate they are.
+ */
+enum class PrecomputationQuality {
+
+    /**
+     * Small maps with few samples, for getting something on screen quickly.
+     */
+    Preview,
+
+    /**
+     * The default. Good enough for most scenes, and quick enough to bake at startup.
+     */
+    Interactive,
+
+    /**
+     * Large maps with many samples, for screenshots and offline renders.
+     */
+    Final,
+};
+
+/**
+ * The resolutions and sample counts used to precompute the image-based lighting
+ * maps. The default values are the `Interactive` preset.
+ */
+struct PrecomputationSettings {
+
+    /**
+     * Whether `EnvironmentMap` should look for the sun in the image, and if it
+     * finds one, clamp it out of the radiance map that the lighting is computed
+     * from and render it as an analytic light instead. This replaces any sun
+     * passed in. The skybox still shows the sun. Without its brightest lobe the
+     * lighting's radiance map is much smoother, so the prefiltered maps converge
+     * with far fewer samples. See `LightExtraction`.
+     */
+    bool extractSun = false;
+
+    /**
+     * How many times brighter than the average a pixel must be to count as part
+     * of the sun, when `extractSun` is set.
+     */
+    float sunThresholdRatio = 50.0f;
+
+    /**
+     * The size of each face of the irradiance map.
+     */
+    unsigned int irradianceMapFaceSize = 16;
+
+    /**
+     * The number of rings of samples taken around each irradiance map texel's
+     * normal. See ComputeIrradianceMap.frag.
+     */
+    int irradianceSampleRings = 30;
+
+    /**
+     * The size of each face of the base level of the prefiltered environment maps.
+     */
+    unsigned int prefilterFaceSize = 128;
+
+    /**
+     * The number of mipmap levels of the prefiltered environment maps, which
+     * cover roughnesses from 0 to 1 in even steps.
+     */
+    unsigned int prefilterMipmapLevels = 5;
+
+    /**
+     * The number of samples per prefiltered environment map texel at roughness 1.
+     */
+    int prefilterSampleCount = 256;
+
+    /**
+     * The fewest samples per prefiltered environment map texel, used at roughness 0.
+     * Set this to `prefilterSampleCount` to use the same number for every roughness.
+     */
+    int minimumPrefilterSampleCount = 32;
+
+    /**
+     * Whether to store the prefiltered environment maps and the irradiance map as
+     * `GL_R11F_G11F_B10F`, which takes 4 bytes per texel rather than the 6 of
+     * `GL_RGB16F`. The precision drops from 10 to 6 or 5 mantissa bits, which is
+     * a relative error of at most about 1.6%, well below the noise of the
+     * sampling. Negative values can't be stored, but radiance is never negative.
+     */
+    bool compactLightingMaps = true;
+
+    /**
+     * The width and height of the BRDF integration maps. They vary smoothly over
+     * both axes, so they are stored small.
+     */
+    unsigned int brdfIntegrationMapSize = 128;
+
+    /**
+     * The number of samples per BRDF integration map texel.
+     */
+    int brdfIntegrationSampleCount = 512;
+
+    /**
+     * The number of samples per texel of the maps that
+     * `PhysicallyBasedScene::estimatePrecomputationError` compares against.
+     */
+    int referenceSampleCount = 4096;
+
+    /**
+     * @return The settings for one of the named presets
+     */
+    static PrecomputationSettings forQuality(PrecomputationQuality quality);
+
+    /**
+     * @return The sized internal format of the prefiltered environment maps and the irradiance map
+     */
+    unsigned int lightingMapFormat() const;
+
+    /**
+     * @return The sized internal format of the BRDF integration maps, which only
+     *         have two channels: the scale and bias applied to F0
+     */
+    unsigned int brdfIntegrationMapFormat() const;
+
+    /**
+     * @return The roughness that a mipmap level of the prefiltered environment maps represents
+     */
+    float roughnessForLevel(unsigned int mipmapLevel) const;
+
+    /**
+     * Chooses the number of samples per texel for a mipmap level of the prefiltered
+     * environment maps.
+     *
+     * The GGX lobe narrows as the roughness falls, so the samples spread over a
+     * smaller solid angle and we need fewer of them for the same noise. The
+     * count scales with the square of the roughness, which is the width of the lobe.
+     */
+    int prefilterSampleCountForLevel(unsigned int mipmapLevel) const;
+
+    /**
+     * @return These settings with the sample counts reduced for the coarse first
+     *         pass of progressive and background precomputation. The resolutions
+     *         are unchanged, since the full-quality pass overwrites the same textures.
+     */
+    PrecomputationSettings coarse() const;
+
+    /**
+     * @return These settings with every sample count set to `referenceSampleCount`,
+     *         and the lighting maps stored at full precision
+     */
+    PrecomputationSettings reference() const;
+};
+
+} // namespace PBR::physically_based
+
+#endif //PHYSICALLYBASEDRENDERER_PRECOMPUTATIONSETTINGS
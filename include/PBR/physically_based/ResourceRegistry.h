@@ -0,0 +1,200 @@
+#ifndef PHYSICALLYBASEDRENDERER_RESOURCEREGISTRY
+#define PHYSICALLYBASEDRENDERER_RESOURCEREGISTRY
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "core/DirectedLightSource.h"
+#include "core/Texture.h"
+#include "physically_based/BRDFCoefficients.h"
+#include "physically_based/EnvironmentMap.h"
+#include "physically_based/PrecomputationSettings.h"
+
+namespace PBR::physically_based {
+
+/**
+ * Identifies an environment map loaded from a file, along with everything that
+ * affects how it is precomputed.
+ */
+struct EnvironmentMapKey {
+    std::string path;
+    std::optional<DirectedLightSource> sun;
+    IrradianceMode irradianceMode;
+    bool extractSun;
+    float sunThresholdRatio;
+    unsigned int irradianceMapFaceSize;
+    int irradianceSampleRings;
+    unsigned int lightingMapFormat;
+
+    bool operator==(const EnvironmentMapKey& other) const;
+};
+
+/**
+ * Identifies a prefiltered environment map: the environment it was computed
+ * from, the BRDF, and the settings that affect its contents.
+ */
+struct PrefilteredEnvironmentMapKey {
+    const EnvironmentMap* environmentMap;
+    unsigned int environmentMapVersion;
+    BRDFCoefficients brdfCoefficients;
+    unsigned int faceSize;
+    unsigned int mipmapLevels;
+    int sampleCount;
+    int minimumSampleCount;
+    unsigned int internalFormat;
+
+    bool operator==(const PrefilteredEnvironmentMapKey& other) const;
+};
+
+/**
+ * Identifies a BRDF integration map. These don't depend on the environment.
+ */
+struct BRDFIntegrationMapKey {
+    BRDFCoefficients brdfCoefficients;
+    unsigned int size;
+    int sampleCount;
+
+    bool operator==(const BRDFIntegrationMapKey& other) const;
+};
+
+struct EnvironmentMapKeyHasher {
+    size_t operator()(const EnvironmentMapKey& key) const;
+};
+
+struct PrefilteredEnvironmentMapKeyHasher {
+    size_t operator()(const PrefilteredEnvironmentMapKey& key) const;
+};
+
+struct BRDFIntegrationMapKeyHasher {
+    size_t operator()(const BRDFIntegrationMapKey& key) const;
+};
+
+/**
+ * A process-wide registry of the resources that are expensive to derive:
+ * environment maps loaded from files, and the prefiltered environment maps and
+ * BRDF integration maps baked for them. Scenes that use the same environment
+ * and BRDFs share one copy, so building a second scene, or switching back to
+ * one whose resources are still alive, skips the loading and baking.
+ *
+ * The registry only holds weak references. A resource lives as long as some
+ * scene uses it, and its entry is dropped the next time the registry is
+ * changed after that. Only full-quality maps are registered, so coarse maps
+ * from progressive or background precomputation are never shared.
+ *
+ * Every method is safe to call from any thread, but the resources themselves
+ * must only be used on threads whose contexts share objects with the one that
+ * created them.
+ */
+class ResourceRegistry {
+private:
+    /**
+     * A prefiltered environment map, along with the environment map it was
+     * computed from, so that an entry for an environment map that has since
+     * been freed isn't matched by a new one at the same address.
+     */
+    struct PrefilteredEnvironmentMapEntry {
+        std::weak_ptr<EnvironmentMap> environmentMap;
+        std::weak_ptr<Texture> texture;
+    };
+
+    std::mutex registryMutex;
+
+    std::unordered_map<EnvironmentMapKey, std::weak_ptr<EnvironmentMap>, EnvironmentMapKeyHasher> environmentMaps;
+
+    std::unordered_map<PrefilteredEnvironmentMapKey, PrefilteredEnvironmentMapEntry,
+                       PrefilteredEnvironmentMapKeyHasher> prefilteredEnvironmentMaps;
+
+    std::unordered_map<BRDFIntegrationMapKey, std::weak_ptr<Texture>, BRDFIntegrationMapKeyHasher> brdfIntegrationMaps;
+
+public:
+    ResourceRegistry();
+
+    ResourceRegistry(const ResourceRegistry&) = delete;
+    ResourceRegistry& operator=(const ResourceRegistry&) = delete;
+
+    /**
+     * @return The registry shared by every scene in the process
+     */
+    static ResourceRegistry& shared();
+
+    /**
+     * Turns sharing on or off for every scene. While it is off, lookups find
+     * nothing and nothing is registered, which is useful for timing bakes.
+     * Sharing is on by default.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @return Whether resources are being shared
+     */
+    static bool isEnabled();
+
+    /**
+     * Returns the environment map already loaded from a file with the same
+     * sun, irradiance mode and settings, or loads it if there isn't one.
+     *
+     * If two threads load the same map at once, both do the work but they get
+     * back the same object.
+     */
+    std::shared_ptr<EnvironmentMap> environmentMap(const std::filesystem::path& texturePath,
+                                                   std::optional<DirectedLightSource> sun = std::nullopt,
+                                                   IrradianceMode irradianceMode = IrradianceMode::IrradianceMap,
+                                                   const PrecomputationSettings& settings = PrecomputationSettings());
+
+    /**
+     * @return The full-quality prefiltered environment map for the current
+     *         version of the environment map with the BRDF and settings, or
+     *         nothing if there isn't one
+     */
+    std::shared_ptr<Texture> findPrefilteredEnvironmentMap(const std::shared_ptr<EnvironmentMap>& environmentMap,
+                                                           const BRDFCoefficients& brdfCoefficients,
+                                                           const PrecomputationSettings& settings);
+
+    /**
+     * Registers a full-quality prefiltered environment map for the current
+     * version of the environment map. Any existing entry for the same key is replaced.
+     */
+    void addPrefilteredEnvironmentMap(const std::shared_ptr<EnvironmentMap>& environmentMap,
+                                      const BRDFCoefficients& brdfCoefficients,
+                                      const PrecomputationSettings& settings,
+                                      const std::shared_ptr<Texture>& texture);
+
+    /**
+     * @return The full-quality BRDF integration map for the BRDF and settings,
+     *         or nothing if there isn't one
+     */
+    std::shared_ptr<Texture> findBRDFIntegrationMap(const BRDFCoefficients& brdfCoefficients,
+                                                    const PrecomputationSettings& settings);
+
+    /**
+     * Registers a full-quality BRDF integration map. Any existing entry for the
+     * same key is replaced.
+     */
+    void addBRDFIntegrationMap(const BRDFCoefficients& brdfCoefficients, const PrecomputationSettings& settings,
+                               const std::shared_ptr<Texture>& texture);
+
+    /**
+     * Drops the entries whose resources are no longer used anywhere.
+     */
+    void evictExpired();
+
+    /**
+     * @return The number of entries, including any that have expired but not yet been evicted
+     */
+    size_t size();
+
+private:
+    /**
+     * Drops expired entries. The caller must hold `registryMutex`.
+     */
+    void evictExpiredLocked();
+};
+
+} // namespace PBR::physically_based
+
+#endif //PHYSICALLYBASEDRENDERER_RESOURCEREGISTRY
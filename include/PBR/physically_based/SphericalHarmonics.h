@@ -0,0 +1,60 @@
+#ifndef PHYSICALLYBASEDRENDERER_SPHERICALHARMONICS
+#define PHYSICALLYBASEDRENDERER_SPHERICALHARMONICS
+
+#include <array>
+#include <memory>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "core/Texture.h"
+#include "core/ThreadPool.h"
+
+namespace PBR::physically_based {
+
+/**
+ * The first nine real spherical harmonic coefficients (bands 0 to 2) of an RGB
+ * function on the unit sphere.
+ */
+struct SphericalHarmonicsL2 {
+    std::array<glm::vec3, 9> coefficients;
+
+    /**
+     * Projects the contents of an HDR cubemap onto the spherical harmonic basis.
+     *
+     * The work is split across the threads of the pool, with each task summing
+     * one row of one face.
+     *
+     * @param cubemap The cubemap to project. It must be complete, including its mipmaps.
+     * @param faceSize The width and height of each face of the cubemap's base level
+     * @param threadPool The pool to run the projection on
+     */
+    static SphericalHarmonicsL2 projectCubemap(const std::shared_ptr<Texture>& cubemap, unsigned int faceSize,
+                                               ThreadPool& threadPool = ThreadPool::shared());
+
+    /**
+     * Convolves these coefficients, which describe incoming radiance, with the
+     * clamped cosine lobe to get the coefficients of the irradiance.
+     *
+     * The result is scaled to match the normalisation used by ComputeIrradianceMap.frag,
+     * so that the two irradiance modes can be swapped for one another.
+     *
+     * See: Ramamoorthi and Hanrahan, "An Efficient Representation for Irradiance
+     * Environment Maps" (2001).
+     */
+    SphericalHarmonicsL2 convolveWithCosineLobe() const;
+
+    /**
+     * Packs the coefficients for the `SphericalHarmonics` uniform block.
+     *
+     * The basis functions' normalisation constants are folded into the
+     * coefficients, so that the shader only needs to multiply each by a
+     * polynomial in the components of the direction. Each coefficient is padded
+     * to a vec4 to match the std140 layout of an array.
+     */
+    std::array<glm::vec4, 9> toShaderCoefficients() const;
+};
+
+} // namespace PBR::physically_based
+
+#endif //PHYSICALLYBASEDRENDERER_SPHERICALHARMONICS
@@ -1,8 +1,12 @@
 #ifndef PHYSICALLYBASEDRENDERER_CUSTOMOBJECT
 #define PHYSICALLYBASEDRENDERER_CUSTOMOBJECT
 
+#include <cstddef>
 #include <filesystem>
+#include <memory>
+#include <vector>
 
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
 #include "core/SceneObject.h"
@@ -32,6 +36,45 @@ public:
                  float scale, const std::optional<std::shared_ptr<Texture>>& texture = std::nullopt);
 };
 
+/**
+ * A (position, normal, texcoord) triple read from a .obj file. Untextured
+ * vertices have their texcoord set to (0,0).
+ */
+struct vertex_data_t {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texcoord;
+
+    bool operator==(const struct vertex_data_t& other) const;
+};
+
+/**
+ * Hashes a `vertex_data_t`, so that vertices repeated in a .obj file can be shared.
+ */
+struct VertexDataHasher {
+    size_t operator()(const vertex_data_t& vertexData) const;
+};
+
+/**
+ * The interleaved vertex buffer and index buffer read from a .obj file, ready
+ * to be passed to `VertexData`.
+ */
+struct ObjMeshData {
+    std::shared_ptr<std::vector<float>> vertexData;
+    std::shared_ptr<std::vector<unsigned int>> indices;
+};
+
+/**
+ * Reads the vertices and indices from the specified .obj file. Unlike
+ * `loadObjFromPath`, this doesn't touch OpenGL, so it can be called without
+ * a context.
+ *
+ * @param objPath The path to the file
+ * @param textured Whether the object will be textured
+ * @return The vertex data, with 8 floats per vertex if textured and 6 otherwise
+ */
+ObjMeshData readObjFile(const std::filesystem::path& objPath, bool textured);
+
 /**
  * Loads vertex data from the specified .obj file.
  *
@@ -0,0 +1,169 @@
+#include "core/BackgroundBaker.h"
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define GL_SILENCE_DEPRECATION
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "core/ErrorCodes.h"
+#include "core/PrecomputationContext.h"
+#include "core/Profiler.h"
+#include "core/ShaderProgram.h"
+
+namespace PBR {
+
+BackgroundBaker::BackgroundBaker(GLFWwindow* sharedWith)
+        :context(), worker(), mutex(), jobsAvailable(), queuedJobs(), submittedJobs(), stopping(false),
+         shaderPrograms()
+{
+    // The context hints set up by Window still apply, so we get the same OpenGL
+    // version. We only need to make sure the window is never shown.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    context = glfwCreateWindow(1, 1, "", nullptr, sharedWith);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+    if (!context) {
+        std::cerr << "Failed to create a context for background baking." << std::endl;
+        exit((int) ErrorCodes::GlfwError);
+    }
+
+    worker = std::thread([this]() { workerLoop(); });
+}
+
+BackgroundBaker::~BackgroundBaker()
+{
+    shutdown();
+}
+
+void BackgroundBaker::submit(std::function<void()> work, std::function<void()> onComplete)
+{
+    // The job may read objects that the main thread has only just written to,
+    // such as a freshly loaded environment map, so it must wait for them
+    GLsync ready = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queuedJobs.push_back(QueuedJob{ready, std::move(work), std::move(onComplete)});
+    }
+    jobsAvailable.notify_one();
+}
+
+void BackgroundBaker::poll()
+{
+    // Collect the jobs whose fences have been passed, without waiting for any others
+    std::vector<std::function<void()>> finishedCallbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = submittedJobs.begin(); it != submittedJobs.end();) {
+            GLenum status = glClientWaitSync(it->fence, 0, 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                glDeleteSync(it->fence);
+                finishedCallbacks.push_back(std::move(it->onComplete));
+                it = submittedJobs.erase(it);
+            }
+            else {
+                it++;
+            }
+        }
+    }
+
+    // Run the callbacks outside the lock, since they may submit more jobs
+    for (const auto& callback : finishedCallbacks) {
+        callback();
+    }
+}
+
+size_t BackgroundBaker::pendingJobs()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queuedJobs.size() + submittedJobs.size();
+}
+
+void BackgroundBaker::shutdown()
+{
+    if (!context) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobsAvailable.notify_all();
+    worker.join();
+
+    for (const auto& job : queuedJobs) {
+        glDeleteSync(job.ready);
+    }
+    queuedJobs.clear();
+
+    for (const auto& job : submittedJobs) {
+        glDeleteSync(job.fence);
+    }
+    submittedJobs.clear();
+
+    glfwDestroyWindow(context);
+    context = nullptr;
+}
+
+std::shared_ptr<ShaderProgram> BackgroundBaker::getShaderProgram(
+        const std::string& name, const std::function<std::shared_ptr<ShaderProgram>()>& create)
+{
+    auto it = shaderPrograms.find(name);
+    if (it == shaderPrograms.end()) {
+        it = shaderPrograms.emplace(name, create()).first;
+    }
+    return it->second;
+}
+
+void BackgroundBaker::workerLoop()
+{
+    // GLEW's function pointers were already loaded by Window, and are valid for
+    // this context too since it was created with the same settings
+    glfwMakeContextCurrent(context);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    while (true) {
+        QueuedJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobsAvailable.wait(lock, [this]() { return stopping || !queuedJobs.empty(); });
+            if (stopping) {
+                break;
+            }
+            job = std::move(queuedJobs.front());
+            queuedJobs.pop_front();
+        }
+
+        glWaitSync(job.ready, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(job.ready);
+        {
+            PBR_PROFILE_SCOPE("Background bake");
+            job.work();
+        }
+
+        // Insert a fence after the job's commands and flush so that the fence
+        // actually reaches the GPU, otherwise the main thread could wait forever
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        submittedJobs.push_back(SubmittedJob{fence, std::move(job.onComplete)});
+    }
+
+    shaderPrograms.clear();
+    PrecomputationContext::releaseCurrent();
+    glfwMakeContextCurrent(nullptr);
+}
+
+} // namespace PBR
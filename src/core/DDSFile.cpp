@@ -0,0 +1,197 @@
+#include "core/DDSFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Layout of the DDS headers.
+// See: https://docs.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+constexpr uint32_t DDS_MAGIC = 0x20534444;  // "DDS "
+constexpr uint32_t DX10_FOURCC = 0x30315844;  // "DX10"
+
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+constexpr uint32_t DXGI_FORMAT_BC6H_UF16 = 95;
+constexpr uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDX10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSPixelFormat) == 32, "DDS pixel format must be 32 bytes");
+static_assert(sizeof(DDSHeader) == 124, "DDS header must be 124 bytes");
+static_assert(sizeof(DDSHeaderDX10) == 20, "DDS DX10 header must be 20 bytes");
+
+} // anonymous namespace
+
+namespace PBR {
+
+std::optional<DDSFile> DDSFile::read(const fs::path& path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        return std::nullopt;
+    }
+
+    // Read and validate the headers
+    uint32_t magic;
+    DDSHeader header;
+    DDSHeaderDX10 headerDX10;
+    stream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!stream || magic != DDS_MAGIC || header.size != sizeof(DDSHeader)) {
+        return std::nullopt;
+    }
+
+    // We only write DX10-style headers, since the legacy header has no way of
+    // describing BC6H or BC7
+    if (!(header.pixelFormat.flags & DDPF_FOURCC) || header.pixelFormat.fourCC != DX10_FOURCC) {
+        return std::nullopt;
+    }
+    stream.read(reinterpret_cast<char*>(&headerDX10), sizeof(headerDX10));
+    if (!stream || headerDX10.resourceDimension != D3D10_RESOURCE_DIMENSION_TEXTURE2D) {
+        return std::nullopt;
+    }
+
+    DDSFile file;
+    if (headerDX10.dxgiFormat == DXGI_FORMAT_BC6H_UF16) {
+        file.format = BlockCompressionFormat::BC6H;
+    }
+    else if (headerDX10.dxgiFormat == DXGI_FORMAT_BC7_UNORM) {
+        file.format = BlockCompressionFormat::BC7;
+    }
+    else {
+        return std::nullopt;
+    }
+
+    // Read each mipmap level in turn
+    unsigned int levels = (header.flags & DDSD_MIPMAPCOUNT) ? std::max(header.mipMapCount, 1u) : 1;
+    unsigned int width = header.width;
+    unsigned int height = header.height;
+    for (unsigned int level = 0; level < levels; level++) {
+        CompressedMipLevel mipLevel{width, height, std::vector<unsigned char>(levelSize(width, height))};
+        stream.read(reinterpret_cast<char*>(mipLevel.data.data()), mipLevel.data.size());
+        if (!stream) {
+            return std::nullopt;
+        }
+        file.mipLevels.push_back(std::move(mipLevel));
+
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return file;
+}
+
+bool DDSFile::write(const fs::path& path) const
+{
+    if (mipLevels.empty()) {
+        return false;
+    }
+
+    DDSHeader header{};
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.width = mipLevels[0].width;
+    header.height = mipLevels[0].height;
+    header.pitchOrLinearSize = mipLevels[0].data.size();
+    header.mipMapCount = mipLevels.size();
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    header.pixelFormat.fourCC = DX10_FOURCC;
+    header.caps = DDSCAPS_TEXTURE | (mipLevels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    DDSHeaderDX10 headerDX10{};
+    headerDX10.dxgiFormat = format == BlockCompressionFormat::BC6H ? DXGI_FORMAT_BC6H_UF16 : DXGI_FORMAT_BC7_UNORM;
+    headerDX10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+    headerDX10.arraySize = 1;
+
+    std::ofstream stream(path, std::ios::binary);
+    stream.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+    for (const auto& mipLevel : mipLevels) {
+        stream.write(reinterpret_cast<const char*>(mipLevel.data.data()), mipLevel.data.size());
+    }
+
+    return static_cast<bool>(stream);
+}
+
+size_t DDSFile::levelSize(unsigned int width, unsigned int height)
+{
+    // Both formats use 16-byte blocks covering 4x4 pixels. Partial blocks at
+    // the edges are padded out to a full block.
+    size_t blocksWide = (width + 3) / 4;
+    size_t blocksHigh = (height + 3) / 4;
+    return blocksWide * blocksHigh * 16;
+}
+
+fs::path DDSFile::compressedPathFor(const fs::path& sourcePath)
+{
+    return fs::path(sourcePath).replace_extension(".dds");
+}
+
+bool DDSFile::isUpToDate(const fs::path& sourcePath)
+{
+    std::error_code error;
+    auto compressedTime = fs::last_write_time(compressedPathFor(sourcePath), error);
+    if (error) {
+        return false;
+    }
+
+    // A missing source can't be newer, so the compressed copy is all there is
+    auto sourceTime = fs::last_write_time(sourcePath, error);
+    return error || compressedTime >= sourceTime;
+}
+
+} // namespace PBR
@@ -0,0 +1,14 @@
+#include "core/FrameSnapshot.h"
+
+#include "core/Camera.h"
+
+namespace PBR {
+
+void FrameSnapshot::captureCamera(const Camera& camera)
+{
+    viewMatrix = camera.getViewMatrix();
+    projectionMatrix = camera.getProjectionMatrix();
+    cameraPosition = camera.position();
+}
+
+} // namespace PBR
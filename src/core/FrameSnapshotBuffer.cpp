@@ -0,0 +1,44 @@
+#include "core/FrameSnapshotBuffer.h"
+
+#include <atomic>
+
+#include "core/FrameSnapshot.h"
+
+namespace PBR {
+
+FrameSnapshotBuffer::FrameSnapshotBuffer()
+        :snapshots(),
+         middle(1),
+         writeIndex(0),
+         readIndex(2)
+{
+}
+
+FrameSnapshot& FrameSnapshotBuffer::writeSnapshot()
+{
+    return snapshots[writeIndex];
+}
+
+void FrameSnapshotBuffer::publish()
+{
+    // Release the writes to the snapshot, and acquire the reader's writes to the
+    // one we get back, which it may have been the last to use
+    writeIndex = middle.exchange(writeIndex | freshFlag, std::memory_order_acq_rel) & indexMask;
+}
+
+bool FrameSnapshotBuffer::acquire()
+{
+    // Only the writer sets the flag, so if it's set now it stays set until we swap
+    if (!(middle.load(std::memory_order_relaxed) & freshFlag)) {
+        return false;
+    }
+    readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+    return true;
+}
+
+const FrameSnapshot& FrameSnapshotBuffer::readSnapshot() const
+{
+    return snapshots[readIndex];
+}
+
+} // namespace PBR
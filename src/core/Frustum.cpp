@@ -0,0 +1,46 @@
+#include "core/Frustum.h"
+
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace PBR {
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjectionMatrix)
+{
+    // Each plane is the sum or difference of the last row and one of the others
+    // (Gribb and Hartmann). glm matrices are column-major, so build the rows first.
+    const glm::mat4& m = viewProjectionMatrix;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    Frustum frustum{{
+            rows[3] + rows[0],
+            rows[3] - rows[0],
+            rows[3] + rows[1],
+            rows[3] - rows[1],
+            rows[3] + rows[2],
+            rows[3] - rows[2],
+    }};
+
+    // Normalise them so that distances to them are in world units
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& centre, float radius) const
+{
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3(plane), centre) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace PBR
@@ -0,0 +1,64 @@
+#include "core/HDRImage.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <stb_image.h>
+
+#include "core/ErrorCodes.h"
+#include "core/RadianceHDRFile.h"
+
+namespace fs = std::filesystem;
+
+namespace PBR {
+
+HDRImage HDRImage::load(const fs::path& path)
+{
+    // Radiance files have their own decoder, which is much faster than stb_image
+    if (path.extension() == ".hdr") {
+        RadianceHDRFile file(path);
+        if (file.isValid()) {
+            HDRImage image{file.width(), file.height(), std::vector<float>((size_t) file.width() * file.height() * 3)};
+            if (file.decodeToFloat(image.pixels.data(), true)) {
+                return image;
+            }
+        }
+    }
+
+    int width, height, numChannels;
+    std::string pathString = path.string();
+
+    stbi_set_flip_vertically_on_load(true);
+    float* data = stbi_loadf(pathString.c_str(), &width, &height, &numChannels, 3);
+    stbi_set_flip_vertically_on_load(false);
+
+    if (!data) {
+        std::cerr << "Failed to load texture: " << path << std::endl;
+        exit((int) ErrorCodes::BadTexture);
+    }
+
+    HDRImage image{(unsigned int) width, (unsigned int) height,
+                   std::vector<float>(data, data + (size_t) width * height * 3)};
+    stbi_image_free(data);
+
+    return image;
+}
+
+glm::vec3 HDRImage::pixel(unsigned int x, unsigned int y) const
+{
+    const float* p = &pixels[((size_t) y * width + x) * 3];
+    return glm::vec3(p[0], p[1], p[2]);
+}
+
+void HDRImage::setPixel(unsigned int x, unsigned int y, glm::vec3 value)
+{
+    float* p = &pixels[((size_t) y * width + x) * 3];
+    p[0] = value.r;
+    p[1] = value.g;
+    p[2] = value.b;
+}
+
+} // namespace PBR
@@ -0,0 +1,68 @@
+#include "core/HalfFloat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+/**
+ * The largest finite half float. Anything brighter is clamped to this rather
+ * than becoming infinity.
+ */
+constexpr float maxHalf = 65504.0f;
+
+/**
+ * Converts one non-negative float to a half float, rounding to nearest even.
+ */
+inline uint16_t floatToHalf(float value)
+{
+    value = std::min(value, maxHalf);
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    // Below the smallest normal half float, the result is a multiple of 2^-24
+    if (bits < 0x38800000) {
+        return (uint16_t) std::lrint(value * 16777216.0f);
+    }
+
+    // Rebias the exponent from 127 to 15, and round off the low 13 bits of the mantissa
+    bits += 0xC8000000 + 0x0FFF + ((bits >> 13) & 1);
+    return (uint16_t) (bits >> 13);
+}
+
+} // anonymous namespace
+
+namespace PBR {
+
+void HalfFloat::convert(const float* input, uint16_t* output, size_t count)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    const __m128 max = _mm_set1_ps(maxHalf);
+    for (; i + 4 <= count; i += 4) {
+        __m128 values = _mm_min_ps(_mm_loadu_ps(input + i), max);
+        __m128i halves = _mm_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), halves);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t max = vdupq_n_f32(maxHalf);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t values = vminq_f32(vld1q_f32(input + i), max);
+        vst1_u16(output + i, vreinterpret_u16_f16(vcvt_f16_f32(values)));
+    }
+#endif
+    for (; i < count; i++) {
+        output[i] = floatToHalf(input[i]);
+    }
+}
+
+} // namespace PBR
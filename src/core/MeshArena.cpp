@@ -0,0 +1,304 @@
+#include "core/MeshArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+#define GL_SILENCE_DEPRECATION
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "core/ErrorCodes.h"
+#include "core/RangeAllocator.h"
+#include "core/VertexData.h"
+
+#define POSITION_OFFSET 0
+#define NORMAL_OFFSET 3
+#define TEXTURE_COORDS_OFFSET 6
+
+namespace {
+
+inline
+size_t getStride(bool textured)
+{
+    // We always have position (3) and normals (3). There are two more
+    // elements for texture coordinates if the data includes them.
+    return textured ? 8 * sizeof(float) : 6 * sizeof(float);
+}
+
+unsigned int createBuffer(size_t size)
+{
+    unsigned int bufferId;
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, bufferId);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return bufferId;
+}
+
+void copyBufferRange(unsigned int source, unsigned int destination, size_t sourceOffset, size_t destinationOffset,
+                     size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void uploadBufferRange(unsigned int buffer, size_t offset, size_t size, const void* data)
+{
+    if (size == 0) {
+        return;
+    }
+
+    // Use the copy target so that no vertex array object's state is touched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * Exits if the arena's context isn't current, since its vertex array objects
+ * wouldn't exist in any other.
+ */
+void checkContext(GLFWwindow* context)
+{
+    if (glfwGetCurrentContext() != context) {
+        std::cerr << "Meshes must be created and defragmented on the main window's OpenGL context." << std::endl;
+        exit((int) PBR::ErrorCodes::MeshArenaError);
+    }
+}
+
+/**
+ * Exits if space couldn't be found for a mesh, even after growing the buffer.
+ */
+size_t checkAllocation(std::optional<size_t> offset)
+{
+    if (!offset) {
+        std::cerr << "Failed to allocate space for a mesh." << std::endl;
+        exit((int) PBR::ErrorCodes::MeshArenaError);
+    }
+    return *offset;
+}
+
+} // anonymous namespace
+
+namespace PBR {
+
+MeshArena::MeshArena(size_t initialVertices, size_t initialIndices)
+        :context(glfwGetCurrentContext()),
+         pools(),
+         eboId(createBuffer(initialIndices * sizeof(unsigned int))),
+         indexAllocator(initialIndices),
+         meshes()
+{
+    for (bool textured : {false, true}) {
+        size_t stride = getStride(textured);
+        unsigned int vaoId;
+        glGenVertexArrays(1, &vaoId);
+        pools.push_back(VertexPool{textured, stride, vaoId, createBuffer(initialVertices * stride),
+                                   RangeAllocator(initialVertices)});
+        bindBuffers(pools.back());
+    }
+}
+
+MeshArena& MeshArena::shared()
+{
+    static MeshArena* arena = new MeshArena(1 << 16, 1 << 18);
+
+    // The old arena's buffers went with its context, so there is nothing to delete
+    GLFWwindow* currentContext = glfwGetCurrentContext();
+    if (currentContext && currentContext != arena->context && arena->meshes.empty()) {
+        delete arena;
+        arena = new MeshArena(1 << 16, 1 << 18);
+    }
+    return *arena;
+}
+
+void MeshArena::add(VertexData& mesh, const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+{
+    checkContext(context);
+
+    VertexPool& pool = poolFor(mesh.hasTextureCoordinates);
+    size_t floatsPerVertex = pool.stride / sizeof(float);
+    assert(vertices.size() % floatsPerVertex == 0);
+
+    size_t vertexCount = vertices.size() / floatsPerVertex;
+    size_t baseVertex = allocateVertices(pool, vertexCount);
+    size_t firstIndex = allocateIndices(indices.size());
+    uploadBufferRange(pool.vboId, baseVertex * pool.stride, vertexCount * pool.stride, vertices.data());
+    uploadBufferRange(eboId, firstIndex * sizeof(unsigned int), indices.size() * sizeof(unsigned int),
+                      indices.data());
+
+    mesh.vaoId = pool.vaoId;
+    mesh.baseVertex = baseVertex;
+    mesh.firstIndex = firstIndex;
+    mesh.vertexCount = vertexCount;
+    mesh.indicesCount = indices.size();
+    meshes.insert(&mesh);
+}
+
+void MeshArena::remove(VertexData& mesh)
+{
+    if (meshes.erase(&mesh) == 0) {
+        return;
+    }
+    poolFor(mesh.hasTextureCoordinates).allocator.free(mesh.baseVertex, mesh.vertexCount);
+    indexAllocator.free(mesh.firstIndex, mesh.indicesCount);
+}
+
+void MeshArena::defragment()
+{
+    checkContext(context);
+    for (VertexPool& pool : pools) {
+        defragmentVertices(pool);
+    }
+    defragmentIndices();
+}
+
+unsigned int MeshArena::getVaoId(bool textured) const
+{
+    return pools[textured ? 1 : 0].vaoId;
+}
+
+MeshArena::VertexPool& MeshArena::poolFor(bool textured)
+{
+    return pools[textured ? 1 : 0];
+}
+
+size_t MeshArena::allocateVertices(VertexPool& pool, size_t count)
+{
+    RangeAllocator& allocator = pool.allocator;
+    std::optional<size_t> offset = allocator.allocate(count);
+
+    // There may be enough space, just not in one piece
+    if (!offset && allocator.getFreeSpace() >= count) {
+        defragmentVertices(pool);
+        offset = allocator.allocate(count);
+    }
+
+    // Otherwise copy everything into a bigger buffer
+    if (!offset) {
+        size_t oldCapacity = allocator.getCapacity();
+        size_t newCapacity = std::max(2 * oldCapacity, oldCapacity + count);
+        unsigned int newVboId = createBuffer(newCapacity * pool.stride);
+        copyBufferRange(pool.vboId, newVboId, 0, 0, oldCapacity * pool.stride);
+        glDeleteBuffers(1, &pool.vboId);
+        pool.vboId = newVboId;
+        allocator.grow(newCapacity);
+        bindBuffers(pool);
+        offset = allocator.allocate(count);
+    }
+
+    return checkAllocation(offset);
+}
+
+size_t MeshArena::allocateIndices(size_t count)
+{
+    std::optional<size_t> offset = indexAllocator.allocate(count);
+
+    if (!offset && indexAllocator.getFreeSpace() >= count) {
+        defragmentIndices();
+        offset = indexAllocator.allocate(count);
+    }
+
+    if (!offset) {
+        size_t oldCapacity = indexAllocator.getCapacity();
+        size_t newCapacity = std::max(2 * oldCapacity, oldCapacity + count);
+        unsigned int newEboId = createBuffer(newCapacity * sizeof(unsigned int));
+        copyBufferRange(eboId, newEboId, 0, 0, oldCapacity * sizeof(unsigned int));
+        glDeleteBuffers(1, &eboId);
+        eboId = newEboId;
+        indexAllocator.grow(newCapacity);
+        for (const VertexPool& pool : pools) {
+            bindBuffers(pool);
+        }
+        offset = indexAllocator.allocate(count);
+    }
+
+    return checkAllocation(offset);
+}
+
+void MeshArena::defragmentVertices(VertexPool& pool)
+{
+    std::vector<VertexData*> poolMeshes;
+    for (VertexData* mesh : meshes) {
+        if (mesh->hasTextureCoordinates == pool.textured) {
+            poolMeshes.push_back(mesh);
+        }
+    }
+    std::sort(poolMeshes.begin(), poolMeshes.end(), [](const VertexData* first, const VertexData* second) {
+        return first->baseVertex < second->baseVertex;
+    });
+
+    // Copy the meshes one after another into a new buffer. Indices are relative
+    // to the base vertex, so they don't need changing.
+    unsigned int newVboId = createBuffer(pool.allocator.getCapacity() * pool.stride);
+    size_t used = 0;
+    for (VertexData* mesh : poolMeshes) {
+        copyBufferRange(pool.vboId, newVboId, mesh->baseVertex * pool.stride, used * pool.stride,
+                        mesh->vertexCount * pool.stride);
+        mesh->baseVertex = used;
+        used += mesh->vertexCount;
+    }
+    glDeleteBuffers(1, &pool.vboId);
+    pool.vboId = newVboId;
+    pool.allocator.compact(used);
+    bindBuffers(pool);
+}
+
+void MeshArena::defragmentIndices()
+{
+    std::vector<VertexData*> sortedMeshes(meshes.begin(), meshes.end());
+    std::sort(sortedMeshes.begin(), sortedMeshes.end(), [](const VertexData* first, const VertexData* second) {
+        return first->firstIndex < second->firstIndex;
+    });
+
+    unsigned int newEboId = createBuffer(indexAllocator.getCapacity() * sizeof(unsigned int));
+    size_t used = 0;
+    for (VertexData* mesh : sortedMeshes) {
+        copyBufferRange(eboId, newEboId, mesh->firstIndex * sizeof(unsigned int), used * sizeof(unsigned int),
+                        mesh->indicesCount * sizeof(unsigned int));
+        mesh->firstIndex = used;
+        used += mesh->indicesCount;
+    }
+    glDeleteBuffers(1, &eboId);
+    eboId = newEboId;
+    indexAllocator.compact(used);
+    for (const VertexPool& pool : pools) {
+        bindBuffers(pool);
+    }
+}
+
+void MeshArena::bindBuffers(const VertexPool& pool) const
+{
+    glBindVertexArray(pool.vaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vboId);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboId);
+
+    // Vertex positions
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, pool.stride, (void*) (POSITION_OFFSET * sizeof(float)));
+    glEnableVertexAttribArray(0);
+
+    // Normals
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, pool.stride, (void*) (NORMAL_OFFSET * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // Texture coordinates
+    if (pool.textured) {
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, pool.stride, (void*) (TEXTURE_COORDS_OFFSET * sizeof(float)));
+        glEnableVertexAttribArray(2);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+} // namespace PBR
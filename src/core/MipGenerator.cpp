@@ -0,0 +1,262 @@
+#include "core/MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "core/ThreadPool.h"
+
+namespace PBR {
+
+namespace {
+
+/**
+ * The number of destination rows each task filters, so that a task's scratch
+ * row is reused.
+ */
+constexpr unsigned int rowsPerTask = 8;
+
+/**
+ * The half-width of the windowed sinc filters, in destination texels.
+ */
+constexpr float sincRadius = 3.0f;
+
+/**
+ * The shape parameter of the Kaiser window. Higher values trade sharpness for
+ * less ringing.
+ */
+constexpr float kaiserAlpha = 4.0f;
+
+constexpr float pi = 3.14159265358979f;
+
+float sinc(float x)
+{
+    if (std::abs(x) < 1e-5f) {
+        return 1.0f;
+    }
+    return std::sin(pi * x) / (pi * x);
+}
+
+/**
+ * The zeroth-order modified Bessel function of the first kind, by its power series.
+ */
+float besselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    float halfX = x / 2.0f;
+    for (int k = 1; k < 32; k++) {
+        term *= (halfX / (float) k) * (halfX / (float) k);
+        sum += term;
+        if (term < sum * 1e-8f) {
+            break;
+        }
+    }
+    return sum;
+}
+
+float filterRadius(MipFilter filter)
+{
+    return filter == MipFilter::Box ? 0.5f : sincRadius;
+}
+
+/**
+ * Evaluates a filter at a distance in destination texels.
+ */
+float evaluateFilter(MipFilter filter, float x)
+{
+    float radius = filterRadius(filter);
+    if (std::abs(x) > radius) {
+        return 0.0f;
+    }
+    switch (filter) {
+    case MipFilter::Box:
+        return 1.0f;
+    case MipFilter::Kaiser: {
+        float t = x / radius;
+        return sinc(x) * besselI0(kaiserAlpha * std::sqrt(1.0f - t * t)) / besselI0(kaiserAlpha);
+    }
+    case MipFilter::Lanczos:
+        return sinc(x) * sinc(x / radius);
+    }
+    return 0.0f;
+}
+
+/**
+ * The source texels that contribute to one destination texel along an axis.
+ */
+struct FilterTaps {
+
+    /**
+     * The index of each source texel, already wrapped or clamped into the image.
+     */
+    std::vector<unsigned int> indices;
+
+    /**
+     * The weight of each source texel. These sum to one.
+     */
+    std::vector<float> weights;
+};
+
+/**
+ * Works out the taps for every destination texel along an axis. The same taps
+ * are reused for every row or column.
+ */
+std::vector<FilterTaps> computeTaps(MipFilter filter, unsigned int sourceSize, unsigned int destinationSize,
+                                    MipEdge edge)
+{
+    float scale = (float) sourceSize / (float) destinationSize;
+    float support = filterRadius(filter) * scale;
+
+    std::vector<FilterTaps> taps(destinationSize);
+    for (unsigned int i = 0; i < destinationSize; i++) {
+        // The centre of the destination texel, in source texels
+        float centre = ((float) i + 0.5f) * scale;
+        int first = (int) std::floor(centre - support);
+        int last = (int) std::ceil(centre + support);
+
+        float totalWeight = 0.0f;
+        for (int j = first; j <= last; j++) {
+            float weight = evaluateFilter(filter, ((float) j + 0.5f - centre) / scale);
+            if (weight == 0.0f) {
+                continue;
+            }
+            int index;
+            if (edge == MipEdge::Wrap) {
+                index = j % (int) sourceSize;
+                if (index < 0) {
+                    index += (int) sourceSize;
+                }
+            }
+            else {
+                index = std::clamp(j, 0, (int) sourceSize - 1);
+            }
+            taps[i].indices.push_back((unsigned int) index);
+            taps[i].weights.push_back(weight);
+            totalWeight += weight;
+        }
+        for (float& weight : taps[i].weights) {
+            weight /= totalWeight;
+        }
+    }
+    return taps;
+}
+
+/**
+ * Filters an image down to the next mipmap level.
+ */
+std::vector<float> downsample(const std::vector<float>& source, unsigned int width, unsigned int height,
+                              unsigned int channels, MipFilter filter, MipEdges edges, ThreadPool& threadPool)
+{
+    unsigned int newWidth = std::max(width / 2, 1u);
+    unsigned int newHeight = std::max(height / 2, 1u);
+    std::vector<FilterTaps> columnTaps = computeTaps(filter, height, newHeight, edges.vertical);
+    std::vector<FilterTaps> rowTaps = computeTaps(filter, width, newWidth, edges.horizontal);
+
+    size_t sourceRowLength = (size_t) width * channels;
+    size_t destinationRowLength = (size_t) newWidth * channels;
+    std::vector<float> destination((size_t) newHeight * destinationRowLength);
+
+    unsigned int numTasks = (newHeight + rowsPerTask - 1) / rowsPerTask;
+    threadPool.parallelFor(numTasks, [&](size_t task) {
+        std::vector<float> column(sourceRowLength);
+
+        unsigned int firstRow = task * rowsPerTask;
+        unsigned int lastRow = std::min(firstRow + rowsPerTask, newHeight);
+        for (unsigned int y = firstRow; y < lastRow; y++) {
+            // Filter down the columns, combining whole source rows at once
+            std::fill(column.begin(), column.end(), 0.0f);
+            const FilterTaps& verticalTaps = columnTaps[y];
+            for (size_t tap = 0; tap < verticalTaps.indices.size(); tap++) {
+                const float* sourceRow = source.data() + verticalTaps.indices[tap] * sourceRowLength;
+                float weight = verticalTaps.weights[tap];
+                float* output = column.data();
+                for (size_t i = 0; i < sourceRowLength; i++) {
+                    output[i] += weight * sourceRow[i];
+                }
+            }
+
+            // Then along the row
+            float* destinationRow = destination.data() + y * destinationRowLength;
+            for (unsigned int x = 0; x < newWidth; x++) {
+                const FilterTaps& horizontalTaps = rowTaps[x];
+                float* output = destinationRow + x * channels;
+                for (size_t tap = 0; tap < horizontalTaps.indices.size(); tap++) {
+                    const float* input = column.data() + horizontalTaps.indices[tap] * channels;
+                    float weight = horizontalTaps.weights[tap];
+                    for (unsigned int c = 0; c < channels; c++) {
+                        output[c] += weight * input[c];
+                    }
+                }
+                for (unsigned int c = 0; c < channels; c++) {
+                    output[c] = std::max(output[c], 0.0f);
+                }
+            }
+        }
+    });
+
+    return destination;
+}
+
+} // anonymous namespace
+
+MipEdges MipEdges::equirectangular()
+{
+    return MipEdges{MipEdge::Wrap, MipEdge::Clamp};
+}
+
+std::vector<std::vector<float>> MipGenerator::generate(const float* pixels, unsigned int width, unsigned int height,
+                                                       unsigned int channels, MipFilter filter, MipEdges edges,
+                                                       ThreadPool& threadPool)
+{
+    std::vector<std::vector<float>> levels;
+    std::vector<float> level(pixels, pixels + (size_t) width * height * channels);
+    while (width > 1 || height > 1) {
+        level = downsample(level, width, height, channels, filter, edges, threadPool);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+std::vector<std::vector<unsigned char>> MipGenerator::generate(const unsigned char* pixels, unsigned int width,
+                                                               unsigned int height, unsigned int channels,
+                                                               MipFilter filter, MipEdges edges,
+                                                               ThreadPool& threadPool)
+{
+    std::vector<float> base(pixels, pixels + (size_t) width * height * channels);
+    std::vector<std::vector<float>> floatLevels = generate(base.data(), width, height, channels, filter, edges,
+                                                           threadPool);
+
+    std::vector<std::vector<unsigned char>> levels;
+    levels.reserve(floatLevels.size());
+    for (const auto& floatLevel : floatLevels) {
+        std::vector<unsigned char> level(floatLevel.size());
+        for (size_t i = 0; i < level.size(); i++) {
+            level[i] = (unsigned char) std::min(floatLevel[i] + 0.5f, 255.0f);
+        }
+        levels.push_back(std::move(level));
+    }
+    return levels;
+}
+
+unsigned int MipGenerator::levelCount(unsigned int width, unsigned int height)
+{
+    unsigned int levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels++;
+    }
+    return levels;
+}
+
+unsigned int MipGenerator::levelSize(unsigned int baseSize, unsigned int level)
+{
+    return std::max(baseSize >> level, 1u);
+}
+
+} // namespace PBR
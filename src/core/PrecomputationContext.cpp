@@ -0,0 +1,190 @@
+#include "core/PrecomputationContext.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#define GL_SILENCE_DEPRECATION
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "core/Texture.h"
+
+namespace {
+
+/**
+ * The unsized format matching a sized internal format, for implementations
+ * without immutable storage where `glTexImage2D` needs both.
+ */
+GLenum baseFormat(GLenum internalFormat)
+{
+    switch (internalFormat) {
+    case GL_R16F:
+    case GL_R32F:
+    case GL_R8:
+        return GL_RED;
+    case GL_RG16F:
+    case GL_RG32F:
+    case GL_RG8:
+        return GL_RG;
+    case GL_RGBA16F:
+    case GL_RGBA32F:
+    case GL_RGBA8:
+        return GL_RGBA;
+    default:
+        return GL_RGB;
+    }
+}
+
+thread_local std::unique_ptr<PBR::PrecomputationContext> currentContext;
+
+} // anonymous namespace
+
+namespace PBR {
+
+PrecomputationContext::PrecomputationContext()
+        :vaoId(), framebufferPool(), batchFramebufferId(0), batchDepth(0)
+{
+    glGenVertexArrays(1, &vaoId);
+}
+
+PrecomputationContext::~PrecomputationContext()
+{
+    // If the thread exits without calling releaseCurrent() then its OpenGL context
+    // may already be gone, along with these objects
+    if (!glfwGetCurrentContext()) {
+        return;
+    }
+
+    glDeleteVertexArrays(1, &vaoId);
+    if (!framebufferPool.empty()) {
+        glDeleteFramebuffers(framebufferPool.size(), framebufferPool.data());
+    }
+}
+
+PrecomputationContext& PrecomputationContext::current()
+{
+    if (!currentContext) {
+        currentContext.reset(new PrecomputationContext());
+    }
+    return *currentContext;
+}
+
+void PrecomputationContext::releaseCurrent()
+{
+    currentContext.reset();
+}
+
+unsigned int PrecomputationContext::beginBatch()
+{
+    if (batchDepth++ == 0) {
+        batchFramebufferId = acquireFramebuffer();
+        glBindFramebuffer(GL_FRAMEBUFFER, batchFramebufferId);
+        glBindVertexArray(vaoId);
+    }
+    return batchFramebufferId;
+}
+
+void PrecomputationContext::endBatch()
+{
+    if (--batchDepth == 0) {
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        releaseFramebuffer(batchFramebufferId);
+        batchFramebufferId = 0;
+    }
+}
+
+void PrecomputationContext::drawFullscreenTriangle(unsigned int instances)
+{
+    if (instances == 1) {
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    else {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 3, instances);
+    }
+}
+
+void PrecomputationContext::allocateStorage(const Texture& texture, unsigned int internalFormat,
+                                            unsigned int width, unsigned int height, unsigned int mipmapLevels,
+                                            unsigned int layers)
+{
+    GLenum target = texture.target();
+    bool isArray = target == GL_TEXTURE_2D_ARRAY || target == GL_TEXTURE_CUBE_MAP_ARRAY;
+    glBindTexture(target, texture.id());
+
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage) {
+        // A single call allocates every face and level, and the driver knows up
+        // front that the texture is complete and will never be resized
+        if (isArray) {
+            glTexStorage3D(target, mipmapLevels, internalFormat, width, height, layers);
+        }
+        else {
+            glTexStorage2D(target, mipmapLevels, internalFormat, width, height);
+        }
+    }
+    else {
+        GLenum format = baseFormat(internalFormat);
+        for (unsigned int mipmapLevel = 0; mipmapLevel < mipmapLevels; mipmapLevel++) {
+            unsigned int levelWidth = std::max(width >> mipmapLevel, 1u);
+            unsigned int levelHeight = std::max(height >> mipmapLevel, 1u);
+            if (isArray) {
+                glTexImage3D(target, mipmapLevel, internalFormat, levelWidth, levelHeight, layers, 0, format,
+                             GL_FLOAT, nullptr);
+            }
+            else if (target == GL_TEXTURE_CUBE_MAP) {
+                for (unsigned int face = 0; face < 6; face++) {
+                    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mipmapLevel, internalFormat,
+                                 levelWidth, levelHeight, 0, format, GL_FLOAT, nullptr);
+                }
+            }
+            else {
+                glTexImage2D(target, mipmapLevel, internalFormat, levelWidth, levelHeight, 0, format, GL_FLOAT,
+                             nullptr);
+            }
+        }
+    }
+
+    // Set up texture sampling parameters
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (target == GL_TEXTURE_CUBE_MAP || target == GL_TEXTURE_CUBE_MAP_ARRAY) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, mipmapLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, mipmapLevels - 1);
+
+    glBindTexture(target, 0);
+}
+
+unsigned int PrecomputationContext::acquireFramebuffer()
+{
+    if (framebufferPool.empty()) {
+        unsigned int framebufferId;
+        glGenFramebuffers(1, &framebufferId);
+        return framebufferId;
+    }
+
+    unsigned int framebufferId = framebufferPool.back();
+    framebufferPool.pop_back();
+    return framebufferId;
+}
+
+void PrecomputationContext::releaseFramebuffer(unsigned int framebufferId)
+{
+    framebufferPool.push_back(framebufferId);
+}
+
+PrecomputationBatch::PrecomputationBatch()
+{
+    PrecomputationContext::current().beginBatch();
+}
+
+PrecomputationBatch::~PrecomputationBatch()
+{
+    PrecomputationContext::current().endBatch();
+}
+
+} // namespace PBR
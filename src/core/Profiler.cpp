@@ -0,0 +1,240 @@
+#include "core/Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/**
+ * The trace thread ID that GPU events are shown on. CPU threads are numbered from 1.
+ */
+constexpr uint32_t gpuTraceThread = 0;
+
+std::atomic<uint32_t> nextThreadIndex(1);
+
+/**
+ * @return A small number identifying the calling thread, which is easier to
+ *         read in a trace than a `std::thread::id`
+ */
+uint32_t currentThreadIndex()
+{
+    thread_local uint32_t threadIndex = nextThreadIndex++;
+    return threadIndex;
+}
+
+/**
+ * Writes a string as a JSON string literal.
+ */
+void writeJSONString(std::ostream& stream, const char* string)
+{
+    stream << '"';
+    for (const char* c = string; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            stream << '\\';
+        }
+        stream << *c;
+    }
+    stream << '"';
+}
+
+} // anonymous namespace
+
+namespace PBR {
+
+Profiler::Profiler(size_t capacity)
+        :startTime(std::chrono::steady_clock::now()),
+         profilerMutex(),
+         events(),
+         nextEvent(0),
+         capacity(std::max(capacity, (size_t) 1)),
+         currentFrame(0),
+         gpuThread(),
+         gpuFrames{GPUFrame{0, {}, {}}, GPUFrame{1, {}, {}}},
+         gpuQueryActive(false)
+{
+}
+
+Profiler::~Profiler()
+{
+    // The queries belong to a context that is normally gone by now, so they are
+    // left for the driver to clean up with it
+}
+
+Profiler& Profiler::shared()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::attachGPUContext()
+{
+    std::lock_guard lock(profilerMutex);
+    gpuThread = std::this_thread::get_id();
+}
+
+double Profiler::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::recordCPU(const char* name, double startMicroseconds, double endMicroseconds)
+{
+    ProfileEvent event{name, false, currentThreadIndex(), 0, startMicroseconds, endMicroseconds - startMicroseconds};
+    std::lock_guard lock(profilerMutex);
+    event.frame = currentFrame;
+    addEventLocked(event);
+}
+
+bool Profiler::beginGPU(const char* name)
+{
+    std::lock_guard lock(profilerMutex);
+    if (gpuQueryActive || gpuThread != std::this_thread::get_id()) {
+        return false;
+    }
+
+    // Reuse this frame's queries, only making more when it has used them all
+    GPUFrame& gpuFrame = gpuFrames[currentFrame % 2];
+    if (gpuFrame.pendingEvents.size() == gpuFrame.queries.size()) {
+        unsigned int query;
+        glGenQueries(1, &query);
+        gpuFrame.queries.push_back(query);
+    }
+    unsigned int query = gpuFrame.queries[gpuFrame.pendingEvents.size()];
+    gpuFrame.pendingEvents.push_back(PendingGPUEvent{name, query, now()});
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpuQueryActive = true;
+    return true;
+}
+
+void Profiler::endGPU()
+{
+    std::lock_guard lock(profilerMutex);
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuQueryActive = false;
+}
+
+void Profiler::endFrame()
+{
+    std::lock_guard lock(profilerMutex);
+
+    // The other slot holds the previous frame's queries, which the GPU has had a
+    // whole frame to finish. Once they are read, the slot is free for the next frame.
+    currentFrame++;
+    GPUFrame& previousFrame = gpuFrames[currentFrame % 2];
+    resolveGPUFrameLocked(previousFrame);
+    previousFrame.frame = currentFrame;
+}
+
+std::vector<ProfileEvent> Profiler::getEvents()
+{
+    std::lock_guard lock(profilerMutex);
+    std::vector<ProfileEvent> orderedEvents(events.begin() + nextEvent, events.end());
+    orderedEvents.insert(orderedEvents.end(), events.begin(), events.begin() + nextEvent);
+    return orderedEvents;
+}
+
+void Profiler::clear()
+{
+    std::lock_guard lock(profilerMutex);
+    events.clear();
+    nextEvent = 0;
+}
+
+bool Profiler::writeChromeTrace(const fs::path& path)
+{
+    std::vector<ProfileEvent> orderedEvents = getEvents();
+
+    std::ofstream stream(path);
+    if (!stream) {
+        return false;
+    }
+
+    // Name the threads so that the GPU row is labelled as such
+    std::set<uint32_t> threads;
+    for (const auto& event : orderedEvents) {
+        threads.insert(event.isGPU ? gpuTraceThread : event.threadIndex);
+    }
+
+    stream << "{\"traceEvents\":[";
+    bool first = true;
+    for (uint32_t thread : threads) {
+        std::string threadName = thread == gpuTraceThread ? "GPU" : "CPU thread " + std::to_string(thread);
+        stream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+               << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+        first = false;
+    }
+    for (const auto& event : orderedEvents) {
+        stream << (first ? "" : ",") << "\n{\"name\":";
+        writeJSONString(stream, event.name);
+        stream << ",\"cat\":\"" << (event.isGPU ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+               << (event.isGPU ? gpuTraceThread : event.threadIndex) << ",\"ts\":" << event.startMicroseconds
+               << ",\"dur\":" << event.durationMicroseconds << ",\"args\":{\"frame\":" << event.frame << "}}";
+        first = false;
+    }
+    stream << "\n]}\n";
+
+    return (bool) stream;
+}
+
+void Profiler::addEventLocked(const ProfileEvent& event)
+{
+    if (events.size() < capacity) {
+        events.push_back(event);
+        return;
+    }
+    events[nextEvent] = event;
+    nextEvent = (nextEvent + 1) % capacity;
+}
+
+void Profiler::resolveGPUFrameLocked(GPUFrame& gpuFrame)
+{
+    for (const auto& pending : gpuFrame.pendingEvents) {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &nanoseconds);
+        addEventLocked(ProfileEvent{pending.name, true, currentThreadIndex(), gpuFrame.frame,
+                                    pending.startMicroseconds, (double) nanoseconds / 1000.0});
+    }
+    gpuFrame.pendingEvents.clear();
+}
+
+ProfileScope::ProfileScope(const char* name)
+        :name(name),
+         startMicroseconds(Profiler::shared().now())
+{
+}
+
+ProfileScope::~ProfileScope()
+{
+    Profiler& profiler = Profiler::shared();
+    profiler.recordCPU(name, startMicroseconds, profiler.now());
+}
+
+GPUProfileScope::GPUProfileScope(const char* name)
+        :cpuScope(name),
+         timingGPU(Profiler::shared().beginGPU(name))
+{
+}
+
+GPUProfileScope::~GPUProfileScope()
+{
+    if (timingGPU) {
+        Profiler::shared().endGPU();
+    }
+}
+
+} // namespace PBR
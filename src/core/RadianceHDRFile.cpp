@@ -0,0 +1,367 @@
+#include "core/RadianceHDRFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "core/HalfFloat.h"
+#include "core/ThreadPool.h"
+
+namespace fs = std::filesystem;
+
+namespace PBR {
+
+/**
+ * A read-only view of a whole file. Where the platform supports it the file is
+ * memory-mapped, so pages are only read in as the decoder touches them.
+ */
+class MappedFile {
+private:
+    const unsigned char* fileData;
+    size_t fileSize;
+
+    /**
+     * The contents of the file, on platforms where we read it instead of mapping it.
+     */
+    std::vector<unsigned char> contents;
+
+public:
+    explicit MappedFile(const fs::path& path)
+            :fileData(nullptr), fileSize(0), contents()
+    {
+#ifdef _WIN32
+        std::ifstream stream(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        fileData = contents.data();
+        fileSize = contents.size();
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                fileData = static_cast<const unsigned char*>(mapping);
+                fileSize = info.st_size;
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (fileData) {
+            munmap(const_cast<unsigned char*>(fileData), fileSize);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const
+    {
+        return fileData;
+    }
+
+    size_t size() const
+    {
+        return fileSize;
+    }
+};
+
+namespace {
+
+/**
+ * The number of scanlines each task decodes, so that a task's scratch buffers
+ * are reused across several rows.
+ */
+constexpr unsigned int rowsPerTask = 16;
+
+/**
+ * Reads one line of the header, without its newline.
+ *
+ * @return Whether a whole line was read
+ */
+bool readLine(const unsigned char* data, size_t size, size_t& offset, std::string& line)
+{
+    line.clear();
+    while (offset < size) {
+        char c = (char) data[offset++];
+        if (c == '\n') {
+            return true;
+        }
+        line.push_back(c);
+    }
+    return false;
+}
+
+/**
+ * Converts a pixel from RGBE to floats, in the same way as stb_image.
+ */
+inline void rgbeToFloat(const unsigned char* rgbe, float* rgb)
+{
+    if (rgbe[3] == 0) {
+        rgb[0] = rgb[1] = rgb[2] = 0.0f;
+        return;
+    }
+    float scale = std::ldexp(1.0f, (int) rgbe[3] - (128 + 8));
+    rgb[0] = rgbe[0] * scale;
+    rgb[1] = rgbe[1] * scale;
+    rgb[2] = rgbe[2] * scale;
+}
+
+} // anonymous namespace
+
+double HDRDecodeStatistics::megabytesPerSecond() const
+{
+    if (milliseconds <= 0.0) {
+        return 0.0;
+    }
+    return ((double) fileBytes / (1024.0 * 1024.0)) / (milliseconds / 1000.0);
+}
+
+RadianceHDRFile::RadianceHDRFile(const fs::path& path)
+        :file(new MappedFile(path)),
+         imageWidth(0),
+         imageHeight(0),
+         topToBottom(true),
+         runLengthEncoded(false),
+         scanlineOffsets()
+{
+    if (!parse()) {
+        scanlineOffsets.clear();
+    }
+}
+
+RadianceHDRFile::~RadianceHDRFile() = default;
+
+bool RadianceHDRFile::isValid() const
+{
+    return !scanlineOffsets.empty();
+}
+
+unsigned int RadianceHDRFile::width() const
+{
+    return imageWidth;
+}
+
+unsigned int RadianceHDRFile::height() const
+{
+    return imageHeight;
+}
+
+bool RadianceHDRFile::parse()
+{
+    const unsigned char* data = file->data();
+    size_t size = file->size();
+    if (!data) {
+        return false;
+    }
+
+    // The header is a magic line, then variables up to a blank line
+    size_t offset = 0;
+    std::string line;
+    if (!readLine(data, size, offset, line) || (line != "#?RADIANCE" && line != "#?RGBE")) {
+        return false;
+    }
+    while (true) {
+        if (!readLine(data, size, offset, line)) {
+            return false;
+        }
+        if (line.empty()) {
+            break;
+        }
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+            return false;
+        }
+    }
+
+    // Then the resolution, with the rows first
+    if (!readLine(data, size, offset, line)) {
+        return false;
+    }
+    char rowSign;
+    unsigned int height, width;
+    if (std::sscanf(line.c_str(), "%cY %u +X %u", &rowSign, &height, &width) != 3
+        || (rowSign != '-' && rowSign != '+') || width == 0 || height == 0) {
+        return false;
+    }
+    imageWidth = width;
+    imageHeight = height;
+    topToBottom = rowSign == '-';
+
+    // New-style run-length encoded scanlines start with 2, 2 and the width. If the
+    // first one doesn't, the whole file is uncompressed.
+    runLengthEncoded = width >= 8 && width < 32768 && offset + 4 <= size
+                       && data[offset] == 2 && data[offset + 1] == 2 && !(data[offset + 2] & 0x80);
+    scanlineOffsets.resize(height);
+
+    if (!runLengthEncoded) {
+        if (size - offset < (size_t) width * height * 4) {
+            return false;
+        }
+        for (unsigned int y = 0; y < height; y++) {
+            scanlineOffsets[y] = offset + (size_t) y * width * 4;
+        }
+        return true;
+    }
+
+    // Skip over each scanline's runs to find the next one. This only reads the
+    // run lengths, so it is much quicker than decoding.
+    for (unsigned int y = 0; y < height; y++) {
+        if (offset + 4 > size || data[offset] != 2 || data[offset + 1] != 2
+            || ((unsigned int) data[offset + 2] << 8 | data[offset + 3]) != width) {
+            return false;
+        }
+        scanlineOffsets[y] = offset;
+        offset += 4;
+
+        for (unsigned int channel = 0; channel < 4; channel++) {
+            unsigned int x = 0;
+            while (x < width) {
+                if (offset >= size) {
+                    return false;
+                }
+                unsigned int count = data[offset++];
+                if (count > 128) {
+                    count -= 128;
+                    offset += 1;
+                }
+                else {
+                    offset += count;
+                }
+                if (count == 0 || x + count > width) {
+                    return false;
+                }
+                x += count;
+            }
+        }
+        if (offset > size) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::optional<HDRDecodeStatistics> RadianceHDRFile::decodeToHalf(uint16_t* output, bool flipVertically,
+                                                                 ThreadPool& threadPool) const
+{
+    size_t rowLength = (size_t) imageWidth * 3;
+    return decode(flipVertically, threadPool, [output, rowLength](const float* row, unsigned int y) {
+        HalfFloat::convert(row, output + y * rowLength, rowLength);
+    });
+}
+
+std::optional<HDRDecodeStatistics> RadianceHDRFile::decodeToFloat(float* output, bool flipVertically,
+                                                                  ThreadPool& threadPool) const
+{
+    size_t rowLength = (size_t) imageWidth * 3;
+    return decode(flipVertically, threadPool, [output, rowLength](const float* row, unsigned int y) {
+        std::memcpy(output + y * rowLength, row, rowLength * sizeof(float));
+    });
+}
+
+std::optional<HDRDecodeStatistics> RadianceHDRFile::decode(bool flipVertically, ThreadPool& threadPool,
+                                                           const std::function<void(const float*, unsigned int)>& writeRow) const
+{
+    if (!isValid()) {
+        return std::nullopt;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    const unsigned char* data = file->data();
+    size_t size = file->size();
+    unsigned int width = imageWidth;
+    unsigned int height = imageHeight;
+    std::atomic<bool> corrupt(false);
+
+    unsigned int numTasks = (height + rowsPerTask - 1) / rowsPerTask;
+    threadPool.parallelFor(numTasks, [&](size_t task) {
+        std::vector<unsigned char> rgbe((size_t) width * 4);
+        std::vector<float> row((size_t) width * 3);
+
+        unsigned int firstRow = task * rowsPerTask;
+        unsigned int lastRow = std::min(firstRow + rowsPerTask, height);
+        for (unsigned int scanline = firstRow; scanline < lastRow; scanline++) {
+            const unsigned char* encoded = data + scanlineOffsets[scanline];
+
+            if (runLengthEncoded) {
+                // The four channels are stored one after another, each as a series of runs
+                const unsigned char* end = data + size;
+                encoded += 4;
+                for (unsigned int channel = 0; channel < 4; channel++) {
+                    unsigned int x = 0;
+                    while (x < width) {
+                        unsigned int count = *encoded++;
+                        if (count > 128) {
+                            count -= 128;
+                            unsigned char value = *encoded++;
+                            for (unsigned int i = 0; i < count; i++) {
+                                rgbe[(x + i) * 4 + channel] = value;
+                            }
+                        }
+                        else {
+                            if (encoded + count > end) {
+                                corrupt = true;
+                                return;
+                            }
+                            for (unsigned int i = 0; i < count; i++) {
+                                rgbe[(x + i) * 4 + channel] = encoded[i];
+                            }
+                            encoded += count;
+                        }
+                        x += count;
+                    }
+                }
+            }
+            else {
+                std::memcpy(rgbe.data(), encoded, rgbe.size());
+            }
+
+            for (unsigned int x = 0; x < width; x++) {
+                rgbeToFloat(&rgbe[x * 4], &row[x * 3]);
+            }
+
+            // Work out where this scanline belongs, given the order of the file and
+            // the order that the caller wants
+            bool storedBottomFirst = flipVertically == topToBottom;
+            unsigned int outputRow = storedBottomFirst ? height - 1 - scanline : scanline;
+            writeRow(row.data(), outputRow);
+        }
+    });
+
+    if (corrupt) {
+        return std::nullopt;
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    return HDRDecodeStatistics{size, std::chrono::duration<double, std::milli>(endTime - startTime).count()};
+}
+
+} // namespace PBR
@@ -0,0 +1,118 @@
+#include "core/RangeAllocator.h"
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <optional>
+
+namespace PBR {
+
+RangeAllocator::RangeAllocator(size_t capacity)
+        :freeRangesByOffset(),
+         freeRangesBySize(),
+         capacity(capacity),
+         freeSpace(0)
+{
+    addFreeRange(0, capacity);
+}
+
+std::optional<size_t> RangeAllocator::allocate(size_t size)
+{
+    if (size == 0) {
+        return 0;
+    }
+
+    // Take the start of the smallest range that fits, and leave the rest free
+    auto bestFit = freeRangesBySize.lower_bound(size);
+    if (bestFit == freeRangesBySize.end()) {
+        return std::nullopt;
+    }
+    size_t offset = bestFit->second;
+    size_t rangeSize = bestFit->first;
+    removeFreeRange(freeRangesByOffset.find(offset));
+    if (rangeSize > size) {
+        addFreeRange(offset + size, rangeSize - size);
+    }
+    return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    assert(offset + size <= capacity);
+
+    // Merge with the free ranges either side, if they touch this one
+    auto next = freeRangesByOffset.lower_bound(offset);
+    if (next != freeRangesByOffset.begin()) {
+        auto previous = std::prev(next);
+        assert(previous->first + previous->second <= offset && "Range freed twice");
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            removeFreeRange(previous);
+        }
+    }
+    if (next != freeRangesByOffset.end()) {
+        assert(offset + size <= next->first && "Range freed twice");
+        if (offset + size == next->first) {
+            size += next->second;
+            removeFreeRange(next);
+        }
+    }
+    addFreeRange(offset, size);
+}
+
+void RangeAllocator::grow(size_t newCapacity)
+{
+    assert(newCapacity >= capacity);
+    size_t oldCapacity = capacity;
+    capacity = newCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+void RangeAllocator::compact(size_t used)
+{
+    assert(used <= capacity);
+    freeRangesByOffset.clear();
+    freeRangesBySize.clear();
+    freeSpace = 0;
+    addFreeRange(used, capacity - used);
+}
+
+size_t RangeAllocator::getCapacity() const
+{
+    return capacity;
+}
+
+size_t RangeAllocator::getFreeSpace() const
+{
+    return freeSpace;
+}
+
+void RangeAllocator::addFreeRange(size_t offset, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    freeRangesByOffset.emplace(offset, size);
+    freeRangesBySize.emplace(size, offset);
+    freeSpace += size;
+}
+
+void RangeAllocator::removeFreeRange(std::map<size_t, size_t>::iterator range)
+{
+    auto [first, last] = freeRangesBySize.equal_range(range->second);
+    for (auto it = first; it != last; it++) {
+        if (it->second == range->first) {
+            freeRangesBySize.erase(it);
+            break;
+        }
+    }
+    freeSpace -= range->second;
+    freeRangesByOffset.erase(range);
+}
+
+} // namespace PBR
@@ -0,0 +1,35 @@
+#include "core/RenderStats.h"
+
+namespace PBR {
+
+RenderStats& RenderStats::operator+=(const RenderStats& other)
+{
+    drawCalls += other.drawCalls;
+    triangles += other.triangles;
+    objectsDrawn += other.objectsDrawn;
+    objectsCulled += other.objectsCulled;
+    programSwitches += other.programSwitches;
+    textureBinds += other.textureBinds;
+    vaoBinds += other.vaoBinds;
+    uniformCalls += other.uniformCalls;
+    bytesUploaded += other.bytesUploaded;
+    vertexShaderInvocations += other.vertexShaderInvocations;
+    fragmentShaderInvocations += other.fragmentShaderInvocations;
+    return *this;
+}
+
+RenderStats& RenderStats::current()
+{
+    thread_local RenderStats stats;
+    return stats;
+}
+
+RenderStats RenderStats::takeCurrent()
+{
+    RenderStats& stats = current();
+    RenderStats taken = stats;
+    stats = RenderStats();
+    return taken;
+}
+
+} // namespace PBR
@@ -1,5 +1,6 @@
 #include "core/ShaderProgram.h"
 
+#include <cstddef>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -13,7 +14,9 @@
 #include <glm/vec4.hpp>
 
 #include "core/ErrorCodes.h"
+#include "core/RenderStats.h"
 #include "core/Texture.h"
+#include "core/UniformBuffer.h"
 #include "phong/Skybox.h"
 
 namespace fs = std::filesystem;
@@ -22,13 +25,82 @@ namespace PBR {
 
 namespace {
 
-unsigned int loadAndCompileShader(const fs::path& shaderLocation, GLenum shaderType)
+/**
+ * A GLSL function shared between several shaders, which is added to any shader
+ * that calls it rather than being copied into each one.
+ */
+struct SharedShaderFunction {
+    const char* name;
+    const char* source;
+};
+
+const SharedShaderFunction sharedShaderFunctions[] = {
+        {
+                "cubemapFaceDirection",
+                R"GLSL(
+/**
+ * Maps from texture coordinates on one face of a cubemap to the direction
+ * that OpenGL associates with that texel.
+ *
+ * The faces are ordered +X, -X, +Y, -Y, +Z, -Z.
+ */
+vec3 cubemapFaceDirection(int face, vec2 uv)
+{
+    float a = 2.0 * uv.x - 1.0;
+    float b = 2.0 * uv.y - 1.0;
+
+    vec3 direction;
+    if (face == 0) direction = vec3(1.0, -b, -a);
+    else if (face == 1) direction = vec3(-1.0, -b, a);
+    else if (face == 2) direction = vec3(a, 1.0, b);
+    else if (face == 3) direction = vec3(a, -1.0, -b);
+    else if (face == 4) direction = vec3(a, -b, 1.0);
+    else direction = vec3(-a, -b, -1.0);
+
+    return normalize(direction);
+}
+)GLSL"
+        },
+};
+
+/**
+ * Counts a `glUniform*` call in the render stats.
+ */
+void countUniform(size_t bytes)
+{
+    RenderStats& stats = RenderStats::current();
+    stats.uniformCalls++;
+    stats.bytesUploaded += bytes;
+}
+
+unsigned int loadAndCompileShader(const fs::path& shaderLocation, GLenum shaderType,
+                                  const std::vector<std::string>& defines)
 {
     // Read the file
     std::ifstream stream(shaderLocation);
     std::string shaderSource((std::istreambuf_iterator<char>(stream)),
             std::istreambuf_iterator<char>());
 
+    // Insert the defines straight after the #version directive, which must come
+    // first, followed by any shared functions that the shader calls
+    std::string preamble;
+    for (const auto& define : defines) {
+        preamble += "#define " + define + "\n";
+    }
+    for (const auto& function : sharedShaderFunctions) {
+        if (shaderSource.find(std::string(function.name) + "(") != std::string::npos) {
+            preamble += function.source;
+        }
+    }
+    if (!preamble.empty()) {
+        size_t insertPosition = 0;
+        if (shaderSource.compare(0, 8, "#version") == 0) {
+            size_t endOfLine = shaderSource.find('\n');
+            insertPosition = endOfLine == std::string::npos ? shaderSource.size() : endOfLine + 1;
+        }
+        shaderSource.insert(insertPosition, preamble);
+    }
+
     // Store the char* in an lvalue so we can pass its address to glShaderSource()
     const char* shaderSourcePtr = shaderSource.c_str();
 
@@ -56,16 +128,42 @@ unsigned int loadAndCompileShader(const fs::path& shaderLocation, GLenum shaderT
 
 } // anonymous namespace
 
-ShaderProgram::ShaderProgram(const fs::path& vertexShaderLocation, const fs::path& fragmentShaderLocation)
+ShaderProgram::ShaderProgram(const fs::path& vertexShaderLocation, const fs::path& fragmentShaderLocation,
+                             const std::vector<std::string>& defines)
         :shaderProgramId(glCreateProgram())
 {
     // Load the shaders
-    unsigned int vertexShader = loadAndCompileShader(vertexShaderLocation, GL_VERTEX_SHADER);
-    unsigned int fragmentShader = loadAndCompileShader(fragmentShaderLocation, GL_FRAGMENT_SHADER);
+    unsigned int vertexShader = loadAndCompileShader(vertexShaderLocation, GL_VERTEX_SHADER, defines);
+    unsigned int fragmentShader = loadAndCompileShader(fragmentShaderLocation, GL_FRAGMENT_SHADER, defines);
+
+    linkShaders({vertexShader, fragmentShader});
+}
+
+ShaderProgram::ShaderProgram(const fs::path& vertexShaderLocation, const fs::path& geometryShaderLocation,
+                             const fs::path& fragmentShaderLocation, const std::vector<std::string>& defines)
+        :shaderProgramId(glCreateProgram())
+{
+    // Load the shaders
+    unsigned int vertexShader = loadAndCompileShader(vertexShaderLocation, GL_VERTEX_SHADER, defines);
+    unsigned int geometryShader = loadAndCompileShader(geometryShaderLocation, GL_GEOMETRY_SHADER, defines);
+    unsigned int fragmentShader = loadAndCompileShader(fragmentShaderLocation, GL_FRAGMENT_SHADER, defines);
+
+    linkShaders({vertexShader, geometryShader, fragmentShader});
+}
 
+ShaderProgram::ShaderProgram(const fs::path& computeShaderLocation, const std::vector<std::string>& defines)
+        :shaderProgramId(glCreateProgram())
+{
+    unsigned int computeShader = loadAndCompileShader(computeShaderLocation, GL_COMPUTE_SHADER, defines);
+    linkShaders({computeShader});
+}
+
+void ShaderProgram::linkShaders(const std::vector<unsigned int>& shaders)
+{
     // Create the combined shader program
-    glAttachShader(shaderProgramId, vertexShader);
-    glAttachShader(shaderProgramId, fragmentShader);
+    for (unsigned int shader : shaders) {
+        glAttachShader(shaderProgramId, shader);
+    }
     glLinkProgram(shaderProgramId);
 
     // Check it was successful
@@ -80,8 +178,9 @@ ShaderProgram::ShaderProgram(const fs::path& vertexShaderLocation, const fs::pat
     }
 
     // We don't need the individual shaders any more
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    for (unsigned int shader : shaders) {
+        glDeleteShader(shader);
+    }
 }
 
 ShaderProgram::~ShaderProgram()
@@ -100,71 +199,90 @@ void ShaderProgram::resetUniforms()
     for (unsigned int i = 0; i < texturesCount; i++) {
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
     }
 
     // Reset the number of textures bound
     texturesCount = 0;
+
+    // Unbind all uniform blocks
+    for (unsigned int i = 0; i < uniformBlocksCount; i++) {
+        glBindBufferBase(GL_UNIFORM_BUFFER, i, 0);
+    }
+    uniformBlocksCount = 0;
 }
 
 void ShaderProgram::setUniform(const std::string& name, bool value)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform1i(position, value);
+    countUniform(sizeof(int));
 }
 
 void ShaderProgram::setUniform(const std::string& name, float value)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform1f(position, value);
+    countUniform(sizeof(float));
 }
 
 void ShaderProgram::setUniform(const std::string& name, double value)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform1d(position, value);
+    countUniform(sizeof(double));
 }
 
 void ShaderProgram::setUniform(const std::string& name, int value)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform1i(position, value);
+    countUniform(sizeof(int));
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::vec3& value)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform3f(position, value[0], value[1], value[2]);
+    countUniform(sizeof(glm::vec3));
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::vec4& value)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform4f(position, value[0], value[1], value[2], value[3]);
+    countUniform(sizeof(glm::vec4));
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::mat4& matrix)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniformMatrix4fv(position, 1, GL_FALSE, &matrix[0][0]);
+    countUniform(sizeof(glm::mat4));
 }
 
 void ShaderProgram::setUniform(const std::string& name, const std::vector<float>& values)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform1fv(position, values.size(), &values[0]);
+    countUniform(values.size() * sizeof(float));
 }
 
 void ShaderProgram::setUniform(const std::string& name, const std::vector<glm::vec3>& values)
 {
     int position = glGetUniformLocation(shaderProgramId, name.c_str());
     glUniform3fv(position, values.size(), reinterpret_cast<const GLfloat*>(&values[0]));
+    countUniform(values.size() * sizeof(glm::vec3));
 }
 
 void ShaderProgram::setUniform(const std::string& name, const std::shared_ptr<Texture>& texture)
 {
     unsigned int textureUnit = texturesCount++;
     glActiveTexture(GL_TEXTURE0 + textureUnit);
-    glBindTexture(GL_TEXTURE_2D, texture->id());
+    glBindTexture(texture->target(), texture->id());
+    RenderStats::current().textureBinds++;
     setUniform(name, (int)textureUnit);
 }
 
@@ -173,7 +291,28 @@ void ShaderProgram::setUniform(const std::string& name, const std::shared_ptr<ph
     unsigned int textureUnit = texturesCount++;
     glActiveTexture(GL_TEXTURE0 + textureUnit);
     glBindTexture(GL_TEXTURE_CUBE_MAP, skybox->getTextureId());
+    RenderStats::current().textureBinds++;
     setUniform(name, (int)textureUnit);
 }
 
+void ShaderProgram::setUniform(const std::string& name, const std::shared_ptr<UniformBuffer>& uniformBlock)
+{
+    unsigned int bindingPoint = uniformBlocksCount++;
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, uniformBlock->id());
+    unsigned int blockIndex = glGetUniformBlockIndex(shaderProgramId, name.c_str());
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgramId, blockIndex, bindingPoint);
+    }
+}
+
+unsigned int ShaderProgram::reserveUniformBlock(const std::string& name)
+{
+    unsigned int bindingPoint = uniformBlocksCount++;
+    unsigned int blockIndex = glGetUniformBlockIndex(shaderProgramId, name.c_str());
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgramId, blockIndex, bindingPoint);
+    }
+    return bindingPoint;
+}
+
 } // namespace PBR
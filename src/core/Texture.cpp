@@ -1,22 +1,229 @@
 #include "core/Texture.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
 #include <variant>
+#include <vector>
 
 #include <GL/glew.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "core/DDSFile.h"
 #include "core/ErrorCodes.h"
+#include "core/HDRImage.h"
+#include "core/MipGenerator.h"
+#include "core/RadianceHDRFile.h"
+#include "core/ThreadPool.h"
 
 namespace fs = std::filesystem;
 
 namespace PBR {
 
-Texture::Texture()
-        :textureId()
+struct PendingMipmapUpload {
+
+    /**
+     * Uploads the filtered levels to the texture. The filtering task sets this
+     * before queueing the upload.
+     */
+    std::function<void()> upload;
+};
+
+namespace {
+
+/**
+ * Guards `finishedMipmaps`.
+ */
+std::mutex finishedMipmapsMutex;
+
+/**
+ * Mipmaps that have been filtered and are waiting for `uploadFinishedMipmaps`.
+ */
+std::vector<std::weak_ptr<PendingMipmapUpload>> finishedMipmaps;
+
+/**
+ * The number of mipmaps being filtered or waiting to be uploaded.
+ */
+std::atomic<size_t> outstandingMipmaps(0);
+
+/**
+ * The filter used for mipmap chains, or -1 to use `glGenerateMipmap`. Shared by
+ * every thread, since textures can be loaded on the background baker's thread.
+ */
+std::atomic<int> cpuMipmapFilter((int) MipFilter::Kaiser);
+
+/**
+ * @return How a texture carries on past its edges. HDR images are equirectangular
+ *         environment maps, which wrap around from east to west but not across
+ *         the poles.
+ */
+MipEdges textureEdges(bool isHDR)
+{
+    return isHDR ? MipEdges::equirectangular() : MipEdges();
+}
+
+GLint glWrapMode(MipEdge edge)
+{
+    return edge == MipEdge::Wrap ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+}
+
+/**
+ * Sets the wrap modes of the bound 2D texture, so that sampling it matches how
+ * its mipmap was filtered.
+ */
+void setWrapModes(MipEdges edges)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, glWrapMode(edges.horizontal));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, glWrapMode(edges.vertical));
+}
+
+/**
+ * Generates the mipmap levels below the base level of the bound 2D texture. With
+ * no filter this is left to `glGenerateMipmap`. Otherwise the levels are made
+ * but left empty, and the texture is limited to its base level until a task on
+ * the thread pool has filtered them and `uploadFinishedMipmaps` fills them in.
+ *
+ * @param filter The filter to use, read once by the caller
+ * @param readBaseLevel Returns the base level, which has already been uploaded,
+ *                      or an empty vector if it can't. This is run on the pool.
+ * @param edges How the image carries on past its edges
+ * @return The levels being filtered, or nullptr if the driver's are used
+ */
+template<typename T>
+std::shared_ptr<PendingMipmapUpload> generateMipmap(unsigned int textureId, std::optional<MipFilter> filter,
+                                                    std::function<std::vector<T>()> readBaseLevel,
+                                                    unsigned int width, unsigned int height, unsigned int channels,
+                                                    GLint internalFormat, GLenum format, GLenum type, MipEdges edges)
+{
+    if (!filter) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        return nullptr;
+    }
+
+    unsigned int levelsCount = MipGenerator::levelCount(width, height);
+    for (unsigned int level = 1; level < levelsCount; level++) {
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, MipGenerator::levelSize(width, level),
+                     MipGenerator::levelSize(height, level), 0, format, type, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    auto pending = std::make_shared<PendingMipmapUpload>();
+    std::weak_ptr<PendingMipmapUpload> weakPending = pending;
+    outstandingMipmaps++;
+    ThreadPool::shared().enqueue([=, readBaseLevel = std::move(readBaseLevel), filter = *filter]() {
+        // Don't bother if the texture has already been deleted
+        std::vector<std::vector<T>> levels;
+        if (!weakPending.expired()) {
+            std::vector<T> pixels = readBaseLevel();
+            if (!pixels.empty()) {
+                levels = MipGenerator::generate(pixels.data(), width, height, channels, filter, edges);
+            }
+        }
+
+        // Only hold the texture's upload while the mutex is locked, so that once
+        // `uploadFinishedMipmaps` has the queue, the texture is the only owner
+        std::lock_guard lock(finishedMipmapsMutex);
+        std::shared_ptr<PendingMipmapUpload> stillPending = weakPending.lock();
+        if (!stillPending) {
+            outstandingMipmaps--;
+            return;
+        }
+        stillPending->upload = [textureId, levels = std::move(levels), width, height, format, type,
+                                levelsCount]() {
+            glBindTexture(GL_TEXTURE_2D, textureId);
+
+            // If the base level couldn't be read again, settle for the driver's levels
+            if (levels.empty()) {
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+
+            // The rows of the smaller levels aren't necessarily a multiple of four bytes long
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            for (unsigned int level = 1; level <= levels.size(); level++) {
+                glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, MipGenerator::levelSize(width, level),
+                                MipGenerator::levelSize(height, level), format, type, levels[level - 1].data());
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+            // Only now can the smaller levels be sampled
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelsCount - 1);
+
+            glBindTexture(GL_TEXTURE_2D, 0);
+        };
+        finishedMipmaps.push_back(weakPending);
+    });
+    return pending;
+}
+
+/**
+ * @return A function that returns a copy of some pixels, for `generateMipmap`
+ */
+template<typename T>
+std::function<std::vector<T>()> copyOf(const T* pixels, size_t count)
+{
+    return [pixels = std::vector<T>(pixels, pixels + count)]() {
+        return pixels;
+    };
+}
+
+/**
+ * Whether the current OpenGL context can sample BC6H and BC7 textures.
+ */
+bool blockCompressionSupported()
+{
+    return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+}
+
+/**
+ * Finds the pre-compressed version of a texture, if one has been generated
+ * by the `CompressTextures` tool since the texture was last modified and the
+ * hardware can use it.
+ */
+std::optional<fs::path> findCompressedTexture(const fs::path& texturePath)
+{
+    if (texturePath.extension() == ".dds") {
+        return texturePath;
+    }
+
+    if (!blockCompressionSupported()) {
+        return std::nullopt;
+    }
+
+    // Ignore a compressed copy made before the source was last edited
+    fs::path compressedPath = DDSFile::compressedPathFor(texturePath);
+    if (!DDSFile::isUpToDate(texturePath)) {
+        if (fs::exists(compressedPath)) {
+            std::cerr << "Warning: " << compressedPath << " is older than " << texturePath
+                      << ", so the uncompressed texture will be used. Rerun CompressTextures to update it."
+                      << std::endl;
+        }
+        return std::nullopt;
+    }
+    return compressedPath;
+}
+
+GLenum glInternalFormat(BlockCompressionFormat format)
+{
+    switch (format) {
+    case BlockCompressionFormat::BC6H: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+    case BlockCompressionFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return GL_NONE;
+}
+
+} // anonymous namespace
+
+Texture::Texture(unsigned int target)
+        :textureId(), textureTarget(target), pendingMipmap()
 {
     glGenTextures(1, &textureId);
 }
@@ -24,6 +231,18 @@ Texture::Texture()
 Texture::Texture(const fs::path& texturePath, bool isHDR, bool createMipmap)
         :Texture()
 {
+    // Prefer a block-compressed copy of the texture if there is one
+    std::optional<fs::path> compressedPath = findCompressedTexture(texturePath);
+    if (compressedPath) {
+        loadCompressed(*compressedPath, createMipmap);
+        return;
+    }
+
+    // Radiance files have their own decoder, which is much faster than stb_image
+    if (isHDR && texturePath.extension() == ".hdr" && loadRadianceHDR(texturePath, createMipmap)) {
+        return;
+    }
+
     // Load the image
     int width, height, numChannels;
     std::string path = texturePath.string();
@@ -50,33 +269,161 @@ Texture::Texture(const fs::path& texturePath, bool isHDR, bool createMipmap)
     glBindTexture(GL_TEXTURE_2D, textureId);
 
     // Set the wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    MipEdges edges = textureEdges(isHDR);
+    setWrapModes(edges);
 
     // Set the filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, createMipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Write the texture data to the GPU and delete the copy stored here afterwards
+    // Write the texture data to the GPU, generate the mipmap, and delete the copy stored here afterwards
+    std::optional<MipFilter> filter = mipmapFilter();
+    size_t count = (size_t) width * height * numChannels;
     if (isHDR) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, std::get<float*>(data));
-        stbi_image_free(std::get<float*>(data));
+        float* pixels = std::get<float*>(data);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, pixels);
+        if (createMipmap) {
+            pendingMipmap = generateMipmap(textureId, filter, copyOf(pixels, count), width, height, numChannels,
+                                           GL_RGB16F, GL_RGB, GL_FLOAT, edges);
+        }
+        stbi_image_free(pixels);
     }
     else {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                     std::get<unsigned char*>(data));
-        stbi_image_free(std::get<unsigned char*>(data));
+        unsigned char* pixels = std::get<unsigned char*>(data);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+        if (createMipmap) {
+            pendingMipmap = generateMipmap(textureId, filter, copyOf(pixels, count), width, height, numChannels,
+                                           GL_RGB, GL_RGB, GL_UNSIGNED_BYTE, edges);
+        }
+        stbi_image_free(pixels);
     }
 
-    // Generate mipmap
+    // Unbind the texture
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+Texture::Texture(const HDRImage& image, bool createMipmap)
+        :Texture()
+{
+    glBindTexture(GL_TEXTURE_2D, textureId);
+
+    // Set the wrapping parameters
+    MipEdges edges = MipEdges::equirectangular();
+    setWrapModes(edges);
+
+    // Set the filtering parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, createMipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, image.width, image.height, 0, GL_RGB, GL_FLOAT, image.pixels.data());
+
     if (createMipmap) {
-        glGenerateMipmap(GL_TEXTURE_2D);
+        pendingMipmap = generateMipmap(textureId, mipmapFilter(), copyOf(image.pixels.data(), image.pixels.size()),
+                                       image.width, image.height, 3, GL_RGB16F, GL_RGB, GL_FLOAT, edges);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Texture::loadCompressed(const fs::path& texturePath, bool createMipmap)
+{
+    std::optional<DDSFile> file = DDSFile::read(texturePath);
+    if (!file || !blockCompressionSupported()) {
+        std::cerr << "Failed to load compressed texture: " << texturePath << std::endl;
+        exit((int) ErrorCodes::BadTexture);
+    }
+
+    // Compressed formats can't be passed to glGenerateMipmap, so we use whichever
+    // levels were generated offline
+    unsigned int levels = createMipmap ? file->mipLevels.size() : 1;
+
+    glBindTexture(GL_TEXTURE_2D, textureId);
+
+    // Set the wrapping parameters
+    setWrapModes(textureEdges(file->format == BlockCompressionFormat::BC6H));
+
+    // Set the filtering parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    // Upload the blocks for each level directly, without any conversion
+    GLenum internalFormat = glInternalFormat(file->format);
+    for (unsigned int level = 0; level < levels; level++) {
+        const CompressedMipLevel& mipLevel = file->mipLevels[level];
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, mipLevel.width, mipLevel.height, 0,
+                               mipLevel.data.size(), mipLevel.data.data());
     }
 
-    // Unbind the texture
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+bool Texture::loadRadianceHDR(const fs::path& texturePath, bool createMipmap)
+{
+    // The mipmap filtering task keeps the file open to decode it again
+    auto file = std::make_shared<RadianceHDRFile>(texturePath);
+    if (!file->isValid()) {
+        return false;
+    }
+    unsigned int width = file->width();
+    unsigned int height = file->height();
+
+    // The pixel buffer object lets the driver copy the pixels to the texture
+    // without going through another buffer of our own
+    size_t size = (size_t) width * height * 3 * sizeof(uint16_t);
+    unsigned int pixelBuffer;
+    glGenBuffers(1, &pixelBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+    auto* pixels = static_cast<uint16_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    bool success = pixels != nullptr && file->decodeToHalf(pixels, true).has_value();
+    if (pixels && !glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+        // The buffer's contents were lost, for example on a mode switch
+        success = false;
+    }
+
+    if (success) {
+        glBindTexture(GL_TEXTURE_2D, textureId);
+
+        // Set the wrapping parameters
+        MipEdges edges = MipEdges::equirectangular();
+        setWrapModes(edges);
+
+        // Set the filtering parameters
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, createMipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // Rows of three half floats are only aligned to two bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_HALF_FLOAT, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (createMipmap) {
+            // The levels are filtered from floats, which are decoded on the pool
+            // rather than read back from the half floats uploaded here
+            std::function<std::vector<float>()> readBaseLevel = [file]() {
+                std::vector<float> baseLevel((size_t) file->width() * file->height() * 3);
+                if (!file->decodeToFloat(baseLevel.data(), true)) {
+                    baseLevel.clear();
+                }
+                return baseLevel;
+            };
+            pendingMipmap = generateMipmap(textureId, mipmapFilter(), std::move(readBaseLevel), width, height, 3,
+                                           GL_RGB16F, GL_RGB, GL_FLOAT, edges);
+        }
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &pixelBuffer);
+
+    return success;
+}
+
 Texture::~Texture()
 {
     glDeleteTextures(1, &textureId);
@@ -87,4 +434,46 @@ unsigned int Texture::id() const
     return textureId;
 }
 
+unsigned int Texture::target() const
+{
+    return textureTarget;
+}
+
+void Texture::setMipmapFilter(std::optional<MipFilter> filter)
+{
+    cpuMipmapFilter = filter ? (int) *filter : -1;
+}
+
+std::optional<MipFilter> Texture::mipmapFilter()
+{
+    int filter = cpuMipmapFilter;
+    if (filter < 0) {
+        return std::nullopt;
+    }
+    return (MipFilter) filter;
+}
+
+void Texture::uploadFinishedMipmaps()
+{
+    std::vector<std::weak_ptr<PendingMipmapUpload>> finished;
+    {
+        std::lock_guard lock(finishedMipmapsMutex);
+        finished.swap(finishedMipmaps);
+    }
+
+    for (const auto& weakPending : finished) {
+        // Skip any whose texture was deleted after the levels were filtered
+        if (std::shared_ptr<PendingMipmapUpload> pending = weakPending.lock()) {
+            pending->upload();
+            pending->upload = nullptr;
+        }
+        outstandingMipmaps--;
+    }
+}
+
+bool Texture::hasPendingMipmaps()
+{
+    return outstandingMipmaps > 0;
+}
+
 } // namespace PBR
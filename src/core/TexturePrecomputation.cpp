@@ -1,27 +1,24 @@
 #include "core/TexturePrecomputation.h"
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <memory>
 
 #include <GL/glew.h>
 
+#include "core/PrecomputationContext.h"
+#include "core/Profiler.h"
 #include "core/ShaderProgram.h"
 #include "core/Texture.h"
 
 namespace {
 
-// These are already in normalised device coordinate form
-constexpr size_t quadVerticesStride = 4 * sizeof(float);
-constexpr float quadVertices[] = {
-        // Position  // TexCoord
-        -1.0f, 1.0f, 0.0f, 1.0f,
-        -1.0f, -1.0f, 0.0f, 0.0f,
-        1.0f, -1.0f, 1.0f, 0.0f,
-
-        -1.0f, 1.0f, 0.0f, 1.0f,
-        1.0f, -1.0f, 1.0f, 0.0f,
-        1.0f, 1.0f, 1.0f, 1.0f
-};
+/**
+ * Shared by every thread, since the background baker's context supports the
+ * same features as the main one.
+ */
+std::atomic<bool> computeShadersEnabled(true);
 
 } // anonymous namespace
 
@@ -29,64 +26,28 @@ namespace PBR {
 
 void TexturePrecomputation::renderToTexture(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
                                             unsigned int width, unsigned int height,
-                                            const std::function<void()>& setUniforms)
+                                            const std::function<void()>& setUniforms, unsigned int internalFormat)
 {
-    // Create a texture that we're going to render to
-    glBindTexture(GL_TEXTURE_2D, texture->id());
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // Create and bind the buffer for this render
-    unsigned int framebufferId;
-    glGenFramebuffers(1, &framebufferId);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebufferId);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->id(), 0);
-
-    // Unbind the texture now that we have finished setting it up
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    /*
-     * It's still a shader, so we still need some vertex data to send in. The vertex data
-     * defined above is in normalised device coordinates, which the vertex shader
-     * essentially just forwards to the fragment shader, where the interesting stuff happens.
-     */
+    PBR_PROFILE_GPU_SCOPE("Bake texture");
 
-    // Set up buffers for the vertex data we're going to send
-    unsigned int vaoId, vboId;
-    glGenVertexArrays(1, &vaoId);
-    glGenBuffers(1, &vboId);
-
-    // Copy data into the buffers
-    glBindBuffer(GL_ARRAY_BUFFER, vboId);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    // Create a texture that we're going to render to
+    PrecomputationContext::allocateStorage(*texture, internalFormat, width, height, 1);
 
-    // Set up the vertex attributes
-    glBindVertexArray(vaoId);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, quadVerticesStride, (void*) (0 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, quadVerticesStride, (void*) (2 * sizeof(float)));
+    // Bind the pooled framebuffer and attach the texture to it
+    PrecomputationContext& context = PrecomputationContext::current();
+    context.beginBatch();
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->id(), 0);
 
     // Enable the shader program and set its uniforms using the supplied callback
     glUseProgram(shaderProgram.id());
     setUniforms();
 
-    // Run the shader program
+    // Run the shader program. The vertex shader just covers the viewport, and the
+    // fragment shader is where the interesting stuff happens.
     glViewport(0, 0, width, height);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    // Delete the frame buffer now that the data is stored in the texture
-    glDeleteFramebuffers(1, &framebufferId);
-
-    // We're done so we can unbind and delete the data buffers
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glDeleteBuffers(1, &vboId);
-    glDeleteVertexArrays(1, &vaoId);
+    context.drawFullscreenTriangle();
 
-    // Unbind the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    context.endBatch();
 }
 
 void TexturePrecomputation::renderToMipmappedTexture(std::shared_ptr<Texture> texture,
@@ -95,63 +56,26 @@ void TexturePrecomputation::renderToMipmappedTexture(std::shared_ptr<Texture> te
                                                      unsigned int mipmapLevels,
                                                      const std::function<void(unsigned int)>& setUniforms)
 {
-    // Allocate memory for the texture we're going to generate
-    glBindTexture(GL_TEXTURE_2D, texture->id());
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, maxWidth, maxHeight, 0, GL_RGB, GL_FLOAT, nullptr);
-
-    // Set up texture sampling parameters
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipmapLevels);
-#ifdef APPLE
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL_APPLE, mipmapLevels);
-#endif
-
-    // Allocate memory for the mipmap
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    /*
-     * It's still a shader, so we still need some vertex data to send in. The vertex data
-     * defined above is in normalised device coordinates, which the vertex shader
-     * essentially just forwards to the fragment shader, where the interesting stuff happens.
-     */
-
-    // Set up buffers for the vertex data we're going to send
-    unsigned int vaoId, vboId;
-    glGenVertexArrays(1, &vaoId);
-    glGenBuffers(1, &vboId);
-
-    // Copy data into the buffers
-    glBindBuffer(GL_ARRAY_BUFFER, vboId);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-
-    // Set up the vertex attributes
-    glBindVertexArray(vaoId);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, quadVerticesStride, (void*) (0 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, quadVerticesStride, (void*) (2 * sizeof(float)));
-
-    // Create a framebuffer that we can render to
-    unsigned int framebufferId;
-    glGenFramebuffers(1, &framebufferId);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebufferId);
+    PBR_PROFILE_GPU_SCOPE("Bake mipmapped texture");
+
+    // Allocate exactly the levels that we're going to render
+    PrecomputationContext::allocateStorage(*texture, GL_RGB16F, maxWidth, maxHeight, mipmapLevels);
+
+    PrecomputationContext& context = PrecomputationContext::current();
+    context.beginBatch();
+
+    // Enable the shader program
+    glUseProgram(shaderProgram.id());
 
     // Run the shader for each mipmap level
     for (unsigned int mipmapLevel = 0; mipmapLevel < mipmapLevels; mipmapLevel++) {
 
-        // Enable the shader program
-        glUseProgram(shaderProgram.id());
-
         // Set the uniforms using the passed-in callback
         setUniforms(mipmapLevel);
 
         // Compute width of this level
-        unsigned int width = maxWidth >> mipmapLevel;
-        unsigned int height = maxHeight >> mipmapLevel;
+        unsigned int width = std::max(maxWidth >> mipmapLevel, 1u);
+        unsigned int height = std::max(maxHeight >> mipmapLevel, 1u);
 
         glViewport(0, 0, width, height);
 
@@ -160,23 +84,167 @@ void TexturePrecomputation::renderToMipmappedTexture(std::shared_ptr<Texture> te
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->id(), mipmapLevel);
 
         // Run the shader
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        context.drawFullscreenTriangle();
+    }
+
+    context.endBatch();
+}
+
+void TexturePrecomputation::renderToCubemap(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
+                                            unsigned int faceSize, unsigned int mipmapLevels,
+                                            const std::function<void(unsigned int)>& setUniforms,
+                                            unsigned int internalFormat)
+{
+    PBR_PROFILE_GPU_SCOPE("Bake cubemap");
+
+    // Allocate memory for every face of every mipmap level
+    PrecomputationContext::allocateStorage(*texture, internalFormat, faceSize, faceSize, mipmapLevels);
+
+    PrecomputationContext& context = PrecomputationContext::current();
+    context.beginBatch();
+
+    glUseProgram(shaderProgram.id());
+    int faceUniformLocation = glGetUniformLocation(shaderProgram.id(), "cubemapFace");
+
+    for (unsigned int mipmapLevel = 0; mipmapLevel < mipmapLevels; mipmapLevel++) {
+
+        // Set the uniforms using the passed-in callback
+        setUniforms(mipmapLevel);
+
+        unsigned int size = std::max(faceSize >> mipmapLevel, 1u);
+        glViewport(0, 0, size, size);
+
+        // Render each face of this level in turn
+        for (unsigned int face = 0; face < 6; face++) {
+            glUniform1i(faceUniformLocation, face);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face,
+                                   texture->id(), mipmapLevel);
+            context.drawFullscreenTriangle();
+        }
+    }
+
+    context.endBatch();
+}
+
+void TexturePrecomputation::renderToLayers(std::shared_ptr<Texture> texture, const ShaderProgram& shaderProgram,
+                                           unsigned int internalFormat, unsigned int width, unsigned int height,
+                                           unsigned int mipmapLevels, unsigned int layerCount,
+                                           unsigned int layersPerDraw,
+                                           const std::function<void(unsigned int, unsigned int, unsigned int)>& setUniforms)
+{
+    PBR_PROFILE_GPU_SCOPE("Bake layers");
+
+    // Each cubemap in a cubemap array takes up six layers of the texture
+    unsigned int facesPerLayer = texture->target() == GL_TEXTURE_CUBE_MAP_ARRAY ? 6 : 1;
+    PrecomputationContext::allocateStorage(*texture, internalFormat, width, height, mipmapLevels,
+                                           layerCount * facesPerLayer);
+
+    PrecomputationContext& context = PrecomputationContext::current();
+    context.beginBatch();
 
+    glUseProgram(shaderProgram.id());
+    int firstLayerUniformLocation = glGetUniformLocation(shaderProgram.id(), "firstLayer");
+
+    for (unsigned int mipmapLevel = 0; mipmapLevel < mipmapLevels; mipmapLevel++) {
+
+        glViewport(0, 0, std::max(width >> mipmapLevel, 1u), std::max(height >> mipmapLevel, 1u));
+
+        // Attach every layer of this level at once. The geometry shader picks which
+        // layer each triangle is drawn to.
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture->id(), mipmapLevel);
+
+        for (unsigned int firstLayer = 0; firstLayer < layerCount; firstLayer += layersPerDraw) {
+            unsigned int layersInDraw = std::min(layersPerDraw, layerCount - firstLayer);
+            setUniforms(mipmapLevel, firstLayer, layersInDraw);
+            glUniform1i(firstLayerUniformLocation, firstLayer);
+            context.drawFullscreenTriangle(layersInDraw);
+        }
+    }
+
+    context.endBatch();
+}
+
+void TexturePrecomputation::computeToTexture(std::shared_ptr<Texture> texture, const ShaderProgram& computeProgram,
+                                             unsigned int width, unsigned int height, unsigned int mipmapLevels,
+                                             const std::function<void(unsigned int)>& setUniforms,
+                                             unsigned int internalFormat)
+{
+    PBR_PROFILE_GPU_SCOPE("Bake with compute shader");
+
+    PrecomputationContext::allocateStorage(*texture, internalFormat, width, height, mipmapLevels);
+
+    // The work group size is declared in the shader, so ask for it rather than duplicating it here
+    int workGroupSize[3];
+    glGetProgramiv(computeProgram.id(), GL_COMPUTE_WORK_GROUP_SIZE, workGroupSize);
+
+    bool isCubemap = texture->target() == GL_TEXTURE_CUBE_MAP;
+    unsigned int faces = isCubemap ? 6 : 1;
+
+    glUseProgram(computeProgram.id());
+
+    for (unsigned int mipmapLevel = 0; mipmapLevel < mipmapLevels; mipmapLevel++) {
+
+        // Set the uniforms using the passed-in callback
+        setUniforms(mipmapLevel);
+
+        // Bind the level as an image. Cubemaps are bound with all their faces at once.
+        glBindImageTexture(0, texture->id(), mipmapLevel, isCubemap ? GL_TRUE : GL_FALSE, 0, GL_WRITE_ONLY,
+                           internalFormat);
+
+        unsigned int levelWidth = std::max(width >> mipmapLevel, 1u);
+        unsigned int levelHeight = std::max(height >> mipmapLevel, 1u);
+        glDispatchCompute((levelWidth + workGroupSize[0] - 1) / workGroupSize[0],
+                          (levelHeight + workGroupSize[1] - 1) / workGroupSize[1],
+                          faces);
     }
 
-    // Unbind the texture
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    // Make the image stores visible to anything that samples or renders to the texture later
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
+bool TexturePrecomputation::computeShadersAvailable()
+{
+    return computeShadersEnabled && GLEW_VERSION_4_3;
+}
+
+void TexturePrecomputation::setComputeShadersEnabled(bool enabled)
+{
+    computeShadersEnabled = enabled;
+}
+
+void TexturePrecomputation::renderToTextureRegion(std::shared_ptr<Texture> texture,
+                                                  const ShaderProgram& shaderProgram,
+                                                  const TextureRegion& region,
+                                                  const std::function<void()>& setUniforms)
+{
+    PBR_PROFILE_GPU_SCOPE("Bake texture region");
+
+    PrecomputationContext& context = PrecomputationContext::current();
+    context.beginBatch();
+
+    // Attach the right face and level of the texture to the framebuffer
+    GLenum attachmentTarget = texture->target() == GL_TEXTURE_CUBE_MAP
+                              ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + region.face
+                              : GL_TEXTURE_2D;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, attachmentTarget, texture->id(),
+                           region.mipmapLevel);
+
+    // Enable the shader program and set its uniforms using the supplied callback
+    glUseProgram(shaderProgram.id());
+    setUniforms();
+    glUniform1i(glGetUniformLocation(shaderProgram.id(), "cubemapFace"), region.face);
 
-    // We're done so we can unbind and delete the data buffers
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glDeleteBuffers(1, &vboId);
-    glDeleteVertexArrays(1, &vaoId);
+    // The triangle still covers the whole level so that the texture coordinates are
+    // correct, but the scissor test discards everything outside the region
+    glViewport(0, 0, region.levelWidth, region.levelHeight);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(region.x, region.y, region.width, region.height);
+    context.drawFullscreenTriangle();
+    glDisable(GL_SCISSOR_TEST);
 
-    // Unbind and delete the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDeleteFramebuffers(1, &framebufferId);
+    context.endBatch();
 }
 
 } // namespace PBR
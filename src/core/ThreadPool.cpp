@@ -0,0 +1,138 @@
+#include "core/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace PBR {
+
+namespace {
+
+/**
+ * The bookkeeping shared between the threads taking part in one `parallelFor`.
+ *
+ * This is reference counted because helper tasks can be picked up by a worker
+ * after the call that queued them has already returned.
+ */
+struct ParallelForState {
+    std::function<void(size_t)> body;
+    size_t count;
+    size_t chunkSize;
+    std::atomic<size_t> nextIndex{0};
+    std::atomic<size_t> completed{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    /**
+     * Claims and runs chunks until there are none left.
+     */
+    void run()
+    {
+        while (true) {
+            size_t begin = nextIndex.fetch_add(chunkSize);
+            if (begin >= count) {
+                return;
+            }
+            size_t end = std::min(begin + chunkSize, count);
+            for (size_t i = begin; i < end; i++) {
+                body(i);
+            }
+            if (completed.fetch_add(end - begin) + (end - begin) == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+};
+
+} // anonymous namespace
+
+ThreadPool::ThreadPool(unsigned int numThreads)
+        :workers(), tasks(), tasksMutex(), tasksAvailable(), stopping(false)
+{
+    if (numThreads == 0) {
+        numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        stopping = true;
+    }
+    tasksAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned int ThreadPool::concurrency() const
+{
+    return workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if (count == 0) {
+        return;
+    }
+
+    // Use a few chunks per thread so that uneven work still balances out
+    auto state = std::make_shared<ParallelForState>();
+    state->body = body;
+    state->count = count;
+    state->chunkSize = std::max<size_t>(1, count / (4 * concurrency()));
+
+    size_t numHelpers = std::min<size_t>(workers.size(), (count + state->chunkSize - 1) / state->chunkSize - 1);
+    for (size_t i = 0; i < numHelpers; i++) {
+        enqueue([state]() { state->run(); });
+    }
+
+    // Do our share of the work, then wait for any chunks still running elsewhere
+    state->run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->completed.load() == state->count; });
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        tasks.push_back(std::move(task));
+    }
+    tasksAvailable.notify_one();
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasksMutex);
+            tasksAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace PBR
@@ -0,0 +1,43 @@
+#include "core/UniformBuffer.h"
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "core/RenderStats.h"
+
+namespace PBR {
+
+UniformBuffer::UniformBuffer(size_t size, const void* data)
+        :bufferId(), bufferSize(size)
+{
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    glBufferData(GL_UNIFORM_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &bufferId);
+}
+
+void UniformBuffer::update(const void* data, size_t size)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+    RenderStats::current().bytesUploaded += size;
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+unsigned int UniformBuffer::id() const
+{
+    return bufferId;
+}
+
+size_t UniformBuffer::size() const
+{
+    return bufferSize;
+}
+
+} // namespace PBR
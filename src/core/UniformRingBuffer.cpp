@@ -0,0 +1,142 @@
+#include "core/UniformRingBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#define GL_SILENCE_DEPRECATION
+#include <GL/glew.h>
+
+#include "core/Profiler.h"
+#include "core/RenderStats.h"
+
+namespace PBR {
+
+UniformRingBuffer::UniformRingBuffer(size_t regionSize, size_t alignment)
+        :bufferId(),
+         regionSize(),
+         alignment(std::max<size_t>(alignment, 1)),
+         persistentMapping(nullptr),
+         staging(),
+         fences(),
+         currentRegion(regionCount - 1),
+         used(0),
+         flushed(0)
+{
+    // Keep each region's start aligned too
+    this->regionSize = allocationSize(regionSize);
+    size_t bufferSize = this->regionSize * regionCount;
+
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    if (GLEW_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, bufferSize, nullptr, flags);
+        persistentMapping = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, bufferSize, flags));
+    }
+    else {
+        glBufferData(GL_UNIFORM_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    // Fall back to copying in the data each frame if the buffer couldn't be
+    // mapped persistently. The storage still allows ordinary mappings.
+    if (!persistentMapping) {
+        staging.resize(this->regionSize);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+    for (GLsync fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (persistentMapping) {
+        glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &bufferId);
+}
+
+void UniformRingBuffer::beginFrame()
+{
+    currentRegion = (currentRegion + 1) % regionCount;
+    used = 0;
+    flushed = 0;
+
+    GLsync& fence = fences[currentRegion];
+    if (fence) {
+        PBR_PROFILE_SCOPE("Wait for uniform ring buffer");
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        assert(status != GL_WAIT_FAILED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+UniformRingBuffer::Allocation UniformRingBuffer::allocate(size_t size)
+{
+    assert(used + size <= regionSize && "Allocations must fit in the region");
+
+    size_t offsetInRegion = used;
+    used += allocationSize(size);
+    RenderStats::current().bytesUploaded += size;
+
+    unsigned char* data = persistentMapping
+                          ? persistentMapping + currentRegion * regionSize + offsetInRegion
+                          : staging.data() + offsetInRegion;
+    return Allocation{data, currentRegion * regionSize + offsetInRegion};
+}
+
+void UniformRingBuffer::flush()
+{
+    // Coherent mappings need no flushing
+    if (persistentMapping || flushed == used) {
+        return;
+    }
+
+    // The fence waited on in beginFrame means that the GPU isn't reading this
+    // region, so there is no need for the driver to synchronise
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    size_t offset = currentRegion * regionSize + flushed;
+    void* mapping = glMapBufferRange(GL_UNIFORM_BUFFER, offset, used - flushed,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapping) {
+        std::memcpy(mapping, staging.data() + flushed, used - flushed);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    flushed = used;
+}
+
+void UniformRingBuffer::endFrame()
+{
+    flush();
+    fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t UniformRingBuffer::allocationSize(size_t size) const
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+unsigned int UniformRingBuffer::id() const
+{
+    return bufferId;
+}
+
+size_t UniformRingBuffer::getRegionSize() const
+{
+    return regionSize;
+}
+
+bool UniformRingBuffer::isPersistent() const
+{
+    return persistentMapping != nullptr;
+}
+
+} // namespace PBR
@@ -1,88 +1,73 @@
 #include "core/VertexData.h"
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <vector>
 
-#define GL_SILENCE_DEPRECATION
-#define GLFW_INCLUDE_NONE
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
 
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
+#include "core/MeshArena.h"
 
 #define POSITION_OFFSET 0
 #define NORMAL_OFFSET 3
 #define TEXTURE_COORDS_OFFSET 6
 
-namespace {
-
-inline
-size_t getStride(bool textured)
-{
-    // We always have position (3) and normals (3). There are two more
-    // elements for texture coordinates if the data includes them.
-    return textured ? 8 * sizeof(float) : 6 * sizeof(float);
-}
-
-} // anonymous namespace
-
 namespace PBR {
 
 VertexData::VertexData(std::shared_ptr<std::vector<float>> vertexData, std::shared_ptr<std::vector<unsigned int>> elementData, bool textured)
-        :data(std::move(vertexData)),
-         indices(std::move(elementData)),
-         stride(getStride(textured)),
-         vaoId(),
-         vboId(),
-         eboId(),
+        :vaoId(),
+         baseVertex(0),
+         firstIndex(0),
+         vertexCount(0),
+         indicesCount(0),
          hasNormals(true),
          hasTextureCoordinates(textured),
          positionOffset(POSITION_OFFSET),
          normalsOffset(NORMAL_OFFSET),
-         textureCoordinatesOffset(TEXTURE_COORDS_OFFSET)
+         textureCoordinatesOffset(TEXTURE_COORDS_OFFSET),
+         boundsCentre(0.0f),
+         boundsRadius(0.0f)
 {
-    initBuffers();
+    computeBounds(*vertexData);
+    MeshArena::shared().add(*this, *vertexData, *elementData);
 }
 
 VertexData::~VertexData()
 {
-    glDeleteBuffers(1, &vboId);
-    glDeleteBuffers(1, &eboId);
-    glDeleteVertexArrays(1, &vaoId);
+    MeshArena::shared().remove(*this);
 }
 
-void VertexData::initBuffers()
+void VertexData::computeBounds(const std::vector<float>& data)
 {
-    // Create the vertex array object
-    glGenVertexArrays(1, &vaoId);
-    glBindVertexArray(vaoId);
-
-    // Create the vertex buffer to hold the actual vertex data
-    glGenBuffers(1, &vboId);
-    glBindBuffer(GL_ARRAY_BUFFER, vboId);
-    glBufferData(GL_ARRAY_BUFFER, data->size() * sizeof(float), &(*data)[0], GL_STATIC_DRAW);
-
-    // Create the element buffer object to hold the indices
-    glGenBuffers(1, &eboId);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboId);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices->size() * sizeof(float), &(*indices)[0], GL_STATIC_DRAW);
-
-    // Vertex positions
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*) (POSITION_OFFSET * sizeof(float)));
-    glEnableVertexAttribArray(0);
-
-    // Normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*) (NORMAL_OFFSET * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    size_t floatsPerVertex = hasTextureCoordinates ? 8 : 6;
+    size_t verticesCount = data.size() / floatsPerVertex;
+    if (verticesCount == 0) {
+        return;
+    }
 
-    // Texture coordinates
-    if (hasTextureCoordinates) {
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*) (TEXTURE_COORDS_OFFSET * sizeof(float)));
-        glEnableVertexAttribArray(2);
+    // Centre the sphere on the bounding box. This isn't the smallest sphere, but
+    // it is close enough for culling and only needs two passes.
+    auto position = [&](size_t i) {
+        const float* vertex = data.data() + i * floatsPerVertex + positionOffset;
+        return glm::vec3(vertex[0], vertex[1], vertex[2]);
+    };
+    glm::vec3 min = position(0);
+    glm::vec3 max = min;
+    for (size_t i = 1; i < verticesCount; i++) {
+        min = glm::min(min, position(i));
+        max = glm::max(max, position(i));
     }
+    boundsCentre = 0.5f * (min + max);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < verticesCount; i++) {
+        glm::vec3 offset = position(i) - boundsCentre;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    boundsRadius = std::sqrt(radiusSquared);
 }
 
 } // namespace PBR
@@ -12,28 +12,44 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "core/BackgroundBaker.h"
 #include "core/ErrorCodes.h"
+#include "core/PrecomputationContext.h"
+#include "core/Profiler.h"
 #include "core/Renderer.h"
 #include "core/RendererDriver.h"
 
 namespace PBR {
 
-Window::Window(const std::string& title, int width, int height)
-        :window()
+Window::Window(const std::string& title, int width, int height, bool visible)
+        :window(),
+         backgroundBaker(),
+         renderOnDemand(false)
 {
     if (!glfwInit()) {
         std::cerr << "Failed to initialise GLFW." << std::endl;
         exit((int) ErrorCodes::GlfwError);
     }
 
+    // Ask for OpenGL 4.3 first, since it lets the precomputations use compute shaders
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
+
+    // The overdraw heatmap counts fragments in the stencil buffer
+    glfwWindowHint(GLFW_STENCIL_BITS, 8);
 
     // Create the window
     window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
 
+    // Fall back to OpenGL 4.1, which is the most that macOS supports
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    }
+
     // Check that the window creation was successful
     if (!window) {
         glfwTerminate();
@@ -44,6 +60,7 @@ Window::Window(const std::string& title, int width, int height)
     // Set callbacks
     glfwSetKeyCallback(window, GLFWCallbackWrapper::keyboardCallback);
     glfwSetFramebufferSizeCallback(window, GLFWCallbackWrapper::frameBufferResizeCallback);
+    glfwSetWindowRefreshCallback(window, GLFWCallbackWrapper::windowRefreshCallback);
     glfwSetErrorCallback(GLFWCallbackWrapper::errorCallback);
 
     // Focus the newly created window
@@ -59,17 +76,85 @@ Window::Window(const std::string& title, int width, int height)
         std::cerr << "Failed to initialise GLEW: " << glewGetErrorString(err) << std::endl;
         exit((int) ErrorCodes::GlewError);
     }
+
+#ifdef PBR_ENABLE_PROFILING
+    // Render passes are timed in this context
+    Profiler::shared().attachGPUContext();
+#endif
 }
 
 Window::~Window()
 {
+    // The baker's context must be destroyed while GLFW is still initialised,
+    // even if a scene is still holding on to the baker
+    if (backgroundBaker) {
+        backgroundBaker->shutdown();
+    }
+    PrecomputationContext::releaseCurrent();
+
     glfwDestroyWindow(window);
     glfwTerminate();
 }
 
+std::shared_ptr<BackgroundBaker> Window::getBackgroundBaker()
+{
+    if (!backgroundBaker) {
+        backgroundBaker = std::make_shared<BackgroundBaker>(window);
+    }
+    return backgroundBaker;
+}
+
+void Window::setVSyncEnabled(bool enabled)
+{
+    glfwSwapInterval(enabled ? 1 : 0);
+}
+
+void Window::setRenderOnDemand(bool enabled)
+{
+    renderOnDemand = enabled;
+}
+
+float Window::getAspectRatio() const
+{
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    return (float) width / (float) height;
+}
+
+void Window::swapBuffers()
+{
+    glfwSwapBuffers(window);
+}
+
+void Window::onWindowKeyboardEvent(GLFWwindow* theWindow, int key, int action)
+{
+    // If they pressed escape then we should close
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+        glfwSetWindowShouldClose(theWindow, GLFW_TRUE);
+    }
+
+    // Save the profile so far
+    if (Profiler::isCompiledIn() && key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+        if (Profiler::shared().writeChromeTrace("profile.json")) {
+            std::cout << "Wrote profile.json" << std::endl;
+        }
+        else {
+            std::cerr << "Failed to write profile.json" << std::endl;
+        }
+    }
+}
+
+void Window::onGLFWError(int error, const char* description)
+{
+    std::cout << "GLFW Error: " << description << std::endl;
+    glfwTerminate();
+    exit((int) ErrorCodes::GlfwError);
+}
+
 // These must be present to avoid a linker error
 std::optional<GLFWCallbackWrapper::KeyboardCallback> GLFWCallbackWrapper::s_keyboardCallback;
 std::optional<GLFWCallbackWrapper::FrameBufferResizeCallback> GLFWCallbackWrapper::s_frameBufferResizeCallback;
+std::optional<GLFWCallbackWrapper::WindowRefreshCallback> GLFWCallbackWrapper::s_windowRefreshCallback;
 std::optional<GLFWCallbackWrapper::ErrorCallback> GLFWCallbackWrapper::s_errorCallback;
 
 void GLFWCallbackWrapper::bindKeyboardCallback(const KeyboardCallback& keyboardCallback)
@@ -84,6 +169,12 @@ void GLFWCallbackWrapper::bindFrameBufferResizeCallback(const FrameBufferResizeC
     s_frameBufferResizeCallback = frameBufferResizeCallback;
 }
 
+void GLFWCallbackWrapper::bindWindowRefreshCallback(const WindowRefreshCallback& windowRefreshCallback)
+{
+    assert(!s_windowRefreshCallback.has_value() && "Cannot bind multiple callbacks at once.");
+    s_windowRefreshCallback = windowRefreshCallback;
+}
+
 void GLFWCallbackWrapper::bindErrorCallback(const ErrorCallback& errorCallback)
 {
     assert(!s_errorCallback.has_value() && "Cannot bind multiple callbacks at once.");
@@ -94,6 +185,7 @@ void GLFWCallbackWrapper::unbindAllCallbacks()
 {
     s_keyboardCallback.reset();
     s_frameBufferResizeCallback.reset();
+    s_windowRefreshCallback.reset();
     s_errorCallback.reset();
 }
 
@@ -113,6 +205,14 @@ void GLFWCallbackWrapper::frameBufferResizeCallback(GLFWwindow *window, int widt
     }
 }
 
+void GLFWCallbackWrapper::windowRefreshCallback(GLFWwindow* window)
+{
+    if (s_windowRefreshCallback.has_value()) {
+        auto& callback = s_windowRefreshCallback.value();
+        callback(window);
+    }
+}
+
 void GLFWCallbackWrapper::errorCallback(int error, const char* description)
 {
     if (s_errorCallback.has_value()) {
@@ -5,6 +5,7 @@
 
 #include <GL/glew.h>
 
+#include "core/Profiler.h"
 #include "core/ShaderProgram.h"
 #include "core/Texture.h"
 
@@ -31,6 +32,8 @@ constexpr float quadVertices[] = {
 
 void renderTextureToBottomCorner(std::shared_ptr<Texture> texture, bool isHDR, bool useMipmapSampling, float lod)
 {
+    PBR_PROFILE_GPU_SCOPE("Debug overlay");
+
     // Set up buffers for the vertex data we're going to send
     unsigned int vaoId, vboId;
     glGenVertexArrays(1, &vaoId);
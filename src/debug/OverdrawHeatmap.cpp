@@ -0,0 +1,180 @@
+#include "debug/OverdrawHeatmap.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/vec3.hpp>
+
+#include "core/Profiler.h"
+#include "core/RenderStats.h"
+#include "core/ShaderProgram.h"
+
+namespace fs = std::filesystem;
+
+namespace PBR::debug {
+
+namespace {
+
+constexpr size_t floatsPerVertex = 6;
+
+/**
+ * The colour for each fragment count, up to `OverdrawHeatmap::colourCount - 1` or more.
+ */
+const glm::vec3 heatmapColours[OverdrawHeatmap::colourCount] = {
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.8f),
+        glm::vec3(0.0f, 0.7f, 0.9f),
+        glm::vec3(0.0f, 0.8f, 0.0f),
+        glm::vec3(0.9f, 0.9f, 0.0f),
+        glm::vec3(1.0f, 0.5f, 0.0f),
+        glm::vec3(0.9f, 0.0f, 0.0f),
+        glm::vec3(0.9f, 0.0f, 0.9f),
+        glm::vec3(1.0f, 1.0f, 1.0f),
+};
+
+} // anonymous namespace
+
+OverdrawHeatmap::OverdrawHeatmap()
+        :shaderProgram(fs::current_path() / "src" / "debug" / "shaders" / "Overlay.vert",
+                       fs::current_path() / "src" / "debug" / "shaders" / "Overlay.frag"),
+         vaoId(),
+         vboId(),
+         queries(),
+         queriesIssued{false, false},
+         currentQueries(0)
+{
+    // One quad covering the viewport for each colour. The overlay shader measures
+    // positions in pixels, so with a viewport size of 1 these cover it exactly.
+    std::vector<float> vertices;
+    for (const auto& colour : heatmapColours) {
+        const float corners[6][2] = {
+                {0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f},
+                {0.0f, 0.0f}, {1.0f, 1.0f}, {1.0f, 0.0f},
+        };
+        for (const auto& corner : corners) {
+            vertices.insert(vertices.end(), {corner[0], corner[1], colour.r, colour.g, colour.b, 1.0f});
+        }
+    }
+
+    glGenVertexArrays(1, &vaoId);
+    glGenBuffers(1, &vboId);
+
+    glBindVertexArray(vaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, vboId);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float), (void*) 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float), (void*) (2 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (isPipelineStatisticsSupported()) {
+        glGenQueries(4, &queries[0][0]);
+    }
+}
+
+OverdrawHeatmap::~OverdrawHeatmap()
+{
+    if (isPipelineStatisticsSupported()) {
+        glDeleteQueries(4, &queries[0][0]);
+    }
+    glDeleteBuffers(1, &vboId);
+    glDeleteVertexArrays(1, &vaoId);
+}
+
+bool OverdrawHeatmap::isPipelineStatisticsSupported()
+{
+    return GLEW_ARB_pipeline_statistics_query;
+}
+
+void OverdrawHeatmap::beginCounting()
+{
+    // Count every fragment that passes the depth test. Fragments that fail it are
+    // normally rejected before shading, so they aren't counted.
+    glStencilMask(0xFF);
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+
+    if (isPipelineStatisticsSupported()) {
+        glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB, queries[currentQueries][0]);
+        glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, queries[currentQueries][1]);
+    }
+}
+
+void OverdrawHeatmap::endCounting()
+{
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glDisable(GL_STENCIL_TEST);
+
+    if (!isPipelineStatisticsSupported()) {
+        return;
+    }
+    glEndQuery(GL_VERTEX_SHADER_INVOCATIONS_ARB);
+    glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+    queriesIssued[currentQueries] = true;
+
+    // Read the previous frame's results, which the GPU has had a frame to finish
+    currentQueries = 1 - currentQueries;
+    if (queriesIssued[currentQueries]) {
+        GLuint64 vertexInvocations = 0, fragmentInvocations = 0;
+        glGetQueryObjectui64v(queries[currentQueries][0], GL_QUERY_RESULT, &vertexInvocations);
+        glGetQueryObjectui64v(queries[currentQueries][1], GL_QUERY_RESULT, &fragmentInvocations);
+        RenderStats& stats = RenderStats::current();
+        stats.vertexShaderInvocations += vertexInvocations;
+        stats.fragmentShaderInvocations += fragmentInvocations;
+    }
+}
+
+void OverdrawHeatmap::reset()
+{
+    queriesIssued[0] = false;
+    queriesIssued[1] = false;
+    currentQueries = 0;
+}
+
+void OverdrawHeatmap::render()
+{
+    PBR_PROFILE_GPU_SCOPE("Overdraw heatmap");
+
+    GLboolean depthTestEnabled = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFaceEnabled = glIsEnabled(GL_CULL_FACE);
+    GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+
+    glUseProgram(shaderProgram.id());
+    shaderProgram.setUniform("viewportWidth", 1.0f);
+    shaderProgram.setUniform("viewportHeight", 1.0f);
+
+    // Fill the pixels with each count in its colour
+    glEnable(GL_STENCIL_TEST);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glBindVertexArray(vaoId);
+    for (int count = 0; count < colourCount; count++) {
+        bool isLast = count == colourCount - 1;
+        glStencilFunc(isLast ? GL_LEQUAL : GL_EQUAL, count, 0xFF);
+        glDrawArrays(GL_TRIANGLES, 6 * count, 6);
+    }
+    glBindVertexArray(0);
+    glDisable(GL_STENCIL_TEST);
+
+    if (blendEnabled) {
+        glEnable(GL_BLEND);
+    }
+    if (cullFaceEnabled) {
+        glEnable(GL_CULL_FACE);
+    }
+    if (depthTestEnabled) {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
+
+} // namespace PBR::debug
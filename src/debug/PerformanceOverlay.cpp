@@ -0,0 +1,321 @@
+#include "debug/PerformanceOverlay.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include <GL/glew.h>
+
+#include <glm/vec4.hpp>
+
+#include "core/Profiler.h"
+#include "core/RenderStats.h"
+#include "core/ShaderProgram.h"
+
+namespace fs = std::filesystem;
+
+namespace PBR::debug {
+
+namespace {
+
+constexpr size_t floatsPerVertex = 6;
+
+constexpr int glyphWidth = 5;
+constexpr int glyphHeight = 7;
+
+/**
+ * A character of the overlay's font. Each row is 5 bits, with the most
+ * significant bit on the left.
+ */
+struct Glyph {
+    char character;
+    uint8_t rows[glyphHeight];
+};
+
+constexpr Glyph font[] = {
+        {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+        {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+        {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+        {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+        {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+        {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+        {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+        {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+        {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+        {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+        {'A', {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}},
+        {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+        {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+        {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+        {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+        {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+        {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+        {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+        {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+        {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+        {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+        {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+        {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+        {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+        {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+        {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+        {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+        {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+        {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+        {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+        {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+        {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+        {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+        {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+        {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+        {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+        {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+        {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+        {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+        {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+};
+
+/**
+ * @return The glyph for a character, or nullptr for spaces and characters
+ *         missing from the font. Lowercase letters are shown as uppercase.
+ */
+const Glyph* findGlyph(char character)
+{
+    char upper = (char) std::toupper((unsigned char) character);
+    for (const auto& glyph : font) {
+        if (glyph.character == upper) {
+            return &glyph;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Formats a number of bytes with a unit that keeps it short.
+ */
+std::string formatBytes(size_t bytes)
+{
+    char buffer[32];
+    if (bytes < 1024) {
+        std::snprintf(buffer, sizeof(buffer), "%zu B", bytes);
+    }
+    else if (bytes < 1024 * 1024) {
+        std::snprintf(buffer, sizeof(buffer), "%.1f KB", (double) bytes / 1024.0);
+    }
+    else {
+        std::snprintf(buffer, sizeof(buffer), "%.1f MB", (double) bytes / (1024.0 * 1024.0));
+    }
+    return buffer;
+}
+
+// Layout, in pixels
+constexpr float margin = 8.0f;
+constexpr float fontScale = 2.0f;
+constexpr float lineHeight = (glyphHeight + 3) * fontScale;
+constexpr float graphHeight = 60.0f;
+
+/**
+ * The frame time at the top of the graph, in seconds. Longer frames are clipped.
+ */
+constexpr float graphMaximumFrameTime = 1.0f / 30.0f;
+
+const glm::vec4 backgroundColour(0.0f, 0.0f, 0.0f, 0.6f);
+const glm::vec4 textColour(1.0f, 1.0f, 1.0f, 1.0f);
+const glm::vec4 targetLineColour(1.0f, 1.0f, 1.0f, 0.4f);
+const glm::vec4 fastFrameColour(0.3f, 0.9f, 0.3f, 0.9f);
+const glm::vec4 slowFrameColour(0.95f, 0.8f, 0.2f, 0.9f);
+const glm::vec4 verySlowFrameColour(0.95f, 0.3f, 0.25f, 0.9f);
+
+} // anonymous namespace
+
+PerformanceOverlay::PerformanceOverlay()
+        :shaderProgram(fs::current_path() / "src" / "debug" / "shaders" / "Overlay.vert",
+                       fs::current_path() / "src" / "debug" / "shaders" / "Overlay.frag"),
+         vaoId(),
+         vboId(),
+         frameTimes(),
+         nextFrameTime(0),
+         frameTimesCount(0),
+         vertices()
+{
+    glGenVertexArrays(1, &vaoId);
+    glGenBuffers(1, &vboId);
+
+    glBindVertexArray(vaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, vboId);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float), (void*) 0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, floatsPerVertex * sizeof(float), (void*) (2 * sizeof(float)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+PerformanceOverlay::~PerformanceOverlay()
+{
+    glDeleteBuffers(1, &vboId);
+    glDeleteVertexArrays(1, &vaoId);
+}
+
+void PerformanceOverlay::addFrameTime(float seconds)
+{
+    frameTimes[nextFrameTime] = seconds;
+    nextFrameTime = (nextFrameTime + 1) % historyLength;
+    frameTimesCount = std::min(frameTimesCount + 1, historyLength);
+}
+
+void PerformanceOverlay::render(const RenderStats& stats)
+{
+    PBR_PROFILE_GPU_SCOPE("Performance overlay");
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Summarise the frame times
+    float latestFrameTime = 0.0f;
+    float meanFrameTime = 0.0f;
+    float worstFrameTime = 0.0f;
+    if (frameTimesCount > 0) {
+        latestFrameTime = frameTimes[(nextFrameTime + historyLength - 1) % historyLength];
+        for (size_t i = 0; i < frameTimesCount; i++) {
+            meanFrameTime += frameTimes[i];
+            worstFrameTime = std::max(worstFrameTime, frameTimes[i]);
+        }
+        meanFrameTime /= (float) frameTimesCount;
+    }
+
+    char buffer[64];
+    std::vector<std::string> lines;
+    std::snprintf(buffer, sizeof(buffer), "FRAME %.2f MS  FPS %.0f", latestFrameTime * 1000.0f,
+                  meanFrameTime > 0.0f ? 1.0f / meanFrameTime : 0.0f);
+    lines.emplace_back(buffer);
+    std::snprintf(buffer, sizeof(buffer), "MEAN %.2f MS  MAX %.2f MS", meanFrameTime * 1000.0f,
+                  worstFrameTime * 1000.0f);
+    lines.emplace_back(buffer);
+    std::snprintf(buffer, sizeof(buffer), "DRAWS %u  TRIANGLES %zu", stats.drawCalls, stats.triangles);
+    lines.emplace_back(buffer);
+    std::snprintf(buffer, sizeof(buffer), "OBJECTS %u  CULLED %u", stats.objectsDrawn, stats.objectsCulled);
+    lines.emplace_back(buffer);
+    std::snprintf(buffer, sizeof(buffer), "PROGRAMS %u  VAOS %u  TEXTURES %u", stats.programSwitches,
+                  stats.vaoBinds, stats.textureBinds);
+    lines.emplace_back(buffer);
+    std::snprintf(buffer, sizeof(buffer), "UNIFORMS %u  UPLOADED ", stats.uniformCalls);
+    lines.emplace_back(buffer + formatBytes(stats.bytesUploaded));
+    if (stats.fragmentShaderInvocations > 0) {
+        std::snprintf(buffer, sizeof(buffer), "VS %llu  FS %llu", (unsigned long long) stats.vertexShaderInvocations,
+                      (unsigned long long) stats.fragmentShaderInvocations);
+        lines.emplace_back(buffer);
+    }
+
+    // Lay out the panel: the text, then the graph below it
+    size_t longestLine = 0;
+    for (const auto& line : lines) {
+        longestLine = std::max(longestLine, line.size());
+    }
+    float textWidth = (float) longestLine * (glyphWidth + 1) * fontScale;
+    float panelWidth = std::max(textWidth, (float) historyLength) + 2.0f * margin;
+    float graphTop = margin + (float) lines.size() * lineHeight + margin;
+    float panelHeight = graphTop + graphHeight + margin;
+
+    vertices.clear();
+    addRectangle(0.0f, 0.0f, panelWidth, panelHeight, backgroundColour);
+    for (size_t i = 0; i < lines.size(); i++) {
+        addText(margin, margin + (float) i * lineHeight, lines[i], fontScale, textColour);
+    }
+
+    // Draw the frame times oldest first, one pixel wide each, with a line at 60 FPS
+    float graphBottom = graphTop + graphHeight;
+    size_t oldestFrameTime = (nextFrameTime + historyLength - frameTimesCount) % historyLength;
+    for (size_t i = 0; i < frameTimesCount; i++) {
+        float frameTime = frameTimes[(oldestFrameTime + i) % historyLength];
+        float barHeight = std::min(frameTime / graphMaximumFrameTime, 1.0f) * graphHeight;
+        const glm::vec4& colour = frameTime <= 1.0f / 55.0f
+                                  ? fastFrameColour
+                                  : (frameTime <= 1.0f / 28.0f ? slowFrameColour : verySlowFrameColour);
+        float left = margin + (float) (historyLength - frameTimesCount + i);
+        addRectangle(left, graphBottom - barHeight, left + 1.0f, graphBottom, colour);
+    }
+    float targetLine = graphBottom - (1.0f / 60.0f) / graphMaximumFrameTime * graphHeight;
+    addRectangle(margin, targetLine, margin + (float) historyLength, targetLine + 1.0f, targetLineColour);
+
+    // Draw it all on top of the scene, blended over it
+    GLboolean depthTestEnabled = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFaceEnabled = glIsEnabled(GL_CULL_FACE);
+    GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+    GLint oldBlendSource, oldBlendDestination;
+    glGetIntegerv(GL_BLEND_SRC_RGB, &oldBlendSource);
+    glGetIntegerv(GL_BLEND_DST_RGB, &oldBlendDestination);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(shaderProgram.id());
+    shaderProgram.setUniform("viewportWidth", (float) viewport[2]);
+    shaderProgram.setUniform("viewportHeight", (float) viewport[3]);
+
+    glBindVertexArray(vaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, vboId);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) (vertices.size() / floatsPerVertex));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glBlendFunc(oldBlendSource, oldBlendDestination);
+    if (!blendEnabled) {
+        glDisable(GL_BLEND);
+    }
+    if (cullFaceEnabled) {
+        glEnable(GL_CULL_FACE);
+    }
+    if (depthTestEnabled) {
+        glEnable(GL_DEPTH_TEST);
+    }
+}
+
+void PerformanceOverlay::addRectangle(float left, float top, float right, float bottom, const glm::vec4& colour)
+{
+    const float corners[6][2] = {
+            {left, top}, {left, bottom}, {right, bottom},
+            {left, top}, {right, bottom}, {right, top},
+    };
+    for (const auto& corner : corners) {
+        vertices.insert(vertices.end(), {corner[0], corner[1], colour.r, colour.g, colour.b, colour.a});
+    }
+}
+
+void PerformanceOverlay::addText(float left, float top, const std::string& text, float scale,
+                                 const glm::vec4& colour)
+{
+    for (size_t i = 0; i < text.size(); i++) {
+        const Glyph* glyph = findGlyph(text[i]);
+        if (!glyph) {
+            continue;
+        }
+        float glyphLeft = left + (float) i * (glyphWidth + 1) * scale;
+
+        // Draw each horizontal run of set pixels as one rectangle
+        for (int row = 0; row < glyphHeight; row++) {
+            float rowTop = top + (float) row * scale;
+            int column = 0;
+            while (column < glyphWidth) {
+                if (!(glyph->rows[row] & (0x10 >> column))) {
+                    column++;
+                    continue;
+                }
+                int runStart = column;
+                while (column < glyphWidth && (glyph->rows[row] & (0x10 >> column))) {
+                    column++;
+                }
+                addRectangle(glyphLeft + (float) runStart * scale, rowTop, glyphLeft + (float) column * scale,
+                             rowTop + scale, colour);
+            }
+        }
+    }
+}
+
+} // namespace PBR::debug
@@ -0,0 +1,10 @@
+#version 410
+
+in vec4 Colour;
+
+out vec4 FragColour;
+
+void main()
+{
+    FragColour = Colour;
+}
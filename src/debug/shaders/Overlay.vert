@@ -0,0 +1,19 @@
+#version 410
+
+layout (location = 0) in vec2 PositionPixels;
+layout (location = 1) in vec4 Colour_in;
+
+// The size of the viewport in pixels, for converting from pixels measured from
+// the top left corner to normalised device coordinates
+uniform float viewportWidth;
+uniform float viewportHeight;
+
+out vec4 Colour;
+
+void main()
+{
+    vec2 positionNDC = vec2(2.0 * PositionPixels.x / viewportWidth - 1.0,
+                            1.0 - 2.0 * PositionPixels.y / viewportHeight);
+    gl_Position = vec4(positionNDC, 0.0, 1.0);
+    Colour = Colour_in;
+}
@@ -8,9 +8,12 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 
-#include "core/Camera.h"
+#include "core/FrameSnapshot.h"
+#include "core/Profiler.h"
+#include "core/RenderStats.h"
 #include "core/Scene.h"
 #include "core/ShaderProgram.h"
+#include "core/VertexData.h"
 #include "phong/PhongScene.h"
 #include "phong/PhongShaderUniforms.h"
 #include "phong/Skybox.h"
@@ -45,44 +48,64 @@ void PhongRenderer::activate()
     glFrontFace(GL_CCW);
 }
 
-void PhongRenderer::render(std::shared_ptr<PhongScene> scene, const Camera& camera, double time)
+void PhongRenderer::render(std::shared_ptr<PhongScene> scene, const FrameSnapshot& frame)
 {
+    RenderStats& stats = RenderStats::current();
+
     // Render each object in the scene
-    for (const auto& object : scene->getSceneObjectsList()) {
-
-        assert((object->hasTexture() || object->material.colour.has_value())
-                       && "Objects must either have a colour or texture.");
-
-        // Select the shader program that we are going to use
-        ShaderProgram& shaderProgram = object->hasTexture()
-                                       ? texturedObjectShader
-                                       : nonTexturedObjectShader;
-
-        // Enable the shader program
-        glUseProgram(shaderProgram.id());
-
-        // Write the uniforms to the shader
-        PhongShaderUniforms uniforms{
-                object->getModelMatrix(),
-                camera.getViewMatrix(),
-                camera.getProjectionMatrix(),
-                object->getRotationMatrix(),
-                camera.position(),
-                object->material,
-                LightingInfo{scene->getAmbientLight(), scene->getLightPositions(), scene->getLightColours()},
-                object->hasTexture() ? std::optional<unsigned int>(object->texture->get()->id()) : std::nullopt,
-        };
-        writeUniformsToShaderProgram(uniforms, shaderProgram);
-
-        // Draw the object
-        glBindVertexArray(object->vertexData->getVaoId());
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object->vertexData->getEboId());
-        glDrawElements(GL_TRIANGLES, object->vertexData->verticesCount(), GL_UNSIGNED_INT, (void*) 0);
+    {
+        PBR_PROFILE_GPU_SCOPE("Objects");
+
+        // Objects with the same vertex layout share a vertex array object
+        unsigned int boundVaoId = 0;
+        for (size_t i = 0; i < scene->getSceneObjectsList().size(); i++) {
+
+            const auto& object = scene->getSceneObjectsList()[i];
+
+            assert((object->hasTexture() || object->material.colour.has_value())
+                           && "Objects must either have a colour or texture.");
+
+            // Select the shader program that we are going to use
+            ShaderProgram& shaderProgram = object->hasTexture()
+                                           ? texturedObjectShader
+                                           : nonTexturedObjectShader;
+
+            // Enable the shader program
+            glUseProgram(shaderProgram.id());
+            stats.programSwitches++;
+
+            // Write the uniforms to the shader
+            PhongShaderUniforms uniforms{
+                    frame.modelMatrices[i],
+                    frame.viewMatrix,
+                    frame.projectionMatrix,
+                    frame.rotationMatrices[i],
+                    frame.cameraPosition,
+                    object->material,
+                    LightingInfo{scene->getAmbientLight(), frame.lightPositions, frame.lightColours},
+                    object->hasTexture() ? std::optional<unsigned int>(object->texture->get()->id()) : std::nullopt,
+            };
+            writeUniformsToShaderProgram(uniforms, shaderProgram);
+
+            // Draw the object
+            const VertexData& vertexData = *object->vertexData;
+            if (vertexData.getVaoId() != boundVaoId) {
+                glBindVertexArray(vertexData.getVaoId());
+                boundVaoId = vertexData.getVaoId();
+                stats.vaoBinds++;
+            }
+            glDrawElementsBaseVertex(GL_TRIANGLES, vertexData.verticesCount(), GL_UNSIGNED_INT,
+                                     vertexData.getIndicesOffset(), vertexData.getBaseVertex());
+            stats.drawCalls++;
+            stats.triangles += vertexData.trianglesCount();
+            stats.objectsDrawn++;
+        }
     }
 
     // Render the skybox, if the scene has one
     if (scene->hasSkybox()) {
-        skyboxRenderer.renderSkybox(scene->getSkybox(), camera);
+        PBR_PROFILE_GPU_SCOPE("Skybox");
+        skyboxRenderer.renderSkybox(scene->getSkybox(), frame.viewMatrix, frame.projectionMatrix);
     }
 }
 
@@ -7,6 +7,8 @@
 
 #include <GL/glew.h>
 
+#include "core/RenderStats.h"
+
 namespace PBR::phong {
 
 void writeUniformsToShaderProgram(const PhongShaderUniforms& uniforms, ShaderProgram& shaderProgram)
@@ -30,6 +32,7 @@ void writeUniformsToShaderProgram(const PhongShaderUniforms& uniforms, ShaderPro
     if (uniforms.textureId) {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, uniforms.textureId.value());
+        RenderStats::current().textureBinds++;
         shaderProgram.setUniform("surfaceTexture", 0);
     }
 }
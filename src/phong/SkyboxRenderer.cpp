@@ -5,8 +5,10 @@
 #include <string_view>
 
 #include <GL/glew.h>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
 
-#include "core/Camera.h"
+#include "core/RenderStats.h"
 #include "phong/Skybox.h"
 
 namespace {
@@ -23,15 +25,13 @@ SkyboxRenderer::SkyboxRenderer()
 {
 }
 
-void SkyboxRenderer::renderSkybox(const std::shared_ptr<Skybox>& skybox, const PBR::Camera& camera)
+void SkyboxRenderer::renderSkybox(const std::shared_ptr<Skybox>& skybox, const glm::mat4& viewMatrix,
+                                  const glm::mat4& projectionMatrix)
 {
     // Use the shader program
     glUseProgram(shaderProgram.id());
 
     // Pass in the view and projection matrices
-    const auto viewMatrix = camera.getViewMatrix();
-    const auto projectionMatrix = camera.getProjectionMatrix();
-
     // Only do the rotation part of the view matrix's transform
     auto viewMatrixCorrected = glm::mat4(glm::mat3(viewMatrix));
 
@@ -55,6 +55,12 @@ void SkyboxRenderer::renderSkybox(const std::shared_ptr<Skybox>& skybox, const P
     glBindVertexArray(skybox->getVaoId());
     glDrawArrays(GL_TRIANGLES, 0, skybox->numVerticesInBuffer());
 
+    RenderStats& stats = RenderStats::current();
+    stats.programSwitches++;
+    stats.vaoBinds++;
+    stats.drawCalls++;
+    stats.triangles += skybox->numVerticesInBuffer() / 3;
+
     // Restore the old face culling settings.
     glDepthFunc(oldDepthFunc);
     glCullFace(oldCullFace);
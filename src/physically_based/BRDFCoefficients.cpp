@@ -1,5 +1,9 @@
 #include "physically_based/BRDFCoefficients.h"
 
+#include <cstddef>
+
+#include <boost/functional/hash.hpp>
+
 namespace PBR::physically_based {
 
 bool NormalDistributionFunctionCoefficients::operator==(
@@ -19,4 +23,14 @@ bool BRDFCoefficients::operator==(const BRDFCoefficients& other) const
             && this->geometricAttenutation == other.geometricAttenutation;
 }
 
+size_t BRDFCoefficientsHasher::operator()(const BRDFCoefficients& coefficients) const
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, boost::hash_value(coefficients.normalDistribution.k_TrowbridgeReitzGGX));
+    boost::hash_combine(seed, boost::hash_value(coefficients.normalDistribution.k_Beckmann));
+    boost::hash_combine(seed, boost::hash_value(coefficients.geometricAttenutation.k_SchlickGGX));
+    boost::hash_combine(seed, boost::hash_value(coefficients.geometricAttenutation.k_CookTorrance));
+    return seed;
+}
+
 } // namespace PBR::physically_based
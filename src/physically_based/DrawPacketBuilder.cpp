@@ -0,0 +1,186 @@
+#include "physically_based/DrawPacketBuilder.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "core/FrameSnapshot.h"
+#include "core/Frustum.h"
+#include "core/Texture.h"
+#include "core/ThreadPool.h"
+#include "core/VertexData.h"
+#include "physically_based/PhysicallyBasedScene.h"
+#include "physically_based/PhysicallyBasedShaderUniforms.h"
+
+namespace PBR::physically_based {
+
+namespace {
+
+uint64_t textureKey(const std::shared_ptr<Texture>& texture)
+{
+    return texture ? texture->id() & 0xFFFF : 0;
+}
+
+/**
+ * Quantises a view-space depth so that nearer objects get smaller keys. The top
+ * bits of a positive float increase with its value, so this keeps more precision
+ * close to the camera.
+ */
+uint64_t depthKey(float depth)
+{
+    depth = std::max(depth, 0.0f);
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    return bits >> 16;
+}
+
+/**
+ * The number of chunks the objects are split into for each thread in the pool.
+ */
+constexpr size_t chunksPerThread = 4;
+
+bool drawsBefore(const DrawPacket& first, const DrawPacket& second)
+{
+    return first.sortKey < second.sortKey;
+}
+
+} // anonymous namespace
+
+DrawPacketBuilder::DrawPacketBuilder(size_t uniformBufferOffsetAlignment, ThreadPool& threadPool)
+        :threadPool(threadPool),
+         objectUniformsStride(),
+         chunkPackets(),
+         mergeBuffer(),
+         packets(),
+         objectUniforms(),
+         culledCount(0)
+{
+    size_t alignment = std::max<size_t>(uniformBufferOffsetAlignment, 1);
+    objectUniformsStride = (sizeof(PhysicallyBasedObjectUniforms) + alignment - 1) / alignment * alignment;
+}
+
+void DrawPacketBuilder::build(const PhysicallyBasedScene& scene, const FrameSnapshot& frame)
+{
+    const auto& objects = scene.getSceneObjectsList();
+    const auto& prefilteredEnvironmentMaps = scene.getPrefilteredEnvironmentMaps();
+    const auto& brdfIntegrationMaps = scene.getBRDFIntegrationMaps();
+    Frustum frustum = Frustum::fromMatrix(frame.projectionMatrix * frame.viewMatrix);
+
+    // Split the objects into chunks, several for each thread so that the threads
+    // still balance out if some chunks are slower than others. Each chunk is
+    // culled, given its place in the draw order and sorted on its own, so the
+    // culled objects never reach the sort at all.
+    size_t objectsCount = objects.size();
+    size_t chunksCount = std::min<size_t>(chunksPerThread * threadPool.concurrency(), objectsCount);
+    chunkPackets.resize(chunksCount);
+    threadPool.parallelFor(chunksCount, [&](size_t chunk) {
+        std::vector<DrawPacket>& chunkPacketsList = chunkPackets[chunk];
+        chunkPacketsList.clear();
+        for (size_t i = chunk * objectsCount / chunksCount; i < (chunk + 1) * objectsCount / chunksCount; i++) {
+            const auto& object = objects[i];
+            const glm::mat4& modelMatrix = frame.modelMatrices[i];
+
+            // Transform the mesh's bounding sphere, scaling it by the largest scale
+            // factor so that it still contains the mesh
+            glm::vec3 centre = glm::vec3(modelMatrix * glm::vec4(object->vertexData->getBoundingSphereCentre(), 1.0f));
+            float scale = std::max({glm::length(glm::vec3(modelMatrix[0])),
+                                    glm::length(glm::vec3(modelMatrix[1])),
+                                    glm::length(glm::vec3(modelMatrix[2]))});
+            float radius = object->vertexData->getBoundingSphereRadius() * scale;
+            if (!frustum.intersectsSphere(centre, radius)) {
+                continue;
+            }
+
+            const VertexData& vertexData = *object->vertexData;
+            DrawPacket packet;
+            packet.objectIndex = i;
+            packet.vaoId = vertexData.getVaoId();
+            packet.indicesCount = vertexData.verticesCount();
+            packet.indicesOffset = vertexData.getIndicesOffset();
+            packet.baseVertex = vertexData.getBaseVertex();
+
+            float depth = -(frame.viewMatrix * glm::vec4(centre, 1.0f)).z;
+            packet.sortKey = textureKey(prefilteredEnvironmentMaps[i]) << 48
+                             | textureKey(brdfIntegrationMaps[i]) << 32
+                             | (uint64_t) (packet.vaoId & 0xFFFF) << 16
+                             | depthKey(depth);
+            chunkPacketsList.push_back(packet);
+        }
+        std::sort(chunkPacketsList.begin(), chunkPacketsList.end(), drawsBefore);
+    });
+
+    // Copy the sorted chunks next to each other, remembering where each one starts
+    std::vector<size_t> runStarts(chunksCount + 1, 0);
+    for (size_t chunk = 0; chunk < chunksCount; chunk++) {
+        runStarts[chunk + 1] = runStarts[chunk] + chunkPackets[chunk].size();
+    }
+    packets.resize(runStarts.back());
+    culledCount = objectsCount - packets.size();
+    threadPool.parallelFor(chunksCount, [&](size_t chunk) {
+        std::copy(chunkPackets[chunk].begin(), chunkPackets[chunk].end(), packets.begin() + runStarts[chunk]);
+    });
+
+    // Merge neighbouring runs in pairs until only one is left. Each pass halves
+    // the number of runs, and the merges within a pass run in parallel.
+    mergeBuffer.resize(packets.size());
+    while (runStarts.size() > 2) {
+        size_t runsCount = runStarts.size() - 1;
+        threadPool.parallelFor((runsCount + 1) / 2, [&](size_t pair) {
+            size_t first = runStarts[2 * pair];
+            size_t middle = runStarts[2 * pair + 1];
+            size_t last = runStarts[std::min(2 * pair + 2, runsCount)];
+            std::merge(packets.begin() + first, packets.begin() + middle,
+                       packets.begin() + middle, packets.begin() + last,
+                       mergeBuffer.begin() + first, drawsBefore);
+        });
+        std::swap(packets, mergeBuffer);
+
+        std::vector<size_t> mergedRunStarts;
+        for (size_t run = 0; run < runsCount; run += 2) {
+            mergedRunStarts.push_back(runStarts[run]);
+        }
+        mergedRunStarts.push_back(runStarts.back());
+        runStarts = std::move(mergedRunStarts);
+    }
+
+    // Pack the uniforms of the visible objects in the order they will be drawn
+    const auto& lightingMapLayers = scene.getLightingMapLayers();
+    objectUniforms.resize(packets.size() * objectUniformsStride);
+    threadPool.parallelFor(packets.size(), [&](size_t j) {
+        size_t i = packets[j].objectIndex;
+        PhysicallyBasedObjectUniforms uniforms = packObjectUniforms(frame.modelMatrices[i], frame.rotationMatrices[i],
+                                                                    objects[i]->material, lightingMapLayers[i]);
+        std::memcpy(objectUniforms.data() + j * objectUniformsStride, &uniforms, sizeof(uniforms));
+    });
+}
+
+const std::vector<DrawPacket>& DrawPacketBuilder::getPackets() const
+{
+    return packets;
+}
+
+const std::vector<unsigned char>& DrawPacketBuilder::getObjectUniforms() const
+{
+    return objectUniforms;
+}
+
+size_t DrawPacketBuilder::getObjectUniformsStride() const
+{
+    return objectUniformsStride;
+}
+
+size_t DrawPacketBuilder::getCulledCount() const
+{
+    return culledCount;
+}
+
+} // namespace PBR::physically_based
@@ -1,23 +1,97 @@
 #include "physically_based/EnvironmentMap.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <optional>
+#include <utility>
 
+#include <GL/glew.h>
+
+#include "core/BackgroundBaker.h"
 #include "core/DirectedLightSource.h"
+#include "core/HDRImage.h"
+#include "core/PrecomputationContext.h"
 #include "core/ShaderProgram.h"
 #include "core/Texture.h"
 #include "core/TexturePrecomputation.h"
+#include "core/UniformBuffer.h"
+#include "physically_based/IBLFile.h"
+#include "physically_based/LightExtraction.h"
 #include "physically_based/PBRUtil.h"
+#include "physically_based/PrecomputationSettings.h"
+#include "physically_based/SphericalHarmonics.h"
 
 namespace fs = std::filesystem;
 
 namespace PBR::physically_based {
 
+namespace {
+
 /**
- * Precomputes the irradiance map of the background and returns it as a `Texture`.
+ * Chooses a cubemap face size that preserves the detail of an equirectangular
+ * texture of the given width.
+ *
+ * Each face covers a quarter of the equator, so we round a quarter of the width
+ * up to the next power of two to keep the mipmap chain a clean size.
  */
-std::shared_ptr<Texture> precomputeIrradianceMap(std::shared_ptr<Texture> radianceMap)
+unsigned int chooseCubemapFaceSize(unsigned int equirectangularWidth)
+{
+    unsigned int faceSize = 64;
+    while (faceSize < equirectangularWidth / 4 && faceSize < 2048) {
+        faceSize *= 2;
+    }
+    return faceSize;
+}
+
+} // anonymous namespace
+
+/**
+ * Converts an equirectangular HDR texture into a mipmapped cubemap.
+ */
+std::shared_ptr<Texture> convertToCubemap(const std::shared_ptr<Texture>& equirectangularMap, unsigned int faceSize)
+{
+    auto vertexShader = PBRUtil::pbrShadersDir() / "PrepVerticesForRenderingTexture.vert";
+    auto fragmentShader = PBRUtil::pbrShadersDir() / "ConvertEquirectangularToCubemap.frag";
+    ShaderProgram shader(vertexShader, fragmentShader);
+
+    auto prepareShaderUniforms = [&shader, equirectangularMap]() {
+        shader.resetUniforms();
+        shader.setUniform("equirectangularMap", equirectangularMap);
+    };
+
+    // Allocate the whole mipmap chain up front, since immutable storage can't grow later
+    unsigned int mipmapLevels = 1;
+    while ((faceSize >> mipmapLevels) > 0) {
+        mipmapLevels++;
+    }
+    std::shared_ptr<Texture> texture(new Texture(GL_TEXTURE_CUBE_MAP));
+    PrecomputationContext::allocateStorage(*texture, GL_RGB16F, faceSize, faceSize, mipmapLevels);
+
+    // Render the base level of each face
+    for (unsigned int face = 0; face < 6; face++) {
+        TextureRegion region{face, 0, faceSize, faceSize, 0, 0, faceSize, faceSize};
+        TexturePrecomputation::renderToTextureRegion(texture, shader, region, prepareShaderUniforms);
+    }
+    shader.resetUniforms();
+
+    // Build the rest of the mipmap chain by downsampling, since the prefiltering
+    // step samples lower levels to avoid aliasing at high roughnesses
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture->id());
+    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    return texture;
+}
+
+/**
+ * Precomputes the irradiance map of the background and returns it as a cubemap `Texture`.
+ *
+ * Irradiance varies very slowly with direction, so the map can be tiny.
+ */
+std::shared_ptr<Texture> precomputeIrradianceMap(std::shared_ptr<Texture> radianceMap,
+                                                 const PrecomputationSettings& settings)
 {
     // Load the shader program we need to use
     auto precomputeIrradianceMapVertexShader =
@@ -27,28 +101,192 @@ std::shared_ptr<Texture> precomputeIrradianceMap(std::shared_ptr<Texture> radian
     ShaderProgram shader(precomputeIrradianceMapVertexShader, precomputeIrradianceMapFragmentShader);
 
     // Code to set up uniforms
-    auto prepareShaderUniforms = [&shader, radianceMap]() {
+    auto prepareShaderUniforms = [&shader, radianceMap, &settings](unsigned int mipmapLevel) {
         shader.resetUniforms();
         shader.setUniform("radianceMap", radianceMap);
+        shader.setUniform("sampleRings", settings.irradianceSampleRings);
     };
 
     // Allocate a texture for rendering
-    std::shared_ptr<Texture> texture(new Texture());
+    std::shared_ptr<Texture> texture(new Texture(GL_TEXTURE_CUBE_MAP));
 
     // Render to the texture
-    int width = 16;
-    int height = 16;
-    TexturePrecomputation::renderToTexture(texture, shader, width, height, prepareShaderUniforms);
+    TexturePrecomputation::renderToCubemap(texture, shader, settings.irradianceMapFaceSize, 1,
+                                           prepareShaderUniforms, settings.lightingMapFormat());
+    shader.resetUniforms();
 
     return texture;
 }
 
+/**
+ * Projects the irradiance of the background onto spherical harmonics and
+ * uploads the coefficients to a uniform buffer.
+ */
+std::shared_ptr<UniformBuffer> precomputeIrradianceSphericalHarmonics(const std::shared_ptr<Texture>& radianceMap,
+                                                                      unsigned int faceSize)
+{
+    auto radiance = SphericalHarmonicsL2::projectCubemap(radianceMap, faceSize);
+    auto coefficients = radiance.convolveWithCosineLobe().toShaderCoefficients();
+    return std::make_shared<UniformBuffer>(sizeof(coefficients), coefficients.data());
+}
+
 EnvironmentMap::EnvironmentMap(const fs::path& texturePath,
-                               std::optional<DirectedLightSource> sun)
-        :radianceMap(new Texture(texturePath, true)),
-         irradianceMap(precomputeIrradianceMap(radianceMap)),
-         sun(sun)
+                               std::optional<DirectedLightSource> sun,
+                               IrradianceMode irradianceMode,
+                               const PrecomputationSettings& settings)
+        :radianceMap(),
+         lightingRadianceMap(),
+         radianceMapFaceSize(),
+         irradianceMode(irradianceMode),
+         irradianceMap(),
+         irradianceSphericalHarmonics(),
+         sun(sun),
+         version(0)
+{
+    if (settings.extractSun) {
+        // The image has to be analysed on the CPU, so any block-compressed copy is skipped
+        precomputeFromImage(HDRImage::load(texturePath), settings);
+        return;
+    }
+
+    // The equirectangular texture is only needed until it has been converted, which
+    // only reads its base level, so it has no mipmap
+    auto equirectangularMap = std::make_shared<Texture>(texturePath, true, false);
+    precompute(equirectangularMap, equirectangularMap, settings);
+}
+
+EnvironmentMap::EnvironmentMap(HDRImage image,
+                               std::optional<DirectedLightSource> sun,
+                               IrradianceMode irradianceMode,
+                               const PrecomputationSettings& settings)
+        :radianceMap(),
+         lightingRadianceMap(),
+         radianceMapFaceSize(),
+         irradianceMode(irradianceMode),
+         irradianceMap(),
+         irradianceSphericalHarmonics(),
+         sun(sun),
+         version(0)
+{
+    precomputeFromImage(image, settings);
+}
+
+void EnvironmentMap::precomputeFromImage(const HDRImage& image, const PrecomputationSettings& settings)
 {
+    auto equirectangularMap = std::make_shared<Texture>(image, false);
+    auto lightingEquirectangularMap = equirectangularMap;
+    if (settings.extractSun) {
+        // The skybox should still show the sun, so only a copy is clamped
+        HDRImage clampedImage = image;
+        auto lights = LightExtraction::extractDominantLights(clampedImage, settings.sunThresholdRatio, 1);
+        if (!lights.empty()) {
+            sun = lights.front();
+            lightingEquirectangularMap = std::make_shared<Texture>(clampedImage, false);
+        }
+    }
+    precompute(equirectangularMap, lightingEquirectangularMap, settings);
+}
+
+void EnvironmentMap::precompute(const std::shared_ptr<Texture>& equirectangularMap,
+                                const std::shared_ptr<Texture>& lightingEquirectangularMap,
+                                const PrecomputationSettings& settings)
+{
+    // Filter across cubemap face edges, both while precomputing and when rendering
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    // Keep the precomputation objects bound across all of the steps below
+    PrecomputationBatch batch;
+
+    int width;
+    glBindTexture(GL_TEXTURE_2D, equirectangularMap->id());
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    radianceMapFaceSize = chooseCubemapFaceSize(std::max(width, 0));
+    radianceMap = convertToCubemap(equirectangularMap, radianceMapFaceSize);
+    lightingRadianceMap = lightingEquirectangularMap == equirectangularMap
+                          ? radianceMap
+                          : convertToCubemap(lightingEquirectangularMap, radianceMapFaceSize);
+
+    switch (irradianceMode) {
+    case IrradianceMode::IrradianceMap:
+        irradianceMap = precomputeIrradianceMap(lightingRadianceMap, settings);
+        break;
+    case IrradianceMode::SphericalHarmonics:
+        irradianceSphericalHarmonics = precomputeIrradianceSphericalHarmonics(lightingRadianceMap,
+                                                                              radianceMapFaceSize);
+        break;
+    }
+}
+
+void EnvironmentMap::loadInBackground(BackgroundBaker& baker,
+                                      const fs::path& texturePath,
+                                      std::optional<DirectedLightSource> sun,
+                                      IrradianceMode irradianceMode,
+                                      std::function<void(std::shared_ptr<EnvironmentMap>)> onLoaded,
+                                      const PrecomputationSettings& settings)
+{
+    // The baker thread fills this in, and the main thread reads it once the GPU work is done
+    auto result = std::make_shared<std::shared_ptr<EnvironmentMap>>();
+
+    baker.submit(
+        [result, texturePath, sun, irradianceMode, settings]() {
+            *result = std::make_shared<EnvironmentMap>(texturePath, sun, irradianceMode, settings);
+        },
+        [result, onLoaded = std::move(onLoaded)]() {
+            onLoaded(*result);
+        }
+    );
+}
+
+std::shared_ptr<EnvironmentMap> EnvironmentMap::loadProgressively(BackgroundBaker& baker,
+                                                                  const IBLFile& file,
+                                                                  IrradianceMode irradianceMode,
+                                                                  std::function<void()> onLoaded,
+                                                                  const PrecomputationSettings& settings)
+{
+    std::optional<fs::path> radiancePath = file.radiancePath();
+    if (!radiancePath) {
+        return nullptr;
+    }
+    if (!file.previewPath || !fs::exists(*file.previewPath)) {
+        auto environmentMap = std::make_shared<EnvironmentMap>(*radiancePath, file.sun, irradianceMode, settings);
+        if (onLoaded) {
+            onLoaded();
+        }
+        return environmentMap;
+    }
+
+    // The preview's highlights are clipped, so there is no sun to find in it. Loading
+    // an LDR image as floats undoes its gamma, which roughly recovers the radiance.
+    PrecomputationSettings previewSettings = settings;
+    previewSettings.extractSun = false;
+    auto environmentMap = std::make_shared<EnvironmentMap>(HDRImage::load(*file.previewPath), file.sun,
+                                                           irradianceMode, previewSettings);
+
+    // The baker thread fills this in, and the main thread reads it once the GPU work is done
+    auto result = std::make_shared<std::shared_ptr<EnvironmentMap>>();
+    std::weak_ptr<EnvironmentMap> weakEnvironmentMap = environmentMap;
+
+    baker.submit(
+        [result, radiancePath = *radiancePath, sun = file.sun, irradianceMode, settings]() {
+            *result = std::make_shared<EnvironmentMap>(radiancePath, sun, irradianceMode, settings);
+        },
+        [result, weakEnvironmentMap, onLoaded = std::move(onLoaded)]() {
+            auto environmentMap = weakEnvironmentMap.lock();
+            if (!environmentMap) {
+                return;
+            }
+            unsigned int version = environmentMap->version + 1;
+            *environmentMap = std::move(**result);
+            environmentMap->version = version;
+            if (onLoaded) {
+                onLoaded();
+            }
+        }
+    );
+
+    return environmentMap;
 }
 
 std::shared_ptr<Texture> EnvironmentMap::getRadianceMap() const
@@ -56,14 +294,39 @@ std::shared_ptr<Texture> EnvironmentMap::getRadianceMap() const
     return radianceMap;
 }
 
+std::shared_ptr<Texture> EnvironmentMap::getLightingRadianceMap() const
+{
+    return lightingRadianceMap;
+}
+
+unsigned int EnvironmentMap::getRadianceMapFaceSize() const
+{
+    return radianceMapFaceSize;
+}
+
+IrradianceMode EnvironmentMap::getIrradianceMode() const
+{
+    return irradianceMode;
+}
+
 std::shared_ptr<Texture> EnvironmentMap::getIrradianceMap() const
 {
     return irradianceMap;
 }
 
+std::shared_ptr<UniformBuffer> EnvironmentMap::getIrradianceSphericalHarmonics() const
+{
+    return irradianceSphericalHarmonics;
+}
+
 const std::optional<DirectedLightSource>& EnvironmentMap::getSun() const
 {
     return sun;
 }
 
+unsigned int EnvironmentMap::getVersion() const
+{
+    return version;
+}
+
 } // namespace PBR::physically_based
@@ -7,7 +7,7 @@
 #include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
 
-#include "core/Camera.h"
+#include "core/RenderStats.h"
 #include "core/ShaderProgram.h"
 #include "physically_based/EnvironmentMap.h"
 #include "physically_based/PBRUtil.h"
@@ -112,15 +112,12 @@ EnvironmentMapRenderer::~EnvironmentMapRenderer()
     glDeleteVertexArrays(1, &vaoId);
 }
 
-void EnvironmentMapRenderer::renderSkybox(const std::shared_ptr<EnvironmentMap>& environmentMap, const Camera& camera)
+void EnvironmentMapRenderer::renderSkybox(const std::shared_ptr<EnvironmentMap>& environmentMap,
+                                          const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
 {
     // Use our shader
     glUseProgram(skyboxRenderingShader.id());
 
-    // Compute uniform matrices
-    const auto viewMatrix = camera.getViewMatrix();
-    const auto projectionMatrix = camera.getProjectionMatrix();
-
     // Correct the view matrix because we only want rotation, no translation
     const auto viewMatrixCorrected = glm::mat4(glm::mat3(viewMatrix));
 
@@ -145,6 +142,12 @@ void EnvironmentMapRenderer::renderSkybox(const std::shared_ptr<EnvironmentMap>&
     int count = 36; // Number of vertices to draw
     glDrawArrays(GL_TRIANGLES, 0, count);
 
+    RenderStats& stats = RenderStats::current();
+    stats.programSwitches++;
+    stats.vaoBinds++;
+    stats.drawCalls++;
+    stats.triangles += count / 3;
+
     // Restore the old settings
     glDepthFunc(oldDepthFunc);
     glCullFace(oldCullFace);
@@ -0,0 +1,130 @@
+#include "physically_based/IBLFile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "core/DirectedLightSource.h"
+#include "physically_based/PBRUtil.h"
+
+namespace fs = std::filesystem;
+
+namespace PBR::physically_based {
+
+namespace {
+
+/**
+ * @return The string without leading or trailing whitespace
+ */
+std::string trim(const std::string& string)
+{
+    size_t start = string.find_first_not_of(" \t\r");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = string.find_last_not_of(" \t\r");
+    return string.substr(start, end - start + 1);
+}
+
+/**
+ * Reads the keys of an INI-style file, named "Section.Key". Quotes around
+ * values are removed.
+ */
+std::map<std::string, std::string> readKeys(std::ifstream& stream)
+{
+    std::map<std::string, std::string> keys;
+    std::string section;
+    std::string line;
+    while (std::getline(stream, line)) {
+        line = trim(line);
+        if (line.empty() || line[0] == ';' || line[0] == '#') {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            section = line.substr(1, line.size() - 2);
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string value = trim(line.substr(equals + 1));
+        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+            value = value.substr(1, value.size() - 2);
+        }
+        keys[section + "." + trim(line.substr(0, equals))] = value;
+    }
+    return keys;
+}
+
+/**
+ * Resolves a file named in a descriptor relative to the descriptor's directory.
+ */
+std::optional<fs::path> findPath(const std::map<std::string, std::string>& keys, const std::string& key,
+                                 const fs::path& directory)
+{
+    auto it = keys.find(key);
+    if (it == keys.end() || it->second.empty()) {
+        return std::nullopt;
+    }
+    return directory / it->second;
+}
+
+} // anonymous namespace
+
+std::optional<IBLFile> IBLFile::read(const fs::path& path)
+{
+    std::ifstream stream(path);
+    if (!stream) {
+        return std::nullopt;
+    }
+    auto keys = readKeys(stream);
+    fs::path directory = path.parent_path();
+
+    IBLFile file;
+    file.name = keys.count("Header.Name") ? keys["Header.Name"] : path.stem().string();
+    file.previewPath = findPath(keys, "Header.PREVIEWfile", directory);
+    // "Enviroment" is how the sIBL format spells it
+    file.environmentPath = findPath(keys, "Enviroment.EVfile", directory);
+    file.reflectionPath = findPath(keys, "Reflection.REFfile", directory);
+    if (!file.environmentPath && !file.reflectionPath) {
+        return std::nullopt;
+    }
+
+    if (keys.count("Sun.SUNu") && keys.count("Sun.SUNv")) {
+        glm::vec2 uv(std::strtof(keys["Sun.SUNu"].c_str(), nullptr),
+                     std::strtof(keys["Sun.SUNv"].c_str(), nullptr));
+        int red = 255, green = 255, blue = 255;
+        if (keys.count("Sun.SUNcolor")) {
+            std::sscanf(keys["Sun.SUNcolor"].c_str(), "%d,%d,%d", &red, &green, &blue);
+        }
+        float intensity = keys.count("Sun.SUNmulti") ? std::strtof(keys["Sun.SUNmulti"].c_str(), nullptr) : 1.0f;
+        file.sun = DirectedLightSource{PBRUtil::uvToCartesian(uv),
+                                       glm::vec3((float) red, (float) green, (float) blue) / 255.0f,
+                                       intensity};
+    }
+
+    return file;
+}
+
+std::optional<fs::path> IBLFile::radiancePath() const
+{
+    if (reflectionPath && fs::exists(*reflectionPath)) {
+        return reflectionPath;
+    }
+    if (environmentPath && fs::exists(*environmentPath)) {
+        return environmentPath;
+    }
+    return std::nullopt;
+}
+
+} // namespace PBR::physically_based
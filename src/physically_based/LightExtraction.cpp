@@ -0,0 +1,199 @@
+#include "physically_based/LightExtraction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/geometric.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "core/DirectedLightSource.h"
+#include "core/HDRImage.h"
+#include "core/ThreadPool.h"
+#include "physically_based/PBRUtil.h"
+
+namespace PBR::physically_based {
+
+namespace {
+
+/**
+ * The smallest share of the map's total light that a region must carry to be
+ * worth extracting.
+ */
+constexpr float minimumEnergyFraction = 0.02f;
+
+/**
+ * The largest solid angle, in steradians, that a region can cover and still be
+ * treated as a directional light. Larger bright regions, such as windows or
+ * overcast patches of sky, are left in the map.
+ */
+constexpr float maximumSolidAngle = 0.1f;
+
+float luminance(glm::vec3 colour)
+{
+    return 0.2126f * colour.r + 0.7152f * colour.g + 0.0722f * colour.b;
+}
+
+/**
+ * The solid angle covered by each pixel of a row of an equirectangular image.
+ * Rows are stored bottom to top.
+ */
+float pixelSolidAngle(unsigned int y, unsigned int width, unsigned int height)
+{
+    constexpr float pi = glm::pi<float>();
+    float polarAngle = pi * (1.0f - ((float) y + 0.5f) / (float) height);
+    return (2.0f * pi / (float) width) * (pi / (float) height) * std::sin(polarAngle);
+}
+
+/**
+ * The direction that the centre of a pixel of an equirectangular image represents.
+ */
+glm::vec3 pixelDirection(unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+{
+    // PBRUtil::uvToCartesian measures v from the top of the image
+    glm::vec2 uv(((float) x + 0.5f) / (float) width, 1.0f - ((float) y + 0.5f) / (float) height);
+    return PBRUtil::uvToCartesian(uv);
+}
+
+/**
+ * A connected group of pixels above the threshold.
+ */
+struct BrightRegion {
+    std::vector<size_t> pixels;
+
+    /**
+     * The light above the threshold, integrated over the region, i.e. the
+     * irradiance that the region contributes beyond its clamped value.
+     */
+    glm::vec3 excessIrradiance{0.0f};
+
+    /**
+     * The sum of the pixel directions, weighted by their excess luminance.
+     */
+    glm::vec3 weightedDirection{0.0f};
+
+    float solidAngle = 0.0f;
+};
+
+} // anonymous namespace
+
+std::vector<DirectedLightSource> LightExtraction::extractDominantLights(HDRImage& image, float thresholdRatio,
+                                                                        unsigned int maxLights,
+                                                                        ThreadPool& threadPool)
+{
+    unsigned int width = image.width;
+    unsigned int height = image.height;
+    if (width == 0 || height == 0 || maxLights == 0) {
+        return {};
+    }
+
+    // Integrate the luminance over the sphere, one row per task
+    std::vector<float> luminances((size_t) width * height);
+    std::vector<double> rowEnergies(height);
+    threadPool.parallelFor(height, [&](size_t y) {
+        float solidAngle = pixelSolidAngle(y, width, height);
+        double energy = 0.0;
+        for (unsigned int x = 0; x < width; x++) {
+            float value = luminance(image.pixel(x, y));
+            luminances[y * width + x] = value;
+            energy += value * solidAngle;
+        }
+        rowEnergies[y] = energy;
+    });
+
+    double totalEnergy = 0.0;
+    for (double energy : rowEnergies) {
+        totalEnergy += energy;
+    }
+    if (totalEnergy <= 0.0) {
+        return {};
+    }
+    float threshold = (float) (totalEnergy / (4.0 * glm::pi<double>())) * thresholdRatio;
+
+    // Mark the pixels above the threshold
+    std::vector<uint8_t> unvisited(luminances.size());
+    threadPool.parallelFor(height, [&](size_t y) {
+        for (unsigned int x = 0; x < width; x++) {
+            unvisited[y * width + x] = luminances[y * width + x] > threshold;
+        }
+    });
+
+    // Group them into connected regions. Only a small fraction of the pixels are
+    // above the threshold, so this is cheap enough to do on one thread.
+    std::vector<BrightRegion> regions;
+    std::vector<size_t> stack;
+    for (size_t start = 0; start < unvisited.size(); start++) {
+        if (!unvisited[start]) {
+            continue;
+        }
+
+        BrightRegion region;
+        unvisited[start] = 0;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            size_t index = stack.back();
+            stack.pop_back();
+            region.pixels.push_back(index);
+
+            auto x = (unsigned int) (index % width);
+            auto y = (unsigned int) (index / width);
+            float solidAngle = pixelSolidAngle(y, width, height);
+            float excess = 1.0f - threshold / luminances[index];
+            glm::vec3 excessColour = image.pixel(x, y) * excess;
+            region.excessIrradiance += excessColour * solidAngle;
+            region.weightedDirection += pixelDirection(x, y, width, height) * luminance(excessColour) * solidAngle;
+            region.solidAngle += solidAngle;
+
+            // Visit the four neighbours, wrapping around horizontally since the
+            // left and right edges of the image meet
+            size_t neighbours[4] = {
+                    y * width + (x + 1) % width,
+                    y * width + (x + width - 1) % width,
+                    y > 0 ? index - width : index,
+                    y + 1 < height ? index + width : index,
+            };
+            for (size_t neighbour : neighbours) {
+                if (unvisited[neighbour]) {
+                    unvisited[neighbour] = 0;
+                    stack.push_back(neighbour);
+                }
+            }
+        }
+
+        bool significant = luminance(region.excessIrradiance) >= minimumEnergyFraction * totalEnergy;
+        if (significant && region.solidAngle <= maximumSolidAngle) {
+            regions.push_back(std::move(region));
+        }
+    }
+
+    // Keep the brightest regions
+    std::sort(regions.begin(), regions.end(), [](const BrightRegion& a, const BrightRegion& b) {
+        return luminance(a.excessIrradiance) > luminance(b.excessIrradiance);
+    });
+    if (regions.size() > maxLights) {
+        regions.resize(maxLights);
+    }
+
+    // Clamp them out of the image and turn them into lights
+    std::vector<DirectedLightSource> lights;
+    for (const auto& region : regions) {
+        for (size_t index : region.pixels) {
+            auto x = (unsigned int) (index % width);
+            auto y = (unsigned int) (index / width);
+            image.setPixel(x, y, image.pixel(x, y) * (threshold / luminances[index]));
+        }
+
+        float intensity = std::max(region.excessIrradiance.r,
+                                   std::max(region.excessIrradiance.g, region.excessIrradiance.b));
+        lights.push_back(DirectedLightSource{glm::normalize(region.weightedDirection),
+                                             region.excessIrradiance / intensity, intensity});
+    }
+
+    return lights;
+}
+
+} // namespace PBR::physically_based
@@ -1,10 +1,18 @@
 #include "physically_based/PhysicallyBasedRenderer.h"
 
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
 #include <memory>
 
 #include <GL/glew.h>
 
+#include "core/FrameSnapshot.h"
+#include "core/Profiler.h"
+#include "core/RenderStats.h"
+#include "core/Texture.h"
+#include "core/UniformRingBuffer.h"
+#include "physically_based/DrawPacketBuilder.h"
 #include "physically_based/PBRUtil.h"
 #include "physically_based/PhysicallyBasedScene.h"
 #include "physically_based/PhysicallyBasedShaderUniforms.h"
@@ -27,10 +35,24 @@ const fs::path& fragmentShaderPath()
     return path;
 }
 
+size_t uniformBufferOffsetAlignment()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return (size_t) alignment;
+}
+
 } // anonymous namespace
 
 PhysicallyBasedRenderer::PhysicallyBasedRenderer()
-        :shaderProgram(vertexShaderPath(), fragmentShaderPath()), environmentMapRenderer()
+        :shaderProgram(vertexShaderPath(), fragmentShaderPath()),
+         sphericalHarmonicsShaderProgram(vertexShaderPath(), fragmentShaderPath(), {"USE_SPHERICAL_HARMONICS"}),
+         layeredShaderProgram(vertexShaderPath(), fragmentShaderPath(), {"LAYERED_LIGHTING_MAPS"}),
+         layeredSphericalHarmonicsShaderProgram(vertexShaderPath(), fragmentShaderPath(),
+                                                {"USE_SPHERICAL_HARMONICS", "LAYERED_LIGHTING_MAPS"}),
+         environmentMapRenderer(),
+         drawPacketBuilder(uniformBufferOffsetAlignment()),
+         uniformRingBuffer()
 {
 }
 
@@ -43,50 +65,143 @@ void PhysicallyBasedRenderer::activate()
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
+
+    // The lighting maps are cubemaps, so filter across the edges of their faces
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 }
 
-void PhysicallyBasedRenderer::render(std::shared_ptr<PhysicallyBasedScene> scene, const Camera& camera, double time)
+void PhysicallyBasedRenderer::render(std::shared_ptr<PhysicallyBasedScene> scene, const FrameSnapshot& frame)
 {
-    // Enable the shader program
-    glUseProgram(shaderProgram.id());
-
-    // Render each object in the scene
-    for (size_t i = 0; i < scene->getSceneObjectsList().size(); i++) {
-
-        const auto& object = scene->getSceneObjectsList()[i];
-        const auto& prefilteredEnvironmentMap = scene->getPrefilteredEnvironmentMaps()[i];
-        const auto& brdfIntegrationMap = scene->getBRDFIntegrationMaps()[i];
-
-        // Write the uniforms to the shader
-        PhysicallyBasedShaderUniforms uniforms{
-                object->getModelMatrix(),
-                camera.getViewMatrix(),
-                camera.getProjectionMatrix(),
-                object->getRotationMatrix(),
-                camera.position(),
-                object->material,
-                PhysicallyBasedDirectLightingInfo{scene->getLightPositions(), scene->getLightColours(),
-                                                  scene->getLightIntensities()},
-                scene->getEnvironmentMap()->getSun(),
-                object->material.brdfCoefficients.normalDistribution,
-                object->material.brdfCoefficients.geometricAttenutation,
-                scene->getEnvironmentMap()->getIrradianceMap(),
-                prefilteredEnvironmentMap,
-                brdfIntegrationMap,
+    // Spend some of this frame improving the lighting maps if they are being computed progressively
+    {
+        PBR_PROFILE_SCOPE("Refine precomputation");
+        scene->refinePrecomputation();
+    }
+
+    // Choose the shader variant matching how the lighting maps are stored
+    const auto& environmentMap = scene->getEnvironmentMap();
+    bool useSphericalHarmonics = environmentMap->getIrradianceMode() == IrradianceMode::SphericalHarmonics;
+    ShaderProgram& activeShaderProgram =
+            scene->hasLayeredLightingMaps()
+            ? (useSphericalHarmonics ? layeredSphericalHarmonicsShaderProgram : layeredShaderProgram)
+            : (useSphericalHarmonics ? sphericalHarmonicsShaderProgram : shaderProgram);
+
+    // Work out what to draw, and the uniforms for each object, on the worker threads
+    {
+        PBR_PROFILE_SCOPE("Build draw packets");
+        drawPacketBuilder.build(*scene, frame);
+    }
+    const auto& packets = drawPacketBuilder.getPackets();
+    RenderStats& stats = RenderStats::current();
+    stats.objectsCulled += drawPacketBuilder.getCulledCount();
+
+    // Write this frame's uniforms into the ring buffer, growing it if they don't fit
+    const auto& objectUniforms = drawPacketBuilder.getObjectUniforms();
+    UniformRingBuffer::Allocation cameraAllocation{}, lightingAllocation{}, objectsAllocation{};
+    {
+        PBR_PROFILE_SCOPE("Write uniforms");
+        auto frameSize = [&](const UniformRingBuffer& ringBuffer) {
+            return ringBuffer.allocationSize(sizeof(PhysicallyBasedCameraUniforms))
+                   + ringBuffer.allocationSize(sizeof(PhysicallyBasedLightingUniforms))
+                   + ringBuffer.allocationSize(objectUniforms.size());
         };
-        writeUniformsToShaderProgram(uniforms, shaderProgram);
+        if (!uniformRingBuffer || frameSize(*uniformRingBuffer) > uniformRingBuffer->getRegionSize()) {
+            // Leave room for the scene to grow, and for each allocation to be padded
+            size_t alignment = uniformBufferOffsetAlignment();
+            size_t regionSize = 2 * (sizeof(PhysicallyBasedCameraUniforms) + sizeof(PhysicallyBasedLightingUniforms)
+                                     + objectUniforms.size() + 3 * alignment);
+            uniformRingBuffer = std::make_unique<UniformRingBuffer>(regionSize, alignment);
+        }
+        uniformRingBuffer->beginFrame();
+
+        cameraAllocation = uniformRingBuffer->allocate(sizeof(PhysicallyBasedCameraUniforms));
+        *static_cast<PhysicallyBasedCameraUniforms*>(cameraAllocation.data) =
+                packCameraUniforms(frame.viewMatrix, frame.projectionMatrix, frame.cameraPosition);
+
+        lightingAllocation = uniformRingBuffer->allocate(sizeof(PhysicallyBasedLightingUniforms));
+        *static_cast<PhysicallyBasedLightingUniforms*>(lightingAllocation.data) =
+                packLightingUniforms(frame.lightPositions, frame.lightColours, frame.lightIntensities,
+                                     environmentMap->getSun(),
+                                     (float) (scene->getPrecomputationSettings().prefilterMipmapLevels - 1));
+
+        objectsAllocation = uniformRingBuffer->allocate(objectUniforms.size());
+        std::memcpy(objectsAllocation.data, objectUniforms.data(), objectUniforms.size());
+
+        uniformRingBuffer->flush();
+    }
 
-        // Draw the object
-        glBindVertexArray(object->vertexData->getVaoId());
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object->vertexData->getEboId());
-        glDrawElements(GL_TRIANGLES, object->vertexData->verticesCount(), GL_UNSIGNED_INT, (void*) 0);
+    // Enable the shader program
+    glUseProgram(activeShaderProgram.id());
+    stats.programSwitches++;
+
+    // Render each visible object in the scene
+    {
+        PBR_PROFILE_GPU_SCOPE("Objects");
+        const Texture* boundPrefilteredEnvironmentMap = nullptr;
+        const Texture* boundBRDFIntegrationMap = nullptr;
+        unsigned int boundVaoId = 0;
+        unsigned int objectDataBindingPoint = 0;
+
+        for (size_t j = 0; j < packets.size(); j++) {
+            const DrawPacket& packet = packets[j];
+            const auto& prefilteredEnvironmentMap = scene->getPrefilteredEnvironmentMaps()[packet.objectIndex];
+            const auto& brdfIntegrationMap = scene->getBRDFIntegrationMaps()[packet.objectIndex];
+
+            // Rebind the textures when the lighting maps change. The packets are
+            // sorted so that objects sharing maps are drawn together.
+            if (j == 0 || prefilteredEnvironmentMap.get() != boundPrefilteredEnvironmentMap
+                    || brdfIntegrationMap.get() != boundBRDFIntegrationMap) {
+                activeShaderProgram.resetUniforms();
+                if (environmentMap->getIrradianceMap()) {
+                    activeShaderProgram.setUniform("irradianceMap", environmentMap->getIrradianceMap());
+                }
+                if (environmentMap->getIrradianceSphericalHarmonics()) {
+                    activeShaderProgram.setUniform("SphericalHarmonics",
+                                                   environmentMap->getIrradianceSphericalHarmonics());
+                }
+                activeShaderProgram.setUniform("preFilteredEnvironmentMap", prefilteredEnvironmentMap);
+                activeShaderProgram.setUniform("brdfIntegrationMap", brdfIntegrationMap);
+                glBindBufferRange(GL_UNIFORM_BUFFER, activeShaderProgram.reserveUniformBlock("CameraData"),
+                                  uniformRingBuffer->id(), cameraAllocation.offset,
+                                  sizeof(PhysicallyBasedCameraUniforms));
+                glBindBufferRange(GL_UNIFORM_BUFFER, activeShaderProgram.reserveUniformBlock("LightingData"),
+                                  uniformRingBuffer->id(), lightingAllocation.offset,
+                                  sizeof(PhysicallyBasedLightingUniforms));
+                objectDataBindingPoint = activeShaderProgram.reserveUniformBlock("ObjectData");
+                boundPrefilteredEnvironmentMap = prefilteredEnvironmentMap.get();
+                boundBRDFIntegrationMap = brdfIntegrationMap.get();
+            }
+
+            // Point the shader at this object's uniforms
+            glBindBufferRange(GL_UNIFORM_BUFFER, objectDataBindingPoint, uniformRingBuffer->id(),
+                              objectsAllocation.offset + j * drawPacketBuilder.getObjectUniformsStride(),
+                              sizeof(PhysicallyBasedObjectUniforms));
+
+            // Draw the object
+            if (packet.vaoId != boundVaoId) {
+                glBindVertexArray(packet.vaoId);
+                boundVaoId = packet.vaoId;
+                stats.vaoBinds++;
+            }
+            glDrawElementsBaseVertex(GL_TRIANGLES, packet.indicesCount, GL_UNSIGNED_INT, packet.indicesOffset,
+                                     packet.baseVertex);
+            stats.drawCalls++;
+            stats.triangles += packet.indicesCount / 3;
+            stats.objectsDrawn++;
+        }
 
         // Reset the uniforms ready for the next usage
-        shaderProgram.resetUniforms();
+        activeShaderProgram.resetUniforms();
     }
 
+    // The GPU reads this frame's uniforms until it has finished these draws
+    uniformRingBuffer->endFrame();
+
     // Render the environment map as a skybox
-    environmentMapRenderer.renderSkybox(scene->getEnvironmentMap(), camera);
+    {
+        PBR_PROFILE_GPU_SCOPE("Skybox");
+        environmentMapRenderer.renderSkybox(environmentMap, frame.viewMatrix, frame.projectionMatrix);
+    }
 }
 
 } // namespace PBR::physically_based
@@ -1,18 +1,31 @@
 #include "physically_based/PhysicallyBasedScene.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include <GL/glew.h>
 #include <boost/functional/hash.hpp>
 
+#include "core/BackgroundBaker.h"
 #include "core/PointLightSource.h"
+#include "core/PrecomputationContext.h"
 #include "core/ShaderProgram.h"
 #include "core/TexturePrecomputation.h"
+#include "physically_based/BRDFCoefficients.h"
 #include "physically_based/EnvironmentMap.h"
 #include "physically_based/PBRUtil.h"
 #include "physically_based/PhysicallyBasedSceneObject.h"
+#include "physically_based/PrecomputationSettings.h"
+#include "physically_based/ResourceRegistry.h"
 
 namespace PBR::physically_based {
 
@@ -34,18 +47,347 @@ struct PhysicallyBasedMaterialHasher {
     }
 };
 
+/**
+ * The most BRDF variants that one layered draw can cover. This sets the size of
+ * the per-layer uniform arrays in the layered shaders.
+ */
+constexpr unsigned int layersPerDraw = 16;
+
+/**
+ * The size of the square tiles that progressive refinement works through.
+ */
+constexpr unsigned int refinementTileSize = 64;
+
+constexpr double defaultRefinementBudgetMilliseconds = 4.0;
+
+/**
+ * The GPU time assumed for a refinement job until the first timings are read back.
+ */
+constexpr double initialRefinementJobMilliseconds = 1.0;
+
+/**
+ * How much each new timing moves the estimated cost of a job. The jobs vary in
+ * cost, so this smooths out the difference between batches of different kinds.
+ */
+constexpr double refinementTimingWeight = 0.25;
+
+/**
+ * Splits one face and mipmap level of a texture into tiles.
+ */
+std::vector<TextureRegion> splitIntoTiles(unsigned int face, unsigned int mipmapLevel,
+                                          unsigned int levelWidth, unsigned int levelHeight)
+{
+    std::vector<TextureRegion> tiles;
+    for (unsigned int y = 0; y < levelHeight; y += refinementTileSize) {
+        for (unsigned int x = 0; x < levelWidth; x += refinementTileSize) {
+            tiles.push_back(TextureRegion{face, mipmapLevel, levelWidth, levelHeight, x, y,
+                                          std::min(refinementTileSize, levelWidth - x),
+                                          std::min(refinementTileSize, levelHeight - y)});
+        }
+    }
+    return tiles;
+}
+
+/**
+ * The format that a compute shader stores a map in. Image stores don't support
+ * three-component formats, so `GL_RGB16F` is widened to `GL_RGBA16F`.
+ */
+unsigned int imageStoreFormat(unsigned int internalFormat)
+{
+    return internalFormat == GL_RGB16F ? GL_RGBA16F : internalFormat;
+}
+
+/**
+ * The define that sets a compute shader's image format qualifier to match the
+ * format that the map is stored in.
+ */
+std::string imageFormatDefine(unsigned int internalFormat)
+{
+    switch (imageStoreFormat(internalFormat)) {
+    case GL_R11F_G11F_B10F: return "IMAGE_FORMAT r11f_g11f_b10f";
+    case GL_RG16F: return "IMAGE_FORMAT rg16f";
+    default: return "IMAGE_FORMAT rgba16f";
+    }
+}
+
+/**
+ * The most samples per texel that the compute shaders can take, which is
+ * `MAX_SAMPLES` in ComputePreFilteredEnvironmentMap.comp and
+ * ComputeBRDFIntegrationMap.comp. Settings asking for more are rendered with the
+ * fragment shaders instead, which have no limit, so that every bake path gives
+ * the same result.
+ */
+constexpr int maxComputeShaderSamples = 1024;
+
+/**
+ * @return A name for a precomputation shader program that tells apart every
+ *         version `makePrefilterShader` or `makeBRDFIntegrationShader` can make
+ */
+std::string shaderName(const std::string& kind, bool useComputeShader, unsigned int internalFormat)
+{
+    return useComputeShader ? kind + " compute " + imageFormatDefine(internalFormat) : kind + " fragment";
+}
+
+std::shared_ptr<ShaderProgram> makePrefilterShader(bool useComputeShader, const PrecomputationSettings& settings)
+{
+    if (useComputeShader) {
+        return std::make_shared<ShaderProgram>(PBRUtil::pbrShadersDir() / "ComputePreFilteredEnvironmentMap.comp",
+                                               std::vector<std::string>{imageFormatDefine(settings.lightingMapFormat())});
+    }
+    return std::make_shared<ShaderProgram>(PBRUtil::pbrShadersDir() / "PrepVerticesForRenderingTexture.vert",
+                                           PBRUtil::pbrShadersDir() / "ComputePreFilteredEnvironmentMap.frag");
+}
+
+std::shared_ptr<ShaderProgram> makeBRDFIntegrationShader(bool useComputeShader, const PrecomputationSettings& settings)
+{
+    if (useComputeShader) {
+        return std::make_shared<ShaderProgram>(PBRUtil::pbrShadersDir() / "ComputeBRDFIntegrationMap.comp",
+                                               std::vector<std::string>{imageFormatDefine(settings.brdfIntegrationMapFormat())});
+    }
+    return std::make_shared<ShaderProgram>(PBRUtil::pbrShadersDir() / "PrepVerticesForRenderingTexture.vert",
+                                           PBRUtil::pbrShadersDir() / "ComputeBRDFIntegrationMap.frag");
+}
+
+/**
+ * Sets the uniforms for computing one mipmap level of a prefiltered environment map.
+ */
+void setPrefilterUniforms(ShaderProgram& shader, const EnvironmentMap& environmentMap,
+                          const PhysicallyBasedMaterial& material, unsigned int mipmapLevel,
+                          const PrecomputationSettings& settings)
+{
+    shader.resetUniforms();
+    shader.setUniform("radianceMap", environmentMap.getLightingRadianceMap());
+    shader.setUniform("radianceMapFaceSize", (float) environmentMap.getRadianceMapFaceSize());
+    shader.setUniform("roughness", settings.roughnessForLevel(mipmapLevel));
+    shader.setUniform("sampleCount", settings.prefilterSampleCountForLevel(mipmapLevel));
+    shader.setUniform("dCoefficients.k_TrowbridgeReitzGGX", material.brdfCoefficients.normalDistribution.k_TrowbridgeReitzGGX);
+    shader.setUniform("dCoefficients.k_Beckmann", material.brdfCoefficients.normalDistribution.k_Beckmann);
+    shader.setUniform("gCoefficients.k_SchlickGGX", material.brdfCoefficients.geometricAttenutation.k_SchlickGGX);
+    shader.setUniform("gCoefficients.k_CookTorrance", material.brdfCoefficients.geometricAttenutation.k_CookTorrance);
+}
+
+/**
+ * Sets the uniforms for computing a BRDF integration map.
+ */
+void setBRDFIntegrationUniforms(ShaderProgram& shaderProgram, const PhysicallyBasedMaterial& material,
+                                const PrecomputationSettings& settings)
+{
+    shaderProgram.resetUniforms();
+    shaderProgram.setUniform("sampleCount", settings.brdfIntegrationSampleCount);
+    shaderProgram.setUniform("dCoefficients.k_TrowbridgeReitzGGX", material.brdfCoefficients.normalDistribution.k_TrowbridgeReitzGGX);
+    shaderProgram.setUniform("dCoefficients.k_Beckmann", material.brdfCoefficients.normalDistribution.k_Beckmann);
+    shaderProgram.setUniform("gCoefficients.k_SchlickGGX", material.brdfCoefficients.geometricAttenutation.k_SchlickGGX);
+    shaderProgram.setUniform("gCoefficients.k_CookTorrance", material.brdfCoefficients.geometricAttenutation.k_CookTorrance);
+}
+
+/**
+ * Sets the BRDF coefficients for each layer of a layered draw.
+ */
+void setPerLayerCoefficients(ShaderProgram& shader, const std::vector<BRDFCoefficients>& variants,
+                             unsigned int firstLayer, unsigned int layerCount)
+{
+    for (unsigned int i = 0; i < layerCount; i++) {
+        const BRDFCoefficients& coefficients = variants[firstLayer + i];
+        std::string index = "[" + std::to_string(i) + "]";
+        shader.setUniform("dCoefficientsPerLayer" + index + ".k_TrowbridgeReitzGGX",
+                          coefficients.normalDistribution.k_TrowbridgeReitzGGX);
+        shader.setUniform("dCoefficientsPerLayer" + index + ".k_Beckmann",
+                          coefficients.normalDistribution.k_Beckmann);
+        shader.setUniform("gCoefficientsPerLayer" + index + ".k_SchlickGGX",
+                          coefficients.geometricAttenutation.k_SchlickGGX);
+        shader.setUniform("gCoefficientsPerLayer" + index + ".k_CookTorrance",
+                          coefficients.geometricAttenutation.k_CookTorrance);
+    }
+}
+
+/**
+ * Renders a whole prefiltered environment map with the given shader, which is
+ * a compute shader if `useComputeShader` is set.
+ */
+std::shared_ptr<Texture> bakePrefilteredEnvironmentMap(ShaderProgram& shader, const EnvironmentMap& environmentMap,
+                                                       const PhysicallyBasedMaterial& material,
+                                                       const PrecomputationSettings& settings, bool useComputeShader)
+{
+    // Code to set up uniforms
+    auto setUniforms = [&shader, &environmentMap, &material, &settings](unsigned int mipmapLevel) {
+        setPrefilterUniforms(shader, environmentMap, material, mipmapLevel, settings);
+    };
+
+    // Allocate a cubemap ready for rendering
+    std::shared_ptr<Texture> texture(new Texture(GL_TEXTURE_CUBE_MAP));
+
+    // Render each face. A cubemap spends its texels far more evenly over the sphere
+    // than an equirectangular map does, so it needs far fewer of them.
+    if (useComputeShader) {
+        TexturePrecomputation::computeToTexture(texture, shader, settings.prefilterFaceSize, settings.prefilterFaceSize,
+                                                settings.prefilterMipmapLevels, setUniforms,
+                                                imageStoreFormat(settings.lightingMapFormat()));
+    }
+    else {
+        TexturePrecomputation::renderToCubemap(texture, shader, settings.prefilterFaceSize,
+                                               settings.prefilterMipmapLevels, setUniforms,
+                                               settings.lightingMapFormat());
+    }
+    shader.resetUniforms();
+
+    return texture;
+}
+
+/**
+ * Renders a whole BRDF integration map with the given shader, which is a
+ * compute shader if `useComputeShader` is set.
+ */
+std::shared_ptr<Texture> bakeBRDFIntegrationMap(ShaderProgram& shader, const PhysicallyBasedMaterial& material,
+                                                const PrecomputationSettings& settings, bool useComputeShader)
+{
+    // Function for setting up shader uniforms
+    auto prepareShaderUniforms = [&shader, &material, &settings]() {
+        setBRDFIntegrationUniforms(shader, material, settings);
+    };
+
+    std::shared_ptr<Texture> texture(new Texture());
+    if (useComputeShader) {
+        TexturePrecomputation::computeToTexture(texture, shader, settings.brdfIntegrationMapSize,
+                                                settings.brdfIntegrationMapSize, 1,
+                                                [&prepareShaderUniforms](unsigned int) { prepareShaderUniforms(); },
+                                                imageStoreFormat(settings.brdfIntegrationMapFormat()));
+    }
+    else {
+        TexturePrecomputation::renderToTexture(texture, shader, settings.brdfIntegrationMapSize,
+                                               settings.brdfIntegrationMapSize, prepareShaderUniforms,
+                                               settings.brdfIntegrationMapFormat());
+    }
+    shader.resetUniforms();
+    return texture;
+}
+
+/**
+ * Reads back one mipmap level of a texture as RGB floats. The faces of a cubemap,
+ * and the layers of an array texture, follow one another.
+ */
+std::vector<float> readTextureLevel(const Texture& texture, unsigned int mipmapLevel)
+{
+    GLenum target = texture.target();
+    bool isCubemap = target == GL_TEXTURE_CUBE_MAP;
+    GLenum levelTarget = isCubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+
+    glBindTexture(target, texture.id());
+    int width, height, depth;
+    glGetTexLevelParameteriv(levelTarget, mipmapLevel, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(levelTarget, mipmapLevel, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(levelTarget, mipmapLevel, GL_TEXTURE_DEPTH, &depth);
+
+    size_t pixelsPerImage = (size_t) width * height;
+    std::vector<float> pixels;
+    if (isCubemap) {
+        pixels.resize(6 * pixelsPerImage * 3);
+        for (unsigned int face = 0; face < 6; face++) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mipmapLevel, GL_RGB, GL_FLOAT,
+                          pixels.data() + face * pixelsPerImage * 3);
+        }
+    }
+    else {
+        // Array textures return every layer at once. For cubemap arrays each layer is six faces.
+        pixels.resize(std::max(depth, 1) * pixelsPerImage * 3);
+        glGetTexImage(target, mipmapLevel, GL_RGB, GL_FLOAT, pixels.data());
+    }
+    glBindTexture(target, 0);
+
+    return pixels;
+}
+
+/**
+ * @return The root-mean-square difference between two sets of values, relative
+ *         to the root-mean-square of the reference values
+ */
+double relativeError(const float* values, const float* reference, size_t count)
+{
+    double squaredError = 0.0;
+    double squaredReference = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double difference = (double) values[i] - (double) reference[i];
+        squaredError += difference * difference;
+        squaredReference += (double) reference[i] * (double) reference[i];
+    }
+    return std::sqrt(squaredError / std::max(squaredReference, 1e-12));
+}
+
 } // anonymous namespace
 
 PhysicallyBasedScene::PhysicallyBasedScene(std::vector<std::shared_ptr<PhysicallyBasedSceneObject>> sceneObjects,
                                            std::vector<PointLightSource> lights,
-                                           std::shared_ptr<EnvironmentMap> environmentMap)
+                                           std::shared_ptr<EnvironmentMap> environmentMap,
+                                           PrecomputationMode precomputationMode,
+                                           std::shared_ptr<BackgroundBaker> backgroundBaker,
+                                           const PrecomputationSettings& settings)
         :Scene<PhysicallyBasedSceneObject>(std::move(sceneObjects), std::move(lights), glm::vec3(0.0f)),
          environmentMap(environmentMap),
          prefilteredEnvironmentMaps(),
-         brdfIntegrationMaps()
+         brdfIntegrationMaps(),
+         lightingMapLayers(),
+         settings(settings),
+         precomputationMode(precomputationMode),
+         environmentMapVersion(environmentMap->getVersion()),
+         usePrefilterComputeShader(false),
+         useBRDFIntegrationComputeShader(false),
+         prefilterShader(),
+         brdfIntegrationShader(),
+         refinementJobs(),
+         totalRefinementJobs(0),
+         refinementBudgetMilliseconds(defaultRefinementBudgetMilliseconds),
+         refinementTimings(),
+         nextRefinementTiming(0),
+         estimatedRefinementJobMilliseconds(initialRefinementJobMilliseconds),
+         backgroundBaker(std::move(backgroundBaker)),
+         finishedBackgroundBakes(new std::vector<std::pair<std::shared_ptr<Texture>, std::shared_ptr<Texture>>>()),
+         outstandingBackgroundBakes(0),
+         totalBackgroundBakes(0),
+         completionCallbacks()
+{
+    if (precomputationMode == PrecomputationMode::Background && !this->backgroundBaker) {
+        precomputationMode = PrecomputationMode::Progressive;
+        this->precomputationMode = precomputationMode;
+    }
+
+    // Progressive refinement renders a tile at a time, so it sticks to rasterisation
+    // throughout. The layered bake is always rasterised too.
+    bool useComputeShaders = TexturePrecomputation::computeShadersAvailable()
+                             && precomputationMode != PrecomputationMode::Progressive
+                             && precomputationMode != PrecomputationMode::Layered;
+    usePrefilterComputeShader = useComputeShaders && settings.prefilterSampleCount <= maxComputeShaderSamples;
+    useBRDFIntegrationComputeShader = useComputeShaders
+                                      && settings.brdfIntegrationSampleCount <= maxComputeShaderSamples;
+    prefilterShader = makePrefilterShader(usePrefilterComputeShader, settings);
+    brdfIntegrationShader = makeBRDFIntegrationShader(useBRDFIntegrationComputeShader, settings);
+
+    // The BRDF maps affect every object's specular lighting, so they are refined first
+    {
+        PrecomputationBatch batch;
+        if (precomputationMode == PrecomputationMode::Layered) {
+            precomputeLayeredLightingMaps();
+        }
+        else {
+            precomputeBRDFIntegrationMaps(precomputationMode);
+            precomputePrefilteredEnvironmentMaps(precomputationMode);
+            lightingMapLayers.assign(getSceneObjectsList().size(), 0);
+        }
+    }
+    totalRefinementJobs = refinementJobs.size();
+
+    // The shaders are only needed on this thread for refinement
+    if (refinementJobs.empty()) {
+        prefilterShader.reset();
+        brdfIntegrationShader.reset();
+    }
+}
+
+PhysicallyBasedScene::~PhysicallyBasedScene()
 {
-    precomputePrefilteredEnvironmentMaps();
-    precomputeBRDFIntegrationMaps();
+    for (auto& timing : refinementTimings) {
+        if (timing.queries[0]) {
+            glDeleteQueries(2, timing.queries.data());
+        }
+    }
 }
 
 std::shared_ptr<EnvironmentMap> PhysicallyBasedScene::getEnvironmentMap() const
@@ -63,94 +405,526 @@ const std::vector<std::shared_ptr<Texture>>& PhysicallyBasedScene::getBRDFIntegr
     return brdfIntegrationMaps;
 }
 
-void PhysicallyBasedScene::precomputePrefilteredEnvironmentMaps()
+const std::vector<int>& PhysicallyBasedScene::getLightingMapLayers() const
+{
+    return lightingMapLayers;
+}
+
+bool PhysicallyBasedScene::hasLayeredLightingMaps() const
+{
+    return !prefilteredEnvironmentMaps.empty()
+           && prefilteredEnvironmentMaps.front()->target() == GL_TEXTURE_CUBE_MAP_ARRAY;
+}
+
+const PrecomputationSettings& PhysicallyBasedScene::getPrecomputationSettings() const
+{
+    return settings;
+}
+
+void PhysicallyBasedScene::refinePrecomputation()
+{
+    if (environmentMap->getVersion() != environmentMapVersion) {
+        recomputeForNewEnvironmentMap();
+    }
+
+    swapInBackgroundBakes();
+    readRefinementTimings();
+
+    if (refinementJobs.empty()) {
+        notifyIfComplete();
+        return;
+    }
+
+    // The jobs render to their own framebuffers, so we need to put the viewport back afterwards
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Time the jobs on the GPU with a pair of timestamps. If the GPU is so far
+    // behind that this frame's timing is still waiting to be read, go without.
+    RefinementTiming& timing = refinementTimings[nextRefinementTiming];
+    bool timed = !timing.pending;
+    if (timed) {
+        if (!timing.queries[0]) {
+            glGenQueries(2, timing.queries.data());
+        }
+        glQueryCounter(timing.queries[0], GL_TIMESTAMP);
+    }
+
+    // Issue jobs while the next one is expected to fit in the budget on the GPU,
+    // and the CPU hasn't spent the budget issuing them
+    PrecomputationBatch batch;
+    auto startTime = std::chrono::steady_clock::now();
+    size_t jobsCount = 0;
+    do {
+        auto job = std::move(refinementJobs.front());
+        refinementJobs.pop_front();
+        job();
+        jobsCount++;
+    } while (!refinementJobs.empty()
+             && (double) (jobsCount + 1) * estimatedRefinementJobMilliseconds <= refinementBudgetMilliseconds
+             && std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count()
+                < refinementBudgetMilliseconds);
+
+    if (timed) {
+        glQueryCounter(timing.queries[1], GL_TIMESTAMP);
+        timing.jobsCount = jobsCount;
+        timing.pending = true;
+        nextRefinementTiming = (nextRefinementTiming + 1) % refinementTimings.size();
+    }
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    if (refinementJobs.empty()) {
+        // The shaders are only needed for refinement
+        prefilterShader.reset();
+        brdfIntegrationShader.reset();
+    }
+
+    notifyIfComplete();
+}
+
+bool PhysicallyBasedScene::needsRedraw() const
+{
+    return Scene::needsRedraw() || environmentMap->getVersion() != environmentMapVersion
+           || !refinementJobs.empty() || !finishedBackgroundBakes->empty();
+}
+
+void PhysicallyBasedScene::setRefinementBudget(double milliseconds)
+{
+    refinementBudgetMilliseconds = milliseconds;
+}
+
+bool PhysicallyBasedScene::isPrecomputationComplete() const
+{
+    return refinementJobs.empty() && outstandingBackgroundBakes == 0;
+}
+
+float PhysicallyBasedScene::getPrecomputationProgress() const
+{
+    size_t totalJobs = totalRefinementJobs + totalBackgroundBakes;
+    if (totalJobs == 0) {
+        return 1.0f;
+    }
+    size_t remainingJobs = refinementJobs.size() + outstandingBackgroundBakes;
+    return 1.0f - (float) remainingJobs / (float) totalJobs;
+}
+
+void PhysicallyBasedScene::addPrecomputationCompleteCallback(std::function<void()> callback)
+{
+    if (isPrecomputationComplete()) {
+        callback();
+    }
+    else {
+        completionCallbacks.push_back(std::move(callback));
+    }
+}
+
+PrecomputationErrorEstimate PhysicallyBasedScene::estimatePrecomputationError() const
+{
+    // The references are always rendered, since the compute shaders have a fixed
+    // limit on the number of samples
+    PrecomputationSettings referenceSettings = settings.reference();
+    auto referencePrefilterShader = makePrefilterShader(false, referenceSettings);
+    auto referenceBRDFIntegrationShader = makeBRDFIntegrationShader(false, referenceSettings);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    PrecomputationErrorEstimate estimate{std::vector<double>(settings.prefilterMipmapLevels, 0.0), 0.0};
+    PrecomputationBatch batch;
+
+    // The maps only depend on the BRDF, so each one only needs comparing once
+    std::unordered_set<BRDFCoefficients, BRDFCoefficientsHasher> compared;
+    for (size_t i = 0; i < getSceneObjectsList().size(); i++) {
+        const PhysicallyBasedMaterial& material = getSceneObjectsList()[i]->material;
+        if (!compared.insert(material.brdfCoefficients).second) {
+            continue;
+        }
+
+        auto referencePrefilteredMap = bakePrefilteredEnvironmentMap(*referencePrefilterShader, *environmentMap,
+                                                                     material, referenceSettings, false);
+        for (unsigned int mipmapLevel = 0; mipmapLevel < settings.prefilterMipmapLevels; mipmapLevel++) {
+            std::vector<float> reference = readTextureLevel(*referencePrefilteredMap, mipmapLevel);
+            std::vector<float> actual = readTextureLevel(*prefilteredEnvironmentMaps[i], mipmapLevel);
+            const float* layer = actual.data() + lightingMapLayers[i] * reference.size();
+            estimate.prefilteredEnvironmentMapErrors[mipmapLevel] =
+                    std::max(estimate.prefilteredEnvironmentMapErrors[mipmapLevel],
+                             relativeError(layer, reference.data(), reference.size()));
+        }
+
+        auto referenceBRDFIntegrationMap = bakeBRDFIntegrationMap(*referenceBRDFIntegrationShader, material,
+                                                                  referenceSettings, false);
+        std::vector<float> reference = readTextureLevel(*referenceBRDFIntegrationMap, 0);
+        std::vector<float> actual = readTextureLevel(*brdfIntegrationMaps[i], 0);
+        const float* layer = actual.data() + lightingMapLayers[i] * reference.size();
+        estimate.brdfIntegrationMapError = std::max(estimate.brdfIntegrationMapError,
+                                                    relativeError(layer, reference.data(), reference.size()));
+    }
+
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    return estimate;
+}
+
+void PhysicallyBasedScene::recomputeForNewEnvironmentMap()
+{
+    environmentMapVersion = environmentMap->getVersion();
+
+    // The shaders are released once refinement finishes, so they may need making again
+    if (!prefilterShader) {
+        prefilterShader = makePrefilterShader(usePrefilterComputeShader, settings);
+    }
+    if (!brdfIntegrationShader) {
+        brdfIntegrationShader = makeBRDFIntegrationShader(useBRDFIntegrationComputeShader, settings);
+    }
+
+    // Refinement jobs and background bakes for the old maps are left to run out,
+    // but they no longer find their maps in use, so their results are dropped
+    size_t queuedJobs = refinementJobs.size();
+    {
+        PrecomputationBatch batch;
+        if (precomputationMode == PrecomputationMode::Layered) {
+            precomputeLayeredLightingMaps();
+        }
+        else {
+            precomputePrefilteredEnvironmentMaps(precomputationMode);
+        }
+    }
+    totalRefinementJobs += refinementJobs.size() - queuedJobs;
+
+    if (refinementJobs.empty()) {
+        prefilterShader.reset();
+        brdfIntegrationShader.reset();
+    }
+}
+
+void PhysicallyBasedScene::precomputePrefilteredEnvironmentMaps(PrecomputationMode precomputationMode)
 {
+    bool coarse = precomputationMode != PrecomputationMode::Blocking;
+    PrecomputationSettings firstPassSettings = coarse ? settings.coarse() : settings;
+
     std::unordered_map<PhysicallyBasedMaterial, std::shared_ptr<Texture>, PhysicallyBasedMaterialHasher> prefilteredCache;
     prefilteredEnvironmentMaps.clear();
+    ResourceRegistry& registry = ResourceRegistry::shared();
     for (const auto& object : getSceneObjectsList()) {
         auto it = prefilteredCache.find(object->material);
-        if (it == prefilteredCache.end()) {
-            // Not found, need to compute it and add it to the cache
-            std::shared_ptr<Texture> prefilteredEnvironmentMap = computePrefilteredEnvironmentMap(object->material);
+        if (it != prefilteredCache.end()) {
+            // Found, use the one we computed already
+            prefilteredEnvironmentMaps.push_back(it->second);
+            continue;
+        }
+
+        // Another scene may already have baked it at full quality
+        const BRDFCoefficients& brdfCoefficients = object->material.brdfCoefficients;
+        std::shared_ptr<Texture> prefilteredEnvironmentMap = registry.findPrefilteredEnvironmentMap(environmentMap,
+                                                                                                   brdfCoefficients,
+                                                                                                   settings);
+        if (prefilteredEnvironmentMap) {
             prefilteredEnvironmentMaps.push_back(prefilteredEnvironmentMap);
             prefilteredCache.insert(std::make_pair(object->material, prefilteredEnvironmentMap));
+            continue;
         }
-        else {
-            // Found, use the one we computed already
-            prefilteredEnvironmentMaps.push_back(it->second);
+
+        // Not found, need to compute it and add it to the cache
+        prefilteredEnvironmentMap = computePrefilteredEnvironmentMap(object->material, firstPassSettings);
+        prefilteredEnvironmentMaps.push_back(prefilteredEnvironmentMap);
+        prefilteredCache.insert(std::make_pair(object->material, prefilteredEnvironmentMap));
+        if (precomputationMode == PrecomputationMode::Blocking) {
+            registry.addPrefilteredEnvironmentMap(environmentMap, brdfCoefficients, settings,
+                                                  prefilteredEnvironmentMap);
+        }
+        else if (precomputationMode == PrecomputationMode::Progressive) {
+            queuePrefilteredEnvironmentMapRefinement(prefilteredEnvironmentMap, object->material);
+        }
+        else if (precomputationMode == PrecomputationMode::Background) {
+            // Uniform values belong to the program, which is shared between contexts,
+            // so the baker thread needs a program of its own, which every job shares.
+            // It bakes from a copy of the environment map, since the main thread may
+            // replace the original's maps.
+            auto bake = [baker = backgroundBaker.get(), environmentMap = *environmentMap,
+                         material = object->material, settings = settings,
+                         useComputeShader = usePrefilterComputeShader]() {
+                auto shader = baker->getShaderProgram(shaderName("Prefilter", useComputeShader,
+                                                                 settings.lightingMapFormat()), [&]() {
+                    return makePrefilterShader(useComputeShader, settings);
+                });
+                return bakePrefilteredEnvironmentMap(*shader, environmentMap, material, settings, useComputeShader);
+            };
+
+            // The result is only worth sharing if it was baked from the current maps
+            std::weak_ptr<EnvironmentMap> source = environmentMap;
+            auto onBaked = [source, version = environmentMap->getVersion(), brdfCoefficients,
+                            settings = settings](const std::shared_ptr<Texture>& texture) {
+                auto environmentMap = source.lock();
+                if (environmentMap && environmentMap->getVersion() == version) {
+                    ResourceRegistry::shared().addPrefilteredEnvironmentMap(environmentMap, brdfCoefficients,
+                                                                            settings, texture);
+                }
+            };
+            submitBackgroundBake(prefilteredEnvironmentMap, bake, onBaked);
         }
     }
 }
 
-std::shared_ptr<Texture> PhysicallyBasedScene::computePrefilteredEnvironmentMap(const PhysicallyBasedMaterial& material)
+std::shared_ptr<Texture> PhysicallyBasedScene::computePrefilteredEnvironmentMap(const PhysicallyBasedMaterial& material,
+                                                                                const PrecomputationSettings& settings)
 {
-    // Load the shader program
-    auto vertexShaderPath = PBRUtil::pbrShadersDir() / "PrepVerticesForRenderingTexture.vert";
-    auto fragmentShaderPath = PBRUtil::pbrShadersDir() / "ComputePreFilteredEnvironmentMap.frag";
-    ShaderProgram shader(vertexShaderPath, fragmentShaderPath);
-
-    // Code to set up uniforms
-    constexpr unsigned int mipmapLevels = 5;
-    auto setUniforms = [this, &shader, mipmapLevels, material](auto mipmapLevel) {
-        float roughness = (float) mipmapLevel / (float) (mipmapLevels - 1);
-        shader.resetUniforms();
-        shader.setUniform("radianceMap", this->environmentMap->getRadianceMap());
-        shader.setUniform("roughness", roughness);
-        shader.setUniform("dCoefficients.k_TrowbridgeReitzGGX", material.brdfCoefficients.normalDistribution.k_TrowbridgeReitzGGX);
-        shader.setUniform("dCoefficients.k_Beckmann", material.brdfCoefficients.normalDistribution.k_Beckmann);
-        shader.setUniform("gCoefficients.k_SchlickGGX", material.brdfCoefficients.geometricAttenutation.k_SchlickGGX);
-        shader.setUniform("gCoefficients.k_CookTorrance", material.brdfCoefficients.geometricAttenutation.k_CookTorrance);
-    };
-
-    // Allocate a texture ready for rendering
-    std::shared_ptr<Texture> texture(new Texture());
+    return bakePrefilteredEnvironmentMap(*prefilterShader, *environmentMap, material, settings,
+                                         usePrefilterComputeShader);
+}
 
-    // Render the texture
-    constexpr unsigned int maxWidth = 512;
-    constexpr unsigned int maxHeight = 512;
-    TexturePrecomputation::renderToMipmappedTexture(texture, shader, maxWidth, maxHeight, mipmapLevels, setUniforms);
+void PhysicallyBasedScene::queuePrefilteredEnvironmentMapRefinement(std::shared_ptr<Texture> texture,
+                                                                   const PhysicallyBasedMaterial& material)
+{
+    for (unsigned int mipmapLevel = 0; mipmapLevel < settings.prefilterMipmapLevels; mipmapLevel++) {
+        unsigned int size = std::max(settings.prefilterFaceSize >> mipmapLevel, 1u);
+        for (unsigned int face = 0; face < 6; face++) {
+            for (const auto& tile : splitIntoTiles(face, mipmapLevel, size, size)) {
+                refinementJobs.emplace_back([this, texture, material, tile]() {
+                    // Skip maps that were dropped when the environment map was replaced
+                    if (std::find(prefilteredEnvironmentMaps.begin(), prefilteredEnvironmentMaps.end(), texture)
+                        == prefilteredEnvironmentMaps.end()) {
+                        return;
+                    }
+                    auto setUniforms = [this, &material, &tile]() {
+                        setPrefilterUniforms(*prefilterShader, *environmentMap, material, tile.mipmapLevel, settings);
+                    };
+                    TexturePrecomputation::renderToTextureRegion(texture, *prefilterShader, tile, setUniforms);
+                    prefilterShader->resetUniforms();
+                });
+            }
+        }
+    }
 
-    return texture;
+    // Once the last tile is done the map is at full quality, so other scenes can use it
+    refinementJobs.emplace_back([this, texture, brdfCoefficients = material.brdfCoefficients]() {
+        if (std::find(prefilteredEnvironmentMaps.begin(), prefilteredEnvironmentMaps.end(), texture)
+            != prefilteredEnvironmentMaps.end()) {
+            ResourceRegistry::shared().addPrefilteredEnvironmentMap(environmentMap, brdfCoefficients, settings,
+                                                                    texture);
+        }
+    });
 }
 
-void PhysicallyBasedScene::precomputeBRDFIntegrationMaps()
+void PhysicallyBasedScene::precomputeBRDFIntegrationMaps(PrecomputationMode precomputationMode)
 {
+    bool coarse = precomputationMode != PrecomputationMode::Blocking;
+    PrecomputationSettings firstPassSettings = coarse ? settings.coarse() : settings;
+
     std::unordered_map<PhysicallyBasedMaterial, std::shared_ptr<Texture>, PhysicallyBasedMaterialHasher> brdfCache;
     brdfIntegrationMaps.clear();
+    ResourceRegistry& registry = ResourceRegistry::shared();
     for (const auto& object : getSceneObjectsList()) {
         auto it = brdfCache.find(object->material);
-        if (it == brdfCache.end()) {
-            // Not found, need to compute it and add it to the cache
-            std::shared_ptr<Texture> brdfIntegrationMap = computeBRDFIntegrationMap(object->material);
+        if (it != brdfCache.end()) {
+            // Found, use the one we computed already
+            brdfIntegrationMaps.push_back(it->second);
+            continue;
+        }
+
+        // Another scene may already have baked it at full quality
+        const BRDFCoefficients& brdfCoefficients = object->material.brdfCoefficients;
+        std::shared_ptr<Texture> brdfIntegrationMap = registry.findBRDFIntegrationMap(brdfCoefficients, settings);
+        if (brdfIntegrationMap) {
             brdfIntegrationMaps.push_back(brdfIntegrationMap);
             brdfCache.insert(std::make_pair(object->material, brdfIntegrationMap));
+            continue;
         }
-        else {
-            // Found, use the one we computed already
-            brdfIntegrationMaps.push_back(it->second);
+
+        // Not found, need to compute it and add it to the cache
+        brdfIntegrationMap = computeBRDFIntegrationMap(object->material, firstPassSettings);
+        brdfIntegrationMaps.push_back(brdfIntegrationMap);
+        brdfCache.insert(std::make_pair(object->material, brdfIntegrationMap));
+        if (precomputationMode == PrecomputationMode::Blocking) {
+            registry.addBRDFIntegrationMap(brdfCoefficients, settings, brdfIntegrationMap);
+        }
+        else if (precomputationMode == PrecomputationMode::Progressive) {
+            queueBRDFIntegrationMapRefinement(brdfIntegrationMap, object->material);
+        }
+        else if (precomputationMode == PrecomputationMode::Background) {
+            auto bake = [baker = backgroundBaker.get(), material = object->material, settings = settings,
+                         useComputeShader = useBRDFIntegrationComputeShader]() {
+                auto shader = baker->getShaderProgram(shaderName("BRDFIntegration", useComputeShader,
+                                                                 settings.brdfIntegrationMapFormat()), [&]() {
+                    return makeBRDFIntegrationShader(useComputeShader, settings);
+                });
+                return bakeBRDFIntegrationMap(*shader, material, settings, useComputeShader);
+            };
+            auto onBaked = [brdfCoefficients, settings = settings](const std::shared_ptr<Texture>& texture) {
+                ResourceRegistry::shared().addBRDFIntegrationMap(brdfCoefficients, settings, texture);
+            };
+            submitBackgroundBake(brdfIntegrationMap, bake, onBaked);
         }
     }
 }
 
-std::shared_ptr<Texture> PhysicallyBasedScene::computeBRDFIntegrationMap(const PhysicallyBasedMaterial& material)
+std::shared_ptr<Texture> PhysicallyBasedScene::computeBRDFIntegrationMap(const PhysicallyBasedMaterial& material,
+                                                                         const PrecomputationSettings& settings)
 {
-    auto vertexShader = PBRUtil::pbrShadersDir() / "PrepVerticesForRenderingTexture.vert";
-    auto fragmentShader = PBRUtil::pbrShadersDir() / "ComputeBRDFIntegrationMap.frag";
-    ShaderProgram shaderProgram(vertexShader, fragmentShader);
+    return bakeBRDFIntegrationMap(*brdfIntegrationShader, material, settings, useBRDFIntegrationComputeShader);
+}
 
-    // Function for setting up shader uniforms
-    auto prepareShaderUniforms = [material, &shaderProgram]() {
-        shaderProgram.resetUniforms();
-        shaderProgram.setUniform("dCoefficients.k_TrowbridgeReitzGGX", material.brdfCoefficients.normalDistribution.k_TrowbridgeReitzGGX);
-        shaderProgram.setUniform("dCoefficients.k_Beckmann", material.brdfCoefficients.normalDistribution.k_Beckmann);
-        shaderProgram.setUniform("gCoefficients.k_SchlickGGX", material.brdfCoefficients.geometricAttenutation.k_SchlickGGX);
-        shaderProgram.setUniform("gCoefficients.k_CookTorrance", material.brdfCoefficients.geometricAttenutation.k_CookTorrance);
+void PhysicallyBasedScene::queueBRDFIntegrationMapRefinement(std::shared_ptr<Texture> texture,
+                                                             const PhysicallyBasedMaterial& material)
+{
+    unsigned int size = settings.brdfIntegrationMapSize;
+    for (const auto& tile : splitIntoTiles(0, 0, size, size)) {
+        refinementJobs.emplace_back([this, texture, material, tile]() {
+            auto setUniforms = [this, &material]() {
+                setBRDFIntegrationUniforms(*brdfIntegrationShader, material, settings);
+            };
+            TexturePrecomputation::renderToTextureRegion(texture, *brdfIntegrationShader, tile, setUniforms);
+            brdfIntegrationShader->resetUniforms();
+        });
+    }
+
+    // Once the last tile is done the map is at full quality, so other scenes can use it
+    refinementJobs.emplace_back([this, texture, brdfCoefficients = material.brdfCoefficients]() {
+        ResourceRegistry::shared().addBRDFIntegrationMap(brdfCoefficients, settings, texture);
+    });
+}
+
+void PhysicallyBasedScene::precomputeLayeredLightingMaps()
+{
+    // Both maps depend only on the BRDF, so objects whose materials differ in
+    // other ways can share a layer
+    std::unordered_map<BRDFCoefficients, int, BRDFCoefficientsHasher> layers;
+    std::vector<BRDFCoefficients> variants;
+    lightingMapLayers.clear();
+    for (const auto& object : getSceneObjectsList()) {
+        const BRDFCoefficients& coefficients = object->material.brdfCoefficients;
+        auto it = layers.find(coefficients);
+        if (it == layers.end()) {
+            it = layers.insert(std::make_pair(coefficients, (int) variants.size())).first;
+            variants.push_back(coefficients);
+        }
+        lightingMapLayers.push_back(it->second);
+    }
+
+    if (variants.empty()) {
+        return;
+    }
+
+    auto shadersDir = PBRUtil::pbrShadersDir();
+    auto vertexShader = shadersDir / "PrepVerticesForRenderingTexture.vert";
+    auto geometryShader = shadersDir / "PrepVerticesForLayeredRendering.geom";
+    std::string maxLayersDefine = "MAX_LAYERS_PER_DRAW " + std::to_string(layersPerDraw);
+
+    // Every roughness level of every variant's prefiltered map, one draw per level
+    ShaderProgram layeredPrefilterShader(vertexShader, geometryShader,
+                                         shadersDir / "ComputePreFilteredEnvironmentMap.frag",
+                                         {"LAYERED", "CUBEMAP_ARRAY", maxLayersDefine});
+    auto setPrefilterUniforms = [this, &layeredPrefilterShader, &variants](unsigned int mipmapLevel,
+                                                                          unsigned int firstLayer,
+                                                                          unsigned int layerCount) {
+        ShaderProgram& shader = layeredPrefilterShader;
+        shader.resetUniforms();
+        shader.setUniform("radianceMap", environmentMap->getLightingRadianceMap());
+        shader.setUniform("radianceMapFaceSize", (float) environmentMap->getRadianceMapFaceSize());
+        shader.setUniform("roughness", settings.roughnessForLevel(mipmapLevel));
+        shader.setUniform("sampleCount", settings.prefilterSampleCountForLevel(mipmapLevel));
+        setPerLayerCoefficients(shader, variants, firstLayer, layerCount);
     };
+    std::shared_ptr<Texture> prefilteredArray(new Texture(GL_TEXTURE_CUBE_MAP_ARRAY));
+    TexturePrecomputation::renderToLayers(prefilteredArray, layeredPrefilterShader, settings.lightingMapFormat(),
+                                          settings.prefilterFaceSize, settings.prefilterFaceSize,
+                                          settings.prefilterMipmapLevels, variants.size(), layersPerDraw,
+                                          setPrefilterUniforms);
+    layeredPrefilterShader.resetUniforms();
 
-    std::shared_ptr<Texture> texture(new Texture());
-    unsigned int width = 512, height = 512;
-    TexturePrecomputation::renderToTexture(texture, shaderProgram, width, height, prepareShaderUniforms);
-    return texture;
+    // Every variant's BRDF integration map in a single draw
+    ShaderProgram layeredBRDFIntegrationShader(vertexShader, geometryShader,
+                                               shadersDir / "ComputeBRDFIntegrationMap.frag",
+                                               {"LAYERED", maxLayersDefine});
+    auto setBRDFIntegrationUniforms = [this, &layeredBRDFIntegrationShader, &variants](unsigned int mipmapLevel,
+                                                                                      unsigned int firstLayer,
+                                                                                      unsigned int layerCount) {
+        ShaderProgram& shader = layeredBRDFIntegrationShader;
+        shader.resetUniforms();
+        shader.setUniform("sampleCount", settings.brdfIntegrationSampleCount);
+        setPerLayerCoefficients(shader, variants, firstLayer, layerCount);
+    };
+    std::shared_ptr<Texture> brdfIntegrationArray(new Texture(GL_TEXTURE_2D_ARRAY));
+    TexturePrecomputation::renderToLayers(brdfIntegrationArray, layeredBRDFIntegrationShader,
+                                          settings.brdfIntegrationMapFormat(),
+                                          settings.brdfIntegrationMapSize, settings.brdfIntegrationMapSize, 1,
+                                          variants.size(), layersPerDraw, setBRDFIntegrationUniforms);
+    layeredBRDFIntegrationShader.resetUniforms();
+
+    // Every object shares the same two textures, and picks its layer in the shader
+    prefilteredEnvironmentMaps.assign(getSceneObjectsList().size(), prefilteredArray);
+    brdfIntegrationMaps.assign(getSceneObjectsList().size(), brdfIntegrationArray);
+}
+
+void PhysicallyBasedScene::submitBackgroundBake(std::shared_ptr<Texture> coarseTexture,
+                                                std::function<std::shared_ptr<Texture>()> bake,
+                                                std::function<void(const std::shared_ptr<Texture>&)> onBaked)
+{
+    // The baker thread fills this in, and the main thread reads it once the GPU work is done
+    auto result = std::make_shared<std::shared_ptr<Texture>>();
+    std::weak_ptr finishedBakes = finishedBackgroundBakes;
+
+    backgroundBaker->submit(
+        [result, bake = std::move(bake)]() {
+            *result = bake();
+        },
+        [result, finishedBakes, coarseTexture = std::move(coarseTexture), onBaked = std::move(onBaked)]() {
+            onBaked(*result);
+            if (auto bakes = finishedBakes.lock()) {
+                bakes->emplace_back(coarseTexture, *result);
+            }
+        }
+    );
+
+    outstandingBackgroundBakes++;
+    totalBackgroundBakes++;
+}
+
+void PhysicallyBasedScene::swapInBackgroundBakes()
+{
+    for (const auto& [coarseTexture, fullTexture] : *finishedBackgroundBakes) {
+        std::replace(prefilteredEnvironmentMaps.begin(), prefilteredEnvironmentMaps.end(), coarseTexture, fullTexture);
+        std::replace(brdfIntegrationMaps.begin(), brdfIntegrationMaps.end(), coarseTexture, fullTexture);
+        outstandingBackgroundBakes--;
+    }
+    finishedBackgroundBakes->clear();
+}
+
+void PhysicallyBasedScene::notifyIfComplete()
+{
+    if (!isPrecomputationComplete()) {
+        return;
+    }
+
+    for (const auto& callback : completionCallbacks) {
+        callback();
+    }
+    completionCallbacks.clear();
+}
+
+void PhysicallyBasedScene::readRefinementTimings()
+{
+    for (auto& timing : refinementTimings) {
+        if (!timing.pending) {
+            continue;
+        }
+
+        // The timestamps are reached in order, so the first is ready if the second is
+        GLint available = 0;
+        glGetQueryObjectiv(timing.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+        GLuint64 startNanoseconds = 0;
+        GLuint64 endNanoseconds = 0;
+        glGetQueryObjectui64v(timing.queries[0], GL_QUERY_RESULT, &startNanoseconds);
+        glGetQueryObjectui64v(timing.queries[1], GL_QUERY_RESULT, &endNanoseconds);
+        timing.pending = false;
+
+        double jobMilliseconds = (double) (endNanoseconds - startNanoseconds) / 1e6 / (double) timing.jobsCount;
+        estimatedRefinementJobMilliseconds += refinementTimingWeight
+                                              * (jobMilliseconds - estimatedRefinementJobMilliseconds);
+    }
 }
 
 } // namespace PBR::physically_based
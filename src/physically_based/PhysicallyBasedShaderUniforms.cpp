@@ -1,59 +1,73 @@
 #include "physically_based/PhysicallyBasedShaderUniforms.h"
 
-#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <vector>
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
 namespace PBR::physically_based {
 
-void writeUniformsToShaderProgram(const PhysicallyBasedShaderUniforms& uniforms, ShaderProgram& shaderProgram)
+PhysicallyBasedObjectUniforms packObjectUniforms(const glm::mat4& modelMatrix, const glm::mat4& normalsRotationMatrix,
+                                                 const PhysicallyBasedMaterial& material, int lightingMapLayer)
 {
-    // The matrices for rendering
-    shaderProgram.setUniform("Model", uniforms.modelMatrix);
-    shaderProgram.setUniform("View", uniforms.viewMatrix);
-    shaderProgram.setUniform("Projection", uniforms.projectionMatrix);
-
-    // The matrix for rotating normals
-    shaderProgram.setUniform("NormalsRotation", uniforms.normalsRotationMatrix);
-
-    // The camera's position in world coordinates
-    shaderProgram.setUniform("cameraPosition", uniforms.cameraPosition);
-
-    // Material properties
-    shaderProgram.setUniform("material.albedo", uniforms.material.albedo);
-    shaderProgram.setUniform("material.roughness", uniforms.material.roughness);
-    shaderProgram.setUniform("material.metallic", uniforms.material.metallic);
-    shaderProgram.setUniform("material.F0", uniforms.material.F0);
-
-    // Direct lighting information
-    shaderProgram.setUniform("lightingInfo.lightPositions", uniforms.lightingInfo.lightPositions);
-    shaderProgram.setUniform("lightingInfo.lightColours", uniforms.lightingInfo.lightColours);
-    shaderProgram.setUniform("lightingInfo.intensities", uniforms.lightingInfo.intensities);
-
-    // BRDF component coefficient information
-    shaderProgram.setUniform("dCoefficients.k_TrowbridgeReitzGGX", uniforms.ndfCoefficients.k_TrowbridgeReitzGGX);
-    shaderProgram.setUniform("dCoefficients.k_Beckmann", uniforms.ndfCoefficients.k_Beckmann);
-    shaderProgram.setUniform("gCoefficients.k_SchlickGGX", uniforms.geometryCoefficients.k_SchlickGGX);
-    shaderProgram.setUniform("gCoefficients.k_CookTorrance", uniforms.geometryCoefficients.k_CookTorrance);
-
-    // Lighting maps
-    shaderProgram.setUniform("irradianceMap", uniforms.irradianceMap);
-    shaderProgram.setUniform("preFilteredEnvironmentMap", uniforms.preFilteredEnvironmentMap);
-    shaderProgram.setUniform("brdfIntegrationMap", uniforms.brdfIntegrationMap);
-
-    // The sun, if present
-    if (uniforms.sun) {
-        shaderProgram.setUniform("sunInfo.direction", uniforms.sun->direction);
-        shaderProgram.setUniform("sunInfo.colour", uniforms.sun->colour);
-        shaderProgram.setUniform("sunInfo.intensity", uniforms.sun->intensity);
+    PhysicallyBasedObjectUniforms uniforms{};
+    uniforms.modelMatrix = modelMatrix;
+    uniforms.normalsRotationMatrix = normalsRotationMatrix;
+    uniforms.albedo = material.albedo;
+    uniforms.roughness = material.roughness;
+    uniforms.metallic = material.metallic;
+    uniforms.F0 = material.F0;
+    uniforms.k_TrowbridgeReitzGGX = material.brdfCoefficients.normalDistribution.k_TrowbridgeReitzGGX;
+    uniforms.k_Beckmann = material.brdfCoefficients.normalDistribution.k_Beckmann;
+    uniforms.k_SchlickGGX = material.brdfCoefficients.geometricAttenutation.k_SchlickGGX;
+    uniforms.k_CookTorrance = material.brdfCoefficients.geometricAttenutation.k_CookTorrance;
+    uniforms.lightingMapLayer = lightingMapLayer;
+    return uniforms;
+}
+
+PhysicallyBasedCameraUniforms packCameraUniforms(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix,
+                                                 const glm::vec3& cameraPosition)
+{
+    PhysicallyBasedCameraUniforms uniforms{};
+    uniforms.viewMatrix = viewMatrix;
+    uniforms.projectionMatrix = projectionMatrix;
+    uniforms.cameraPosition = cameraPosition;
+    return uniforms;
+}
+
+PhysicallyBasedLightingUniforms packLightingUniforms(const std::vector<glm::vec3>& lightPositions,
+                                                     const std::vector<glm::vec3>& lightColours,
+                                                     const std::vector<float>& lightIntensities,
+                                                     const std::optional<DirectedLightSource>& sun,
+                                                     float preFilteredEnvironmentMapMaxLod)
+{
+    // Zero-initialise so that the unused lights contribute nothing
+    PhysicallyBasedLightingUniforms uniforms{};
+
+    size_t lightsCount = std::min(lightPositions.size(), maxPointLights);
+    for (size_t i = 0; i < lightsCount; i++) {
+        uniforms.lightPositions[i] = glm::vec4(lightPositions[i], 1.0f);
+        uniforms.lightColours[i] = glm::vec4(lightColours[i], 1.0f);
+        uniforms.lightIntensities[i].x = lightIntensities[i];
+    }
+
+    if (sun) {
+        uniforms.sunDirection = sun->direction;
+        uniforms.sunColour = sun->colour;
+        uniforms.sunIntensity = sun->intensity;
     }
     else {
-        // We have to send something anyway to avoid undefined behaviour
-        shaderProgram.setUniform("sunInfo.direction", glm::vec3(1.0f, 0.0f, 0.0f));
-        shaderProgram.setUniform("sunInfo.colour", glm::vec3(1.0f));
-        shaderProgram.setUniform("sunInfo.intensity", 0.0f);
+        uniforms.sunDirection = glm::vec3(1.0f, 0.0f, 0.0f);
+        uniforms.sunColour = glm::vec3(1.0f);
+        uniforms.sunIntensity = 0.0f;
     }
+
+    uniforms.preFilteredEnvironmentMapMaxLod = preFilteredEnvironmentMapMaxLod;
+    return uniforms;
 }
 
 } // namespace PBR::physically_based
@@ -0,0 +1,93 @@
+#include "physically_based/PrecomputationSettings.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <GL/glew.h>
+
+namespace {
+
+// The sample counts for the coarse first pass of progressive precomputation
+constexpr int coarsePrefilterSampleCount = 16;
+constexpr int coarseMinimumPrefilterSampleCount = 4;
+constexpr int coarseBRDFIntegrationSampleCount = 32;
+
+} // anonymous namespace
+
+namespace PBR::physically_based {
+
+PrecomputationSettings PrecomputationSettings::forQuality(PrecomputationQuality quality)
+{
+    PrecomputationSettings settings;
+    switch (quality) {
+    case PrecomputationQuality::Preview:
+        settings.irradianceMapFaceSize = 8;
+        settings.irradianceSampleRings = 10;
+        settings.prefilterFaceSize = 64;
+        settings.prefilterSampleCount = 64;
+        settings.minimumPrefilterSampleCount = 8;
+        settings.brdfIntegrationMapSize = 64;
+        settings.brdfIntegrationSampleCount = 64;
+        break;
+    case PrecomputationQuality::Interactive:
+        break;
+    case PrecomputationQuality::Final:
+        settings.irradianceMapFaceSize = 32;
+        settings.irradianceSampleRings = 60;
+        settings.prefilterFaceSize = 256;
+        settings.prefilterMipmapLevels = 6;
+        settings.prefilterSampleCount = 1024;
+        settings.minimumPrefilterSampleCount = 64;
+        settings.compactLightingMaps = false;
+        settings.brdfIntegrationMapSize = 256;
+        settings.brdfIntegrationSampleCount = 1024;
+        break;
+    }
+    return settings;
+}
+
+unsigned int PrecomputationSettings::lightingMapFormat() const
+{
+    return compactLightingMaps ? GL_R11F_G11F_B10F : GL_RGB16F;
+}
+
+unsigned int PrecomputationSettings::brdfIntegrationMapFormat() const
+{
+    return GL_RG16F;
+}
+
+float PrecomputationSettings::roughnessForLevel(unsigned int mipmapLevel) const
+{
+    if (prefilterMipmapLevels <= 1) {
+        return 0.0f;
+    }
+    return (float) mipmapLevel / (float) (prefilterMipmapLevels - 1);
+}
+
+int PrecomputationSettings::prefilterSampleCountForLevel(unsigned int mipmapLevel) const
+{
+    float roughness = roughnessForLevel(mipmapLevel);
+    int sampleCount = (int) std::ceil((float) prefilterSampleCount * roughness * roughness);
+    return std::clamp(sampleCount, std::min(minimumPrefilterSampleCount, prefilterSampleCount), prefilterSampleCount);
+}
+
+PrecomputationSettings PrecomputationSettings::coarse() const
+{
+    PrecomputationSettings settings = *this;
+    settings.prefilterSampleCount = std::min(prefilterSampleCount, coarsePrefilterSampleCount);
+    settings.minimumPrefilterSampleCount = std::min(minimumPrefilterSampleCount, coarseMinimumPrefilterSampleCount);
+    settings.brdfIntegrationSampleCount = std::min(brdfIntegrationSampleCount, coarseBRDFIntegrationSampleCount);
+    return settings;
+}
+
+PrecomputationSettings PrecomputationSettings::reference() const
+{
+    PrecomputationSettings settings = *this;
+    settings.prefilterSampleCount = referenceSampleCount;
+    settings.minimumPrefilterSampleCount = referenceSampleCount;
+    settings.brdfIntegrationSampleCount = referenceSampleCount;
+    settings.compactLightingMaps = false;
+    return settings;
+}
+
+} // namespace PBR::physically_based
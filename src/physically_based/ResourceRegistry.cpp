@@ -0,0 +1,274 @@
+#include "physically_based/ResourceRegistry.h"
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include <boost/functional/hash.hpp>
+
+#include "core/DirectedLightSource.h"
+#include "core/Texture.h"
+#include "physically_based/BRDFCoefficients.h"
+#include "physically_based/EnvironmentMap.h"
+#include "physically_based/PrecomputationSettings.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/**
+ * Shared by every thread, like the registry itself.
+ */
+std::atomic<bool> sharingEnabled(true);
+
+/**
+ * Removes the entries of a map whose resources have expired.
+ */
+template<typename Map, typename IsExpired>
+void eraseExpired(Map& map, IsExpired isExpired)
+{
+    for (auto it = map.begin(); it != map.end();) {
+        if (isExpired(it->second)) {
+            it = map.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+} // anonymous namespace
+
+namespace PBR::physically_based {
+
+bool EnvironmentMapKey::operator==(const EnvironmentMapKey& other) const
+{
+    bool sameSun = sun.has_value() == other.sun.has_value()
+                   && (!sun || (sun->direction == other.sun->direction && sun->colour == other.sun->colour
+                                && sun->intensity == other.sun->intensity));
+    return path == other.path && sameSun && irradianceMode == other.irradianceMode
+           && extractSun == other.extractSun && sunThresholdRatio == other.sunThresholdRatio
+           && irradianceMapFaceSize == other.irradianceMapFaceSize
+           && irradianceSampleRings == other.irradianceSampleRings && lightingMapFormat == other.lightingMapFormat;
+}
+
+bool PrefilteredEnvironmentMapKey::operator==(const PrefilteredEnvironmentMapKey& other) const
+{
+    return environmentMap == other.environmentMap && environmentMapVersion == other.environmentMapVersion
+           && brdfCoefficients == other.brdfCoefficients && faceSize == other.faceSize
+           && mipmapLevels == other.mipmapLevels && sampleCount == other.sampleCount
+           && minimumSampleCount == other.minimumSampleCount && internalFormat == other.internalFormat;
+}
+
+bool BRDFIntegrationMapKey::operator==(const BRDFIntegrationMapKey& other) const
+{
+    return brdfCoefficients == other.brdfCoefficients && size == other.size && sampleCount == other.sampleCount;
+}
+
+size_t EnvironmentMapKeyHasher::operator()(const EnvironmentMapKey& key) const
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, boost::hash_value(key.path));
+    if (key.sun) {
+        boost::hash_combine(seed, boost::hash_value(key.sun->direction.x));
+        boost::hash_combine(seed, boost::hash_value(key.sun->direction.y));
+        boost::hash_combine(seed, boost::hash_value(key.sun->direction.z));
+        boost::hash_combine(seed, boost::hash_value(key.sun->intensity));
+    }
+    boost::hash_combine(seed, boost::hash_value((int) key.irradianceMode));
+    boost::hash_combine(seed, boost::hash_value(key.extractSun));
+    boost::hash_combine(seed, boost::hash_value(key.irradianceMapFaceSize));
+    boost::hash_combine(seed, boost::hash_value(key.irradianceSampleRings));
+    boost::hash_combine(seed, boost::hash_value(key.lightingMapFormat));
+    return seed;
+}
+
+size_t PrefilteredEnvironmentMapKeyHasher::operator()(const PrefilteredEnvironmentMapKey& key) const
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, boost::hash_value(key.environmentMap));
+    boost::hash_combine(seed, boost::hash_value(key.environmentMapVersion));
+    boost::hash_combine(seed, BRDFCoefficientsHasher()(key.brdfCoefficients));
+    boost::hash_combine(seed, boost::hash_value(key.faceSize));
+    boost::hash_combine(seed, boost::hash_value(key.mipmapLevels));
+    boost::hash_combine(seed, boost::hash_value(key.sampleCount));
+    boost::hash_combine(seed, boost::hash_value(key.minimumSampleCount));
+    boost::hash_combine(seed, boost::hash_value(key.internalFormat));
+    return seed;
+}
+
+size_t BRDFIntegrationMapKeyHasher::operator()(const BRDFIntegrationMapKey& key) const
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, BRDFCoefficientsHasher()(key.brdfCoefficients));
+    boost::hash_combine(seed, boost::hash_value(key.size));
+    boost::hash_combine(seed, boost::hash_value(key.sampleCount));
+    return seed;
+}
+
+namespace {
+
+PrefilteredEnvironmentMapKey makePrefilteredKey(const std::shared_ptr<EnvironmentMap>& environmentMap,
+                                                const BRDFCoefficients& brdfCoefficients,
+                                                const PrecomputationSettings& settings)
+{
+    return PrefilteredEnvironmentMapKey{environmentMap.get(), environmentMap->getVersion(), brdfCoefficients,
+                                        settings.prefilterFaceSize, settings.prefilterMipmapLevels,
+                                        settings.prefilterSampleCount, settings.minimumPrefilterSampleCount,
+                                        settings.lightingMapFormat()};
+}
+
+BRDFIntegrationMapKey makeBRDFIntegrationKey(const BRDFCoefficients& brdfCoefficients,
+                                             const PrecomputationSettings& settings)
+{
+    return BRDFIntegrationMapKey{brdfCoefficients, settings.brdfIntegrationMapSize,
+                                 settings.brdfIntegrationSampleCount};
+}
+
+} // anonymous namespace
+
+ResourceRegistry::ResourceRegistry()
+        :registryMutex(),
+         environmentMaps(),
+         prefilteredEnvironmentMaps(),
+         brdfIntegrationMaps()
+{
+}
+
+ResourceRegistry& ResourceRegistry::shared()
+{
+    static ResourceRegistry registry;
+    return registry;
+}
+
+void ResourceRegistry::setEnabled(bool enabled)
+{
+    sharingEnabled = enabled;
+}
+
+bool ResourceRegistry::isEnabled()
+{
+    return sharingEnabled;
+}
+
+std::shared_ptr<EnvironmentMap> ResourceRegistry::environmentMap(const fs::path& texturePath,
+                                                                 std::optional<DirectedLightSource> sun,
+                                                                 IrradianceMode irradianceMode,
+                                                                 const PrecomputationSettings& settings)
+{
+    if (!isEnabled()) {
+        return std::make_shared<EnvironmentMap>(texturePath, sun, irradianceMode, settings);
+    }
+
+    std::error_code error;
+    fs::path canonicalPath = fs::weakly_canonical(texturePath, error);
+    EnvironmentMapKey key{(error ? texturePath : canonicalPath).string(), sun, irradianceMode, settings.extractSun,
+                          settings.sunThresholdRatio, settings.irradianceMapFaceSize, settings.irradianceSampleRings,
+                          settings.lightingMapFormat()};
+    {
+        std::lock_guard lock(registryMutex);
+        auto it = environmentMaps.find(key);
+        if (it != environmentMaps.end()) {
+            if (auto existing = it->second.lock()) {
+                return existing;
+            }
+        }
+    }
+
+    // Loading takes a while, so don't hold up other threads in the meantime
+    auto loaded = std::make_shared<EnvironmentMap>(texturePath, sun, irradianceMode, settings);
+
+    std::lock_guard lock(registryMutex);
+    evictExpiredLocked();
+    auto& entry = environmentMaps[key];
+    if (auto existing = entry.lock()) {
+        return existing;
+    }
+    entry = loaded;
+    return loaded;
+}
+
+std::shared_ptr<Texture> ResourceRegistry::findPrefilteredEnvironmentMap(
+        const std::shared_ptr<EnvironmentMap>& environmentMap, const BRDFCoefficients& brdfCoefficients,
+        const PrecomputationSettings& settings)
+{
+    if (!isEnabled()) {
+        return nullptr;
+    }
+
+    std::lock_guard lock(registryMutex);
+    auto it = prefilteredEnvironmentMaps.find(makePrefilteredKey(environmentMap, brdfCoefficients, settings));
+    if (it == prefilteredEnvironmentMaps.end() || it->second.environmentMap.lock() != environmentMap) {
+        return nullptr;
+    }
+    return it->second.texture.lock();
+}
+
+void ResourceRegistry::addPrefilteredEnvironmentMap(const std::shared_ptr<EnvironmentMap>& environmentMap,
+                                                    const BRDFCoefficients& brdfCoefficients,
+                                                    const PrecomputationSettings& settings,
+                                                    const std::shared_ptr<Texture>& texture)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    std::lock_guard lock(registryMutex);
+    evictExpiredLocked();
+    prefilteredEnvironmentMaps[makePrefilteredKey(environmentMap, brdfCoefficients, settings)]
+            = PrefilteredEnvironmentMapEntry{environmentMap, texture};
+}
+
+std::shared_ptr<Texture> ResourceRegistry::findBRDFIntegrationMap(const BRDFCoefficients& brdfCoefficients,
+                                                                  const PrecomputationSettings& settings)
+{
+    if (!isEnabled()) {
+        return nullptr;
+    }
+
+    std::lock_guard lock(registryMutex);
+    auto it = brdfIntegrationMaps.find(makeBRDFIntegrationKey(brdfCoefficients, settings));
+    if (it == brdfIntegrationMaps.end()) {
+        return nullptr;
+    }
+    return it->second.lock();
+}
+
+void ResourceRegistry::addBRDFIntegrationMap(const BRDFCoefficients& brdfCoefficients,
+                                             const PrecomputationSettings& settings,
+                                             const std::shared_ptr<Texture>& texture)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    std::lock_guard lock(registryMutex);
+    evictExpiredLocked();
+    brdfIntegrationMaps[makeBRDFIntegrationKey(brdfCoefficients, settings)] = texture;
+}
+
+void ResourceRegistry::evictExpired()
+{
+    std::lock_guard lock(registryMutex);
+    evictExpiredLocked();
+}
+
+size_t ResourceRegistry::size()
+{
+    std::lock_guard lock(registryMutex);
+    return environmentMaps.size() + prefilteredEnvironmentMaps.size() + brdfIntegrationMaps.size();
+}
+
+void ResourceRegistry::evictExpiredLocked()
+{
+    eraseExpired(environmentMaps, [](const auto& environmentMap) { return environmentMap.expired(); });
+    eraseExpired(prefilteredEnvironmentMaps, [](const auto& entry) {
+        return entry.environmentMap.expired() || entry.texture.expired();
+    });
+    eraseExpired(brdfIntegrationMaps, [](const auto& texture) { return texture.expired(); });
+}
+
+} // namespace PBR::physically_based
@@ -0,0 +1,201 @@
+#include "physically_based/SphericalHarmonics.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "core/Texture.h"
+#include "core/ThreadPool.h"
+
+namespace PBR::physically_based {
+
+namespace {
+
+/**
+ * The largest face size that we read back for the projection. Band 2 harmonics
+ * are very smooth, so a small mipmap level loses nothing visible.
+ */
+constexpr unsigned int maxProjectionFaceSize = 64;
+
+// Normalisation constants of the real spherical harmonic basis functions
+constexpr float Y00 = 0.282095f;
+constexpr float Y1 = 0.488603f;
+constexpr float Y2 = 1.092548f;
+constexpr float Y20 = 0.315392f;
+constexpr float Y22 = 0.546274f;
+
+/**
+ * Maps a position on a cubemap face to the direction that OpenGL associates
+ * with it, matching the cubemapFaceDirection() that ShaderProgram adds to the
+ * shaders. The result is not normalised.
+ */
+glm::vec3 cubemapFaceDirection(unsigned int face, float a, float b)
+{
+    switch (face) {
+    case 0: return glm::vec3(1.0f, -b, -a);
+    case 1: return glm::vec3(-1.0f, -b, a);
+    case 2: return glm::vec3(a, 1.0f, b);
+    case 3: return glm::vec3(a, -1.0f, -b);
+    case 4: return glm::vec3(a, -b, 1.0f);
+    default: return glm::vec3(-a, -b, -1.0f);
+    }
+}
+
+/**
+ * The weighted sums for one row of one face, kept separate so that they can be
+ * reduced in a fixed order regardless of how the rows were scheduled.
+ */
+struct RowSum {
+    std::array<float, 9> r{};
+    std::array<float, 9> g{};
+    std::array<float, 9> b{};
+    float weight = 0.0f;
+};
+
+/**
+ * Projects one row of texels.
+ *
+ * The basis functions and weights are first evaluated for the whole row into
+ * flat arrays, so that the accumulation loops are simple multiply-adds over
+ * contiguous floats that the compiler can vectorise.
+ */
+RowSum projectRow(const float* texels, unsigned int face, unsigned int y, unsigned int size)
+{
+    std::vector<float> basis(9 * size);
+    std::vector<float> weights(size);
+    std::vector<float> red(size), green(size), blue(size);
+
+    float b = 2.0f * ((float) y + 0.5f) / (float) size - 1.0f;
+    for (unsigned int x = 0; x < size; x++) {
+        float a = 2.0f * ((float) x + 0.5f) / (float) size - 1.0f;
+
+        // The solid angle subtended by a texel shrinks towards the edges of a face
+        float lengthSquared = 1.0f + a * a + b * b;
+        float weight = 1.0f / (lengthSquared * std::sqrt(lengthSquared));
+
+        glm::vec3 d = cubemapFaceDirection(face, a, b) / std::sqrt(lengthSquared);
+        basis[0 * size + x] = Y00;
+        basis[1 * size + x] = Y1 * d.y;
+        basis[2 * size + x] = Y1 * d.z;
+        basis[3 * size + x] = Y1 * d.x;
+        basis[4 * size + x] = Y2 * d.x * d.y;
+        basis[5 * size + x] = Y2 * d.y * d.z;
+        basis[6 * size + x] = Y20 * (3.0f * d.z * d.z - 1.0f);
+        basis[7 * size + x] = Y2 * d.x * d.z;
+        basis[8 * size + x] = Y22 * (d.x * d.x - d.y * d.y);
+
+        weights[x] = weight;
+        red[x] = texels[3 * x + 0] * weight;
+        green[x] = texels[3 * x + 1] * weight;
+        blue[x] = texels[3 * x + 2] * weight;
+    }
+
+    RowSum sum;
+    for (unsigned int i = 0; i < 9; i++) {
+        const float* basisRow = &basis[i * size];
+        float r = 0.0f, g = 0.0f, bl = 0.0f;
+        for (unsigned int x = 0; x < size; x++) {
+            r += basisRow[x] * red[x];
+            g += basisRow[x] * green[x];
+            bl += basisRow[x] * blue[x];
+        }
+        sum.r[i] = r;
+        sum.g[i] = g;
+        sum.b[i] = bl;
+    }
+    for (unsigned int x = 0; x < size; x++) {
+        sum.weight += weights[x];
+    }
+
+    return sum;
+}
+
+} // anonymous namespace
+
+SphericalHarmonicsL2 SphericalHarmonicsL2::projectCubemap(const std::shared_ptr<Texture>& cubemap,
+                                                          unsigned int faceSize, ThreadPool& threadPool)
+{
+    // Pick the first mipmap level that is small enough
+    unsigned int level = 0;
+    unsigned int size = faceSize;
+    while (size > maxProjectionFaceSize) {
+        size = std::max(size / 2, 1u);
+        level++;
+    }
+
+    // Read back that level of each face
+    std::vector<float> texels(6 * size * size * 3);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap->id());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (unsigned int face = 0; face < 6; face++) {
+        glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_FLOAT,
+                      &texels[face * size * size * 3]);
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    // Project each row in parallel
+    std::vector<RowSum> rowSums(6 * size);
+    threadPool.parallelFor(rowSums.size(), [&](size_t row) {
+        unsigned int face = row / size;
+        unsigned int y = row % size;
+        const float* rowTexels = &texels[(face * size + y) * size * 3];
+        rowSums[row] = projectRow(rowTexels, face, y, size);
+    });
+
+    // Add up the rows. The weights should sum to the area of the sphere, so we
+    // normalise by that to cancel out the discretisation error.
+    SphericalHarmonicsL2 result{};
+    float totalWeight = 0.0f;
+    for (const auto& rowSum : rowSums) {
+        for (unsigned int i = 0; i < 9; i++) {
+            result.coefficients[i] += glm::vec3(rowSum.r[i], rowSum.g[i], rowSum.b[i]);
+        }
+        totalWeight += rowSum.weight;
+    }
+    float normalisation = 4.0f * glm::pi<float>() / totalWeight;
+    for (auto& coefficient : result.coefficients) {
+        coefficient *= normalisation;
+    }
+
+    return result;
+}
+
+SphericalHarmonicsL2 SphericalHarmonicsL2::convolveWithCosineLobe() const
+{
+    // The convolution scales each band by a constant A_l. ComputeIrradianceMap.frag
+    // computes half of the true irradiance, so we do the same here.
+    constexpr float pi = glm::pi<float>();
+    constexpr float scale = 0.5f;
+    constexpr std::array<float, 3> bandScales = {scale * pi, scale * 2.0f * pi / 3.0f, scale * pi / 4.0f};
+
+    SphericalHarmonicsL2 result{};
+    result.coefficients[0] = coefficients[0] * bandScales[0];
+    for (unsigned int i = 1; i < 4; i++) {
+        result.coefficients[i] = coefficients[i] * bandScales[1];
+    }
+    for (unsigned int i = 4; i < 9; i++) {
+        result.coefficients[i] = coefficients[i] * bandScales[2];
+    }
+    return result;
+}
+
+std::array<glm::vec4, 9> SphericalHarmonicsL2::toShaderCoefficients() const
+{
+    constexpr std::array<float, 9> basisConstants = {Y00, Y1, Y1, Y1, Y2, Y2, Y20, Y2, Y22};
+
+    std::array<glm::vec4, 9> result;
+    for (unsigned int i = 0; i < 9; i++) {
+        result[i] = glm::vec4(coefficients[i] * basisConstants[i], 0.0f);
+    }
+    return result;
+}
+
+} // namespace PBR::physically_based
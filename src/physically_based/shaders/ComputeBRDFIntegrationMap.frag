@@ -14,8 +14,21 @@ struct GeometricAttenuationFunctionCoefficients {
 
 in vec2 TexCoords;
 
+#ifdef LAYERED
+// Each layer of the draw is a different BRDF variant. MAX_LAYERS_PER_DRAW is
+// defined by the program. See PrepVerticesForLayeredRendering.geom.
+flat in int layerInDraw;
+uniform NormalDistributionFunctionCoefficients dCoefficientsPerLayer[MAX_LAYERS_PER_DRAW];
+uniform GeometricAttenuationFunctionCoefficients gCoefficientsPerLayer[MAX_LAYERS_PER_DRAW];
+#define dCoefficients dCoefficientsPerLayer[layerInDraw]
+#define gCoefficients gCoefficientsPerLayer[layerInDraw]
+#else
 uniform NormalDistributionFunctionCoefficients dCoefficients;
 uniform GeometricAttenuationFunctionCoefficients gCoefficients;
+#endif
+
+// Number of samples to use
+uniform int sampleCount;
 
 out vec4 FragColour;
 
@@ -23,9 +36,6 @@ out vec4 FragColour;
 #define PI 3.1415926535
 #define EPSILON 0.000001
 
-// Number of samples to use
-#define N 512
-
 
 // ----- NORMAL DISTRIBUTION FUNCTION ---------------------------------------------------
 
@@ -216,11 +226,11 @@ void main()
 
     float totalProbability = 0;
 
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < sampleCount; i++) {
 
         // Use Hammersley point set to generate a "random" uv coordinate where
         // each of u and v are uniformly distributed in [0,1]
-        vec2 uv = hammersley2D(i, N);
+        vec2 uv = hammersley2D(i, sampleCount);
 
         // Now map that to a halfway vector h using GGX imporance sampling,
         // so regions with a high GGX probability density value are more likely
@@ -253,5 +263,5 @@ void main()
         bias += commonPart * schlickPart;
     }
 
-    FragColour = vec4(scale/N, bias/N, 0.0, 1.0);
+    FragColour = vec4(scale/sampleCount, bias/sampleCount, 0.0, 1.0);
 }
@@ -2,71 +2,32 @@
 
 in vec2 TexCoords;
 
-uniform sampler2D radianceMap;
-
-out vec4 FragColour;
-
-
-#define PI 3.1415926535
+uniform samplerCube radianceMap;
+uniform int cubemapFace;
 
 // Number of alpha values to choose
-#define N_ALPHA 30
-
-
-/**
- * Maps from texture coordinates to spherical coordinates.
- */
-vec2 uvToSpherical(vec2 uv)
-{
-    float u = uv.x;
-    float v = uv.y;
-
-    float phi = (2.0 * u - 1.0) * PI;
-    float theta = (0.5 - v) * PI;
+uniform int sampleRings;
 
-    return vec2(phi, theta);
-}
+out vec4 FragColour;
 
-/**
- * Maps from spherical coordinates to texture coordinates.
- */
-vec2 sphericalToUV(vec2 phiTheta)
-{
-    float phi = mod(phiTheta.x + PI, 2*PI) - PI;
-    float theta = mod(phiTheta.y + PI, 2*PI) - PI;
 
-    float u = (phi + PI) / (2.0 * PI);
-    float v = 0.5 - theta / PI;
+#define PI 3.1415926535
 
-    return vec2(u, v);
-}
+// cubemapFaceDirection() is added to this shader by ShaderProgram.
 
-/**
- * Samples the texture using spherical coordinates.
- */
-vec4 sampleTextureSpherical(vec2 spherical)
-{
-    vec2 uv = sphericalToUV(spherical);
-    return texture(radianceMap, uv);
-}
 
 void main()
 {
-    // Map this texture coordinate into spherical coordinates
-    vec2 phiThetaCentral = uvToSpherical(TexCoords);
-    float phi = phiThetaCentral.x;
-    float theta = phiThetaCentral.y;
+    // Map this texel to the direction that it represents
+    vec3 n = cubemapFaceDirection(cubemapFace, TexCoords);
 
     /*
-     * Explanation: we're in spherical coordinates, and we need a way to loop
-     * over/sample from the hemisphere centred around our current position.
-     * Simply doing phi += pi, theta += pi/2 will NOT work! (Think about what
-     * that looks like near a pole...)
+     * Explanation: we need a way to loop over/sample from the hemisphere
+     * centred around our current direction.
      *
-     * What I'm doing here is extracting the localised basis vectors - these are
-     * the directions that you would move in if you were to increment phi, theta
-     * and r each by some small value respectively. e_phi and e_theta are tangents
-     * to the unit sphere, while e_r is the normal.
+     * What I'm doing here is building a localised set of basis vectors around
+     * the direction. e_phi and e_theta are tangents to the unit sphere, while
+     * e_r is the normal.
      *
      * Then, I sample UNIFORMLY from the hemisphere by first varying an angle
      * alpha from 0 to pi/2 -- this is the angle away from e_r -- then, in the inner
@@ -83,19 +44,20 @@ void main()
      * I also invented this method myself, sadly unlike cosinal importance sampling!)
      */
 
-    // Compute the basis vectors e_phi, e_theta, e_r in Cartesian coordinates.
-    // Derivation: write the expression for mapping from spherical polar to Cartesian
-    // coordinates then differentiate wrt phi, theta and r respectively
-    vec3 e_phi = normalize(vec3(cos(phi)*cos(theta), 0, sin(phi)*cos(theta)));
-    vec3 e_theta = vec3(-sin(phi)*sin(theta), cos(theta), cos(phi)*sin(theta));
-    vec3 e_r = vec3(sin(phi)*cos(theta), sin(theta), -cos(phi)*cos(theta));
+    // Compute the basis vectors e_phi, e_theta, e_r in Cartesian coordinates. Any
+    // tangent will do since we sweep all the way around e_r, but we have to avoid
+    // taking the cross product of parallel vectors at the poles.
+    vec3 up = abs(n.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 e_phi = normalize(cross(up, n));
+    vec3 e_theta = cross(n, e_phi);
+    vec3 e_r = n;
 
     // Compute the integral
     vec4 result = vec4(0.0);
-    for (int i = 0; i < N_ALPHA; i++) {
+    for (int i = 0; i < sampleRings; i++) {
 
         // Alpha is the angle between the normal and the point we're currently sampling
-        float alpha = float(i)/(N_ALPHA-1) * PI / 2.0;
+        float alpha = float(i)/(sampleRings-1) * PI / 2.0;
 
         // Setting J = 4*i would be "fairer" here, but then you don't get a single sample
         // at the pole, which is the strongest contributor of all. It's a trade-off.
@@ -113,16 +75,8 @@ void main()
             // in Cartesian coordinates.
             vec3 sampleCartesian = cos(alpha)*e_r + sin(alpha)*on_ePhi_eTheta_circle;
 
-            // Convert this sample point's coordinates back to spherical polar. It is
-            // already guaranteed to be a unit vector because it's on the unit sphere,
-            // so we don't need an r coordinate.
-            float r_xzPlane = sqrt(sampleCartesian.x*sampleCartesian.x + sampleCartesian.z*sampleCartesian.z);
-            float samplePhi = atan(sampleCartesian.x, -sampleCartesian.z);
-            float sampleTheta = atan(sampleCartesian.y, r_xzPlane);
-            vec2 samplePolar = vec2(samplePhi, sampleTheta);
-
-            // Sample the texture
-            vec4 thisSample = sampleTextureSpherical(samplePolar);
+            // Sample the cubemap directly in that direction
+            vec4 thisSample = texture(radianceMap, sampleCartesian);
 
             // Add to the accumulator
             result += thisSample * cos(alpha);
@@ -130,6 +84,6 @@ void main()
     }
 
     // Compensate for the number of samples collected
-    int numSamples = N_ALPHA * (2*N_ALPHA - 1);  // arithmetic series :) (1 + 5 + 9 + ...)
+    int numSamples = sampleRings * (2*sampleRings - 1);  // arithmetic series :) (1 + 5 + 9 + ...)
     FragColour = PI * result * (1.0 / numSamples);
 }
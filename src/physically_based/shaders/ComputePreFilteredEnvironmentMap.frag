@@ -14,10 +14,28 @@ struct GeometricAttenuationFunctionCoefficients {
 
 in vec2 TexCoords;
 
-uniform sampler2D radianceMap;
+uniform samplerCube radianceMap;
+uniform float radianceMapFaceSize;
 uniform float roughness;
+
+#ifdef LAYERED
+// Each layer of the draw is a different BRDF variant. MAX_LAYERS_PER_DRAW is
+// defined by the program. See PrepVerticesForLayeredRendering.geom.
+flat in int layerInDraw;
+flat in int cubemapFaceInLayer;
+uniform NormalDistributionFunctionCoefficients dCoefficientsPerLayer[MAX_LAYERS_PER_DRAW];
+uniform GeometricAttenuationFunctionCoefficients gCoefficientsPerLayer[MAX_LAYERS_PER_DRAW];
+#define dCoefficients dCoefficientsPerLayer[layerInDraw]
+#define gCoefficients gCoefficientsPerLayer[layerInDraw]
+#define cubemapFace cubemapFaceInLayer
+#else
+uniform int cubemapFace;
 uniform NormalDistributionFunctionCoefficients dCoefficients;
 uniform GeometricAttenuationFunctionCoefficients gCoefficients;
+#endif
+
+// Number of samples to use
+uniform int sampleCount;
 
 out vec4 FragColour;
 
@@ -25,59 +43,10 @@ out vec4 FragColour;
 #define PI 3.1415926535
 #define EPSILON 0.000001
 
-// Number of alpha values to choose
-#define N 256
-
 
 // ----- COORDINATE TRANSFORMS ----------------------------------------------------------
 
-/**
- * Maps from Cartesian coordinates to spherical coordinates
- */
-vec2 cartesianToSpherical(vec3 cartesian)
-{
-    float r = sqrt(cartesian.x * cartesian.x + cartesian.z * cartesian.z);
-    float phi = atan(cartesian.x, -cartesian.z);
-    float theta = atan(cartesian.y, r);
-    return vec2(phi, theta);
-}
-
-/**
- * Maps from texture coordinates to spherical coordinates.
- */
-vec2 uvToSpherical(vec2 uv)
-{
-    float u = uv.x;
-    float v = uv.y;
-
-    float phi = (2.0 * u - 1.0) * PI;
-    float theta = (0.5 - v) * PI;
-
-    return vec2(phi, theta);
-}
-
-/**
- * Maps from spherical coordinates to texture coordinates.
- */
-vec2 sphericalToUV(vec2 phiTheta)
-{
-    float phi = mod(phiTheta.x + PI, 2*PI) - PI;
-    float theta = mod(phiTheta.y + PI, 2*PI) - PI;
-
-    float u = (phi + PI) / (2.0 * PI);
-    float v = 0.5 - theta / PI;
-
-    return vec2(u, v);
-}
-
-/**
- * Samples the texture using spherical coordinates.
- */
-vec4 sampleTextureSpherical(vec2 spherical, float lod)
-{
-    vec2 uv = sphericalToUV(spherical);
-    return textureLod(radianceMap, uv, lod);
-}
+// cubemapFaceDirection() is added to this shader by ShaderProgram.
 
 // ----- IMPORTANCE SAMPLING ------------------------------------------------------------
 
@@ -242,16 +211,13 @@ void main()
     // sampling algorithm goes funky!)
     float roughnessCorrected = max(roughness, 0.001);
 
-    // Map this texture coordinate into spherical coordinates
-    vec2 phiTheta = uvToSpherical(TexCoords);
-    float phi = phiTheta.x;
-    float theta = phiTheta.y;
+    // Map this texel to the direction that it represents
+    vec3 n = cubemapFaceDirection(cubemapFace, TexCoords);
 
-    // These are the basis vectors e_phi, e_theta and e_r in Cartesian coordinates.
-    // See ComputeIrradianceMap.frag for an explanation.
-    vec3 n = vec3(sin(phi)*cos(theta), sin(theta), -cos(phi)*cos(theta));
-    vec3 tangent = normalize(vec3(cos(phi)*cos(theta), 0, sin(phi)*cos(theta)));
-    vec3 bitangent = vec3(-sin(phi)*sin(theta), cos(theta), cos(phi)*sin(theta));
+    // Build a tangent space basis around it. See ComputeIrradianceMap.frag for an explanation.
+    vec3 up = abs(n.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, n));
+    vec3 bitangent = cross(n, tangent);
 
     // We have to assume that we're viewing the thing from directly overhead. (Epic Games paper)
     vec3 wo = n;
@@ -259,11 +225,11 @@ void main()
     // Approximate the integral using GGX importance sampling
     vec4 result = vec4(0.0);
     float totalWeight = 0.0;
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < sampleCount; i++) {
 
         // Use Hammersley point set to generate a "random" uv coordinate where
         // each of u and v are uniformly distributed in [0,1]
-        vec2 uv = hammersley2D(i, N);
+        vec2 uv = hammersley2D(i, sampleCount);
 
         // Now map that to a halfway vector h in tangent space, spherical coordinates, using
         // GGX imporance sampling
@@ -296,14 +262,13 @@ void main()
         // Implementation modified from: https://learnopengl.com/PBR/IBL/Specular-IBL
         float probabilityDensity = D(n, h, roughnessCorrected);
         float pdf = (probabilityDensity * dot(n, h) / (4.0 * dot(h, wo))) + 0.0001;
-        float resolution = 512.0; // Resolution of largest mipmap
+        float resolution = radianceMapFaceSize; // Resolution of largest mipmap
         float saTexel  = 4.0 * PI / (6.0 * resolution * resolution);
-        float saSample = 1.0 / (float(N) * pdf + 0.0001);
+        float saSample = 1.0 / (float(sampleCount) * pdf + 0.0001);
         float mipLevel = roughness == 0.0 ? 0.0 : 0.5 * log2(saSample / saTexel);
 
-        // Convert wi to polar spherical coordinates
-        vec2 sampleCoords = sphericalToUV(cartesianToSpherical(wi));
-        vec4 sampled = textureLod(radianceMap, sampleCoords, mipLevel);
+        // Sample the cubemap directly in that direction
+        vec4 sampled = textureLod(radianceMap, wi, mipLevel);
 
         // Combine
         result += sampled * dot(n, h);  // We have to factor in the view angle for physical accuracy
@@ -0,0 +1,43 @@
+#version 410
+
+in vec2 TexCoords;
+
+uniform sampler2D equirectangularMap;
+uniform int cubemapFace;
+
+out vec4 FragColour;
+
+
+#define PI 3.1415926535
+
+// cubemapFaceDirection() is added to this shader by ShaderProgram.
+
+
+/**
+ * Convert from a direction to UV coordinates in the equirectangular texture.
+ */
+vec2 directionToUV(vec3 direction)
+{
+    // Radius when projected into the XZ plane
+    float r = sqrt(direction.x * direction.x + direction.z * direction.z);
+
+    // Rotation clockwise from -Z axis
+    float phi = atan(direction.x, -direction.z);
+
+    // Rotation up from XZ plane
+    float theta = atan(direction.y, r);
+
+    // Corresponding texture location
+    float u = 0.5 + phi / (2 * PI);
+    float v = 0.5 + theta / PI;
+
+    return vec2(u, v);
+}
+
+void main()
+{
+    // This is the only place that we pay for the trigonometry: everything
+    // downstream samples the cubemap directly using a direction vector
+    vec3 direction = cubemapFaceDirection(cubemapFace, TexCoords);
+    FragColour = vec4(textureLod(equirectangularMap, directionToUV(direction), 0.0).rgb, 1.0);
+}
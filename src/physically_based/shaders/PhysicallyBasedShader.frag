@@ -53,17 +53,64 @@ in vec4 Normal;
 in vec4 Position_world;
 in vec2 TexCoord;
 
-uniform vec3 cameraPosition;
-uniform Material material;
-uniform DirectLightingInfo lightingInfo;
-uniform SunInfo sunInfo;
+/**
+ * Everything that differs between the objects drawn in a frame. Each object's
+ * copy is a range of one buffer that is filled in once per frame, so drawing an
+ * object only takes a buffer binding rather than a uniform call per member.
+ * This must match PhysicallyBasedObjectUniforms and the block in the other stage.
+ */
+layout (std140) uniform ObjectData {
+    mat4 Model;
+    mat4 NormalsRotation;
+    Material material;
+    NormalDistributionFunctionCoefficients dCoefficients;
+    GeometricAttenuationFunctionCoefficients gCoefficients;
+    int lightingMapLayer;
+};
+
+/**
+ * The camera, which is the same for every object drawn in a frame.
+ */
+layout (std140) uniform CameraData {
+    mat4 View;
+    mat4 Projection;
+    vec3 cameraPosition;
+};
+
+/**
+ * The direct lighting and the environment map's mip range, which are the same
+ * for every object drawn in a frame. This must match PhysicallyBasedLightingUniforms.
+ */
+layout (std140) uniform LightingData {
+    DirectLightingInfo lightingInfo;
+    SunInfo sunInfo;
 
-uniform NormalDistributionFunctionCoefficients dCoefficients;
-uniform GeometricAttenuationFunctionCoefficients gCoefficients;
+    // The mipmap level of preFilteredEnvironmentMap that holds roughness 1
+    float preFilteredEnvironmentMapMaxLod;
+};
 
-uniform sampler2D irradianceMap;
-uniform sampler2D preFilteredEnvironmentMap;
+#ifdef USE_SPHERICAL_HARMONICS
+/**
+ * The irradiance as spherical harmonic coefficients, with the basis functions'
+ * normalisation constants already folded in. Only the rgb channels are used.
+ */
+layout (std140) uniform SphericalHarmonics {
+    vec4 shCoefficients[9];
+};
+#else
+uniform samplerCube irradianceMap;
+#endif
+#ifdef LAYERED_LIGHTING_MAPS
+/**
+ * Every BRDF variant's maps are layers of the same two textures, and this object's
+ * variant is the one in layer lightingMapLayer. See PrecomputationMode::Layered.
+ */
+uniform samplerCubeArray preFilteredEnvironmentMap;
+uniform sampler2DArray brdfIntegrationMap;
+#else
+uniform samplerCube preFilteredEnvironmentMap;
 uniform sampler2D brdfIntegrationMap;
+#endif
 
 out vec4 FragColour;
 
@@ -208,27 +255,26 @@ vec3 BRDF(vec3 p, vec3 wi, vec3 wo, vec3 n, vec3 F0)
     return (kD * material.albedo / PI) + specular;
 }
 
-// ----- COORDINATE TRANSFORMATIONS -----------------------------------------------------
+// ----- DIFFUSE IMAGE-BASED LIGHTING ---------------------------------------------------
 
 /**
- * Convert from cubemap coordinates to UV coordinates for the texture.
+ * Looks up the precomputed irradiance arriving at a surface with normal n.
  */
-vec2 cubemapCoordsToUVs(vec3 cubemapCoords)
+vec3 irradiance(vec3 n)
 {
-    // Radius when projected into the XZ plane
-    float r = sqrt(cubemapCoords.x * cubemapCoords.x + cubemapCoords.z * cubemapCoords.z);
-
-    // Rotation clockwise from -Z axis
-    float phi = atan(cubemapCoords.x, -cubemapCoords.z);
-
-    // Rotation up from XZ plane
-    float theta = atan(cubemapCoords.y, r);
-
-    // Corresponding texture location
-    float u = 0.5 + phi / (2 * PI);
-    float v = 0.5 + theta / PI;
-
-    return vec2(u, v);
+#ifdef USE_SPHERICAL_HARMONICS
+    return shCoefficients[0].rgb
+         + shCoefficients[1].rgb * n.y
+         + shCoefficients[2].rgb * n.z
+         + shCoefficients[3].rgb * n.x
+         + shCoefficients[4].rgb * (n.x * n.y)
+         + shCoefficients[5].rgb * (n.y * n.z)
+         + shCoefficients[6].rgb * (3.0 * n.z * n.z - 1.0)
+         + shCoefficients[7].rgb * (n.x * n.z)
+         + shCoefficients[8].rgb * (n.x * n.x - n.y * n.y);
+#else
+    return texture(irradianceMap, n).rgb;
+#endif
 }
 
 // ----- COLOUR PROCESSING --------------------------------------------------------------
@@ -292,18 +338,23 @@ void main()
     vec3 kD = (1.0 - F) * (1.0 - material.metallic);
 
     // Add the diffuse contribution from the irradiance map
-    vec2 uv = cubemapCoordsToUVs(n);
-    vec4 sampledDiffuse = texture(irradianceMap, uv);
-    Lo += kD * sampledDiffuse.rgb * material.albedo;
+    Lo += kD * irradiance(n) * material.albedo;
 
     // Compute the incoming specular light direction
     vec3 wi = 2.0 * dot(wo, n) * n - wo;
 
     // Sample the precomputed environment map and BRDF function
-    float lod = material.roughness * 4.0;  // Remember the environment map encodes different roughnesses
-                                           // in different mipmap levels
-    vec3 environmentMapComponent = textureLod(preFilteredEnvironmentMap, cubemapCoordsToUVs(wi), lod).rgb;
+    float lod = material.roughness * preFilteredEnvironmentMapMaxLod;  // Remember the environment map encodes
+                                                                       // different roughnesses in different
+                                                                       // mipmap levels
+#ifdef LAYERED_LIGHTING_MAPS
+    vec3 environmentMapComponent = textureLod(preFilteredEnvironmentMap, vec4(wi, lightingMapLayer), lod).rgb;
+    vec4 brdfScaleAndBias = texture(brdfIntegrationMap,
+                                    vec3(max(dot(wo, n), 0.0), material.roughness, lightingMapLayer));
+#else
+    vec3 environmentMapComponent = textureLod(preFilteredEnvironmentMap, wi, lod).rgb;
     vec4 brdfScaleAndBias = texture(brdfIntegrationMap, vec2(max(dot(wo, n), 0.0), material.roughness));
+#endif
     float F0_scale = brdfScaleAndBias.x;
     float F0_bias = brdfScaleAndBias.y;
 
@@ -4,10 +4,39 @@ layout (location = 0) in vec3 VertexPos;
 layout (location = 1) in vec3 Normal_modelCoords;
 layout (location = 2) in vec2 TexCoord_in;
 
-uniform mat4 Model;
-uniform mat4 View;
-uniform mat4 Projection;
-uniform mat4 NormalsRotation;
+struct Material {
+    vec3 albedo;
+    float roughness;
+    float metallic;
+    vec3 F0;
+};
+
+struct NormalDistributionFunctionCoefficients {
+    float k_TrowbridgeReitzGGX;
+    float k_Beckmann;
+};
+
+struct GeometricAttenuationFunctionCoefficients {
+    float k_SchlickGGX;
+    float k_CookTorrance;
+};
+
+// The per-object uniforms, declared exactly as in PhysicallyBasedShader.frag
+layout (std140) uniform ObjectData {
+    mat4 Model;
+    mat4 NormalsRotation;
+    Material material;
+    NormalDistributionFunctionCoefficients dCoefficients;
+    GeometricAttenuationFunctionCoefficients gCoefficients;
+    int lightingMapLayer;
+};
+
+// Declared exactly as in PhysicallyBasedShader.frag
+layout (std140) uniform CameraData {
+    mat4 View;
+    mat4 Projection;
+    vec3 cameraPosition;
+};
 
 out vec4 Normal;
 out vec4 Position_world;
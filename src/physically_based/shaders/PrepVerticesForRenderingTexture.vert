@@ -1,15 +1,26 @@
 #version 410
 
-// DISCLAIMER: This file is just a modified version of how they did it
-// here: https://learnopengl.com/Advanced-OpenGL/Framebuffers
+// Generates a single triangle that covers the whole viewport, so no vertex
+// data is needed. The corners are at (-1, -1), (3, -1) and (-1, 3) in NDC, and
+// the part of the triangle inside the viewport has texture coordinates from
+// (0, 0) to (1, 1). Draw it with glDrawArrays(GL_TRIANGLES, 0, 3).
+//
+// With LAYERED defined, the output goes to PrepVerticesForLayeredRendering.geom
+// instead, along with the instance index so that it can choose a layer.
 
-layout (location = 0) in vec2 PositionNDC;
-layout (location = 1) in vec2 TexCoords_in;
+#ifdef LAYERED
+#define TexCoords vertexTexCoords
+flat out int vertexInstance;
+#endif
 
 out vec2 TexCoords;
 
 void main()
 {
-    gl_Position = vec4(PositionNDC.x, PositionNDC.y, 0.0, 1.0);
-    TexCoords = TexCoords_in;
+    vec2 position = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    gl_Position = vec4(position, 0.0, 1.0);
+    TexCoords = 0.5 * position + 0.5;
+#ifdef LAYERED
+    vertexInstance = gl_InstanceID;
+#endif
 }
@@ -22,8 +22,7 @@ void main()
     // be rendered if no geometry has been rendered to that fragment.
     gl_Position.z = gl_Position.w;
 
-    // We output in cubemap coordinates, even though the raw texture data
-    // is a spherical texture. The coordinate transform will be handled
-    // in the fragment shader.
+    // We output in cubemap coordinates, which can be used to sample the
+    // environment map directly
     TexCoords = VertexPos;
 }
@@ -9,6 +9,7 @@
 
 #include <boost/functional/hash.hpp>
 
+#include <glm/geometric.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 
@@ -23,39 +24,50 @@ namespace fs = std::filesystem;
 
 namespace {
 
-struct vertex_data_t {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 texcoord;
-
-    bool operator==(const struct vertex_data_t& other) const
-    {
-        return position == other.position && normal == other.normal && texcoord == other.texcoord;
-    }
-
-};
-
-struct VertexDataHasher {
-    size_t operator()(const vertex_data_t& vertexData) const
-    {
-        size_t seed = 0;
-        boost::hash_combine(seed, boost::hash_value(vertexData.position.x));
-        boost::hash_combine(seed, boost::hash_value(vertexData.position.y));
-        boost::hash_combine(seed, boost::hash_value(vertexData.position.z));
-        boost::hash_combine(seed, boost::hash_value(vertexData.normal.x));
-        boost::hash_combine(seed, boost::hash_value(vertexData.normal.y));
-        boost::hash_combine(seed, boost::hash_value(vertexData.normal.z));
-        boost::hash_combine(seed, boost::hash_value(vertexData.texcoord.s));
-        boost::hash_combine(seed, boost::hash_value(vertexData.texcoord.t));
-        return seed;
-    }
-};
+/**
+ * Computes the normal of a triangle, for files that don't specify normals.
+ * tinyobjloader triangulates every face, so each face is three consecutive indices.
+ *
+ * @param attrib The attributes parsed by tinyobjloader
+ * @param indices The indices of the shape that the triangle belongs to
+ * @param firstIndex The position in `indices` of the triangle's first vertex
+ * @return The triangle's unit normal, or zero if the triangle is degenerate
+ */
+glm::vec3 faceNormal(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::index_t>& indices,
+                     size_t firstIndex)
+{
+    glm::vec3 a = *((glm::vec3*) &attrib.vertices[3 * indices[firstIndex].vertex_index]);
+    glm::vec3 b = *((glm::vec3*) &attrib.vertices[3 * indices[firstIndex + 1].vertex_index]);
+    glm::vec3 c = *((glm::vec3*) &attrib.vertices[3 * indices[firstIndex + 2].vertex_index]);
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    float length = glm::length(normal);
+    return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
 
 } // anonymous namespace
 
 namespace PBR::scene_objects {
 
-std::shared_ptr<VertexData> loadObjFromPath(const fs::path& objPath, bool textured)
+bool vertex_data_t::operator==(const struct vertex_data_t& other) const
+{
+    return position == other.position && normal == other.normal && texcoord == other.texcoord;
+}
+
+size_t VertexDataHasher::operator()(const vertex_data_t& vertexData) const
+{
+    size_t seed = 0;
+    boost::hash_combine(seed, boost::hash_value(vertexData.position.x));
+    boost::hash_combine(seed, boost::hash_value(vertexData.position.y));
+    boost::hash_combine(seed, boost::hash_value(vertexData.position.z));
+    boost::hash_combine(seed, boost::hash_value(vertexData.normal.x));
+    boost::hash_combine(seed, boost::hash_value(vertexData.normal.y));
+    boost::hash_combine(seed, boost::hash_value(vertexData.normal.z));
+    boost::hash_combine(seed, boost::hash_value(vertexData.texcoord.s));
+    boost::hash_combine(seed, boost::hash_value(vertexData.texcoord.t));
+    return seed;
+}
+
+ObjMeshData readObjFile(const fs::path& objPath, bool textured)
 {
     tinyobj::ObjReader reader;
 
@@ -79,7 +91,6 @@ std::shared_ptr<VertexData> loadObjFromPath(const fs::path& objPath, bool textur
     const auto& materials = reader.GetMaterials();
 
     assert(!attrib.vertices.empty());
-    assert(!attrib.normals.empty());
 
     // Buffers to store the loaded data
     std::shared_ptr<std::vector<float>> vertexDataBuffer(new std::vector<float>());
@@ -100,11 +111,15 @@ std::shared_ptr<VertexData> loadObjFromPath(const fs::path& objPath, bool textur
 
     // Loop over all vertices of all shapes
     for (const auto& shape : shapes) {
-        for (auto idx : shape.mesh.indices) {
+        const auto& indices = shape.mesh.indices;
+        for (size_t i = 0; i < indices.size(); i++) {
+            const auto& idx = indices[i];
 
             // Read the data parsed by tinyobjloader
             glm::vec3 vertexPosition = *((glm::vec3*) &attrib.vertices[3 * idx.vertex_index]);
-            glm::vec3 normal = *((glm::vec3*) &attrib.normals[3 * idx.normal_index]);
+            glm::vec3 normal = idx.normal_index >= 0
+                               ? *((glm::vec3*) &attrib.normals[3 * idx.normal_index])
+                               : faceNormal(attrib, indices, i - i % 3);
             glm::vec2 texCoords = textured
                                   ? *((glm::vec2*) &attrib.texcoords[2 * idx.texcoord_index])
                                   : glm::vec2(0.0f);
@@ -145,7 +160,13 @@ std::shared_ptr<VertexData> loadObjFromPath(const fs::path& objPath, bool textur
         }
     }
 
-    return std::make_shared<VertexData>(vertexDataBuffer, indicesBuffer, textured);
+    return ObjMeshData{vertexDataBuffer, indicesBuffer};
+}
+
+std::shared_ptr<VertexData> loadObjFromPath(const fs::path& objPath, bool textured)
+{
+    ObjMeshData meshData = readObjFile(objPath, textured);
+    return std::make_shared<VertexData>(meshData.vertexData, meshData.indices, textured);
 }
 
 } // namespace PBR::scene_objects
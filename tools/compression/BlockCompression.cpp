@@ -0,0 +1,408 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <PBR/core/DDSFile.h>
+
+namespace {
+
+// Interpolation weights for 4-bit indices, shared by BC6H and BC7
+constexpr int WEIGHTS_4BIT[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+/**
+ * Writes values into a 128-bit block, least significant bit first.
+ */
+class BlockWriter {
+private:
+    unsigned char* block;
+    unsigned int position;
+
+public:
+    explicit BlockWriter(unsigned char* block)
+            :block(block), position(0)
+    {
+        std::memset(block, 0, 16);
+    }
+
+    void write(uint32_t value, unsigned int numBits)
+    {
+        for (unsigned int i = 0; i < numBits; i++, position++) {
+            if (value & (1u << i)) {
+                block[position / 8] |= (unsigned char) (1u << (position % 8));
+            }
+        }
+    }
+};
+
+/**
+ * Finds the principal axis of a set of points using a few rounds of power
+ * iteration on their covariance matrix.
+ *
+ * @param points The points, `numChannels` floats each
+ * @param numChannels The dimension of each point (at most 4)
+ * @param mean Filled in with the centroid of the points
+ * @param axis Filled in with the normalised principal axis
+ */
+void principalAxis(const float* points, int numChannels, float* mean, float* axis)
+{
+    for (int c = 0; c < numChannels; c++) {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            mean[c] += points[i * numChannels + c];
+        }
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < numChannels; a++) {
+            for (int b = 0; b < numChannels; b++) {
+                covariance[a][b] += (points[i * numChannels + a] - mean[a]) * (points[i * numChannels + b] - mean[b]);
+            }
+        }
+    }
+
+    // Start from the diagonal, which works well for the colour data we see in practice
+    for (int c = 0; c < numChannels; c++) {
+        axis[c] = 1.0f;
+    }
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        for (int a = 0; a < numChannels; a++) {
+            for (int b = 0; b < numChannels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+        }
+        float length = 0.0f;
+        for (int c = 0; c < numChannels; c++) {
+            length += next[c] * next[c];
+        }
+        length = std::sqrt(length);
+        if (length < 1e-6f) {
+            break;
+        }
+        for (int c = 0; c < numChannels; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+}
+
+/**
+ * Picks the two endpoints of the line segment through the points, by projecting
+ * onto their principal axis and taking the extremes.
+ */
+void chooseEndpoints(const float* points, int numChannels, float* endpoint0, float* endpoint1)
+{
+    float mean[4], axis[4];
+    principalAxis(points, numChannels, mean, axis);
+
+    float minT = std::numeric_limits<float>::max();
+    float maxT = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < numChannels; c++) {
+            t += (points[i * numChannels + c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    for (int c = 0; c < numChannels; c++) {
+        endpoint0[c] = mean[c] + minT * axis[c];
+        endpoint1[c] = mean[c] + maxT * axis[c];
+    }
+}
+
+// ----- BC7 ----------------------------------------------------------------------------
+
+/**
+ * Quantizes an RGBA endpoint to 7 bits per channel plus a shared p-bit, choosing
+ * the p-bit that gives the smallest error.
+ */
+void quantizeEndpointBC7(const float* endpoint, int* quantized, int& pBit)
+{
+    float bestError = std::numeric_limits<float>::max();
+    for (int p = 0; p < 2; p++) {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            float value = std::clamp(endpoint[c], 0.0f, 255.0f);
+            candidate[c] = std::clamp((int) std::lround((value - (float) p) / 2.0f), 0, 127);
+            float reconstructed = (float) ((candidate[c] << 1) | p);
+            error += (reconstructed - value) * (reconstructed - value);
+        }
+        if (error < bestError) {
+            bestError = error;
+            pBit = p;
+            std::copy(candidate, candidate + 4, quantized);
+        }
+    }
+}
+
+// ----- BC6H ---------------------------------------------------------------------------
+
+/**
+ * Converts a non-negative float into the bits of the nearest half-precision float.
+ */
+uint16_t floatToHalfBits(float value)
+{
+    if (!(value > 0.0f)) {
+        return 0;  // Also catches NaN
+    }
+    if (value >= 65504.0f) {
+        return 0x7BFF;  // Largest finite half
+    }
+
+    int exponent;
+    float mantissa = std::frexp(value, &exponent);  // value = mantissa * 2^exponent, mantissa in [0.5, 1)
+    int halfExponent = exponent + 14;
+    if (halfExponent <= 0) {
+        // Denormal
+        return (uint16_t) std::lround(std::ldexp(value, 24));
+    }
+    int halfMantissa = (int) std::lround((mantissa * 2.0f - 1.0f) * 1024.0f);
+    if (halfMantissa == 1024) {
+        halfMantissa = 0;
+        halfExponent++;
+    }
+    return (uint16_t) std::min((halfExponent << 10) | halfMantissa, 0x7BFF);
+}
+
+/**
+ * The value that the GPU reconstructs from a 10-bit unsigned BC6H endpoint.
+ */
+int unquantizeBC6H(int value)
+{
+    if (value == 0) {
+        return 0;
+    }
+    if (value == 1023) {
+        return 0xFFFF;
+    }
+    return ((value << 16) + 0x8000) >> 10;
+}
+
+/**
+ * Maps an interpolated BC6H value back to the bits of a half-precision float.
+ */
+int finishUnquantizeBC6H(int value)
+{
+    return (value * 31) >> 6;
+}
+
+/**
+ * Finds the 10-bit endpoint that reconstructs to the closest half-float value.
+ */
+int quantizeBC6H(float halfBits)
+{
+    int estimate = std::clamp((int) (halfBits / 31.0f), 0, 1023);
+    int best = estimate;
+    float bestError = std::numeric_limits<float>::max();
+    for (int candidate = std::max(estimate - 1, 0); candidate <= std::min(estimate + 1, 1023); candidate++) {
+        float error = std::abs((float) finishUnquantizeBC6H(unquantizeBC6H(candidate)) - halfBits);
+        if (error < bestError) {
+            bestError = error;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+} // anonymous namespace
+
+namespace PBR::tools {
+
+void compressBlockBC7(const unsigned char* pixels, unsigned char* block)
+{
+    float points[16 * 4];
+    for (int i = 0; i < 16 * 4; i++) {
+        points[i] = (float) pixels[i];
+    }
+
+    // Choose and quantize the endpoints
+    float endpoint0[4], endpoint1[4];
+    chooseEndpoints(points, 4, endpoint0, endpoint1);
+    int quantized[2][4];
+    int pBits[2];
+    quantizeEndpointBC7(endpoint0, quantized[0], pBits[0]);
+    quantizeEndpointBC7(endpoint1, quantized[1], pBits[1]);
+
+    // Work out the palette that the GPU will reconstruct
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            int e0 = (quantized[0][c] << 1) | pBits[0];
+            int e1 = (quantized[1][c] << 1) | pBits[1];
+            palette[i][c] = ((64 - WEIGHTS_4BIT[i]) * e0 + WEIGHTS_4BIT[i] * e1 + 32) >> 6;
+        }
+    }
+
+    // Pick the closest palette entry for each pixel
+    int indices[16];
+    for (int p = 0; p < 16; p++) {
+        int bestError = std::numeric_limits<int>::max();
+        for (int i = 0; i < 16; i++) {
+            int error = 0;
+            for (int c = 0; c < 4; c++) {
+                int difference = palette[i][c] - (int) pixels[p * 4 + c];
+                error += difference * difference;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[p] = i;
+            }
+        }
+    }
+
+    // The most significant bit of the first index is implicitly zero, so swap
+    // the endpoints if necessary to make that true
+    if (indices[0] & 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (int& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    // Mode 6 layout: mode, R0 R1 G0 G1 B0 B1 A0 A1, P0 P1, indices
+    BlockWriter writer(block);
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(quantized[0][c], 7);
+        writer.write(quantized[1][c], 7);
+    }
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; i++) {
+        writer.write(indices[i], 4);
+    }
+}
+
+void compressBlockBC6H(const float* pixels, unsigned char* block)
+{
+    // BC6H interpolates the bit patterns of half floats, which behaves roughly
+    // logarithmically, so we fit our endpoints in that space too.
+    float points[16 * 3];
+    for (int i = 0; i < 16 * 3; i++) {
+        points[i] = (float) floatToHalfBits(pixels[i]);
+    }
+
+    // Choose and quantize the endpoints
+    float endpoint0[3], endpoint1[3];
+    chooseEndpoints(points, 3, endpoint0, endpoint1);
+    int quantized[2][3];
+    for (int c = 0; c < 3; c++) {
+        quantized[0][c] = quantizeBC6H(std::clamp(endpoint0[c], 0.0f, (float) 0x7BFF));
+        quantized[1][c] = quantizeBC6H(std::clamp(endpoint1[c], 0.0f, (float) 0x7BFF));
+    }
+
+    // Work out the palette that the GPU will reconstruct
+    int palette[16][3];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            int e0 = unquantizeBC6H(quantized[0][c]);
+            int e1 = unquantizeBC6H(quantized[1][c]);
+            palette[i][c] = finishUnquantizeBC6H(((64 - WEIGHTS_4BIT[i]) * e0 + WEIGHTS_4BIT[i] * e1 + 32) >> 6);
+        }
+    }
+
+    // Pick the closest palette entry for each pixel
+    int indices[16];
+    for (int p = 0; p < 16; p++) {
+        float bestError = std::numeric_limits<float>::max();
+        for (int i = 0; i < 16; i++) {
+            float error = 0;
+            for (int c = 0; c < 3; c++) {
+                float difference = (float) palette[i][c] - points[p * 3 + c];
+                error += difference * difference;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[p] = i;
+            }
+        }
+    }
+
+    // The most significant bit of the first index is implicitly zero
+    if (indices[0] & 8) {
+        std::swap(quantized[0], quantized[1]);
+        for (int& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    // Mode 11 layout: mode (00011), RW GW BW, RX GX BX, indices
+    BlockWriter writer(block);
+    writer.write(0x03, 5);
+    for (int c = 0; c < 3; c++) {
+        writer.write(quantized[0][c], 10);
+    }
+    for (int c = 0; c < 3; c++) {
+        writer.write(quantized[1][c], 10);
+    }
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; i++) {
+        writer.write(indices[i], 4);
+    }
+}
+
+CompressedMipLevel compressImage(const void* pixels, unsigned int width, unsigned int height,
+                                 BlockCompressionFormat format, unsigned int numThreads)
+{
+    unsigned int blocksWide = (width + 3) / 4;
+    unsigned int blocksHigh = (height + 3) / 4;
+    CompressedMipLevel level{width, height, std::vector<unsigned char>(DDSFile::levelSize(width, height))};
+
+    // Compresses one row of blocks. Pixels beyond the edge of the image are
+    // filled by clamping to the last row/column.
+    auto compressBlockRow = [&](unsigned int blockY) {
+        for (unsigned int blockX = 0; blockX < blocksWide; blockX++) {
+            unsigned char* output = &level.data[(blockY * blocksWide + blockX) * 16];
+            if (format == BlockCompressionFormat::BC7) {
+                unsigned char blockPixels[16 * 4];
+                const auto* source = static_cast<const unsigned char*>(pixels);
+                for (unsigned int i = 0; i < 16; i++) {
+                    unsigned int x = std::min(blockX * 4 + i % 4, width - 1);
+                    unsigned int y = std::min(blockY * 4 + i / 4, height - 1);
+                    std::memcpy(&blockPixels[i * 4], &source[(y * width + x) * 4], 4);
+                }
+                compressBlockBC7(blockPixels, output);
+            }
+            else {
+                float blockPixels[16 * 3];
+                const auto* source = static_cast<const float*>(pixels);
+                for (unsigned int i = 0; i < 16; i++) {
+                    unsigned int x = std::min(blockX * 4 + i % 4, width - 1);
+                    unsigned int y = std::min(blockY * 4 + i / 4, height - 1);
+                    std::memcpy(&blockPixels[i * 3], &source[(y * width + x) * 3], 3 * sizeof(float));
+                }
+                compressBlockBC6H(blockPixels, output);
+            }
+        }
+    };
+
+    // Interleave the rows between threads so that each gets a similar workload
+    numThreads = std::max(1u, std::min(numThreads, blocksHigh));
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (unsigned int blockY = t; blockY < blocksHigh; blockY += numThreads) {
+                compressBlockRow(blockY);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    return level;
+}
+
+} // namespace PBR::tools
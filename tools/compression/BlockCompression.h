@@ -0,0 +1,50 @@
+#ifndef PHYSICALLYBASEDRENDERER_BLOCKCOMPRESSION
+#define PHYSICALLYBASEDRENDERER_BLOCKCOMPRESSION
+
+#include <vector>
+
+#include <PBR/core/DDSFile.h>
+
+namespace PBR::tools {
+
+/**
+ * Compresses a 4x4 block of 8-bit RGBA pixels into a 16-byte BC7 block.
+ *
+ * All blocks are encoded using BC7 mode 6 (a single subset with 7-bit RGBA
+ * endpoints plus a p-bit and 4-bit indices), which is a good general-purpose
+ * mode for opaque colour textures.
+ *
+ * @param pixels The 16 pixels of the block in row-major order, 4 bytes each
+ * @param block The 16 bytes to write the block to
+ */
+void compressBlockBC7(const unsigned char* pixels, unsigned char* block);
+
+/**
+ * Compresses a 4x4 block of floating-point RGB pixels into a 16-byte BC6H block.
+ *
+ * All blocks are encoded using BC6H mode 11 (a single region with 10-bit
+ * endpoints and 4-bit indices). Negative values are clamped to zero since we
+ * write the unsigned variant of the format.
+ *
+ * @param pixels The 16 pixels of the block in row-major order, 3 floats each
+ * @param block The 16 bytes to write the block to
+ */
+void compressBlockBC6H(const float* pixels, unsigned char* block);
+
+/**
+ * Compresses a whole image, splitting the rows of blocks between threads.
+ *
+ * @param pixels The image data, either 4 unsigned chars per pixel (BC7) or
+ *               3 floats per pixel (BC6H)
+ * @param width The width of the image in pixels
+ * @param height The height of the image in pixels
+ * @param format The format to compress to
+ * @param numThreads The number of threads to use
+ * @return The compressed level
+ */
+CompressedMipLevel compressImage(const void* pixels, unsigned int width, unsigned int height,
+                                 BlockCompressionFormat format, unsigned int numThreads);
+
+} // namespace PBR::tools
+
+#endif //PHYSICALLYBASEDRENDERER_BLOCKCOMPRESSION
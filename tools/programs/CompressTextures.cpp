@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <stb_image.h>
+
+#include <PBR/core/DDSFile.h>
+#include <PBR/core/MipGenerator.h>
+
+#include "../compression/BlockCompression.h"
+
+using namespace PBR;
+
+namespace fs = std::filesystem;
+
+/**
+ * Compresses every level of the mipmap chain of an image.
+ */
+template<typename T>
+DDSFile compressWithMipmaps(const std::vector<T>& pixels, unsigned int width, unsigned int height,
+                            unsigned int channels, BlockCompressionFormat format, std::optional<MipFilter> mipFilter,
+                            MipEdges edges, unsigned int numThreads)
+{
+    DDSFile file{format, {}};
+    file.mipLevels.push_back(tools::compressImage(pixels.data(), width, height, format, numThreads));
+    if (!mipFilter) {
+        return file;
+    }
+
+    auto levels = MipGenerator::generate(pixels.data(), width, height, channels, *mipFilter, edges);
+    for (unsigned int level = 1; level <= levels.size(); level++) {
+        file.mipLevels.push_back(tools::compressImage(levels[level - 1].data(), MipGenerator::levelSize(width, level),
+                                                      MipGenerator::levelSize(height, level), format, numThreads));
+    }
+    return file;
+}
+
+/**
+ * Compresses a single image file, writing the result next to it with a .dds extension.
+ */
+bool compressFile(const fs::path& inputPath, std::optional<MipFilter> mipFilter, unsigned int numThreads)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    std::string path = inputPath.string();
+    int width, height, numChannels;
+    DDSFile file;
+
+    if (stbi_is_hdr(path.c_str())) {
+        // Texture flips HDR images vertically on load, so we must store them flipped too
+        stbi_set_flip_vertically_on_load(true);
+        float* data = stbi_loadf(path.c_str(), &width, &height, &numChannels, 3);
+        stbi_set_flip_vertically_on_load(false);
+        if (!data) {
+            std::cerr << "Failed to load " << inputPath << std::endl;
+            return false;
+        }
+        std::vector<float> pixels(data, data + width * height * 3);
+        stbi_image_free(data);
+        // HDR images are equirectangular environment maps, which don't wrap across the poles
+        file = compressWithMipmaps(pixels, width, height, 3, BlockCompressionFormat::BC6H, mipFilter,
+                                   MipEdges::equirectangular(), numThreads);
+    }
+    else {
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &numChannels, 4);
+        if (!data) {
+            std::cerr << "Failed to load " << inputPath << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> pixels(data, data + width * height * 4);
+        stbi_image_free(data);
+        file = compressWithMipmaps(pixels, width, height, 4, BlockCompressionFormat::BC7, mipFilter, MipEdges(),
+                                   numThreads);
+    }
+
+    fs::path outputPath = DDSFile::compressedPathFor(inputPath);
+    if (!file.write(outputPath)) {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        return false;
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+    std::cout << inputPath.filename().string() << " -> " << outputPath.filename().string()
+              << " (" << width << "x" << height << ", " << file.mipLevels.size() << " levels, "
+              << fs::file_size(outputPath) / 1024 << " KiB, " << milliseconds << " ms)" << std::endl;
+    return true;
+}
+
+/**
+ * The assets used by the example programs that benefit from compression.
+ */
+std::vector<fs::path> defaultAssets()
+{
+    std::vector<fs::path> assets;
+    auto resourcesDir = fs::current_path() / "example" / "resources";
+
+    for (const auto& entry : fs::recursive_directory_iterator(resourcesDir / "environment_maps")) {
+        if (entry.path().extension() == ".hdr") {
+            assets.push_back(entry.path());
+        }
+    }
+    for (const auto& entry : fs::directory_iterator(resourcesDir / "textures")) {
+        if (entry.path().extension() == ".png" || entry.path().extension() == ".jpg") {
+            assets.push_back(entry.path());
+        }
+    }
+
+    return assets;
+}
+
+int main(int argc, char** argv)
+{
+    std::optional<MipFilter> mipFilter = MipFilter::Kaiser;
+    unsigned int numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<fs::path> inputs;
+    bool force = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--force") {
+            force = true;
+        }
+        else if (arg == "--no-mipmaps") {
+            mipFilter = std::nullopt;
+        }
+        else if (arg == "--mip-filter" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "box") {
+                mipFilter = MipFilter::Box;
+            }
+            else if (name == "kaiser") {
+                mipFilter = MipFilter::Kaiser;
+            }
+            else if (name == "lanczos") {
+                mipFilter = MipFilter::Lanczos;
+            }
+            else {
+                std::cerr << "Unknown mipmap filter " << name << ", expected box, kaiser or lanczos" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if (arg == "--help") {
+            std::cout << "Usage: CompressTextures [--threads N] [--mip-filter box|kaiser|lanczos] [--no-mipmaps] [--force]"
+                      << " [image ...]"
+                      << std::endl
+                      << "Writes a BC6H (HDR) or BC7 (LDR) compressed .dds file next to each image." << std::endl
+                      << "With no images, compresses the example assets." << std::endl
+                      << "Images whose .dds is newer than them are skipped unless --force is given." << std::endl;
+            return 0;
+        }
+        else {
+            inputs.emplace_back(arg);
+        }
+    }
+
+    if (inputs.empty()) {
+        inputs = defaultAssets();
+    }
+
+    bool success = true;
+    for (const auto& input : inputs) {
+        // Leave compressed copies that are newer than their images alone
+        if (!force && DDSFile::isUpToDate(input)) {
+            std::cout << input.filename().string() << " is up to date" << std::endl;
+            continue;
+        }
+        success = compressFile(input, mipFilter, numThreads) && success;
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <stb_image.h>
+
+#include <PBR/core/RadianceHDRFile.h>
+
+using namespace PBR;
+
+namespace fs = std::filesystem;
+
+/**
+ * Decodes a file once with stb_image, for comparison.
+ *
+ * @return The time taken in milliseconds, or a negative number if the file couldn't be decoded
+ */
+double timeStbDecode(const fs::path& path, std::vector<float>& pixels)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    int width, height, numChannels;
+    stbi_set_flip_vertically_on_load(true);
+    float* data = stbi_loadf(path.string().c_str(), &width, &height, &numChannels, 3);
+    stbi_set_flip_vertically_on_load(false);
+    if (!data) {
+        return -1.0;
+    }
+
+    auto endTime = std::chrono::steady_clock::now();
+    pixels.assign(data, data + (size_t) width * height * 3);
+    stbi_image_free(data);
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+/**
+ * @return The largest difference between two decodes of the same image, relative to the brighter of the two
+ */
+double largestDifference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    double difference = 0.0;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); i++) {
+        double scale = std::max({std::abs(a[i]), std::abs(b[i]), 1e-6f});
+        difference = std::max(difference, std::abs(a[i] - b[i]) / scale);
+    }
+    return difference;
+}
+
+/**
+ * Times each decoder on one file, and checks that they agree.
+ */
+bool timeFile(const fs::path& path, unsigned int runs)
+{
+    std::cout << path.filename().string() << " (" << fs::file_size(path) / 1024 << " KiB)" << std::endl;
+
+    std::vector<float> stbPixels;
+    std::vector<double> stbTimes;
+    for (unsigned int run = 0; run < runs; run++) {
+        double milliseconds = timeStbDecode(path, stbPixels);
+        if (milliseconds < 0.0) {
+            std::cerr << "  stb_image failed to decode " << path << std::endl;
+            return false;
+        }
+        stbTimes.push_back(milliseconds);
+    }
+
+    // Opening the file is included in the time, since it has to find every scanline
+    std::vector<float> pixels;
+    std::vector<uint16_t> halves;
+    std::vector<double> floatTimes, halfTimes;
+    for (unsigned int run = 0; run < runs; run++) {
+        auto startTime = std::chrono::steady_clock::now();
+        RadianceHDRFile file(path);
+        if (!file.isValid()) {
+            std::cerr << "  RadianceHDRFile can't decode " << path << std::endl;
+            return false;
+        }
+        pixels.resize((size_t) file.width() * file.height() * 3);
+        bool success = file.decodeToFloat(pixels.data(), true).has_value();
+        auto endTime = std::chrono::steady_clock::now();
+        floatTimes.push_back(std::chrono::duration<double, std::milli>(endTime - startTime).count());
+
+        halves.resize(pixels.size());
+        startTime = std::chrono::steady_clock::now();
+        success = success && file.decodeToHalf(halves.data(), true).has_value();
+        endTime = std::chrono::steady_clock::now();
+        halfTimes.push_back(std::chrono::duration<double, std::milli>(endTime - startTime).count());
+
+        if (!success) {
+            std::cerr << "  RadianceHDRFile failed to decode " << path << std::endl;
+            return false;
+        }
+    }
+
+    double megabytes = (double) fs::file_size(path) / (1024.0 * 1024.0);
+    auto print = [megabytes](const std::string& name, std::vector<double> times) {
+        std::sort(times.begin(), times.end());
+        std::cout << "  " << name << ": fastest " << times.front() << " ms ("
+                  << megabytes / (times.front() / 1000.0) << " MB/s)" << std::endl;
+    };
+    print("stb_image", stbTimes);
+    print("RadianceHDRFile to floats", floatTimes);
+    print("RadianceHDRFile to halves", halfTimes);
+
+    double difference = largestDifference(stbPixels, pixels);
+    std::cout << "  Largest difference from stb_image: " << difference * 100.0 << "%" << std::endl;
+    return difference == 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int runs = 5;
+    std::vector<fs::path> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if (arg == "--help") {
+            std::cout << "Usage: TimeHDRDecode [--runs N] [image.hdr ...]" << std::endl
+                      << "Times decoding Radiance .hdr files with RadianceHDRFile and with stb_image," << std::endl
+                      << "and checks that they agree. With no images, uses the example environment maps." << std::endl;
+            return 0;
+        }
+        else {
+            inputs.emplace_back(arg);
+        }
+    }
+
+    if (inputs.empty()) {
+        auto environmentMapsDir = fs::current_path() / "example" / "resources" / "environment_maps";
+        for (const auto& entry : fs::recursive_directory_iterator(environmentMapsDir)) {
+            if (entry.path().extension() == ".hdr") {
+                inputs.push_back(entry.path());
+            }
+        }
+    }
+
+    bool success = true;
+    for (const auto& input : inputs) {
+        success = timeFile(input, runs) && success;
+    }
+
+    return success ? 0 : 1;
+}
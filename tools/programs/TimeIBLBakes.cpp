@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <PBR/PBR.h>
+
+using namespace PBR;
+using namespace PBR::physically_based;
+
+namespace fs = std::filesystem;
+
+/**
+ * A row of spheres, each with a different BRDF, so that every one of them needs
+ * its own prefiltered environment map and BRDF integration map.
+ */
+std::vector<std::shared_ptr<PhysicallyBasedSceneObject>> makeObjects()
+{
+    fs::path objPath = fs::current_path() / "example" / "resources" / "models" / "SphereHighPoly.obj";
+    std::vector<std::shared_ptr<PhysicallyBasedSceneObject>> sceneObjects;
+    for (int i = 0; i < 4; i++) {
+        PhysicallyBasedMaterial material{glm::vec3(0.8f), 0.5f, 0.8f, FresnelValues::Silver};
+        material.brdfCoefficients.normalDistribution = NormalDistributionFunctionCoefficients{(float) (3 - i) / 3, (float) i / 3};
+        material.brdfCoefficients.geometricAttenutation = GeometricAttenuationFunctionCoefficients{(float) (3 - i) / 3, (float) i / 3};
+        sceneObjects.emplace_back(new scene_objects::CustomObject(objPath, glm::vec3(2.1f * i, 0.0f, 0.0f),
+                                                                  glm::vec3(0.0f), material, 1.0f));
+    }
+    return sceneObjects;
+}
+
+/**
+ * Times how long it takes to bake every map for the objects, including waiting
+ * for the GPU to finish.
+ *
+ * @return The time taken in milliseconds
+ */
+double timeBake(const std::vector<std::shared_ptr<PhysicallyBasedSceneObject>>& sceneObjects,
+                const std::shared_ptr<EnvironmentMap>& environmentMap, const PrecomputationSettings& settings)
+{
+    glFinish();
+    auto startTime = std::chrono::steady_clock::now();
+
+    PhysicallyBasedScene scene(sceneObjects, {}, environmentMap, PrecomputationMode::Blocking, nullptr, settings);
+    glFinish();
+
+    auto endTime = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+/**
+ * Prints the fastest and median times of a set of runs.
+ */
+void printTimes(const std::string& name, std::vector<double> times)
+{
+    std::sort(times.begin(), times.end());
+    std::cout << "  " << name << ": fastest " << times.front() << " ms, median " << times[times.size() / 2] << " ms"
+              << std::endl;
+}
+
+/**
+ * Times the bakes with the given settings, with and without compute shaders.
+ */
+void timeBakes(const std::vector<std::shared_ptr<PhysicallyBasedSceneObject>>& sceneObjects,
+               const std::shared_ptr<EnvironmentMap>& environmentMap, const PrecomputationSettings& settings,
+               unsigned int runs)
+{
+    // Compile the shaders and warm up the driver before timing anything
+    TexturePrecomputation::setComputeShadersEnabled(false);
+    timeBake(sceneObjects, environmentMap, settings);
+
+    std::vector<double> rasterTimes;
+    for (unsigned int run = 0; run < runs; run++) {
+        rasterTimes.push_back(timeBake(sceneObjects, environmentMap, settings));
+    }
+    printTimes("Fragment shaders", rasterTimes);
+
+    TexturePrecomputation::setComputeShadersEnabled(true);
+    if (!TexturePrecomputation::computeShadersAvailable()) {
+        std::cout << "  Compute shaders: not supported by this context" << std::endl;
+        return;
+    }
+    timeBake(sceneObjects, environmentMap, settings);
+
+    std::vector<double> computeTimes;
+    for (unsigned int run = 0; run < runs; run++) {
+        computeTimes.push_back(timeBake(sceneObjects, environmentMap, settings));
+    }
+    printTimes("Compute shaders", computeTimes);
+}
+
+/**
+ * Prints how far the maps baked with the given settings are from a high-sample reference.
+ */
+void printErrors(const std::vector<std::shared_ptr<PhysicallyBasedSceneObject>>& sceneObjects,
+                 const std::shared_ptr<EnvironmentMap>& environmentMap, const PrecomputationSettings& settings)
+{
+    PhysicallyBasedScene scene(sceneObjects, {}, environmentMap, PrecomputationMode::Blocking, nullptr, settings);
+    PrecomputationErrorEstimate estimate = scene.estimatePrecomputationError();
+
+    std::cout << "  Error against " << settings.referenceSampleCount << " samples: prefiltered levels";
+    for (double error : estimate.prefilteredEnvironmentMapErrors) {
+        std::cout << " " << error * 100.0 << "%";
+    }
+    std::cout << ", BRDF integration " << estimate.brdfIntegrationMapError * 100.0 << "%" << std::endl;
+}
+
+/**
+ * @return The number of bytes per texel of one of the formats that the lighting maps are stored in
+ */
+unsigned int bytesPerTexel(unsigned int internalFormat)
+{
+    switch (internalFormat) {
+    case GL_RGBA16F: return 8;
+    case GL_RGB16F: return 6;
+    case GL_RGB8: return 3;
+    default: return 4;
+    }
+}
+
+/**
+ * Works out how much memory the maps baked for the objects take up: the
+ * irradiance map, and a prefiltered environment map and BRDF integration map
+ * for each of the objects' BRDFs.
+ *
+ * @return The size in bytes
+ */
+size_t lightingMapBytes(const PrecomputationSettings& settings, size_t brdfCount)
+{
+    size_t irradianceBytes = (size_t) 6 * settings.irradianceMapFaceSize * settings.irradianceMapFaceSize
+                             * bytesPerTexel(settings.lightingMapFormat());
+
+    size_t prefilterBytes = 0;
+    for (unsigned int level = 0; level < settings.prefilterMipmapLevels; level++) {
+        size_t faceSize = std::max(settings.prefilterFaceSize >> level, 1u);
+        prefilterBytes += 6 * faceSize * faceSize * bytesPerTexel(settings.lightingMapFormat());
+    }
+
+    size_t brdfIntegrationBytes = (size_t) settings.brdfIntegrationMapSize * settings.brdfIntegrationMapSize
+                                  * bytesPerTexel(settings.brdfIntegrationMapFormat());
+
+    return irradianceBytes + brdfCount * (prefilterBytes + brdfIntegrationBytes);
+}
+
+/**
+ * Compares the compact formats with full precision: how much memory the maps
+ * take, and how far each is from the full-precision reference.
+ */
+void compareFormats(const std::vector<std::shared_ptr<PhysicallyBasedSceneObject>>& sceneObjects,
+                    const std::shared_ptr<EnvironmentMap>& environmentMap, PrecomputationSettings settings)
+{
+    for (bool compact : {false, true}) {
+        settings.compactLightingMaps = compact;
+        std::cout << "  " << (compact ? "R11F_G11F_B10F" : "RGB16F") << " lighting maps, "
+                  << lightingMapBytes(settings, sceneObjects.size()) / 1024 << " KiB:" << std::endl;
+        printErrors(sceneObjects, environmentMap, settings);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int runs = 5;
+    bool estimateErrors = false;
+    bool compareStorageFormats = false;
+    std::vector<std::pair<std::string, PrecomputationQuality>> presets{
+            {"Preview", PrecomputationQuality::Preview},
+            {"Interactive", PrecomputationQuality::Interactive},
+            {"Final", PrecomputationQuality::Final},
+    };
+    std::vector<std::pair<std::string, PrecomputationQuality>> chosenPresets;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(std::stoi(argv[++i]), 1);
+        }
+        else if (arg == "--errors") {
+            estimateErrors = true;
+        }
+        else if (arg == "--formats") {
+            compareStorageFormats = true;
+        }
+        else if (arg == "--quality" && i + 1 < argc) {
+            std::string name = argv[++i];
+            auto preset = std::find_if(presets.begin(), presets.end(),
+                                       [&name](const auto& preset) { return preset.first == name; });
+            if (preset == presets.end()) {
+                std::cerr << "Unknown quality " << name << ", expected Preview, Interactive or Final" << std::endl;
+                return 1;
+            }
+            chosenPresets.push_back(*preset);
+        }
+        else if (arg == "--help") {
+            std::cout << "Usage: TimeIBLBakes [--runs N] [--quality Preview|Interactive|Final ...] [--errors] [--formats]" << std::endl
+                      << "Times the prefiltered environment map and BRDF integration map bakes for a" << std::endl
+                      << "scene of four BRDFs, with and without compute shaders, at each quality." << std::endl
+                      << "With --errors, also compares the maps against a high-sample reference." << std::endl
+                      << "With --formats, also compares the memory use and error of the compact and" << std::endl
+                      << "full-precision storage formats." << std::endl;
+            return 0;
+        }
+    }
+
+    // The bakes need a context, so we make a window even though we never draw to it
+    Window window("Physically Based Renderer: Time IBL Bakes", 256, 256);
+
+    // Otherwise every scene after the first would reuse the maps rather than baking them
+    ResourceRegistry::setEnabled(false);
+    std::cout << "OpenGL " << glGetString(GL_VERSION) << ", " << glGetString(GL_RENDERER) << std::endl;
+
+    auto environmentMapsDir = fs::current_path() / "example" / "resources" / "environment_maps";
+    auto texturePath = environmentMapsDir / "Arches_E_PineTree" / "Arches_E_PineTree_3k.hdr";
+    auto sunDirection = PBRUtil::uvToCartesian(glm::vec2(0.583750f, 0.365000f));
+    DirectedLightSource sun{sunDirection, glm::vec3(254.0f / 255.0f, 241.0f / 255.0f, 224.0f / 255.0f), 1.2f};
+    std::shared_ptr<EnvironmentMap> environmentMap(new EnvironmentMap(texturePath, sun));
+    auto sceneObjects = makeObjects();
+
+    if (chosenPresets.empty()) {
+        chosenPresets = presets;
+    }
+
+    for (const auto& [name, quality] : chosenPresets) {
+        std::cout << name << ":" << std::endl;
+        PrecomputationSettings settings = PrecomputationSettings::forQuality(quality);
+        timeBakes(sceneObjects, environmentMap, settings, runs);
+        if (estimateErrors) {
+            printErrors(sceneObjects, environmentMap, settings);
+        }
+        if (compareStorageFormats) {
+            compareFormats(sceneObjects, environmentMap, settings);
+        }
+    }
+
+    return 0;
+}